@@ -285,6 +285,26 @@ OSMesaPostprocess(OSMesaContext osmesa, const char *filter,
                   unsigned enable_value);
 
 
+/**
+ * Start rendering all pending commands into the current context's image
+ * buffer, like glFlush, but return without waiting for the rendering or
+ * for the copy into the image buffer to complete.  OSMesaWaitFlush() must
+ * be called before the image buffer is read.
+ * New in Mesa 10.3
+ */
+GLAPI void GLAPIENTRY
+OSMesaFlushAsync(void);
+
+
+/**
+ * Wait until the image buffer holds the results of the last
+ * OSMesaFlushAsync() call for the current context.
+ * New in Mesa 10.3
+ */
+GLAPI void GLAPIENTRY
+OSMesaWaitFlush(void);
+
+
 #ifdef __cplusplus
 }
 #endif
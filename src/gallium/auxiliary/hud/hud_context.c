@@ -31,6 +31,10 @@
  *
  * The HUD is controlled with the GALLIUM_HUD environment variable.
  * Set GALLIUM_HUD=help for more info.
+ *
+ * The graph values can also be streamed to a file or socket with
+ * GALLIUM_HUD_DUMP, and GALLIUM_HUD_VISIBLE=false only updates the graphs
+ * without drawing anything.
  */
 
 #include <stdio.h>
@@ -58,6 +62,9 @@ struct hud_context {
 
    struct list_head pane_list;
 
+   boolean visible;
+   struct hud_export *exporter;
+
    /* states */
    struct pipe_blend_state alpha_blend;
    struct pipe_depth_stencil_alpha_state dsa;
@@ -405,6 +412,16 @@ hud_draw(struct hud_context *hud, struct pipe_resource *tex)
    struct hud_pane *pane;
    struct hud_graph *gr;
 
+   if (!hud->visible) {
+      /* only sample the graphs, for GALLIUM_HUD_DUMP */
+      LIST_FOR_EACH_ENTRY(pane, &hud->pane_list, head) {
+         LIST_FOR_EACH_ENTRY(gr, &pane->graph_list, head) {
+            gr->query_new_value(gr);
+         }
+      }
+      return;
+   }
+
    hud->fb_width = tex->width0;
    hud->fb_height = tex->height0;
    hud->constants.two_div_fb_width = 2.0f / hud->fb_width;
@@ -648,6 +665,9 @@ hud_graph_add_value(struct hud_graph *gr, uint64_t value)
    }
 
    gr->current_value = value;
+   if (gr->exporter) {
+      hud_export_value(gr->exporter, gr->export_index, value);
+   }
    if (value > gr->pane->max_value) {
       hud_pane_set_max_value(gr->pane, value);
    }
@@ -879,6 +899,12 @@ print_help(struct pipe_screen *screen)
    puts("");
    puts("  Example: GALLIUM_HUD=\"cpu,fps;primitives-generated\"");
    puts("");
+   puts("  GALLIUM_HUD_PERIOD=seconds sets the graph update rate.");
+   puts("  GALLIUM_HUD_DUMP=file or unix:socket-path streams the graph values");
+   puts("    as CSV (time_us,graph,value), or in a binary format if");
+   puts("    GALLIUM_HUD_DUMP_BINARY=true.");
+   puts("  GALLIUM_HUD_VISIBLE=false updates the graphs without drawing them.");
+   puts("");
    puts("  Available names:");
    puts("    fps");
    puts("    cpu");
@@ -925,6 +951,7 @@ hud_create(struct pipe_context *pipe, struct cso_context *cso)
    struct pipe_sampler_view view_templ;
    unsigned i;
    const char *env = debug_get_option("GALLIUM_HUD", NULL);
+   const char *dump;
 
    if (!env || !*env)
       return NULL;
@@ -1072,6 +1099,17 @@ hud_create(struct pipe_context *pipe, struct cso_context *cso)
    LIST_INITHEAD(&hud->pane_list);
 
    hud_parse_env_var(hud, env);
+
+   hud->visible = debug_get_bool_option("GALLIUM_HUD_VISIBLE", TRUE);
+
+   dump = debug_get_option("GALLIUM_HUD_DUMP", NULL);
+   if (dump && *dump) {
+      hud->exporter =
+         hud_export_create(dump,
+                           debug_get_bool_option("GALLIUM_HUD_DUMP_BINARY",
+                                                 FALSE),
+                           &hud->pane_list);
+   }
    return hud;
 }
 
@@ -1082,6 +1120,9 @@ hud_destroy(struct hud_context *hud)
    struct hud_pane *pane, *pane_tmp;
    struct hud_graph *graph, *graph_tmp;
 
+   if (hud->exporter)
+      hud_export_destroy(hud->exporter);
+
    LIST_FOR_EACH_ENTRY_SAFE(pane, pane_tmp, &hud->pane_list, head) {
       LIST_FOR_EACH_ENTRY_SAFE(graph, graph_tmp, &pane->graph_list, head) {
          LIST_DEL(&graph->head);
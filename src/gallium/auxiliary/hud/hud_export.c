@@ -0,0 +1,341 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* This file streams the values of the HUD graphs to a file or a local
+ * socket (GALLIUM_HUD_DUMP), so that they can be collected when nobody is
+ * looking at the screen.
+ *
+ * The values are queued in a ring buffer by the thread drawing the HUD and
+ * written by a separate thread, so the application only pays for the
+ * queries themselves. If the writer can't keep up, new values are dropped.
+ *
+ * The CSV format has a header line and then one line per value:
+ *
+ *    time_us,graph,value
+ *
+ * The binary format starts with a header:
+ *
+ *    char     magic[4] = "HUDX"
+ *    uint32_t version = 1
+ *    uint32_t num_graphs
+ *    num_graphs zero-terminated graph names
+ *
+ * followed by struct hud_export_record's, in the host byte order.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "hud/hud_private.h"
+#include "os/os_thread.h"
+#include "os/os_time.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#if defined(PIPE_OS_UNIX)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#define HUD_EXPORT_VERSION 1
+
+/* number of values the ring buffer can hold */
+#define HUD_EXPORT_RING_SIZE 4096
+
+/* wake up the writer when the ring is this full, or after this many
+ * microseconds */
+#define HUD_EXPORT_FLUSH_COUNT (HUD_EXPORT_RING_SIZE / 4)
+#define HUD_EXPORT_FLUSH_TIME (1000 * 1000)
+
+struct hud_export_record {
+   uint64_t time;  /* os_time_get() */
+   uint32_t graph; /* index of the graph name in the header */
+   uint32_t pad;
+   uint64_t value;
+};
+
+struct hud_export {
+   FILE *file;
+   boolean binary;
+   boolean failed;
+
+   const char **names;
+   unsigned num_names;
+
+   pipe_thread thread;
+   pipe_mutex mutex;
+   pipe_condvar new_values;
+   boolean quit;
+
+   /* Ring of values. head and tail are free-running counters, the records
+    * between tail and head are owned by the writer thread. */
+   struct hud_export_record ring[HUD_EXPORT_RING_SIZE];
+   unsigned head, tail;
+   unsigned num_dropped;
+   int64_t last_flush;
+};
+
+static void
+write_header(struct hud_export *exp)
+{
+   unsigned i;
+
+   if (exp->binary) {
+      uint32_t header[2] = {HUD_EXPORT_VERSION, exp->num_names};
+
+      fwrite("HUDX", 4, 1, exp->file);
+      fwrite(header, sizeof(header), 1, exp->file);
+      for (i = 0; i < exp->num_names; i++)
+         fwrite(exp->names[i], strlen(exp->names[i]) + 1, 1, exp->file);
+   }
+   else {
+      fprintf(exp->file, "time_us,graph,value\n");
+   }
+   fflush(exp->file);
+}
+
+static void
+write_records(struct hud_export *exp, unsigned start, unsigned end)
+{
+   unsigned i;
+
+   if (exp->binary) {
+      /* at most two contiguous pieces of the ring */
+      while (start != end) {
+         unsigned index = start % HUD_EXPORT_RING_SIZE;
+         unsigned n = MIN2(end - start, HUD_EXPORT_RING_SIZE - index);
+
+         fwrite(&exp->ring[index], sizeof(exp->ring[0]), n, exp->file);
+         start += n;
+      }
+   }
+   else {
+      for (i = start; i != end; i++) {
+         const struct hud_export_record *rec =
+            &exp->ring[i % HUD_EXPORT_RING_SIZE];
+
+         fprintf(exp->file, "%llu,%s,%llu\n", (unsigned long long)rec->time,
+                 exp->names[rec->graph], (unsigned long long)rec->value);
+      }
+   }
+
+   if (fflush(exp->file) != 0 || ferror(exp->file)) {
+      fprintf(stderr, "gallium_hud: can't write the graph values, "
+              "giving up\n");
+      exp->failed = TRUE;
+   }
+}
+
+static PIPE_THREAD_ROUTINE(hud_export_thread, param)
+{
+   struct hud_export *exp = param;
+
+   pipe_mutex_lock(exp->mutex);
+   while (1) {
+      unsigned start, end;
+
+      while (exp->head == exp->tail && !exp->quit)
+         pipe_condvar_wait(exp->new_values, exp->mutex);
+
+      if (exp->head == exp->tail)
+         break;
+
+      start = exp->tail;
+      end = exp->head;
+
+      /* The producer never touches the records we are writing, so they
+       * can be written without holding the lock. */
+      pipe_mutex_unlock(exp->mutex);
+      if (!exp->failed)
+         write_records(exp, start, end);
+      pipe_mutex_lock(exp->mutex);
+
+      exp->tail = end;
+   }
+   pipe_mutex_unlock(exp->mutex);
+   return 0;
+}
+
+/**
+ * Queue a new value of a graph.
+ */
+void
+hud_export_value(struct hud_export *exp, unsigned graph, uint64_t value)
+{
+   int64_t now = os_time_get();
+   struct hud_export_record *rec;
+
+   pipe_mutex_lock(exp->mutex);
+   if (exp->head - exp->tail == HUD_EXPORT_RING_SIZE) {
+      exp->num_dropped++;
+   }
+   else {
+      rec = &exp->ring[exp->head % HUD_EXPORT_RING_SIZE];
+      rec->time = now;
+      rec->graph = graph;
+      rec->pad = 0;
+      rec->value = value;
+      exp->head++;
+
+      if (exp->head - exp->tail >= HUD_EXPORT_FLUSH_COUNT ||
+          now - exp->last_flush >= HUD_EXPORT_FLUSH_TIME) {
+         exp->last_flush = now;
+         pipe_condvar_signal(exp->new_values);
+      }
+   }
+   pipe_mutex_unlock(exp->mutex);
+}
+
+static FILE *
+open_destination(const char *dest)
+{
+   if (strncmp(dest, "unix:", 5) == 0) {
+#if defined(PIPE_OS_UNIX)
+      struct sockaddr_un addr;
+      FILE *file;
+      int fd;
+
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      strncpy(addr.sun_path, dest + 5, sizeof(addr.sun_path) - 1);
+
+      fd = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (fd < 0)
+         return NULL;
+
+      if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+         close(fd);
+         return NULL;
+      }
+
+      file = fdopen(fd, "w");
+      if (!file)
+         close(fd);
+      return file;
+#else
+      return NULL;
+#endif
+   }
+
+   return fopen(dest, "w");
+}
+
+/**
+ * Start streaming the values of all graphs to \p dest, which is either a
+ * file name or "unix:" followed by the path of a local socket.
+ */
+struct hud_export *
+hud_export_create(const char *dest, boolean binary,
+                  struct list_head *pane_list)
+{
+   struct hud_export *exp;
+   struct hud_pane *pane;
+   struct hud_graph *gr;
+   unsigned num_graphs = 0;
+
+   LIST_FOR_EACH_ENTRY(pane, pane_list, head) {
+      num_graphs += pane->num_graphs;
+   }
+
+   exp = CALLOC_STRUCT(hud_export);
+   if (!exp)
+      return NULL;
+
+   exp->names = CALLOC(num_graphs, sizeof(exp->names[0]));
+   if (num_graphs && !exp->names) {
+      FREE(exp);
+      return NULL;
+   }
+
+   exp->file = open_destination(dest);
+   if (!exp->file) {
+      fprintf(stderr, "gallium_hud: can't open '%s' to dump the graphs\n",
+              dest);
+      FREE(exp->names);
+      FREE(exp);
+      return NULL;
+   }
+
+   exp->binary = binary;
+
+   LIST_FOR_EACH_ENTRY(pane, pane_list, head) {
+      LIST_FOR_EACH_ENTRY(gr, &pane->graph_list, head) {
+         gr->exporter = exp;
+         gr->export_index = exp->num_names;
+         exp->names[exp->num_names++] = gr->name;
+      }
+   }
+
+   write_header(exp);
+
+   pipe_mutex_init(exp->mutex);
+   pipe_condvar_init(exp->new_values);
+   exp->last_flush = os_time_get();
+
+   /* The thread blocks all signals, so a reader closing the socket
+    * doesn't kill the application with SIGPIPE. */
+   exp->thread = pipe_thread_create(hud_export_thread, exp);
+   if (!exp->thread) {
+      LIST_FOR_EACH_ENTRY(pane, pane_list, head) {
+         LIST_FOR_EACH_ENTRY(gr, &pane->graph_list, head) {
+            gr->exporter = NULL;
+         }
+      }
+      fclose(exp->file);
+      pipe_condvar_destroy(exp->new_values);
+      pipe_mutex_destroy(exp->mutex);
+      FREE(exp->names);
+      FREE(exp);
+      return NULL;
+   }
+   return exp;
+}
+
+/**
+ * Write the values still queued and close the destination.
+ */
+void
+hud_export_destroy(struct hud_export *exp)
+{
+   pipe_mutex_lock(exp->mutex);
+   exp->quit = TRUE;
+   pipe_condvar_signal(exp->new_values);
+   pipe_mutex_unlock(exp->mutex);
+
+   pipe_thread_wait(exp->thread);
+
+   if (exp->num_dropped)
+      fprintf(stderr, "gallium_hud: %u graph values were dropped because "
+              "they couldn't be written fast enough\n", exp->num_dropped);
+
+   fclose(exp->file);
+   pipe_condvar_destroy(exp->new_values);
+   pipe_mutex_destroy(exp->mutex);
+   FREE(exp->names);
+   FREE(exp);
+}
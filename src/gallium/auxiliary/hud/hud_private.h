@@ -31,6 +31,8 @@
 #include "pipe/p_context.h"
 #include "util/u_double_list.h"
 
+struct hud_export;
+
 struct hud_graph {
    /* initialized by common code */
    struct list_head head;
@@ -44,6 +46,10 @@ struct hud_graph {
    void (*query_new_value)(struct hud_graph *gr);
    void (*free_query_data)(void *ptr); /**< do not use ordinary free() */
 
+   /* GALLIUM_HUD_DUMP, if enabled */
+   struct hud_export *exporter;
+   unsigned export_index;
+
    /* mutable variables */
    unsigned num_vertices;
    unsigned index; /* vertex index being updated */
@@ -75,6 +81,12 @@ void hud_pane_add_graph(struct hud_pane *pane, struct hud_graph *gr);
 void hud_pane_set_max_value(struct hud_pane *pane, uint64_t value);
 void hud_graph_add_value(struct hud_graph *gr, uint64_t value);
 
+/* dumping the graph values */
+struct hud_export *hud_export_create(const char *dest, boolean binary,
+                                     struct list_head *pane_list);
+void hud_export_destroy(struct hud_export *exp);
+void hud_export_value(struct hud_export *exp, unsigned graph, uint64_t value);
+
 /* graphs/queries */
 #define ALL_CPUS ~0 /* optionally set as cpu_index */
 
@@ -39,6 +39,12 @@ struct pp_program;
 typedef void (*pp_func) (struct pp_queue_t *, struct pipe_resource *,
                          struct pipe_resource *, unsigned int);
 
+/* Per-pixel color filters, which can be folded into a single pass */
+#define PP_FUSE_NORED      (1 << 0)
+#define PP_FUSE_NOGREEN    (1 << 1)
+#define PP_FUSE_NOBLUE     (1 << 2)
+#define PP_FUSE_CELSHADE   (1 << 3)
+
 /* Main functions */
 
 /**
@@ -79,6 +85,8 @@ bool pp_jimenezmlaa_init(struct pp_queue_t *, unsigned int, unsigned int);
 bool pp_jimenezmlaa_init_color(struct pp_queue_t *, unsigned int,
                                unsigned int);
 
+bool pp_fused_init(struct pp_queue_t *, unsigned int, unsigned int);
+
 /* The filter free functions */
 
 void pp_celshade_free(struct pp_queue_t *, unsigned int);
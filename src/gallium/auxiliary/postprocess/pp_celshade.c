@@ -30,6 +30,14 @@
 #include "postprocess/pp_filters.h"
 #include "postprocess/pp_private.h"
 
+static const char celshade[] =
+   CELSHADE_DECLS
+   CELSHADE_LUMA_IMM
+   CELSHADE_IMMS
+   CELSHADE_BODY
+   " 36: MUL OUT[0], TEMP[0], TEMP[1].xxxx\n"
+   " 37: END\n";
+
 /** Init function */
 bool
 pp_celshade_init(struct pp_queue_t *ppq, unsigned int n, unsigned int val)
@@ -26,10 +26,15 @@
  **************************************************************************/
 
 #include "postprocess/postprocess.h"
+#include "postprocess/pp_celshade.h"
 #include "postprocess/pp_colors.h"
 #include "postprocess/pp_filters.h"
 #include "postprocess/pp_private.h"
 
+#include "util/u_string.h"
+
+#define IMM_SPACE 80
+
 /** The run function of the color filters */
 void
 pp_nocolor(struct pp_queue_t *ppq, struct pipe_resource *in,
@@ -87,6 +92,62 @@ pp_noblue_init(struct pp_queue_t *ppq, unsigned int n, unsigned int val)
    return (ppq->shaders[n][1] != NULL) ? TRUE : FALSE;
 }
 
+
+/**
+ * Init function for several color filters run as one pass. fuse is a mask
+ * of the PP_FUSE_* flags of the enabled filters.
+ *
+ * The channel filters zero channels of the sampled color, and celshade only
+ * looks at the luminance of its input, so running them in order is the same
+ * as masking the luminance weights and the final color.
+ */
+bool
+pp_fused_init(struct pp_queue_t *ppq, unsigned int n, unsigned int fuse)
+{
+   static const float luma[3] = { 0.2126f, 0.7152f, 0.0722f };
+   char text[sizeof(CELSHADE_DECLS CELSHADE_IMMS CELSHADE_BODY) +
+             3 * IMM_SPACE];
+   float mask[3];
+   unsigned int i;
+
+   mask[0] = (fuse & PP_FUSE_NORED) ? 0.0f : 1.0f;
+   mask[1] = (fuse & PP_FUSE_NOGREEN) ? 0.0f : 1.0f;
+   mask[2] = (fuse & PP_FUSE_NOBLUE) ? 0.0f : 1.0f;
+
+   if (fuse & PP_FUSE_CELSHADE) {
+      float weights[3];
+
+      for (i = 0; i < 3; i++)
+         weights[i] = luma[i] * mask[i];
+
+      util_snprintf(text, sizeof(text), "%s"
+                    "IMM FLT32 { %.4f, %.4f, %.4f, 4.0000}\n"
+                    "%s"
+                    "IMM FLT32 { %.4f, %.4f, %.4f, 1.0000}\n"
+                    "%s"
+                    " 36: MUL TEMP[0], TEMP[0], TEMP[1].xxxx\n"
+                    " 37: MUL OUT[0], TEMP[0], IMM[3]\n"
+                    " 38: END\n",
+                    CELSHADE_DECLS, weights[0], weights[1], weights[2],
+                    CELSHADE_IMMS, mask[0], mask[1], mask[2],
+                    CELSHADE_BODY);
+   } else {
+      util_snprintf(text, sizeof(text), "%s"
+                    "IMM FLT32 { %.4f, %.4f, %.4f, 1.0000}\n"
+                    "  0: TEX TEMP[0], IN[0].xyyy, SAMP[0], 2D\n"
+                    "  1: MUL OUT[0], TEMP[0], IMM[0]\n"
+                    "  2: END\n",
+                    CELSHADE_DECLS, mask[0], mask[1], mask[2]);
+   }
+
+   pp_debug("Folding color filters 0x%x into one pass\n", fuse);
+
+   ppq->shaders[n][1] =
+      pp_tgsi_to_state(ppq->p->pipe, text, false, "fused colors");
+
+   return (ppq->shaders[n][1] != NULL) ? TRUE : FALSE;
+}
+
 /* Free functions */
 void
 pp_nocolor_free(struct pp_queue_t *ppq, unsigned int n)
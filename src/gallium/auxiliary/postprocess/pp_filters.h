@@ -46,6 +46,8 @@
 void pp_filter_setup_in(struct pp_program *, struct pipe_resource *);
 void pp_filter_setup_out(struct pp_program *, struct pipe_resource *);
 void pp_filter_end_pass(struct pp_program *);
+struct pipe_sampler_view *pp_get_sampler_view(struct pp_program *,
+                                              struct pipe_resource *);
 void *pp_tgsi_to_state(struct pipe_context *, const char *, bool,
                        const char *);
 void pp_filter_misc_state(struct pp_program *);
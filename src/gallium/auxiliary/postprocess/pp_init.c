@@ -42,20 +42,32 @@ struct pp_queue_t *
 pp_init(struct pipe_context *pipe, const unsigned int *enabled,
         struct cso_context *cso)
 {
-   unsigned int num_filters = 0;
+   unsigned int num_filters = 0, num_fused = 0, fuse = 0;
    unsigned int curpos = 0, i, tmp_req = 0;
    struct pp_queue_t *ppq;
+   bool fused = false;
 
    pp_debug("Initializing the post-processing queue.\n");
 
    /* How many filters were requested? */
    for (i = 0; i < PP_FILTERS; i++) {
-      if (enabled[i])
+      if (enabled[i]) {
          num_filters++;
+         if (pp_filters[i].fuse) {
+            num_fused++;
+            fuse |= pp_filters[i].fuse;
+         }
+      }
    }
    if (num_filters == 0)
       return NULL;
 
+   /* Several per-pixel color filters take a single pass. */
+   if (num_fused > 1)
+      num_filters -= num_fused - 1;
+   else
+      fuse = 0;
+
    ppq = CALLOC(1, sizeof(struct pp_queue_t));
 
    if (ppq == NULL) {
@@ -88,6 +100,14 @@ pp_init(struct pipe_context *pipe, const unsigned int *enabled,
    curpos = 0;
    for (i = 0; i < PP_FILTERS; i++) {
       if (enabled[i]) {
+         bool fuse_here = fuse && pp_filters[i].fuse;
+         bool ok;
+
+         /* The first fusable filter stands in for all of them. */
+         if (fuse_here && fused)
+            continue;
+         fused = fused || fuse_here;
+
          ppq->pp_queue[curpos] = pp_filters[i].main;
          tmp_req = MAX2(tmp_req, pp_filters[i].inner_tmps);
          ppq->filters[curpos] = i;
@@ -102,7 +122,11 @@ pp_init(struct pipe_context *pipe, const unsigned int *enabled,
          }
 
          /* Call the initialization function for the filter. */
-         if (!pp_filters[i].init(ppq, curpos, enabled[i])) {
+         if (fuse_here)
+            ok = pp_fused_init(ppq, curpos, fuse);
+         else
+            ok = pp_filters[i].init(ppq, curpos, enabled[i]);
+         if (!ok) {
             pp_debug("Initialization for filter %u failed.\n", i);
             goto error;
          }           
@@ -144,6 +168,9 @@ pp_free_fbos(struct pp_queue_t *ppq)
 
    unsigned int i;
 
+   if (ppq->p)
+      pp_flush_view_cache(ppq->p);
+
    if (!ppq->fbos_init)
       return;
 
@@ -46,7 +46,6 @@
 #include "postprocess/pp_private.h"
 
 #include "util/u_box.h"
-#include "util/u_sampler.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_string.h"
@@ -80,7 +79,7 @@ pp_jimenezmlaa_run(struct pp_queue_t *ppq, struct pipe_resource *in,
    struct pp_program *p = ppq->p;
 
    struct pipe_depth_stencil_alpha_state mstencil;
-   struct pipe_sampler_view v_tmp, *arr[3];
+   struct pipe_sampler_view *arr[3];
 
    unsigned int w = 0;
    unsigned int h = 0;
@@ -161,10 +160,7 @@ pp_jimenezmlaa_run(struct pp_queue_t *ppq, struct pipe_resource *in,
    pp_filter_setup_in(p, ppq->areamaptex);
    pp_filter_setup_out(p, ppq->inner_tmp[1]);
 
-   u_sampler_view_default_template(&v_tmp, ppq->inner_tmp[0],
-                                   ppq->inner_tmp[0]->format);
-   arr[1] = arr[2] = p->pipe->create_sampler_view(p->pipe,
-                                                  ppq->inner_tmp[0], &v_tmp);
+   arr[1] = arr[2] = pp_get_sampler_view(p, ppq->inner_tmp[0]);
 
    pp_filter_set_clear_fb(p);
 
@@ -196,8 +192,7 @@ pp_jimenezmlaa_run(struct pp_queue_t *ppq, struct pipe_resource *in,
            w, h, 0, p->framebuffer.cbufs[0],
            0, 0, w, h);
 
-   u_sampler_view_default_template(&v_tmp, in, in->format);
-   arr[0] = p->pipe->create_sampler_view(p->pipe, in, &v_tmp);
+   arr[0] = pp_get_sampler_view(p, in);
 
    cso_single_sampler(p->cso, PIPE_SHADER_FRAGMENT, 0, &p->sampler_point);
    cso_single_sampler(p->cso, PIPE_SHADER_FRAGMENT, 1, &p->sampler_point);
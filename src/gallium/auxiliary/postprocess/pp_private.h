@@ -32,6 +32,20 @@
 #include "postprocess.h"
 
 
+#define PP_MAX_CACHED_VIEWS 8
+
+/**
+ * Surface and sampler view of a resource the filters used.
+ */
+struct pp_cached_view
+{
+   struct pipe_resource *res;
+   struct pipe_surface *surf;
+   struct pipe_sampler_view *view;
+   unsigned int last_use;
+};
+
+
 /**
  * Internal control details.
  */
@@ -57,6 +71,11 @@ struct pp_program
    struct pipe_resource *vbuf;
    struct pipe_surface surf;
    struct pipe_sampler_view *view;
+
+   /* Views of the resources used by the last frames, so that they aren't
+    * created again for every pass. */
+   struct pp_cached_view cache[PP_MAX_CACHED_VIEWS];
+   unsigned int cache_stamp;
 };
 
 
@@ -91,6 +110,8 @@ struct pp_queue_t
 
 void pp_free_fbos(struct pp_queue_t *);
 
+void pp_flush_view_cache(struct pp_program *);
+
 void pp_debug(const char *, ...);
 
 struct pp_program *pp_init_prog(struct pp_queue_t *, struct pipe_context *pipe,
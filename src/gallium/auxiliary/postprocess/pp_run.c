@@ -208,6 +208,91 @@ pp_run(struct pp_queue_t *ppq, struct pipe_resource *in,
 }
 
 
+/** Release the views of a cache entry. */
+static void
+pp_release_cached_view(struct pp_cached_view *entry)
+{
+   pipe_surface_reference(&entry->surf, NULL);
+   pipe_sampler_view_reference(&entry->view, NULL);
+   pipe_resource_reference(&entry->res, NULL);
+   entry->last_use = 0;
+}
+
+/** Drop all cached views. Called when the temp buffers are freed. */
+void
+pp_flush_view_cache(struct pp_program *p)
+{
+   unsigned int i;
+
+   for (i = 0; i < PP_MAX_CACHED_VIEWS; i++)
+      pp_release_cached_view(&p->cache[i]);
+}
+
+/**
+ * Find the cache entry of a resource, reusing the least recently used one
+ * if it isn't cached yet.
+ */
+static struct pp_cached_view *
+pp_lookup_cached_view(struct pp_program *p, struct pipe_resource *res)
+{
+   struct pp_cached_view *entry = &p->cache[0];
+   unsigned int i;
+
+   for (i = 0; i < PP_MAX_CACHED_VIEWS; i++) {
+      if (p->cache[i].res == res) {
+         entry = &p->cache[i];
+         entry->last_use = ++p->cache_stamp;
+         return entry;
+      }
+
+      if (p->cache[i].last_use < entry->last_use)
+         entry = &p->cache[i];
+   }
+
+   pp_release_cached_view(entry);
+   pipe_resource_reference(&entry->res, res);
+   entry->last_use = ++p->cache_stamp;
+   return entry;
+}
+
+/**
+ * Return a reference to a sampler view of the resource, which the caller
+ * must release.
+ */
+struct pipe_sampler_view *
+pp_get_sampler_view(struct pp_program *p, struct pipe_resource *res)
+{
+   struct pp_cached_view *entry = pp_lookup_cached_view(p, res);
+   struct pipe_sampler_view *view = NULL;
+
+   if (!entry->view) {
+      struct pipe_sampler_view v_tmp;
+
+      u_sampler_view_default_template(&v_tmp, res, res->format);
+      entry->view = p->pipe->create_sampler_view(p->pipe, res, &v_tmp);
+   }
+
+   pipe_sampler_view_reference(&view, entry->view);
+   return view;
+}
+
+/** Like pp_get_sampler_view, for a surface to render to. */
+static struct pipe_surface *
+pp_get_surface(struct pp_program *p, struct pipe_resource *res)
+{
+   struct pp_cached_view *entry = pp_lookup_cached_view(p, res);
+   struct pipe_surface *surf = NULL;
+
+   if (!entry->surf) {
+      p->surf.format = res->format;
+      entry->surf = p->pipe->create_surface(p->pipe, res, &p->surf);
+   }
+
+   pipe_surface_reference(&surf, entry->surf);
+   return surf;
+}
+
+
 /* Utility functions for the filters. You're not forced to use these if */
 /* your filter is more complicated. */
 
@@ -215,18 +300,14 @@ pp_run(struct pp_queue_t *ppq, struct pipe_resource *in,
 void
 pp_filter_setup_in(struct pp_program *p, struct pipe_resource *in)
 {
-   struct pipe_sampler_view v_tmp;
-   u_sampler_view_default_template(&v_tmp, in, in->format);
-   p->view = p->pipe->create_sampler_view(p->pipe, in, &v_tmp);
+   p->view = pp_get_sampler_view(p, in);
 }
 
 /** Setup this resource as the filter output. */
 void
 pp_filter_setup_out(struct pp_program *p, struct pipe_resource *out)
 {
-   p->surf.format = out->format;
-
-   p->framebuffer.cbufs[0] = p->pipe->create_surface(p->pipe, out, &p->surf);
+   p->framebuffer.cbufs[0] = pp_get_surface(p, out);
 }
 
 /** Clean up the input and output set with the above. */
@@ -0,0 +1,884 @@
+/*
+ * Copyright (C) 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Included by Mesa's texcompress_s3tc.c and by u_format_s3tc.c to define
+ * the DXT1, DXT3 and DXT5 decoders and encoder.
+ *
+ * This replaces libtxc_dxtn.  The fetch functions have the same names and
+ * signatures as the ones in that library:
+ *
+ *    fetch_2d_texel_rgb_dxt1(), fetch_2d_texel_rgba_dxt1(),
+ *    fetch_2d_texel_rgba_dxt3(), fetch_2d_texel_rgba_dxt5()
+ *       decode one texel of an image which is srcRowStride texels wide.
+ *
+ * dxtn_compress() is like libtxc_dxtn's tx_compress_dxtn(), with an
+ * explicit source row stride and quality.  Images with enough blocks are
+ * compressed with several threads, each one doing a band of block rows.
+ *
+ * The quality/speed trade-off defaults to DXTN_QUALITY_NORMAL and can be
+ * changed with the MESA_DXTN_QUALITY environment variable (0 = fast,
+ * 1 = normal, 2 = best).
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "u_parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define DXTN_RGB_DXT1   0x83F0
+#define DXTN_RGBA_DXT1  0x83F1
+#define DXTN_RGBA_DXT3  0x83F2
+#define DXTN_RGBA_DXT5  0x83F3
+
+/** Bounding box endpoints, no refinement */
+#define DXTN_QUALITY_FAST    0
+/** Principal axis endpoints, one least squares refinement pass */
+#define DXTN_QUALITY_NORMAL  1
+/** Like normal, with up to four refinement passes */
+#define DXTN_QUALITY_BEST    2
+
+/** Don't bother with a thread for less than this many blocks */
+#define DXTN_MIN_BLOCKS_PER_THREAD 1024
+
+
+/*
+ * Decoding
+ */
+
+static void
+dxtn_decode_565(unsigned c, unsigned char rgb[3])
+{
+   rgb[0] = ((c >> 8) & 0xf8) | ((c >> 13) & 0x7);
+   rgb[1] = ((c >> 3) & 0xfc) | ((c >> 9) & 0x3);
+   rgb[2] = ((c << 3) & 0xf8) | ((c >> 2) & 0x7);
+}
+
+
+/**
+ * Compute the four colors of a color block, as the hardware does.
+ * DXT3 and DXT5 always use the four color mode.
+ */
+static void
+dxtn_color_palette(unsigned c0, unsigned c1, int dxt1,
+                   unsigned char palette[4][4])
+{
+   unsigned k;
+
+   dxtn_decode_565(c0, palette[0]);
+   dxtn_decode_565(c1, palette[1]);
+   palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+   if (c0 > c1 || !dxt1) {
+      for (k = 0; k < 3; k++) {
+         palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+         palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+      }
+   }
+   else {
+      for (k = 0; k < 3; k++) {
+         palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+         palette[3][k] = 0;
+      }
+      palette[3][3] = 0;
+   }
+}
+
+
+static void
+dxtn_fetch_color(const unsigned char *blk, int i, int j, int dxt1,
+                 unsigned char *rgba)
+{
+   const unsigned c0 = blk[0] | (blk[1] << 8);
+   const unsigned c1 = blk[2] | (blk[3] << 8);
+   const unsigned code = (blk[4 + (j & 3)] >> (2 * (i & 3))) & 0x3;
+   unsigned char palette[4][4];
+
+   dxtn_color_palette(c0, c1, dxt1, palette);
+   memcpy(rgba, palette[code], 4);
+}
+
+
+static unsigned
+dxtn_fetch_alpha(const unsigned char *blk, int i, int j)
+{
+   const unsigned alpha0 = blk[0];
+   const unsigned alpha1 = blk[1];
+   const unsigned bit_pos = ((j & 3) * 4 + (i & 3)) * 3;
+   const unsigned acodelow = blk[2 + bit_pos / 8];
+   const unsigned acodehigh = (3 + bit_pos / 8) < 8 ? blk[3 + bit_pos / 8] : 0;
+   const unsigned code = (acodelow >> (bit_pos & 0x7) |
+                          (acodehigh << (8 - (bit_pos & 0x7)))) & 0x7;
+
+   if (code == 0)
+      return alpha0;
+   else if (code == 1)
+      return alpha1;
+   else if (alpha0 > alpha1)
+      return (alpha0 * (8 - code) + alpha1 * (code - 1)) / 7;
+   else if (code < 6)
+      return (alpha0 * (6 - code) + alpha1 * (code - 1)) / 5;
+   else if (code == 6)
+      return 0;
+   else
+      return 255;
+}
+
+
+static const unsigned char *
+dxtn_block_address(int srcRowStride, const unsigned char *pixdata,
+                   int i, int j, unsigned blockSize)
+{
+   return pixdata + ((srcRowStride + 3) / 4 * (j / 4) + (i / 4)) * blockSize;
+}
+
+
+static void
+fetch_2d_texel_rgb_dxt1(int srcRowStride, const unsigned char *pixdata,
+                        int i, int j, void *texel)
+{
+   unsigned char *rgba = (unsigned char *) texel;
+
+   dxtn_fetch_color(dxtn_block_address(srcRowStride, pixdata, i, j, 8),
+                    i, j, 1, rgba);
+   rgba[3] = 255;
+}
+
+
+static void
+fetch_2d_texel_rgba_dxt1(int srcRowStride, const unsigned char *pixdata,
+                         int i, int j, void *texel)
+{
+   dxtn_fetch_color(dxtn_block_address(srcRowStride, pixdata, i, j, 8),
+                    i, j, 1, (unsigned char *) texel);
+}
+
+
+static void
+fetch_2d_texel_rgba_dxt3(int srcRowStride, const unsigned char *pixdata,
+                         int i, int j, void *texel)
+{
+   const unsigned char *blk =
+      dxtn_block_address(srcRowStride, pixdata, i, j, 16);
+   unsigned char *rgba = (unsigned char *) texel;
+   const unsigned anibble =
+      (blk[(j & 3) * 2 + ((i & 3) >> 1)] >> (4 * (i & 1))) & 0xf;
+
+   dxtn_fetch_color(blk + 8, i, j, 0, rgba);
+   rgba[3] = anibble | (anibble << 4);
+}
+
+
+static void
+fetch_2d_texel_rgba_dxt5(int srcRowStride, const unsigned char *pixdata,
+                         int i, int j, void *texel)
+{
+   const unsigned char *blk =
+      dxtn_block_address(srcRowStride, pixdata, i, j, 16);
+   unsigned char *rgba = (unsigned char *) texel;
+
+   dxtn_fetch_color(blk + 8, i, j, 0, rgba);
+   rgba[3] = dxtn_fetch_alpha(blk, i, j);
+}
+
+
+/*
+ * Encoding
+ */
+
+static int
+dxtn_default_quality(void)
+{
+   static int quality = -1;
+
+   if (quality < 0) {
+      const char *env = getenv("MESA_DXTN_QUALITY");
+      int q = env ? atoi(env) : DXTN_QUALITY_NORMAL;
+
+      if (q < DXTN_QUALITY_FAST)
+         q = DXTN_QUALITY_FAST;
+      if (q > DXTN_QUALITY_BEST)
+         q = DXTN_QUALITY_BEST;
+      quality = q;
+   }
+
+   return quality;
+}
+
+
+static unsigned
+dxtn_quantize_565(const float rgb[3])
+{
+   unsigned q[3];
+   unsigned k;
+
+   for (k = 0; k < 3; k++) {
+      const unsigned max = k == 1 ? 63 : 31;
+      const float v = rgb[k] < 0.0F ? 0.0F : rgb[k] > 255.0F ? 255.0F : rgb[k];
+      q[k] = (unsigned) (v * max / 255.0F + 0.5F);
+   }
+
+   return (q[0] << 11) | (q[1] << 5) | q[2];
+}
+
+
+#ifndef __SSE2__
+/**
+ * Pick the closest of the first numColors palette entries for each pixel
+ * of the block.  Pixels with mask bit clear are not considered and get
+ * index 3.
+ *
+ * \return sum of the squared errors
+ */
+static unsigned
+dxtn_pick_indices_c(const unsigned char px[16][4], unsigned mask,
+                    const unsigned char palette[4][4], unsigned numColors,
+                    unsigned char indices[16])
+{
+   unsigned total = 0;
+   unsigned i, c;
+
+   for (i = 0; i < 16; i++) {
+      unsigned best = ~0u, bestIndex = 0;
+
+      if (!(mask & (1 << i))) {
+         indices[i] = 3;
+         continue;
+      }
+
+      for (c = 0; c < numColors; c++) {
+         const int dr = px[i][0] - palette[c][0];
+         const int dg = px[i][1] - palette[c][1];
+         const int db = px[i][2] - palette[c][2];
+         const unsigned d = dr * dr + dg * dg + db * db;
+         if (d < best) {
+            best = d;
+            bestIndex = c;
+         }
+      }
+
+      indices[i] = bestIndex;
+      total += best;
+   }
+
+   return total;
+}
+#endif
+
+
+#ifdef __SSE2__
+/**
+ * SSE2 version of dxtn_pick_indices_c(), which gives the same results.
+ * Four pixels are handled at a time, with 32-bit distances.
+ */
+static unsigned
+dxtn_pick_indices_sse2(const unsigned char px[16][4], unsigned mask,
+                       const unsigned char palette[4][4], unsigned numColors,
+                       unsigned char indices[16])
+{
+   const __m128i zero = _mm_setzero_si128();
+   const __m128i rgbmask = _mm_set1_epi32(0x00ffffff);
+   __m128i pal[4];
+   unsigned total = 0;
+   unsigned i, c;
+
+   for (c = 0; c < numColors; c++) {
+      int p;
+      memcpy(&p, palette[c], 4);
+      pal[c] = _mm_unpacklo_epi8(_mm_and_si128(_mm_set1_epi32(p), rgbmask),
+                                 zero);
+   }
+
+   for (i = 0; i < 16; i += 4) {
+      const __m128i pixels =
+         _mm_and_si128(_mm_loadu_si128((const __m128i *) px[i]), rgbmask);
+      /* 16-bit components of pixels i, i+1 and i+2, i+3 */
+      const __m128i lo = _mm_unpacklo_epi8(pixels, zero);
+      const __m128i hi = _mm_unpackhi_epi8(pixels, zero);
+      __m128i best = _mm_set1_epi32(0x7fffffff);
+      __m128i bestIndex = zero;
+      union {
+         __m128i v;
+         unsigned u[4];
+      } d, idx;
+      unsigned k;
+
+      for (c = 0; c < numColors; c++) {
+         const __m128i dlo = _mm_sub_epi16(lo, pal[c]);
+         const __m128i dhi = _mm_sub_epi16(hi, pal[c]);
+         /* (dr^2 + dg^2, db^2) for each pixel */
+         const __m128i slo = _mm_madd_epi16(dlo, dlo);
+         const __m128i shi = _mm_madd_epi16(dhi, dhi);
+         const __m128i even = _mm_castps_si128(
+            _mm_shuffle_ps(_mm_castsi128_ps(slo), _mm_castsi128_ps(shi),
+                           _MM_SHUFFLE(2, 0, 2, 0)));
+         const __m128i odd = _mm_castps_si128(
+            _mm_shuffle_ps(_mm_castsi128_ps(slo), _mm_castsi128_ps(shi),
+                           _MM_SHUFFLE(3, 1, 3, 1)));
+         const __m128i dist = _mm_add_epi32(even, odd);
+         const __m128i closer = _mm_cmplt_epi32(dist, best);
+
+         best = _mm_or_si128(_mm_and_si128(closer, dist),
+                             _mm_andnot_si128(closer, best));
+         bestIndex = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(c)),
+                                  _mm_andnot_si128(closer, bestIndex));
+      }
+
+      d.v = best;
+      idx.v = bestIndex;
+      for (k = 0; k < 4; k++) {
+         if (mask & (1 << (i + k))) {
+            indices[i + k] = idx.u[k];
+            total += d.u[k];
+         }
+         else {
+            indices[i + k] = 3;
+         }
+      }
+   }
+
+   return total;
+}
+#endif
+
+
+static unsigned
+dxtn_pick_indices(const unsigned char px[16][4], unsigned mask,
+                  const unsigned char palette[4][4], unsigned numColors,
+                  unsigned char indices[16])
+{
+#ifdef __SSE2__
+   return dxtn_pick_indices_sse2(px, mask, palette, numColors, indices);
+#else
+   return dxtn_pick_indices_c(px, mask, palette, numColors, indices);
+#endif
+}
+
+
+/**
+ * Find the two endpoints of the line through the colors of the block,
+ * either from the bounding box or from the principal axis.
+ */
+static void
+dxtn_initial_endpoints(const unsigned char px[16][4], unsigned mask,
+                       int quality, float ep0[3], float ep1[3])
+{
+   float mean[3] = { 0.0F, 0.0F, 0.0F };
+   float cov[6] = { 0.0F, 0.0F, 0.0F, 0.0F, 0.0F, 0.0F };
+   float axis[3], minDot, maxDot;
+   int min[3] = { 255, 255, 255 }, max[3] = { 0, 0, 0 };
+   unsigned minPixel = 0, maxPixel = 0;
+   unsigned i, k, n = 0;
+
+   for (i = 0; i < 16; i++) {
+      if (!(mask & (1 << i)))
+         continue;
+      for (k = 0; k < 3; k++) {
+         mean[k] += px[i][k];
+         if (px[i][k] < min[k])
+            min[k] = px[i][k];
+         if (px[i][k] > max[k])
+            max[k] = px[i][k];
+      }
+      n++;
+   }
+
+   if (quality == DXTN_QUALITY_FAST) {
+      /* inset the bounding box a bit, which reduces the average error */
+      for (k = 0; k < 3; k++) {
+         const float inset = (max[k] - min[k]) / 16.0F;
+         ep0[k] = max[k] - inset;
+         ep1[k] = min[k] + inset;
+      }
+      return;
+   }
+
+   for (k = 0; k < 3; k++)
+      mean[k] /= n;
+
+   for (i = 0; i < 16; i++) {
+      float r, g, b;
+      if (!(mask & (1 << i)))
+         continue;
+      r = px[i][0] - mean[0];
+      g = px[i][1] - mean[1];
+      b = px[i][2] - mean[2];
+      cov[0] += r * r;
+      cov[1] += r * g;
+      cov[2] += r * b;
+      cov[3] += g * g;
+      cov[4] += g * b;
+      cov[5] += b * b;
+   }
+
+   /* power iteration, starting from the bounding box diagonal */
+   axis[0] = (float) (max[0] - min[0]);
+   axis[1] = (float) (max[1] - min[1]);
+   axis[2] = (float) (max[2] - min[2]);
+   for (i = 0; i < 4; i++) {
+      const float r = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+      const float g = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+      const float b = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+      float m = r > 0 ? r : -r;
+      if ((g > 0 ? g : -g) > m)
+         m = g > 0 ? g : -g;
+      if ((b > 0 ? b : -b) > m)
+         m = b > 0 ? b : -b;
+      if (m < 1e-6F)
+         break;
+      axis[0] = r / m;
+      axis[1] = g / m;
+      axis[2] = b / m;
+   }
+
+   minDot = 1e30F;
+   maxDot = -1e30F;
+   for (i = 0; i < 16; i++) {
+      float dot;
+      if (!(mask & (1 << i)))
+         continue;
+      dot = px[i][0] * axis[0] + px[i][1] * axis[1] + px[i][2] * axis[2];
+      if (dot < minDot) {
+         minDot = dot;
+         minPixel = i;
+      }
+      if (dot > maxDot) {
+         maxDot = dot;
+         maxPixel = i;
+      }
+   }
+
+   for (k = 0; k < 3; k++) {
+      ep0[k] = px[maxPixel][k];
+      ep1[k] = px[minPixel][k];
+   }
+}
+
+
+/**
+ * Least squares fit of the two endpoints to the pixels, given the
+ * interpolation weight the current indices give each pixel.
+ *
+ * \return GL_FALSE if the system is degenerate
+ */
+static int
+dxtn_refine_endpoints(const unsigned char px[16][4], unsigned mask,
+                      const unsigned char indices[16], int threeColor,
+                      float ep0[3], float ep1[3])
+{
+   static const float weights4[4] = { 0.0F, 1.0F, 1.0F / 3.0F, 2.0F / 3.0F };
+   static const float weights3[4] = { 0.0F, 1.0F, 0.5F, 0.0F };
+   const float *weights = threeColor ? weights3 : weights4;
+   float aa = 0.0F, bb = 0.0F, ab = 0.0F, det;
+   float ax[3] = { 0.0F, 0.0F, 0.0F }, bx[3] = { 0.0F, 0.0F, 0.0F };
+   unsigned i, k;
+
+   for (i = 0; i < 16; i++) {
+      float b, a;
+      if (!(mask & (1 << i)) || (threeColor && indices[i] == 3))
+         continue;
+      b = weights[indices[i]];
+      a = 1.0F - b;
+      aa += a * a;
+      bb += b * b;
+      ab += a * b;
+      for (k = 0; k < 3; k++) {
+         ax[k] += a * px[i][k];
+         bx[k] += b * px[i][k];
+      }
+   }
+
+   det = aa * bb - ab * ab;
+   if (det > -1e-6F && det < 1e-6F)
+      return 0;
+
+   for (k = 0; k < 3; k++) {
+      ep0[k] = (ax[k] * bb - bx[k] * ab) / det;
+      ep1[k] = (bx[k] * aa - ax[k] * ab) / det;
+   }
+   return 1;
+}
+
+
+/**
+ * Encode the two endpoints and indices into a color block.  The endpoints
+ * are swapped if needed so that c0 > c1 selects the four color mode and
+ * c0 <= c1 the three color one.
+ */
+static void
+dxtn_write_color_block(unsigned c0, unsigned c1, int threeColor,
+                       const unsigned char indices[16], unsigned char *out)
+{
+   unsigned char idx[16];
+   unsigned i;
+
+   memcpy(idx, indices, 16);
+
+   if (threeColor) {
+      if (c0 > c1) {
+         unsigned t = c0; c0 = c1; c1 = t;
+         for (i = 0; i < 16; i++) {
+            if (idx[i] < 2)
+               idx[i] ^= 1;
+         }
+      }
+   }
+   else {
+      if (c0 < c1) {
+         unsigned t = c0; c0 = c1; c1 = t;
+         for (i = 0; i < 16; i++)
+            idx[i] ^= 1;
+      }
+      else if (c0 == c1) {
+         /* would select the three color mode, only use c0 */
+         memset(idx, 0, 16);
+      }
+   }
+
+   out[0] = c0 & 0xff;
+   out[1] = c0 >> 8;
+   out[2] = c1 & 0xff;
+   out[3] = c1 >> 8;
+   for (i = 0; i < 4; i++) {
+      out[4 + i] = idx[i * 4 + 0] | (idx[i * 4 + 1] << 2) |
+                   (idx[i * 4 + 2] << 4) | (idx[i * 4 + 3] << 6);
+   }
+}
+
+
+/**
+ * Encode the colors of a block.
+ * \param dxt1Alpha  encode pixels with alpha < 128 as transparent
+ */
+static void
+dxtn_encode_color(const unsigned char px[16][4], int dxt1Alpha, int quality,
+                  unsigned char *out)
+{
+   const int passes = quality == DXTN_QUALITY_BEST ? 4 :
+                      quality == DXTN_QUALITY_NORMAL ? 1 : 0;
+   unsigned mask = 0xffff;
+   unsigned char palette[4][4];
+   unsigned char indices[16], bestIndices[16];
+   unsigned c0, c1, bestC0, bestC1, error, bestError;
+   float ep0[3], ep1[3];
+   int threeColor = 0;
+   int pass;
+   unsigned i;
+
+   if (dxt1Alpha) {
+      for (i = 0; i < 16; i++) {
+         if (px[i][3] < 128)
+            mask &= ~(1 << i);
+      }
+      if (mask == 0) {
+         /* fully transparent */
+         static const unsigned char transparent[8] =
+            { 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff };
+         memcpy(out, transparent, 8);
+         return;
+      }
+      threeColor = mask != 0xffff;
+   }
+
+   dxtn_initial_endpoints(px, mask, quality, ep0, ep1);
+   bestC0 = dxtn_quantize_565(ep0);
+   bestC1 = dxtn_quantize_565(ep1);
+   /* in the three color mode the palette is built with c0 <= c1, and the
+    * indices of the two endpoints are fixed up afterwards
+    */
+   if (threeColor)
+      dxtn_color_palette(MIN2(bestC0, bestC1), MAX2(bestC0, bestC1), 1,
+                         palette);
+   else
+      dxtn_color_palette(bestC0, bestC1, 0, palette);
+   bestError = dxtn_pick_indices(px, mask, palette, threeColor ? 3 : 4,
+                                 bestIndices);
+   if (threeColor && bestC0 > bestC1) {
+      /* palette was built with the endpoints swapped */
+      for (i = 0; i < 16; i++) {
+         if (bestIndices[i] < 2)
+            bestIndices[i] ^= 1;
+      }
+   }
+
+   for (pass = 0; pass < passes && bestError > 0; pass++) {
+      if (!dxtn_refine_endpoints(px, mask, bestIndices, threeColor, ep0, ep1))
+         break;
+      c0 = dxtn_quantize_565(ep0);
+      c1 = dxtn_quantize_565(ep1);
+      if (c0 == bestC0 && c1 == bestC1)
+         break;
+
+      if (threeColor) {
+         dxtn_color_palette(MIN2(c0, c1), MAX2(c0, c1), 1, palette);
+         error = dxtn_pick_indices(px, mask, palette, 3, indices);
+         if (c0 > c1) {
+            for (i = 0; i < 16; i++) {
+               if (indices[i] < 2)
+                  indices[i] ^= 1;
+            }
+         }
+      }
+      else {
+         dxtn_color_palette(c0, c1, 0, palette);
+         error = dxtn_pick_indices(px, mask, palette, 4, indices);
+      }
+
+      if (error >= bestError)
+         break;
+      bestError = error;
+      bestC0 = c0;
+      bestC1 = c1;
+      memcpy(bestIndices, indices, 16);
+   }
+
+   dxtn_write_color_block(bestC0, bestC1, threeColor, bestIndices, out);
+}
+
+
+/**
+ * Pick the closest alpha values and compute the error for one alpha
+ * block mode.
+ */
+static unsigned
+dxtn_pick_alpha_indices(const unsigned char px[16][4],
+                        unsigned alpha0, unsigned alpha1,
+                        unsigned char indices[16])
+{
+   unsigned values[8];
+   unsigned total = 0;
+   unsigned i, c;
+
+   values[0] = alpha0;
+   values[1] = alpha1;
+   for (c = 2; c < 8; c++) {
+      if (alpha0 > alpha1)
+         values[c] = (alpha0 * (8 - c) + alpha1 * (c - 1)) / 7;
+      else if (c < 6)
+         values[c] = (alpha0 * (6 - c) + alpha1 * (c - 1)) / 5;
+      else
+         values[c] = c == 6 ? 0 : 255;
+   }
+
+   for (i = 0; i < 16; i++) {
+      unsigned best = ~0u;
+      for (c = 0; c < 8; c++) {
+         const int d = (int) px[i][3] - (int) values[c];
+         const unsigned e = d * d;
+         if (e < best) {
+            best = e;
+            indices[i] = c;
+         }
+      }
+      total += best;
+   }
+
+   return total;
+}
+
+
+/** Encode the alpha of a block the DXT5 way. */
+static void
+dxtn_encode_alpha(const unsigned char px[16][4], int quality,
+                  unsigned char *out)
+{
+   unsigned char indices[16];
+   unsigned min = 255, max = 0, min6 = 255, max6 = 0;
+   unsigned alpha0, alpha1;
+   unsigned i;
+   uint64_t bits = 0;
+
+   for (i = 0; i < 16; i++) {
+      const unsigned a = px[i][3];
+      if (a < min)
+         min = a;
+      if (a > max)
+         max = a;
+      if (a != 0 && a != 255) {
+         if (a < min6)
+            min6 = a;
+         if (a > max6)
+            max6 = a;
+      }
+   }
+
+   /* eight value mode */
+   alpha0 = max;
+   alpha1 = min;
+
+   if (max == min) {
+      memset(indices, 0, sizeof indices);
+   }
+   else {
+      unsigned error = dxtn_pick_alpha_indices(px, alpha0, alpha1, indices);
+
+      /* six value mode, which has exact 0 and 255 */
+      if (quality != DXTN_QUALITY_FAST && (min == 0 || max == 255) &&
+          error > 0) {
+         unsigned char indices6[16];
+         unsigned error6;
+
+         if (min6 > max6)
+            min6 = max6 = min;
+         error6 = dxtn_pick_alpha_indices(px, min6, max6, indices6);
+         if (error6 < error) {
+            alpha0 = min6;
+            alpha1 = max6;
+            memcpy(indices, indices6, sizeof indices);
+         }
+      }
+   }
+
+   for (i = 0; i < 16; i++)
+      bits |= (uint64_t) indices[i] << (3 * i);
+
+   out[0] = alpha0;
+   out[1] = alpha1;
+   for (i = 0; i < 6; i++)
+      out[2 + i] = (bits >> (8 * i)) & 0xff;
+}
+
+
+/** Encode the alpha of a block the DXT3 way. */
+static void
+dxtn_encode_explicit_alpha(const unsigned char px[16][4], unsigned char *out)
+{
+   unsigned i;
+
+   for (i = 0; i < 8; i++) {
+      const unsigned a0 = (px[2 * i][3] + 8) / 17;
+      const unsigned a1 = (px[2 * i + 1][3] + 8) / 17;
+      out[i] = a0 | (a1 << 4);
+   }
+}
+
+
+struct dxtn_job
+{
+   int srccomps;
+   int width, height;
+   const unsigned char *src;
+   int srcRowStride;
+   unsigned destformat;
+   unsigned char *dest;
+   int dstRowStride;
+   int quality;
+};
+
+
+/** util_parallel_rows() callback compressing some of the block rows */
+static void
+dxtn_compress_rows(void *data, unsigned firstBlockRow, unsigned numBlockRows)
+{
+   const struct dxtn_job *job = (const struct dxtn_job *) data;
+   const unsigned blockSize =
+      (job->destformat == DXTN_RGB_DXT1 ||
+       job->destformat == DXTN_RGBA_DXT1) ? 8 : 16;
+   int by, bx;
+
+   for (by = firstBlockRow; by < (int) (firstBlockRow + numBlockRows); by++) {
+      unsigned char *out = job->dest + by * job->dstRowStride;
+
+      for (bx = 0; bx < job->width; bx += 4) {
+         unsigned char px[16][4];
+         int i, j;
+
+         /* get the block, replicating the last row / column at the edges */
+         for (j = 0; j < 4; j++) {
+            const int y = MIN2(by * 4 + j, job->height - 1);
+            const unsigned char *row = job->src + y * job->srcRowStride;
+            for (i = 0; i < 4; i++) {
+               const int x = MIN2(bx + i, job->width - 1);
+               const unsigned char *p = row + x * job->srccomps;
+               px[j * 4 + i][0] = p[0];
+               px[j * 4 + i][1] = p[1];
+               px[j * 4 + i][2] = p[2];
+               px[j * 4 + i][3] = job->srccomps == 4 ? p[3] : 255;
+            }
+         }
+
+         switch (job->destformat) {
+         case DXTN_RGB_DXT1:
+            dxtn_encode_color(px, 0, job->quality, out);
+            break;
+         case DXTN_RGBA_DXT1:
+            dxtn_encode_color(px, 1, job->quality, out);
+            break;
+         case DXTN_RGBA_DXT3:
+            dxtn_encode_explicit_alpha(px, out);
+            dxtn_encode_color(px, 0, job->quality, out + 8);
+            break;
+         case DXTN_RGBA_DXT5:
+            dxtn_encode_alpha(px, job->quality, out);
+            dxtn_encode_color(px, 0, job->quality, out + 8);
+            break;
+         }
+
+         out += blockSize;
+      }
+   }
+}
+
+
+/**
+ * Compress an RGB or RGBA ubyte image.
+ *
+ * \param srcRowStride  bytes between source rows
+ * \param dstRowStride  bytes between block rows, or 0 if tightly packed
+ * \param quality  one of the DXTN_QUALITY_x values
+ */
+static void
+dxtn_compress(int srccomps, int width, int height,
+              const unsigned char *src, int srcRowStride,
+              unsigned destformat, unsigned char *dest, int dstRowStride,
+              int quality)
+{
+   const unsigned blockSize =
+      (destformat == DXTN_RGB_DXT1 || destformat == DXTN_RGBA_DXT1) ? 8 : 16;
+   const int blocksWide = (width + 3) / 4;
+   const int blockRows = (height + 3) / 4;
+   struct dxtn_job job;
+
+   if (width <= 0 || height <= 0)
+      return;
+
+   job.srccomps = srccomps;
+   job.width = width;
+   job.height = height;
+   job.src = src;
+   job.srcRowStride = srcRowStride;
+   job.destformat = destformat;
+   job.dest = dest;
+   job.dstRowStride = dstRowStride ? dstRowStride : blocksWide * blockSize;
+   job.quality = quality;
+
+   util_parallel_rows(blockRows,
+                      (blocksWide * blockRows) / DXTN_MIN_BLOCKS_PER_THREAD,
+                      dxtn_compress_rows, &job);
+}
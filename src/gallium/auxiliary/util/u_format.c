@@ -35,6 +35,7 @@
 #include "u_math.h"
 #include "u_memory.h"
 #include "u_format.h"
+#include "u_format_direct.h"
 #include "u_format_s3tc.h"
 #include "u_surface.h"
 
@@ -590,9 +591,19 @@ util_format_translate(enum pipe_format dst_format,
    dst_step = y_step / dst_format_desc->block.height * dst_stride;
    src_step = y_step / src_format_desc->block.height * src_stride;
 
+   /*
+    * Common pairs have single pass kernels.
+    */
+
+   if (x_step == 1 && y_step == 1 &&
+       util_format_translate_direct(dst_format, dst_row, dst_stride,
+                                    src_format, src_row, src_stride,
+                                    width, height)) {
+      return TRUE;
+   }
+
    /*
     * TODO: double formats will loose precision
-    * TODO: Add a special case for formats that are mere swizzles of each other
     */
 
    if (src_format_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS ||
@@ -0,0 +1,937 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Direct format to format conversion kernels.
+ *
+ * util_format_translate() normally converts through an intermediate row of
+ * RGBA 8unorm or float pixels, using the generic unpack/pack functions.
+ * For the most common pairs this file provides single pass kernels, which
+ * give bit-identical results to the generic path:
+ *
+ * - any 32bpp 4 x 8bit unorm format to any other (RGBA8, BGRA8, BGRX8, ...)
+ * - B5G6R5 to/from any 32bpp 4 x 8bit unorm format
+ * - 16bit float to/from 32bit float, with any number of channels
+ * - Z24S8/Z24X8 to/from S8Z24/X8Z24
+ *
+ * Each kernel has a plain C version and SIMD versions for SSE2, SSSE3
+ * and AVX2, compiled with per-function target attributes and chosen at
+ * runtime from util_cpu_caps.
+ *
+ * Only little endian hosts are supported; elsewhere no direct path is
+ * reported and the generic code is used.
+ */
+
+
+#include "u_cpu_detect.h"
+#include "u_format.h"
+#include "u_format_direct.h"
+#include "u_half.h"
+#include "u_math.h"
+
+
+#if (defined(PIPE_ARCH_X86) || defined(PIPE_ARCH_X86_64)) && \
+    (defined(__clang__) || \
+     (defined(PIPE_CC_GCC) && \
+      (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define DIRECT_X86 1
+#define DIRECT_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#endif
+
+
+/* Values of direct_conv::swizzle other than byte indices. */
+#define SWZ_ZERO 4
+#define SWZ_ONE  5
+
+
+struct direct_conv;
+
+typedef void
+(*direct_row_func)(uint8_t *dst, const uint8_t *src, unsigned width,
+                   const struct direct_conv *conv);
+
+struct direct_conv {
+   direct_row_func row;
+
+   /* Destination byte i of each 32bit pixel is source byte swizzle[i], or
+    * SWZ_ZERO/SWZ_ONE. For B5G6R5 sources the source is the pixel expanded
+    * to R8G8B8A8, for B5G6R5 destinations it's the pixel before packing. */
+   uint8_t swizzle[4];
+
+   /* Number of 16/32bit elements per pixel for the float kernels. */
+   unsigned nr_elements;
+
+   /* Z24 kernels: rotate each pixel by 8 bits, then apply mask. */
+   boolean rotate_left;
+   uint32_t mask;
+};
+
+
+/*
+ * Plain C kernels.
+ */
+
+
+static void
+swizzle_4x8_generic(uint8_t *dst, const uint8_t *src, unsigned width,
+                    const struct direct_conv *conv)
+{
+   const uint8_t *swz = conv->swizzle;
+   unsigned x;
+
+   for (x = 0; x < width; x++) {
+      uint8_t tmp[6];
+
+      memcpy(tmp, src, 4);
+      tmp[SWZ_ZERO] = 0;
+      tmp[SWZ_ONE] = 0xff;
+
+      dst[0] = tmp[swz[0]];
+      dst[1] = tmp[swz[1]];
+      dst[2] = tmp[swz[2]];
+      dst[3] = tmp[swz[3]];
+
+      src += 4;
+      dst += 4;
+   }
+}
+
+
+/* These match the (x * 0xff / 0x1f) and (x * 0xff / 0x3f) expressions of
+ * the generated unpack code, but only need 16bit intermediates. */
+#define EXPAND_5(x) (((x) * 1053) >> 7)
+#define EXPAND_6(x) (((x) * 259 + 3) >> 6)
+
+
+static void
+b5g6r5_to_4x8_generic(uint8_t *dst, const uint8_t *src, unsigned width,
+                      const struct direct_conv *conv)
+{
+   unsigned x;
+
+   for (x = 0; x < width; x++) {
+      uint16_t value = *(const uint16_t *)src;
+      uint8_t tmp[4];
+
+      tmp[0] = EXPAND_5(value >> 11);
+      tmp[1] = EXPAND_6((value >> 5) & 0x3f);
+      tmp[2] = EXPAND_5(value & 0x1f);
+      tmp[3] = 0xff;
+
+      swizzle_4x8_generic(dst, tmp, 1, conv);
+
+      src += 2;
+      dst += 4;
+   }
+}
+
+
+static void
+b5g6r5_from_4x8_generic(uint8_t *dst, const uint8_t *src, unsigned width,
+                        const struct direct_conv *conv)
+{
+   unsigned x;
+
+   for (x = 0; x < width; x++) {
+      uint8_t tmp[4];
+
+      swizzle_4x8_generic(tmp, src, 1, conv);
+
+      *(uint16_t *)dst = ((tmp[0] >> 3) << 11) |
+                         ((tmp[1] >> 2) << 5) |
+                         (tmp[2] >> 3);
+
+      src += 4;
+      dst += 2;
+   }
+}
+
+
+static void
+half_to_float_generic(uint8_t *dst, const uint8_t *src, unsigned width,
+                      const struct direct_conv *conv)
+{
+   const uint16_t *s = (const uint16_t *)src;
+   float *d = (float *)dst;
+   unsigned n = width * conv->nr_elements;
+   unsigned i;
+
+   for (i = 0; i < n; i++) {
+      d[i] = util_half_to_float(s[i]);
+   }
+}
+
+
+static void
+float_to_half_generic(uint8_t *dst, const uint8_t *src, unsigned width,
+                      const struct direct_conv *conv)
+{
+   const float *s = (const float *)src;
+   uint16_t *d = (uint16_t *)dst;
+   unsigned n = width * conv->nr_elements;
+   unsigned i;
+
+   for (i = 0; i < n; i++) {
+      d[i] = util_float_to_half(s[i]);
+   }
+}
+
+
+static void
+z24_rotate_generic(uint8_t *dst, const uint8_t *src, unsigned width,
+                   const struct direct_conv *conv)
+{
+   const uint32_t *s = (const uint32_t *)src;
+   uint32_t *d = (uint32_t *)dst;
+   unsigned x;
+
+   if (conv->rotate_left) {
+      for (x = 0; x < width; x++) {
+         d[x] = ((s[x] << 8) | (s[x] >> 24)) & conv->mask;
+      }
+   } else {
+      for (x = 0; x < width; x++) {
+         d[x] = ((s[x] >> 8) | (s[x] << 24)) & conv->mask;
+      }
+   }
+}
+
+
+#ifdef DIRECT_X86
+
+
+/*
+ * SSE2 kernels.
+ */
+
+
+/* conv->swizzle as shifts and masks, for four 32bit pixels at a time. */
+struct swizzle_sse2 {
+   unsigned nr_bytes;
+   __m128i lshift[4];
+   __m128i rshift[4];
+   __m128i mask[4];
+   __m128i ones;
+};
+
+
+static void DIRECT_TARGET("sse2")
+swizzle_sse2_init(struct swizzle_sse2 *swz, const uint8_t *swizzle)
+{
+   unsigned ones = 0;
+   unsigned i;
+
+   swz->nr_bytes = 0;
+
+   for (i = 0; i < 4; i++) {
+      unsigned n = swz->nr_bytes;
+
+      if (swizzle[i] == SWZ_ONE) {
+         ones |= 0xff << (8 * i);
+      } else if (swizzle[i] != SWZ_ZERO) {
+         int shift = 8 * ((int)i - (int)swizzle[i]);
+
+         swz->lshift[n] = _mm_cvtsi32_si128(shift > 0 ? shift : 0);
+         swz->rshift[n] = _mm_cvtsi32_si128(shift < 0 ? -shift : 0);
+         swz->mask[n] = _mm_set1_epi32(0xff << (8 * i));
+         swz->nr_bytes++;
+      }
+   }
+
+   swz->ones = _mm_set1_epi32(ones);
+}
+
+
+static INLINE __m128i DIRECT_TARGET("sse2")
+swizzle_sse2_reg(__m128i v, const struct swizzle_sse2 *swz)
+{
+   __m128i res = swz->ones;
+   unsigned i;
+
+   for (i = 0; i < swz->nr_bytes; i++) {
+      __m128i c = _mm_srl_epi32(_mm_sll_epi32(v, swz->lshift[i]),
+                                swz->rshift[i]);
+      res = _mm_or_si128(res, _mm_and_si128(c, swz->mask[i]));
+   }
+   return res;
+}
+
+
+static void DIRECT_TARGET("sse2")
+swizzle_4x8_sse2(uint8_t *dst, const uint8_t *src, unsigned width,
+                 const struct direct_conv *conv)
+{
+   struct swizzle_sse2 swz;
+   unsigned x;
+
+   swizzle_sse2_init(&swz, conv->swizzle);
+
+   for (x = 0; x + 4 <= width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)src);
+      _mm_storeu_si128((__m128i *)dst, swizzle_sse2_reg(v, &swz));
+      src += 16;
+      dst += 16;
+   }
+
+   swizzle_4x8_generic(dst, src, width - x, conv);
+}
+
+
+static void DIRECT_TARGET("sse2")
+b5g6r5_to_4x8_sse2(uint8_t *dst, const uint8_t *src, unsigned width,
+                   const struct direct_conv *conv)
+{
+   const __m128i mask5 = _mm_set1_epi16(0x1f);
+   const __m128i mask6 = _mm_set1_epi16(0x3f);
+   const __m128i mul5 = _mm_set1_epi16(1053);
+   const __m128i mul6 = _mm_set1_epi16(259);
+   const __m128i add6 = _mm_set1_epi16(3);
+   const __m128i alpha = _mm_set1_epi16((short)0xff00);
+   struct swizzle_sse2 swz;
+   unsigned x;
+
+   swizzle_sse2_init(&swz, conv->swizzle);
+
+   for (x = 0; x + 8 <= width; x += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i *)src);
+      __m128i r, g, b, rg, ba;
+
+      r = _mm_srli_epi16(v, 11);
+      g = _mm_and_si128(_mm_srli_epi16(v, 5), mask6);
+      b = _mm_and_si128(v, mask5);
+
+      r = _mm_srli_epi16(_mm_mullo_epi16(r, mul5), 7);
+      g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, mul6), add6), 6);
+      b = _mm_srli_epi16(_mm_mullo_epi16(b, mul5), 7);
+
+      rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+      ba = _mm_or_si128(b, alpha);
+
+      _mm_storeu_si128((__m128i *)dst,
+                       swizzle_sse2_reg(_mm_unpacklo_epi16(rg, ba), &swz));
+      _mm_storeu_si128((__m128i *)(dst + 16),
+                       swizzle_sse2_reg(_mm_unpackhi_epi16(rg, ba), &swz));
+      src += 16;
+      dst += 32;
+   }
+
+   b5g6r5_to_4x8_generic(dst, src, width - x, conv);
+}
+
+
+/* Pack four 4 x 8bit pixels to B5G6R5, one per 32bit lane. The shift
+ * counts select the top bits of the source bytes holding R, G and B. */
+static INLINE __m128i DIRECT_TARGET("sse2")
+b5g6r5_pack_sse2_reg(__m128i v, __m128i r_shift, __m128i g_shift,
+                     __m128i b_shift)
+{
+   const __m128i mask5 = _mm_set1_epi32(0x1f);
+   const __m128i mask6 = _mm_set1_epi32(0x3f);
+   __m128i r = _mm_and_si128(_mm_srl_epi32(v, r_shift), mask5);
+   __m128i g = _mm_and_si128(_mm_srl_epi32(v, g_shift), mask6);
+   __m128i b = _mm_and_si128(_mm_srl_epi32(v, b_shift), mask5);
+   __m128i res = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(r, 11),
+                                           _mm_slli_epi32(g, 5)), b);
+
+   /* Sign extend so that the signed saturation of packs is a no-op. */
+   return _mm_srai_epi32(_mm_slli_epi32(res, 16), 16);
+}
+
+
+static void DIRECT_TARGET("sse2")
+b5g6r5_from_4x8_sse2(uint8_t *dst, const uint8_t *src, unsigned width,
+                     const struct direct_conv *conv)
+{
+   const uint8_t *swz = conv->swizzle;
+   __m128i r_shift, g_shift, b_shift;
+   unsigned x;
+
+   /* Only formats with R, G and B all present in the source take this
+    * path, see direct_conv_init(). */
+   r_shift = _mm_cvtsi32_si128(8 * swz[0] + 3);
+   g_shift = _mm_cvtsi32_si128(8 * swz[1] + 2);
+   b_shift = _mm_cvtsi32_si128(8 * swz[2] + 3);
+
+   for (x = 0; x + 8 <= width; x += 8) {
+      __m128i lo = _mm_loadu_si128((const __m128i *)src);
+      __m128i hi = _mm_loadu_si128((const __m128i *)(src + 16));
+
+      lo = b5g6r5_pack_sse2_reg(lo, r_shift, g_shift, b_shift);
+      hi = b5g6r5_pack_sse2_reg(hi, r_shift, g_shift, b_shift);
+
+      _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+      src += 32;
+      dst += 16;
+   }
+
+   b5g6r5_from_4x8_generic(dst, src, width - x, conv);
+}
+
+
+/* Same algorithm as util_half_to_float(), four halves per call. */
+static INLINE __m128 DIRECT_TARGET("sse2")
+half_to_float_sse2_reg(__m128i h)
+{
+   const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(0xef << 23));
+   const __m128 infnan = _mm_set1_ps(65536.0f);
+   __m128i bits = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+   __m128 f = _mm_mul_ps(_mm_castsi128_ps(bits), magic);
+   __m128 is_infnan = _mm_cmpge_ps(f, infnan);
+
+   f = _mm_or_ps(f, _mm_and_ps(is_infnan,
+                               _mm_castsi128_ps(_mm_set1_epi32(0xff << 23))));
+   bits = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+   return _mm_or_ps(f, _mm_castsi128_ps(bits));
+}
+
+
+/* Same algorithm as util_float_to_half(), results in the 32bit lanes,
+ * sign extended for packs. */
+static INLINE __m128i DIRECT_TARGET("sse2")
+float_to_half_sse2_reg(__m128 f)
+{
+   const __m128i sign_mask = _mm_set1_epi32(0x80000000);
+   const __m128i round_mask = _mm_set1_epi32(~0xfff);
+   const __m128i f32inf = _mm_set1_epi32(0xff << 23);
+   const __m128i f16inf = _mm_set1_epi32(0x1f << 23);
+   const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32(0xf << 23));
+   __m128i bits = _mm_castps_si128(f);
+   __m128i sign = _mm_and_si128(bits, sign_mask);
+   __m128i is_inf, is_nan, overflow, num, res;
+
+   bits = _mm_xor_si128(bits, sign);
+   is_inf = _mm_cmpeq_epi32(bits, f32inf);
+   is_nan = _mm_cmpgt_epi32(bits, f32inf);
+
+   num = _mm_and_si128(bits, round_mask);
+   num = _mm_castps_si128(_mm_mul_ps(_mm_castsi128_ps(num), magic));
+   num = _mm_sub_epi32(num, round_mask);
+   overflow = _mm_cmpgt_epi32(num, f16inf);
+   num = _mm_or_si128(_mm_andnot_si128(overflow, num),
+                      _mm_and_si128(overflow,
+                                    _mm_sub_epi32(f16inf, _mm_set1_epi32(1))));
+   num = _mm_srli_epi32(num, 13);
+
+   res = _mm_or_si128(_mm_andnot_si128(_mm_or_si128(is_inf, is_nan), num),
+                      _mm_or_si128(_mm_and_si128(is_inf, _mm_set1_epi32(0x7c00)),
+                                   _mm_and_si128(is_nan, _mm_set1_epi32(0x7e00))));
+   res = _mm_or_si128(res, _mm_srli_epi32(sign, 16));
+
+   return _mm_srai_epi32(_mm_slli_epi32(res, 16), 16);
+}
+
+
+static void DIRECT_TARGET("sse2")
+half_to_float_sse2(uint8_t *dst, const uint8_t *src, unsigned width,
+                   const struct direct_conv *conv)
+{
+   const __m128i zero = _mm_setzero_si128();
+   unsigned n = width * conv->nr_elements;
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8) {
+      __m128i h = _mm_loadu_si128((const __m128i *)src);
+
+      _mm_storeu_ps((float *)dst,
+                    half_to_float_sse2_reg(_mm_unpacklo_epi16(h, zero)));
+      _mm_storeu_ps((float *)(dst + 16),
+                    half_to_float_sse2_reg(_mm_unpackhi_epi16(h, zero)));
+      src += 16;
+      dst += 32;
+   }
+
+   for (; i < n; i++) {
+      *(float *)dst = util_half_to_float(*(const uint16_t *)src);
+      src += 2;
+      dst += 4;
+   }
+}
+
+
+static void DIRECT_TARGET("sse2")
+float_to_half_sse2(uint8_t *dst, const uint8_t *src, unsigned width,
+                   const struct direct_conv *conv)
+{
+   unsigned n = width * conv->nr_elements;
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8) {
+      __m128i lo = float_to_half_sse2_reg(_mm_loadu_ps((const float *)src));
+      __m128i hi = float_to_half_sse2_reg(_mm_loadu_ps((const float *)(src + 16)));
+
+      _mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+      src += 32;
+      dst += 16;
+   }
+
+   for (; i < n; i++) {
+      *(uint16_t *)dst = util_float_to_half(*(const float *)src);
+      src += 4;
+      dst += 2;
+   }
+}
+
+
+static void DIRECT_TARGET("sse2")
+z24_rotate_sse2(uint8_t *dst, const uint8_t *src, unsigned width,
+                const struct direct_conv *conv)
+{
+   const __m128i mask = _mm_set1_epi32(conv->mask);
+   unsigned x;
+
+   for (x = 0; x + 4 <= width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)src);
+
+      if (conv->rotate_left) {
+         v = _mm_or_si128(_mm_slli_epi32(v, 8), _mm_srli_epi32(v, 24));
+      } else {
+         v = _mm_or_si128(_mm_srli_epi32(v, 8), _mm_slli_epi32(v, 24));
+      }
+      _mm_storeu_si128((__m128i *)dst, _mm_and_si128(v, mask));
+      src += 16;
+      dst += 16;
+   }
+
+   z24_rotate_generic(dst, src, width - x, conv);
+}
+
+
+/*
+ * SSSE3 kernels.
+ */
+
+
+/* Build the pshufb control and the OR mask for 16 bytes worth of pixels. */
+static void
+swizzle_4x8_shuffle_mask(const uint8_t *swz, uint8_t shuffle[16],
+                         uint8_t ones[16])
+{
+   unsigned i;
+
+   for (i = 0; i < 16; i++) {
+      uint8_t s = swz[i % 4];
+
+      shuffle[i] = s < 4 ? (i & ~3) + s : 0x80;
+      ones[i] = s == SWZ_ONE ? 0xff : 0;
+   }
+}
+
+
+static void DIRECT_TARGET("ssse3")
+swizzle_4x8_ssse3(uint8_t *dst, const uint8_t *src, unsigned width,
+                  const struct direct_conv *conv)
+{
+   uint8_t shuffle[16], ones[16];
+   __m128i shuffle_mask, ones_mask;
+   unsigned x;
+
+   swizzle_4x8_shuffle_mask(conv->swizzle, shuffle, ones);
+   shuffle_mask = _mm_loadu_si128((const __m128i *)shuffle);
+   ones_mask = _mm_loadu_si128((const __m128i *)ones);
+
+   for (x = 0; x + 4 <= width; x += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i *)src);
+
+      v = _mm_or_si128(_mm_shuffle_epi8(v, shuffle_mask), ones_mask);
+      _mm_storeu_si128((__m128i *)dst, v);
+      src += 16;
+      dst += 16;
+   }
+
+   swizzle_4x8_generic(dst, src, width - x, conv);
+}
+
+
+/*
+ * AVX2 kernels.
+ */
+
+
+static void DIRECT_TARGET("avx2")
+swizzle_4x8_avx2(uint8_t *dst, const uint8_t *src, unsigned width,
+                 const struct direct_conv *conv)
+{
+   uint8_t shuffle[16], ones[16];
+   __m256i shuffle_mask, ones_mask;
+   unsigned x;
+
+   /* vpshufb works within 128bit lanes, so the same control is used for
+    * both halves. */
+   swizzle_4x8_shuffle_mask(conv->swizzle, shuffle, ones);
+   shuffle_mask = _mm256_broadcastsi128_si256(
+                     _mm_loadu_si128((const __m128i *)shuffle));
+   ones_mask = _mm256_broadcastsi128_si256(
+                  _mm_loadu_si128((const __m128i *)ones));
+
+   for (x = 0; x + 8 <= width; x += 8) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)src);
+
+      v = _mm256_or_si256(_mm256_shuffle_epi8(v, shuffle_mask), ones_mask);
+      _mm256_storeu_si256((__m256i *)dst, v);
+      src += 32;
+      dst += 32;
+   }
+
+   swizzle_4x8_generic(dst, src, width - x, conv);
+}
+
+
+static void DIRECT_TARGET("avx2")
+half_to_float_avx2(uint8_t *dst, const uint8_t *src, unsigned width,
+                   const struct direct_conv *conv)
+{
+   const __m256i mant_exp = _mm256_set1_epi32(0x7fff);
+   const __m256i sign_mask = _mm256_set1_epi32(0x8000);
+   const __m256i exp_mask = _mm256_set1_epi32(0xff << 23);
+   const __m256 magic = _mm256_castsi256_ps(_mm256_set1_epi32(0xef << 23));
+   const __m256 infnan = _mm256_set1_ps(65536.0f);
+   unsigned n = width * conv->nr_elements;
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8) {
+      __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)src));
+      __m256i bits = _mm256_slli_epi32(_mm256_and_si256(h, mant_exp), 13);
+      __m256 f = _mm256_mul_ps(_mm256_castsi256_ps(bits), magic);
+      __m256 is_infnan = _mm256_cmp_ps(f, infnan, _CMP_GE_OQ);
+
+      f = _mm256_or_ps(f, _mm256_and_ps(is_infnan,
+                                        _mm256_castsi256_ps(exp_mask)));
+      bits = _mm256_slli_epi32(_mm256_and_si256(h, sign_mask), 16);
+      _mm256_storeu_ps((float *)dst,
+                       _mm256_or_ps(f, _mm256_castsi256_ps(bits)));
+      src += 16;
+      dst += 32;
+   }
+
+   for (; i < n; i++) {
+      *(float *)dst = util_half_to_float(*(const uint16_t *)src);
+      src += 2;
+      dst += 4;
+   }
+}
+
+
+static void DIRECT_TARGET("avx2")
+float_to_half_avx2(uint8_t *dst, const uint8_t *src, unsigned width,
+                   const struct direct_conv *conv)
+{
+   const __m256i sign_mask = _mm256_set1_epi32(0x80000000);
+   const __m256i round_mask = _mm256_set1_epi32(~0xfff);
+   const __m256i f32inf = _mm256_set1_epi32(0xff << 23);
+   const __m256i f16inf = _mm256_set1_epi32(0x1f << 23);
+   const __m256i f16max = _mm256_set1_epi32((0x1f << 23) - 1);
+   const __m256i half_inf = _mm256_set1_epi32(0x7c00);
+   const __m256i half_nan = _mm256_set1_epi32(0x7e00);
+   const __m256 magic = _mm256_castsi256_ps(_mm256_set1_epi32(0xf << 23));
+   unsigned n = width * conv->nr_elements;
+   unsigned i;
+
+   for (i = 0; i + 8 <= n; i += 8) {
+      __m256i bits = _mm256_loadu_si256((const __m256i *)src);
+      __m256i sign = _mm256_and_si256(bits, sign_mask);
+      __m256i is_inf, is_nan, num, res;
+
+      bits = _mm256_xor_si256(bits, sign);
+      is_inf = _mm256_cmpeq_epi32(bits, f32inf);
+      is_nan = _mm256_cmpgt_epi32(bits, f32inf);
+
+      num = _mm256_and_si256(bits, round_mask);
+      num = _mm256_castps_si256(_mm256_mul_ps(_mm256_castsi256_ps(num), magic));
+      num = _mm256_sub_epi32(num, round_mask);
+      num = _mm256_blendv_epi8(num, f16max, _mm256_cmpgt_epi32(num, f16inf));
+      num = _mm256_srli_epi32(num, 13);
+
+      res = _mm256_blendv_epi8(num, half_inf, is_inf);
+      res = _mm256_blendv_epi8(res, half_nan, is_nan);
+      res = _mm256_or_si256(res, _mm256_srli_epi32(sign, 16));
+
+      /* packus works per 128bit lane, fix up the order afterwards. */
+      res = _mm256_packus_epi32(res, res);
+      res = _mm256_permute4x64_epi64(res, 0x08);
+      _mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(res));
+      src += 32;
+      dst += 16;
+   }
+
+   for (; i < n; i++) {
+      *(uint16_t *)dst = util_float_to_half(*(const float *)src);
+      src += 4;
+      dst += 2;
+   }
+}
+
+
+#endif /* DIRECT_X86 */
+
+
+/*
+ * Kernel selection.
+ */
+
+
+static boolean
+is_4x8_unorm(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB ||
+       desc->block.bits != 32 ||
+       desc->nr_channels != 4) {
+      return FALSE;
+   }
+
+   for (i = 0; i < 4; i++) {
+      const struct util_format_channel_description *chan = &desc->channel[i];
+
+      if (chan->size != 8 || chan->shift % 8 != 0)
+         return FALSE;
+      if (chan->type == UTIL_FORMAT_TYPE_VOID)
+         continue;
+      if (chan->type != UTIL_FORMAT_TYPE_UNSIGNED || !chan->normalized)
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/* Number of channels if all channels are floats of the given size. */
+static unsigned
+float_channels(const struct util_format_description *desc, unsigned size)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->colorspace != UTIL_FORMAT_COLORSPACE_RGB) {
+      return 0;
+   }
+
+   for (i = 0; i < desc->nr_channels; i++) {
+      if (desc->channel[i].type != UTIL_FORMAT_TYPE_FLOAT ||
+          desc->channel[i].size != size) {
+         return 0;
+      }
+   }
+
+   return desc->nr_channels;
+}
+
+
+/**
+ * Compute the byte swizzle that gives the same result as
+ * pack_rgba_8unorm(unpack_rgba_8unorm(src)).
+ */
+static void
+swizzle_4x8(const struct util_format_description *dst_desc,
+            const struct util_format_description *src_desc,
+            uint8_t swizzle[4])
+{
+   unsigned i, c;
+
+   for (i = 0; i < 4; i++) {
+      const struct util_format_channel_description *chan = &dst_desc->channel[i];
+      unsigned byte = chan->shift / 8;
+      unsigned s;
+
+      swizzle[byte] = SWZ_ZERO;
+
+      if (chan->type == UTIL_FORMAT_TYPE_VOID)
+         continue;
+
+      /* The pack functions write the first component mapped to a channel. */
+      for (c = 0; c < 4; c++) {
+         if (dst_desc->swizzle[c] == i)
+            break;
+      }
+      if (c == 4)
+         continue;
+
+      s = src_desc->swizzle[c];
+      if (s <= UTIL_FORMAT_SWIZZLE_W) {
+         swizzle[byte] = src_desc->channel[s].shift / 8;
+      } else if (s == UTIL_FORMAT_SWIZZLE_1) {
+         swizzle[byte] = SWZ_ONE;
+      }
+   }
+}
+
+
+static boolean
+direct_conv_init(struct direct_conv *conv,
+                 enum pipe_format dst_format,
+                 enum pipe_format src_format)
+{
+#ifdef PIPE_ARCH_LITTLE_ENDIAN
+   const struct util_format_description *dst_desc;
+   const struct util_format_description *src_desc;
+   boolean sse2 = FALSE, ssse3 = FALSE, avx2 = FALSE;
+   unsigned dst_n, src_n;
+
+   dst_desc = util_format_description(dst_format);
+   src_desc = util_format_description(src_format);
+   if (!dst_desc || !src_desc)
+      return FALSE;
+
+   memset(conv, 0, sizeof *conv);
+
+#ifdef DIRECT_X86
+   util_cpu_detect();
+   sse2 = util_cpu_caps.has_sse2;
+   ssse3 = util_cpu_caps.has_ssse3;
+   avx2 = util_cpu_caps.has_avx2;
+#endif
+
+   if (is_4x8_unorm(dst_desc) && is_4x8_unorm(src_desc)) {
+      swizzle_4x8(dst_desc, src_desc, conv->swizzle);
+      conv->row = swizzle_4x8_generic;
+#ifdef DIRECT_X86
+      if (avx2)
+         conv->row = swizzle_4x8_avx2;
+      else if (ssse3)
+         conv->row = swizzle_4x8_ssse3;
+      else if (sse2)
+         conv->row = swizzle_4x8_sse2;
+#endif
+      return TRUE;
+   }
+
+   if (src_format == PIPE_FORMAT_B5G6R5_UNORM && is_4x8_unorm(dst_desc)) {
+      swizzle_4x8(dst_desc,
+                  util_format_description(PIPE_FORMAT_R8G8B8A8_UNORM),
+                  conv->swizzle);
+      conv->row = b5g6r5_to_4x8_generic;
+#ifdef DIRECT_X86
+      if (sse2)
+         conv->row = b5g6r5_to_4x8_sse2;
+#endif
+      return TRUE;
+   }
+
+   if (dst_format == PIPE_FORMAT_B5G6R5_UNORM && is_4x8_unorm(src_desc)) {
+      swizzle_4x8(util_format_description(PIPE_FORMAT_R8G8B8A8_UNORM),
+                  src_desc, conv->swizzle);
+      conv->row = b5g6r5_from_4x8_generic;
+#ifdef DIRECT_X86
+      if (sse2 && conv->swizzle[0] < 4 && conv->swizzle[1] < 4 &&
+          conv->swizzle[2] < 4)
+         conv->row = b5g6r5_from_4x8_sse2;
+#endif
+      return TRUE;
+   }
+
+   dst_n = float_channels(dst_desc, 32);
+   src_n = float_channels(src_desc, 16);
+   if (dst_n && dst_n == src_n &&
+       memcmp(dst_desc->swizzle, src_desc->swizzle, 4) == 0) {
+      conv->nr_elements = dst_n;
+      conv->row = half_to_float_generic;
+#ifdef DIRECT_X86
+      if (avx2)
+         conv->row = half_to_float_avx2;
+      else if (sse2)
+         conv->row = half_to_float_sse2;
+#endif
+      return TRUE;
+   }
+
+   dst_n = float_channels(dst_desc, 16);
+   src_n = float_channels(src_desc, 32);
+   if (dst_n && dst_n == src_n &&
+       memcmp(dst_desc->swizzle, src_desc->swizzle, 4) == 0) {
+      conv->nr_elements = dst_n;
+      conv->row = float_to_half_generic;
+#ifdef DIRECT_X86
+      if (avx2)
+         conv->row = float_to_half_avx2;
+      else if (sse2)
+         conv->row = float_to_half_sse2;
+#endif
+      return TRUE;
+   }
+
+   if ((src_format == PIPE_FORMAT_Z24_UNORM_S8_UINT &&
+        dst_format == PIPE_FORMAT_S8_UINT_Z24_UNORM) ||
+       (src_format == PIPE_FORMAT_Z24X8_UNORM &&
+        dst_format == PIPE_FORMAT_X8Z24_UNORM)) {
+      conv->rotate_left = TRUE;
+      conv->mask = dst_format == PIPE_FORMAT_X8Z24_UNORM ? 0xffffff00 : ~0;
+   } else if ((src_format == PIPE_FORMAT_S8_UINT_Z24_UNORM &&
+               dst_format == PIPE_FORMAT_Z24_UNORM_S8_UINT) ||
+              (src_format == PIPE_FORMAT_X8Z24_UNORM &&
+               dst_format == PIPE_FORMAT_Z24X8_UNORM)) {
+      conv->rotate_left = FALSE;
+      conv->mask = dst_format == PIPE_FORMAT_Z24X8_UNORM ? 0x00ffffff : ~0;
+   } else {
+      return FALSE;
+   }
+
+   conv->row = z24_rotate_generic;
+#ifdef DIRECT_X86
+   if (sse2)
+      conv->row = z24_rotate_sse2;
+#endif
+   return TRUE;
+#else
+   return FALSE;
+#endif
+}
+
+
+boolean
+util_format_has_direct_translate(enum pipe_format dst_format,
+                                 enum pipe_format src_format)
+{
+   struct direct_conv conv;
+
+   return direct_conv_init(&conv, dst_format, src_format);
+}
+
+
+boolean
+util_format_translate_direct(enum pipe_format dst_format,
+                             uint8_t *dst_row, unsigned dst_stride,
+                             enum pipe_format src_format,
+                             const uint8_t *src_row, unsigned src_stride,
+                             unsigned width, unsigned height)
+{
+   struct direct_conv conv;
+
+   if (!direct_conv_init(&conv, dst_format, src_format))
+      return FALSE;
+
+   while (height--) {
+      conv.row(dst_row, src_row, width, &conv);
+      dst_row += dst_stride;
+      src_row += src_stride;
+   }
+
+   return TRUE;
+}
@@ -0,0 +1,79 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Direct format to format conversion, without going through an
+ * intermediate RGBA 8unorm or float row.
+ */
+
+
+#ifndef U_FORMAT_DIRECT_H_
+#define U_FORMAT_DIRECT_H_
+
+
+#include "pipe/p_compiler.h"
+#include "pipe/p_format.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * Whether there is a direct conversion kernel from src_format to dst_format.
+ */
+boolean
+util_format_has_direct_translate(enum pipe_format dst_format,
+                                 enum pipe_format src_format);
+
+
+/**
+ * Convert a rectangle of pixels with a direct kernel.
+ *
+ * dst_row and src_row point to the first pixel of the rectangle. The best
+ * implementation supported by the CPU (see util_cpu_caps) is used.
+ *
+ * @return FALSE if there is no direct path between the two formats, in
+ * which case nothing is written.
+ */
+boolean
+util_format_translate_direct(enum pipe_format dst_format,
+                             uint8_t *dst_row, unsigned dst_stride,
+                             enum pipe_format src_format,
+                             const uint8_t *src_row, unsigned src_stride,
+                             unsigned width, unsigned height);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* U_FORMAT_DIRECT_H_ */
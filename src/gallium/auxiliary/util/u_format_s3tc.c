@@ -23,138 +23,43 @@
  *
  **************************************************************************/
 
-#include "u_dl.h"
 #include "u_math.h"
 #include "u_format.h"
 #include "u_format_s3tc.h"
 #include "u_format_srgb.h"
 
-
-#if defined(_WIN32) || defined(WIN32)
-#define DXTN_LIBNAME "dxtn.dll"
-#elif defined(__APPLE__)
-#define DXTN_LIBNAME "libtxc_dxtn.dylib"
-#else
-#define DXTN_LIBNAME "libtxc_dxtn.so"
-#endif
-
-
-static void
-util_format_dxt1_rgb_fetch_stub(int src_stride,
-                                const uint8_t *src,
-                                int col, int row,
-                                uint8_t *dst)
-{
-   assert(0);
-}
-
-
-static void
-util_format_dxt1_rgba_fetch_stub(int src_stride,
-                                 const uint8_t *src,
-                                 int col, int row,
-                                 uint8_t *dst )
-{
-   assert(0);
-}
-
-
-static void
-util_format_dxt3_rgba_fetch_stub(int src_stride,
-                                 const uint8_t *src,
-                                 int col, int row,
-                                 uint8_t *dst )
-{
-   assert(0);
-}
-
-
-static void
-util_format_dxt5_rgba_fetch_stub(int src_stride,
-                                 const uint8_t *src,
-                                 int col, int row,
-                                 uint8_t *dst )
-{
-   assert(0);
-}
+#include "u_dxtn.h"
 
 
 static void
-util_format_dxtn_pack_stub(int src_comps,
-                           int width, int height,
-                           const uint8_t *src,
-                           enum util_format_dxtn dst_format,
-                           uint8_t *dst,
-                           int dst_stride)
+util_format_dxtn_pack_builtin(int src_comps,
+                              int width, int height,
+                              const uint8_t *src,
+                              enum util_format_dxtn dst_format,
+                              uint8_t *dst,
+                              int dst_stride)
 {
-   assert(0);
+   dxtn_compress(src_comps, width, height, src, width * src_comps,
+                 dst_format, dst, dst_stride, dxtn_default_quality());
 }
 
 
-boolean util_format_s3tc_enabled = FALSE;
+boolean util_format_s3tc_enabled = TRUE;
 
-util_format_dxtn_fetch_t util_format_dxt1_rgb_fetch = util_format_dxt1_rgb_fetch_stub;
-util_format_dxtn_fetch_t util_format_dxt1_rgba_fetch = util_format_dxt1_rgba_fetch_stub;
-util_format_dxtn_fetch_t util_format_dxt3_rgba_fetch = util_format_dxt3_rgba_fetch_stub;
-util_format_dxtn_fetch_t util_format_dxt5_rgba_fetch = util_format_dxt5_rgba_fetch_stub;
+util_format_dxtn_fetch_t util_format_dxt1_rgb_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgb_dxt1;
+util_format_dxtn_fetch_t util_format_dxt1_rgba_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgba_dxt1;
+util_format_dxtn_fetch_t util_format_dxt3_rgba_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgba_dxt3;
+util_format_dxtn_fetch_t util_format_dxt5_rgba_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgba_dxt5;
 
-util_format_dxtn_pack_t util_format_dxtn_pack = util_format_dxtn_pack_stub;
+util_format_dxtn_pack_t util_format_dxtn_pack = util_format_dxtn_pack_builtin;
 
 
+/**
+ * The DXTn codec is built in, so there is nothing to load any more.
+ */
 void
 util_format_s3tc_init(void)
 {
-   static boolean first_time = TRUE;
-   struct util_dl_library *library = NULL;
-   util_dl_proc fetch_2d_texel_rgb_dxt1;
-   util_dl_proc fetch_2d_texel_rgba_dxt1;
-   util_dl_proc fetch_2d_texel_rgba_dxt3;
-   util_dl_proc fetch_2d_texel_rgba_dxt5;
-   util_dl_proc tx_compress_dxtn;
-
-   if (!first_time)
-      return;
-   first_time = FALSE;
-
-   if (util_format_s3tc_enabled)
-      return;
-
-   library = util_dl_open(DXTN_LIBNAME);
-   if (!library) {
-      debug_printf("couldn't open " DXTN_LIBNAME ", software DXTn "
-                   "compression/decompression unavailable\n");
-      return;
-   }
-
-   fetch_2d_texel_rgb_dxt1 =
-         util_dl_get_proc_address(library, "fetch_2d_texel_rgb_dxt1");
-   fetch_2d_texel_rgba_dxt1 =
-         util_dl_get_proc_address(library, "fetch_2d_texel_rgba_dxt1");
-   fetch_2d_texel_rgba_dxt3 =
-         util_dl_get_proc_address(library, "fetch_2d_texel_rgba_dxt3");
-   fetch_2d_texel_rgba_dxt5 =
-         util_dl_get_proc_address(library, "fetch_2d_texel_rgba_dxt5");
-   tx_compress_dxtn =
-         util_dl_get_proc_address(library, "tx_compress_dxtn");
-
-   if (!util_format_dxt1_rgb_fetch ||
-       !util_format_dxt1_rgba_fetch ||
-       !util_format_dxt3_rgba_fetch ||
-       !util_format_dxt5_rgba_fetch ||
-       !util_format_dxtn_pack) {
-      debug_printf("couldn't reference all symbols in " DXTN_LIBNAME
-                   ", software DXTn compression/decompression "
-                   "unavailable\n");
-      util_dl_close(library);
-      return;
-   }
-
-   util_format_dxt1_rgb_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgb_dxt1;
-   util_format_dxt1_rgba_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgba_dxt1;
-   util_format_dxt3_rgba_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgba_dxt3;
-   util_format_dxt5_rgba_fetch = (util_format_dxtn_fetch_t)fetch_2d_texel_rgba_dxt5;
-   util_format_dxtn_pack = (util_format_dxtn_pack_t)tx_compress_dxtn;
-   util_format_s3tc_enabled = TRUE;
 }
 
 
@@ -409,6 +314,14 @@ util_format_dxtn_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride,
 {
    const unsigned bw = 4, bh = 4, comps = 4;
    unsigned x, y, i, j, k;
+
+   if (!srgb) {
+      /* compress the whole rectangle at once, which is multi-threaded */
+      dxtn_compress(comps, width, height, src, src_stride,
+                    format, dst_row, dst_stride, dxtn_default_quality());
+      return;
+   }
+
    for(y = 0; y < height; y += bh) {
       uint8_t *dst = dst_row;
       for(x = 0; x < width; x += bw) {
@@ -418,12 +331,7 @@ util_format_dxtn_pack_rgba_8unorm(uint8_t *dst_row, unsigned dst_stride,
                uint8_t src_tmp;
                for(k = 0; k < 3; ++k) {
                   src_tmp = src[(y + j)*src_stride/sizeof(*src) + (x+i)*comps + k];
-                  if (srgb) {
-                     tmp[j][i][k] = util_format_linear_to_srgb_8unorm(src_tmp);
-                  }
-                  else {
-                     tmp[j][i][k] = src_tmp;
-                  }
+                  tmp[j][i][k] = util_format_linear_to_srgb_8unorm(src_tmp);
                }
                /* for sake of simplicity there's an unneeded 4th component for dxt1_rgb */
                tmp[j][i][3] = src[(y + j)*src_stride/sizeof(*src) + (x+i)*comps + 3];
@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Split the rows of an image into bands and process them in parallel.
+ *
+ * This is header-only so that core Mesa, which doesn't link with the
+ * gallium auxiliary library, can use it too.  The threads only live for
+ * the duration of one util_parallel_rows() call, so it's only worth it
+ * for a lot of work.
+ */
+
+#ifndef U_PARALLEL_H
+#define U_PARALLEL_H
+
+#include "c11/threads.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+
+#define UTIL_PARALLEL_MAX_THREADS 8
+
+
+/**
+ * Process rows [first, first + count) of the image described by data.
+ */
+typedef void (*util_parallel_rows_func)(void *data, unsigned first,
+                                        unsigned count);
+
+struct util_parallel_band
+{
+   util_parallel_rows_func func;
+   void *data;
+   unsigned first, count;
+};
+
+
+/**
+ * Number of CPUs, clamped to [1, UTIL_PARALLEL_MAX_THREADS].
+ */
+static inline unsigned
+util_parallel_max_threads(void)
+{
+   static unsigned max_threads = 0;
+
+   if (max_threads == 0) {
+      long n = 1;
+#if defined(_WIN32)
+      SYSTEM_INFO info;
+      GetSystemInfo(&info);
+      n = info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+      n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+      max_threads = n < 1 ? 1 :
+                    n > UTIL_PARALLEL_MAX_THREADS ? UTIL_PARALLEL_MAX_THREADS :
+                    (unsigned) n;
+   }
+
+   return max_threads;
+}
+
+
+static inline int
+util_parallel_band_thread(void *data)
+{
+   const struct util_parallel_band *band =
+      (const struct util_parallel_band *) data;
+
+   band->func(band->data, band->first, band->count);
+   return 0;
+}
+
+
+/**
+ * Call func on nbands bands of about the same number of rows, each one in
+ * its own thread.  nbands is clamped to the number of rows and to
+ * util_parallel_max_threads(); with a single band func is just called for
+ * all the rows.
+ */
+static inline void
+util_parallel_rows(unsigned rows, unsigned nbands,
+                   util_parallel_rows_func func, void *data)
+{
+   struct util_parallel_band bands[UTIL_PARALLEL_MAX_THREADS];
+   thrd_t threads[UTIL_PARALLEL_MAX_THREADS];
+   int started[UTIL_PARALLEL_MAX_THREADS];
+   unsigned rowsPerBand, first, i;
+
+   if (nbands > util_parallel_max_threads())
+      nbands = util_parallel_max_threads();
+   if (nbands > rows)
+      nbands = rows;
+   if (nbands <= 1) {
+      if (rows)
+         func(data, 0, rows);
+      return;
+   }
+
+   rowsPerBand = (rows + nbands - 1) / nbands;
+
+   for (i = 0, first = 0; i < nbands && first < rows;
+        i++, first += rowsPerBand) {
+      bands[i].func = func;
+      bands[i].data = data;
+      bands[i].first = first;
+      bands[i].count = rows - first < rowsPerBand ? rows - first : rowsPerBand;
+   }
+   nbands = i;
+
+   /* The calling thread does the first band itself.  If a thread can't
+    * be created its band is done here too.
+    */
+   for (i = 1; i < nbands; i++) {
+      started[i] = thrd_create(&threads[i], util_parallel_band_thread,
+                               &bands[i]) == thrd_success;
+   }
+
+   util_parallel_band_thread(&bands[0]);
+
+   for (i = 1; i < nbands; i++) {
+      if (started[i])
+         thrd_join(threads[i], NULL);
+      else
+         util_parallel_band_thread(&bands[i]);
+   }
+}
+
+
+#endif /* U_PARALLEL_H */
@@ -81,14 +81,37 @@
  * rate down.
  *
  *
+ * 3) Translated buffer cache
+ *
+ * Translating vertex buffers is expensive and the result is usually the
+ * same from frame to frame, e.g. for static meshes using doubles or other
+ * formats the hardware can't fetch. The output of such translations is kept
+ * in a small LRU cache keyed on the source buffer, the translated range and
+ * the translate key.
+ *
+ * Real buffers are also keyed on a write generation, which is bumped by
+ * every transfer, copy and clear writing to them and by stream output.
+ * This is done by hooking the corresponding pipe_context functions, and
+ * the generations are shared by all the contexts since any of them can
+ * write to the buffer. Buffers the GPU can write to in other ways, shared
+ * and persistently mapped buffers, and stream buffers are never cached.
+ *
+ * User buffers have no generation, so their entries keep a copy of the
+ * source bytes, which is compared against the current contents before the
+ * cached output is reused.
+ *
+ *
  * If there is nothing to do, it forwards every command to the driver.
  * The module also has its own CSO cache of vertex element states.
  */
 
 #include "util/u_vbuf.h"
 
+#include "os/os_thread.h"
+#include "util/u_double_list.h"
 #include "util/u_dump.h"
 #include "util/u_format.h"
+#include "util/u_hash_table.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_upload_mgr.h"
@@ -140,6 +163,42 @@ enum {
    VB_NUM = 3
 };
 
+#define U_VBUF_TRANSLATE_CACHE_SIZE     8
+#define U_VBUF_TRANSLATE_CACHE_MAX_SIZE (4 * 1024 * 1024)
+
+/* Real buffers which can be written to without going through the hooked
+ * pipe_context functions. */
+#define U_VBUF_UNTRACKED_BINDINGS (PIPE_BIND_STREAM_OUTPUT | \
+                                   PIPE_BIND_GLOBAL | \
+                                   PIPE_BIND_SHADER_RESOURCE | \
+                                   PIPE_BIND_COMPUTE_RESOURCE | \
+                                   PIPE_BIND_SHARED)
+#define U_VBUF_UNTRACKED_FLAGS    (PIPE_RESOURCE_FLAG_MAP_PERSISTENT | \
+                                   PIPE_RESOURCE_FLAG_MAP_COHERENT)
+
+/* A translated vertex buffer which can be reused by later draws. */
+struct u_vbuf_translated_vb {
+   struct translate_key key;
+
+   /* The source buffer and the range that was translated. */
+   struct pipe_resource *src_buffer;
+   unsigned src_generation;
+   const void *src_user; /* the user buffer, if src_buffer is NULL */
+   void *src_data; /* copy of the user buffer range, to detect changes */
+   unsigned src_index;
+   unsigned src_offset;
+   unsigned src_stride;
+   unsigned src_size;
+   int start;
+   unsigned count;
+
+   /* The result. */
+   struct pipe_resource *out_buffer;
+   unsigned out_offset;
+
+   unsigned last_used;
+};
+
 struct u_vbuf {
    struct u_vbuf_caps caps;
 
@@ -184,14 +243,302 @@ struct u_vbuf {
    uint32_t incompatible_vb_mask; /* each bit describes a corresp. buffer */
    /* Which buffer has a non-zero stride. */
    uint32_t nonzero_stride_vb_mask; /* each bit describes a corresp. buffer */
+
+   /* Cache of translated vertex buffers. */
+   struct u_vbuf_translated_vb translated_vb[U_VBUF_TRANSLATE_CACHE_SIZE];
+   unsigned translated_vb_stamp;
+
+   /* The buffers bound for stream output, which draws write to. */
+   struct pipe_resource *so_buffers[PIPE_MAX_SO_BUFFERS];
+   unsigned num_so_buffers;
+
+   /* The pipe_context functions replaced to track buffer writes. */
+   struct list_head list;
+   void *(*transfer_map)(struct pipe_context *, struct pipe_resource *,
+                         unsigned, unsigned, const struct pipe_box *,
+                         struct pipe_transfer **);
+   void (*transfer_unmap)(struct pipe_context *, struct pipe_transfer *);
+   void (*transfer_inline_write)(struct pipe_context *,
+                                 struct pipe_resource *, unsigned, unsigned,
+                                 const struct pipe_box *, const void *,
+                                 unsigned, unsigned);
+   void (*resource_copy_region)(struct pipe_context *,
+                                struct pipe_resource *, unsigned,
+                                unsigned, unsigned, unsigned,
+                                struct pipe_resource *, unsigned,
+                                const struct pipe_box *);
+   void (*clear_buffer)(struct pipe_context *, struct pipe_resource *,
+                        unsigned, unsigned, const void *, int);
+   void (*set_stream_output_targets)(struct pipe_context *, unsigned,
+                                     struct pipe_stream_output_target **,
+                                     const unsigned *);
+};
+
+/* The write generation of a buffer with cached translations. */
+struct u_vbuf_buffer_generation {
+   unsigned generation;
+   unsigned num_entries; /* cache entries using it, in all contexts */
 };
 
+/* All the contexts with a u_vbuf, and the generations of the buffers with
+ * cached translations, keyed on the pipe_resource. */
+static struct list_head u_vbuf_contexts = { &u_vbuf_contexts,
+                                            &u_vbuf_contexts };
+static struct util_hash_table *u_vbuf_generations;
+pipe_static_mutex(u_vbuf_mutex);
+
 static void *
 u_vbuf_create_vertex_elements(struct u_vbuf *mgr, unsigned count,
                               const struct pipe_vertex_element *attribs);
 static void u_vbuf_delete_vertex_elements(struct u_vbuf *mgr, void *cso);
 
 
+static unsigned
+u_vbuf_pointer_hash(void *key)
+{
+   return (unsigned)((uintptr_t)key >> 4);
+}
+
+static int
+u_vbuf_pointer_compare(void *key1, void *key2)
+{
+   return key1 != key2;
+}
+
+/* Called when a buffer has been written to. */
+static void
+u_vbuf_buffer_written(struct pipe_resource *buf)
+{
+   struct u_vbuf_buffer_generation *gen;
+
+   if (!buf || buf->target != PIPE_BUFFER)
+      return;
+
+   pipe_mutex_lock(u_vbuf_mutex);
+   gen = u_vbuf_generations ?
+            util_hash_table_get(u_vbuf_generations, buf) : NULL;
+   if (gen)
+      gen->generation++;
+   pipe_mutex_unlock(u_vbuf_mutex);
+}
+
+static unsigned
+u_vbuf_buffer_get_generation(struct pipe_resource *buf)
+{
+   struct u_vbuf_buffer_generation *gen;
+   unsigned generation;
+
+   pipe_mutex_lock(u_vbuf_mutex);
+   gen = util_hash_table_get(u_vbuf_generations, buf);
+   generation = gen->generation;
+   pipe_mutex_unlock(u_vbuf_mutex);
+
+   return generation;
+}
+
+/* Start tracking the writes to a buffer for a new cache entry, and return
+ * its current generation. */
+static boolean
+u_vbuf_buffer_track(struct pipe_resource *buf, unsigned *generation)
+{
+   struct u_vbuf_buffer_generation *gen;
+   boolean ret = FALSE;
+
+   pipe_mutex_lock(u_vbuf_mutex);
+   if (!u_vbuf_generations) {
+      u_vbuf_generations = util_hash_table_create(u_vbuf_pointer_hash,
+                                                  u_vbuf_pointer_compare);
+      if (!u_vbuf_generations)
+         goto out;
+   }
+
+   gen = util_hash_table_get(u_vbuf_generations, buf);
+   if (!gen) {
+      gen = CALLOC_STRUCT(u_vbuf_buffer_generation);
+      if (!gen)
+         goto out;
+      if (util_hash_table_set(u_vbuf_generations, buf, gen) != PIPE_OK) {
+         FREE(gen);
+         goto out;
+      }
+   }
+
+   gen->num_entries++;
+   *generation = gen->generation;
+   ret = TRUE;
+out:
+   pipe_mutex_unlock(u_vbuf_mutex);
+   return ret;
+}
+
+static void
+u_vbuf_buffer_untrack(struct pipe_resource *buf)
+{
+   struct u_vbuf_buffer_generation *gen;
+
+   pipe_mutex_lock(u_vbuf_mutex);
+   gen = util_hash_table_get(u_vbuf_generations, buf);
+   if (--gen->num_entries == 0) {
+      util_hash_table_remove(u_vbuf_generations, buf);
+      FREE(gen);
+   }
+   pipe_mutex_unlock(u_vbuf_mutex);
+}
+
+static struct u_vbuf *
+u_vbuf_from_pipe(struct pipe_context *pipe)
+{
+   struct u_vbuf *mgr, *found = NULL;
+
+   pipe_mutex_lock(u_vbuf_mutex);
+   LIST_FOR_EACH_ENTRY(mgr, &u_vbuf_contexts, list) {
+      if (mgr->pipe == pipe) {
+         found = mgr;
+         break;
+      }
+   }
+   pipe_mutex_unlock(u_vbuf_mutex);
+
+   assert(found);
+   return found;
+}
+
+static void *
+u_vbuf_transfer_map(struct pipe_context *pipe,
+                    struct pipe_resource *resource,
+                    unsigned level, unsigned usage,
+                    const struct pipe_box *box,
+                    struct pipe_transfer **transfer)
+{
+   struct u_vbuf *mgr = u_vbuf_from_pipe(pipe);
+
+   return mgr->transfer_map(pipe, resource, level, usage, box, transfer);
+}
+
+static void
+u_vbuf_transfer_unmap(struct pipe_context *pipe,
+                      struct pipe_transfer *transfer)
+{
+   struct u_vbuf *mgr = u_vbuf_from_pipe(pipe);
+
+   /* The writes through the mapping are done. */
+   if (transfer->usage & PIPE_TRANSFER_WRITE)
+      u_vbuf_buffer_written(transfer->resource);
+
+   mgr->transfer_unmap(pipe, transfer);
+}
+
+static void
+u_vbuf_transfer_inline_write(struct pipe_context *pipe,
+                             struct pipe_resource *resource,
+                             unsigned level, unsigned usage,
+                             const struct pipe_box *box,
+                             const void *data,
+                             unsigned stride, unsigned layer_stride)
+{
+   struct u_vbuf *mgr = u_vbuf_from_pipe(pipe);
+
+   mgr->transfer_inline_write(pipe, resource, level, usage, box, data,
+                              stride, layer_stride);
+   u_vbuf_buffer_written(resource);
+}
+
+static void
+u_vbuf_resource_copy_region(struct pipe_context *pipe,
+                            struct pipe_resource *dst,
+                            unsigned dst_level,
+                            unsigned dstx, unsigned dsty, unsigned dstz,
+                            struct pipe_resource *src,
+                            unsigned src_level,
+                            const struct pipe_box *src_box)
+{
+   struct u_vbuf *mgr = u_vbuf_from_pipe(pipe);
+
+   mgr->resource_copy_region(pipe, dst, dst_level, dstx, dsty, dstz,
+                             src, src_level, src_box);
+   u_vbuf_buffer_written(dst);
+}
+
+static void
+u_vbuf_clear_buffer(struct pipe_context *pipe,
+                    struct pipe_resource *res,
+                    unsigned offset, unsigned size,
+                    const void *clear_value, int clear_value_size)
+{
+   struct u_vbuf *mgr = u_vbuf_from_pipe(pipe);
+
+   mgr->clear_buffer(pipe, res, offset, size, clear_value, clear_value_size);
+   u_vbuf_buffer_written(res);
+}
+
+static void
+u_vbuf_set_stream_output_targets(struct pipe_context *pipe,
+                                 unsigned num_targets,
+                                 struct pipe_stream_output_target **targets,
+                                 const unsigned *offsets)
+{
+   struct u_vbuf *mgr = u_vbuf_from_pipe(pipe);
+   unsigned i;
+
+   /* The draws since the targets were bound may have written to them. */
+   for (i = 0; i < mgr->num_so_buffers; i++) {
+      u_vbuf_buffer_written(mgr->so_buffers[i]);
+      pipe_resource_reference(&mgr->so_buffers[i], NULL);
+   }
+
+   for (i = 0; i < num_targets; i++) {
+      pipe_resource_reference(&mgr->so_buffers[i],
+                              targets[i] ? targets[i]->buffer : NULL);
+   }
+   mgr->num_so_buffers = num_targets;
+
+   mgr->set_stream_output_targets(pipe, num_targets, targets, offsets);
+}
+
+static void
+u_vbuf_hook_context(struct u_vbuf *mgr)
+{
+   struct pipe_context *pipe = mgr->pipe;
+
+   pipe_mutex_lock(u_vbuf_mutex);
+   LIST_ADDTAIL(&mgr->list, &u_vbuf_contexts);
+   pipe_mutex_unlock(u_vbuf_mutex);
+
+   mgr->transfer_map = pipe->transfer_map;
+   mgr->transfer_unmap = pipe->transfer_unmap;
+   mgr->transfer_inline_write = pipe->transfer_inline_write;
+   mgr->resource_copy_region = pipe->resource_copy_region;
+   mgr->clear_buffer = pipe->clear_buffer;
+   mgr->set_stream_output_targets = pipe->set_stream_output_targets;
+
+   pipe->transfer_map = u_vbuf_transfer_map;
+   pipe->transfer_unmap = u_vbuf_transfer_unmap;
+   pipe->transfer_inline_write = u_vbuf_transfer_inline_write;
+   pipe->resource_copy_region = u_vbuf_resource_copy_region;
+   if (pipe->clear_buffer)
+      pipe->clear_buffer = u_vbuf_clear_buffer;
+   if (pipe->set_stream_output_targets)
+      pipe->set_stream_output_targets = u_vbuf_set_stream_output_targets;
+}
+
+static void
+u_vbuf_unhook_context(struct u_vbuf *mgr)
+{
+   struct pipe_context *pipe = mgr->pipe;
+
+   pipe->transfer_map = mgr->transfer_map;
+   pipe->transfer_unmap = mgr->transfer_unmap;
+   pipe->transfer_inline_write = mgr->transfer_inline_write;
+   pipe->resource_copy_region = mgr->resource_copy_region;
+   pipe->clear_buffer = mgr->clear_buffer;
+   pipe->set_stream_output_targets = mgr->set_stream_output_targets;
+
+   pipe_mutex_lock(u_vbuf_mutex);
+   LIST_DEL(&mgr->list);
+   pipe_mutex_unlock(u_vbuf_mutex);
+}
+
+
 void u_vbuf_get_caps(struct pipe_screen *screen, struct u_vbuf_caps *caps)
 {
    caps->format_fixed32 =
@@ -250,6 +597,8 @@ u_vbuf_create(struct pipe_context *pipe,
    mgr->uploader = u_upload_create(pipe, 1024 * 1024, 4,
                                    PIPE_BIND_VERTEX_BUFFER);
 
+   u_vbuf_hook_context(mgr);
+
    return mgr;
 }
 
@@ -300,6 +649,17 @@ void u_vbuf_set_vertex_elements(struct u_vbuf *mgr, unsigned count,
    mgr->ve = u_vbuf_set_vertex_elements_internal(mgr, count, states);
 }
 
+static void
+u_vbuf_translated_vb_release(struct u_vbuf_translated_vb *entry)
+{
+   if (entry->src_buffer)
+      u_vbuf_buffer_untrack(entry->src_buffer);
+   pipe_resource_reference(&entry->src_buffer, NULL);
+   pipe_resource_reference(&entry->out_buffer, NULL);
+   FREE(entry->src_data);
+   memset(entry, 0, sizeof(*entry));
+}
+
 void u_vbuf_destroy(struct u_vbuf *mgr)
 {
    struct pipe_screen *screen = mgr->pipe->screen;
@@ -320,12 +680,118 @@ void u_vbuf_destroy(struct u_vbuf *mgr)
    }
    pipe_resource_reference(&mgr->aux_vertex_buffer_saved.buffer, NULL);
 
+   for (i = 0; i < U_VBUF_TRANSLATE_CACHE_SIZE; i++) {
+      u_vbuf_translated_vb_release(&mgr->translated_vb[i]);
+   }
+   for (i = 0; i < mgr->num_so_buffers; i++) {
+      pipe_resource_reference(&mgr->so_buffers[i], NULL);
+   }
+
+   u_vbuf_unhook_context(mgr);
+
    translate_cache_destroy(mgr->translate_cache);
    u_upload_destroy(mgr->uploader);
    cso_cache_delete(mgr->cso_cache);
    FREE(mgr);
 }
 
+/* Whether translations of the given vertex buffer range can be cached. */
+static boolean
+u_vbuf_translated_vb_cacheable(const struct pipe_vertex_buffer *vb,
+                               unsigned size)
+{
+   if (vb->user_buffer)
+      return size <= U_VBUF_TRANSLATE_CACHE_MAX_SIZE;
+
+   return vb->buffer->usage != PIPE_USAGE_STREAM &&
+          !(vb->buffer->bind & U_VBUF_UNTRACKED_BINDINGS) &&
+          !(vb->buffer->flags & U_VBUF_UNTRACKED_FLAGS);
+}
+
+/* Return a cached translation of the given source range, or NULL.
+ * The contents of user buffers must be mapped, so that they can be
+ * compared with the contents at the time of the translation. */
+static struct u_vbuf_translated_vb *
+u_vbuf_translated_vb_find(struct u_vbuf *mgr, const struct translate_key *key,
+                          unsigned src_index, const struct pipe_vertex_buffer *vb,
+                          unsigned src_offset, unsigned src_size,
+                          const void *src_map, int start, unsigned count)
+{
+   unsigned i;
+
+   for (i = 0; i < U_VBUF_TRANSLATE_CACHE_SIZE; i++) {
+      struct u_vbuf_translated_vb *entry = &mgr->translated_vb[i];
+
+      if ((!entry->src_buffer && !entry->src_user) ||
+          entry->src_buffer != vb->buffer ||
+          entry->src_user != vb->user_buffer ||
+          entry->src_index != src_index ||
+          entry->src_offset != src_offset ||
+          entry->src_stride != vb->stride ||
+          entry->src_size != src_size ||
+          entry->start != start ||
+          entry->count != count ||
+          translate_key_compare(&entry->key, key) != 0) {
+         continue;
+      }
+
+      /* The buffer has been written to since. */
+      if (entry->src_buffer ?
+             entry->src_generation !=
+                u_vbuf_buffer_get_generation(entry->src_buffer) :
+             memcmp(entry->src_data, src_map, src_size) != 0) {
+         u_vbuf_translated_vb_release(entry);
+         return NULL;
+      }
+
+      entry->last_used = ++mgr->translated_vb_stamp;
+      return entry;
+   }
+   return NULL;
+}
+
+static void
+u_vbuf_translated_vb_add(struct u_vbuf *mgr, const struct translate_key *key,
+                         unsigned src_index, const struct pipe_vertex_buffer *vb,
+                         unsigned src_offset, unsigned src_size,
+                         const void *src_map, int start, unsigned count,
+                         struct pipe_resource *out_buffer, unsigned out_offset)
+{
+   struct u_vbuf_translated_vb *entry = &mgr->translated_vb[0];
+   unsigned i;
+
+   /* Replace the least recently used entry. */
+   for (i = 1; i < U_VBUF_TRANSLATE_CACHE_SIZE; i++) {
+      if (mgr->translated_vb[i].last_used < entry->last_used) {
+         entry = &mgr->translated_vb[i];
+      }
+   }
+   u_vbuf_translated_vb_release(entry);
+
+   if (vb->user_buffer) {
+      entry->src_data = MALLOC(src_size);
+      if (!entry->src_data)
+         return;
+      memcpy(entry->src_data, src_map, src_size);
+      entry->src_user = vb->user_buffer;
+   } else {
+      if (!u_vbuf_buffer_track(vb->buffer, &entry->src_generation))
+         return;
+      pipe_resource_reference(&entry->src_buffer, vb->buffer);
+   }
+
+   memcpy(&entry->key, key, sizeof(*key));
+   entry->src_index = src_index;
+   entry->src_offset = src_offset;
+   entry->src_stride = vb->stride;
+   entry->src_size = src_size;
+   entry->start = start;
+   entry->count = count;
+   pipe_resource_reference(&entry->out_buffer, out_buffer);
+   entry->out_offset = out_offset;
+   entry->last_used = ++mgr->translated_vb_stamp;
+}
+
 static enum pipe_error
 u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
                          unsigned vb_mask, unsigned out_vb,
@@ -339,6 +805,11 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
    uint8_t *out_map;
    unsigned out_offset, mask;
    enum pipe_error err;
+   /* Only translations of a single buffer are cached. */
+   boolean cacheable = !unroll_indices && util_bitcount(vb_mask) == 1;
+   const struct pipe_vertex_buffer *src_vb = NULL;
+   const uint8_t *src_map = NULL;
+   unsigned src_index = 0, src_offset = 0, src_size = 0;
 
    /* Get a translate object. */
    tr = translate_cache_find(mgr->translate_cache, key);
@@ -347,19 +818,17 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
    mask = vb_mask;
    while (mask) {
       struct pipe_vertex_buffer *vb;
-      unsigned offset;
+      unsigned offset, size;
       uint8_t *map;
       unsigned i = u_bit_scan(&mask);
 
       vb = &mgr->vertex_buffer[i];
       offset = vb->buffer_offset + vb->stride * start_vertex;
+      size = vb->stride ? num_vertices * vb->stride : sizeof(double)*4;
 
       if (vb->user_buffer) {
          map = (uint8_t*)vb->user_buffer + offset;
       } else {
-         unsigned size = vb->stride ? num_vertices * vb->stride
-                                    : sizeof(double)*4;
-
          if (offset+size > vb->buffer->width0) {
             size = vb->buffer->width0 - offset;
          }
@@ -368,6 +837,14 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
                                      PIPE_TRANSFER_READ, &vb_transfer[i]);
       }
 
+      if (cacheable && map && u_vbuf_translated_vb_cacheable(vb, size)) {
+         src_vb = vb;
+         src_map = map;
+         src_index = i;
+         src_offset = offset;
+         src_size = size;
+      }
+
       /* Subtract min_index so that indexing with the index buffer works. */
       if (unroll_indices) {
          map -= (ptrdiff_t)vb->stride * min_index;
@@ -417,6 +894,20 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
          pipe_buffer_unmap(mgr->pipe, transfer);
       }
    } else {
+      struct u_vbuf_translated_vb *cached = NULL;
+
+      if (src_vb) {
+         cached = u_vbuf_translated_vb_find(mgr, key, src_index, src_vb,
+                                            src_offset, src_size, src_map,
+                                            start_vertex, num_vertices);
+      }
+
+      if (cached) {
+         pipe_resource_reference(&out_buffer, cached->out_buffer);
+         out_offset = cached->out_offset;
+         goto unmap;
+      }
+
       /* Create and map the output buffer. */
       err = u_upload_alloc(mgr->uploader,
                            key->output_stride * start_vertex,
@@ -429,8 +920,16 @@ u_vbuf_translate_buffers(struct u_vbuf *mgr, struct translate_key *key,
       out_offset -= key->output_stride * start_vertex;
 
       tr->run(tr, 0, num_vertices, 0, 0, out_map);
+
+      if (src_vb) {
+         u_vbuf_translated_vb_add(mgr, key, src_index, src_vb,
+                                  src_offset, src_size, src_map,
+                                  start_vertex, num_vertices,
+                                  out_buffer, out_offset);
+      }
    }
 
+unmap:
    /* Unmap all buffers. */
    mask = vb_mask;
    while (mask) {
@@ -1134,6 +1633,12 @@ void u_vbuf_draw_vbo(struct u_vbuf *mgr, const struct pipe_draw_info *info)
    uint32_t user_vb_mask = mgr->user_vb_mask & used_vb_mask;
    uint32_t incompatible_vb_mask = mgr->incompatible_vb_mask & used_vb_mask;
    struct pipe_draw_info new_info;
+   unsigned i;
+
+   /* The draw writes to the stream output buffers. */
+   for (i = 0; i < mgr->num_so_buffers; i++) {
+      u_vbuf_buffer_written(mgr->so_buffers[i]);
+   }
 
    /* Normal draw. No fallback and no user buffers. */
    if (!incompatible_vb_mask &&
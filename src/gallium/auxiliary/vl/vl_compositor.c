@@ -508,9 +508,7 @@ init_buffers(struct vl_compositor *c)
    /*
     * Create our vertex buffer and vertex buffer elements
     */
-   c->vertex_buf.stride = sizeof(struct vertex2f) + sizeof(struct vertex4f) * 2;
-   c->vertex_buf.buffer_offset = 0;
-   c->vertex_buf.buffer = NULL;
+   c->vertex_stride = sizeof(struct vertex2f) + sizeof(struct vertex4f) * 2;
 
    vertex_elems[0].src_offset = 0;
    vertex_elems[0].instance_divisor = 0;
@@ -535,7 +533,6 @@ cleanup_buffers(struct vl_compositor *c)
    assert(c);
 
    c->pipe->delete_vertex_elements_state(c->pipe, c->vertex_elems_state);
-   pipe_resource_reference(&c->vertex_buf.buffer, NULL);
 }
 
 static INLINE struct u_rect
@@ -708,22 +705,21 @@ calc_drawn_area(struct vl_compositor_state *s, struct vl_compositor_layer *layer
 static void
 gen_vertex_data(struct vl_compositor *c, struct vl_compositor_state *s, struct u_rect *dirty)
 {
+   bool upload = !s->vertex_buf.buffer || s->uploaded_layers != s->used_layers;
    struct vertex2f *vb;
    unsigned i;
 
    assert(c);
 
-   /* Allocate new memory for vertices. */
-   u_upload_alloc(c->upload, 0,
-                  c->vertex_buf.stride * VL_COMPOSITOR_MAX_LAYERS * 4, /* size */
-                  &c->vertex_buf.buffer_offset, &c->vertex_buf.buffer,
-                  (void**)&vb);
-
    for (i = 0; i < VL_COMPOSITOR_MAX_LAYERS; i++) {
       if (s->used_layers & (1 << i)) {
          struct vl_compositor_layer *layer = &s->layers[i];
-         gen_rect_verts(vb, layer);
-         vb += 20;
+
+         if (layer->dirty) {
+            gen_rect_verts(layer->vertices, layer);
+            layer->dirty = false;
+            upload = true;
+         }
 
          if (!layer->viewport_valid) {
             layer->viewport.scale[0] = c->fb_state.width;
@@ -748,32 +744,98 @@ gen_vertex_data(struct vl_compositor *c, struct vl_compositor_state *s, struct u
       }
    }
 
+   if (!upload || !s->used_layers)
+      return;
+
+   /* Pack the quads of all layers into one upload. */
+   s->vertex_buf.stride = c->vertex_stride;
+   u_upload_alloc(c->upload, 0,
+                  c->vertex_stride * util_bitcount(s->used_layers) * 4, /* size */
+                  &s->vertex_buf.buffer_offset, &s->vertex_buf.buffer,
+                  (void**)&vb);
+   if (!vb)
+      return;
+
+   for (i = 0; i < VL_COMPOSITOR_MAX_LAYERS; i++) {
+      if (s->used_layers & (1 << i)) {
+         memcpy(vb, s->layers[i].vertices, sizeof(s->layers[i].vertices));
+         vb += Elements(s->layers[i].vertices);
+      }
+   }
+
    u_upload_unmap(c->upload);
+   s->uploaded_layers = s->used_layers;
+}
+
+static INLINE unsigned
+num_sampler_views(struct vl_compositor_layer *layer)
+{
+   struct pipe_sampler_view **samplers = &layer->sampler_views[0];
+   return !samplers[1] ? 1 : !samplers[2] ? 2 : 3;
+}
+
+/**
+ * Whether layer b can be drawn together with layer a, in the same draw.
+ */
+static INLINE bool
+same_draw_state(struct vl_compositor_layer *a, void *blend_a,
+                struct vl_compositor_layer *b, void *blend_b)
+{
+   unsigned i, n = num_sampler_views(a);
+
+   if (blend_a != blend_b || a->fs != b->fs || n != num_sampler_views(b) ||
+       memcmp(&a->viewport, &b->viewport, sizeof(a->viewport)))
+      return false;
+
+   for (i = 0; i < n; ++i)
+      if (a->samplers[i] != b->samplers[i] ||
+          a->sampler_views[i] != b->sampler_views[i])
+         return false;
+
+   return true;
 }
 
 static void
 draw_layers(struct vl_compositor *c, struct vl_compositor_state *s, struct u_rect *dirty)
 {
-   unsigned vb_index, i;
+   struct vl_compositor_layer *prev = NULL;
+   void *prev_blend = NULL;
+   unsigned vb_index, first = 0, i;
 
    assert(c);
 
+   /*
+    * Consecutive layers with the same state are drawn with one draw call,
+    * their quads are next to each other in the vertex buffer. Otherwise only
+    * the state which differs from the previous layer is bound.
+    */
    for (i = 0, vb_index = 0; i < VL_COMPOSITOR_MAX_LAYERS; ++i) {
       if (s->used_layers & (1 << i)) {
          struct vl_compositor_layer *layer = &s->layers[i];
          struct pipe_sampler_view **samplers = &layer->sampler_views[0];
-         unsigned num_sampler_views = !samplers[1] ? 1 : !samplers[2] ? 2 : 3;
+         unsigned num_views = num_sampler_views(layer);
          void *blend = layer->blend ? layer->blend : i ? c->blend_add : c->blend_clear;
 
-         c->pipe->bind_blend_state(c->pipe, blend);
-         c->pipe->set_viewport_states(c->pipe, 0, 1, &layer->viewport);
-         c->pipe->bind_fs_state(c->pipe, layer->fs);
-         c->pipe->bind_sampler_states(c->pipe, PIPE_SHADER_FRAGMENT, 0,
-                                      num_sampler_views, layer->samplers);
-         c->pipe->set_sampler_views(c->pipe, PIPE_SHADER_FRAGMENT, 0,
-                                    num_sampler_views, samplers);
-
-         util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, vb_index * 4, 4);
+         if (!prev || !same_draw_state(prev, prev_blend, layer, blend)) {
+            if (prev)
+               util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, first * 4,
+                                (vb_index - first) * 4);
+            first = vb_index;
+
+            if (!prev || blend != prev_blend)
+               c->pipe->bind_blend_state(c->pipe, blend);
+            if (!prev || memcmp(&layer->viewport, &prev->viewport, sizeof(layer->viewport)))
+               c->pipe->set_viewport_states(c->pipe, 0, 1, &layer->viewport);
+            if (!prev || layer->fs != prev->fs)
+               c->pipe->bind_fs_state(c->pipe, layer->fs);
+            c->pipe->bind_sampler_states(c->pipe, PIPE_SHADER_FRAGMENT, 0,
+                                         num_views, layer->samplers);
+            c->pipe->set_sampler_views(c->pipe, PIPE_SHADER_FRAGMENT, 0,
+                                       num_views, samplers);
+
+            prev = layer;
+            prev_blend = blend;
+         }
          vb_index++;
 
          if (dirty) {
@@ -786,6 +848,10 @@ draw_layers(struct vl_compositor *c, struct vl_compositor_state *s, struct u_rec
          }
       }
    }
+
+   if (prev)
+      util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, first * 4,
+                       (vb_index - first) * 4);
 }
 
 void
@@ -833,6 +899,7 @@ vl_compositor_clear_layers(struct vl_compositor_state *s)
       s->layers[i].viewport.translate[2] = 0;
       s->layers[i].viewport.translate[3] = 0;
       s->layers[i].rotate = VL_COMPOSITOR_ROTATE_0;
+      s->layers[i].dirty = true;
 
       for ( j = 0; j < 3; j++)
          pipe_sampler_view_reference(&s->layers[i].sampler_views[j], NULL);
@@ -932,6 +999,7 @@ vl_compositor_set_buffer_layer(struct vl_compositor_state *s,
    assert(layer < VL_COMPOSITOR_MAX_LAYERS);
 
    s->used_layers |= 1 << layer;
+   s->layers[layer].dirty = true;
    sampler_views = buffer->get_sampler_view_components(buffer);
    for (i = 0; i < 3; ++i) {
       s->layers[layer].samplers[i] = c->sampler_linear;
@@ -983,6 +1051,7 @@ vl_compositor_set_palette_layer(struct vl_compositor_state *s,
    assert(layer < VL_COMPOSITOR_MAX_LAYERS);
 
    s->used_layers |= 1 << layer;
+   s->layers[layer].dirty = true;
 
    s->layers[layer].fs = include_color_conversion ?
       c->fs_palette.yuv : c->fs_palette.rgb;
@@ -1014,6 +1083,7 @@ vl_compositor_set_rgba_layer(struct vl_compositor_state *s,
    assert(layer < VL_COMPOSITOR_MAX_LAYERS);
 
    s->used_layers |= 1 << layer;
+   s->layers[layer].dirty = true;
    s->layers[layer].fs = c->fs_rgba;
    s->layers[layer].samplers[0] = c->sampler_linear;
    s->layers[layer].samplers[1] = NULL;
@@ -1038,6 +1108,7 @@ vl_compositor_set_layer_rotation(struct vl_compositor_state *s,
    assert(s);
    assert(layer < VL_COMPOSITOR_MAX_LAYERS);
    s->layers[layer].rotate = rotate;
+   s->layers[layer].dirty = true;
 }
 
 void
@@ -1075,7 +1146,7 @@ vl_compositor_render(struct vl_compositor_state *s,
    c->pipe->set_scissor_states(c->pipe, 0, 1, &s->scissor);
    c->pipe->set_framebuffer_state(c->pipe, &c->fb_state);
    c->pipe->bind_vs_state(c->pipe, c->vs);
-   c->pipe->set_vertex_buffers(c->pipe, 0, 1, &c->vertex_buf);
+   c->pipe->set_vertex_buffers(c->pipe, 0, 1, &s->vertex_buf);
    c->pipe->bind_vertex_elements_state(c->pipe, c->vertex_elems_state);
    pipe_set_constant_buffer(c->pipe, PIPE_SHADER_FRAGMENT, 0, s->csc_matrix);
    c->pipe->bind_rasterizer_state(c->pipe, c->rast);
@@ -1160,4 +1231,5 @@ vl_compositor_cleanup_state(struct vl_compositor_state *s)
 
    vl_compositor_clear_layers(s);
    pipe_resource_reference(&s->csc_matrix, NULL);
+   pipe_resource_reference(&s->vertex_buf.buffer, NULL);
 }
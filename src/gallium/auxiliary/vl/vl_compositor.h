@@ -80,6 +80,10 @@ struct vl_compositor_layer
    struct vertex2f zw;
    struct vertex4f colors[4];
    enum vl_compositor_rotation rotate;
+
+   /* vertices of the layer's quad, regenerated only when dirty */
+   bool dirty;
+   struct vertex2f vertices[20];
 };
 
 struct vl_compositor_state
@@ -94,6 +98,10 @@ struct vl_compositor_state
 
    unsigned used_layers:VL_COMPOSITOR_MAX_LAYERS;
    struct vl_compositor_layer layers[VL_COMPOSITOR_MAX_LAYERS];
+
+   /* quads of all used layers, reused as long as no layer changes */
+   struct pipe_vertex_buffer vertex_buf;
+   unsigned uploaded_layers:VL_COMPOSITOR_MAX_LAYERS;
 };
 
 struct vl_compositor
@@ -102,7 +110,7 @@ struct vl_compositor
    struct u_upload_mgr *upload;
 
    struct pipe_framebuffer_state fb_state;
-   struct pipe_vertex_buffer vertex_buf;
+   unsigned vertex_stride;
 
    void *sampler_linear;
    void *sampler_nearest;
@@ -27,6 +27,9 @@
  **************************************************************************/
 
 #include "pipe/p_video_codec.h"
+#include "os/os_thread.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_debug.h"
 #include "util/u_memory.h"
 
 #include "vl_vlc.h"
@@ -52,6 +55,66 @@ struct dct_coeff_compressed
    struct dct_coeff coeff;
 };
 
+#define VL_MPG12_BS_MAX_THREADS 8
+
+/* size of the dct blocks of a macroblock, in shorts */
+#define VL_MPG12_BS_MB_BLOCKS (64 * 6)
+
+/*
+ * Slices are parsed in parallel by a pool of worker threads. Each worker
+ * collects the macroblocks of its slices in its own output buffer, and
+ * once the whole picture is parsed the calling thread hands them to the
+ * decoder in bitstream order, so decode_macroblock is never called
+ * concurrently.
+ */
+struct vl_mpg12_bs_output
+{
+   struct pipe_mpeg12_macroblock *mbs;
+   short *blocks;
+   unsigned num_mbs, max_mbs;
+};
+
+struct vl_mpg12_bs_slice
+{
+   /* bitstream position right after the slice start code */
+   struct vl_vlc vlc;
+
+   /* worker which parsed the slice, and its macroblocks in that
+    * worker's output */
+   unsigned worker;
+   unsigned first_mb, num_mbs;
+};
+
+struct vl_mpg12_bs_worker
+{
+   struct vl_mpg12_bs_pool *pool;
+
+   /* private parser state, decoder and picture are copied from the
+    * parent */
+   struct vl_mpg12_bs bs;
+   struct vl_mpg12_bs_output output;
+
+   pipe_thread thread;
+   pipe_semaphore start;
+};
+
+struct vl_mpg12_bs_pool
+{
+   /* worker 0 is the thread calling vl_mpg12_bs_decode */
+   struct vl_mpg12_bs_worker workers[VL_MPG12_BS_MAX_THREADS];
+   unsigned num_workers;
+
+   pipe_semaphore done;
+   boolean quit;
+
+   struct pipe_video_buffer *target;
+   struct vl_mpg12_bs_slice *slices;
+   unsigned num_slices, max_slices;
+
+   pipe_mutex mutex;
+   unsigned next_slice;
+};
+
 /* coding table as found in the spec annex B.5 table B-1 */
 static const struct vl_vlc_compressed macroblock_address_increment[] = {
    { 0x8000, { 1, 1 } },
@@ -805,6 +868,53 @@ entry:
       vl_vlc_eatbits(&bs->vlc, 1);
 }
 
+/**
+ * Hand a macroblock to the decoder, or queue it in the output of the
+ * worker thread parsing the slice.
+ */
+static void
+emit_macroblock(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target,
+                const struct pipe_mpeg12_macroblock *mb)
+{
+   struct vl_mpg12_bs_output *out = bs->output;
+   unsigned n;
+
+   if (!out) {
+      bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base, &mb->base, 1);
+      return;
+   }
+
+   n = out->num_mbs;
+   if (n == out->max_mbs) {
+      unsigned max_mbs = MAX2(out->max_mbs * 2, 64);
+      struct pipe_mpeg12_macroblock *mbs;
+      short *blocks;
+
+      mbs = REALLOC(out->mbs, out->max_mbs * sizeof(*mbs),
+                    max_mbs * sizeof(*mbs));
+      if (!mbs)
+         return;
+      out->mbs = mbs;
+
+      blocks = REALLOC(out->blocks,
+                       out->max_mbs * VL_MPG12_BS_MB_BLOCKS * sizeof(short),
+                       max_mbs * VL_MPG12_BS_MB_BLOCKS * sizeof(short));
+      if (!blocks)
+         return;
+      out->blocks = blocks;
+
+      out->max_mbs = max_mbs;
+   }
+
+   /* the blocks pointer is fixed up when the output is submitted, the
+    * array might still move */
+   out->mbs[n] = *mb;
+   if (mb->macroblock_type & (PIPE_MPEG12_MB_TYPE_INTRA | PIPE_MPEG12_MB_TYPE_PATTERN))
+      memcpy(out->blocks + n * VL_MPG12_BS_MB_BLOCKS, mb->blocks,
+             VL_MPG12_BS_MB_BLOCKS * sizeof(short));
+   out->num_mbs++;
+}
+
 static INLINE void
 decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
 {
@@ -852,7 +962,7 @@ decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
          if (!inc)
             return;
          mb.num_skipped_macroblocks = inc - 1;
-         bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base, &mb.base, 1);
+         emit_macroblock(bs, target, &mb);
       }
       mb.x = x += inc;
       if (bs->decoder->profile == PIPE_VIDEO_PROFILE_MPEG1) {
@@ -961,11 +1071,202 @@ decode_slice(struct vl_mpg12_bs *bs, struct pipe_video_buffer *target)
    } while (vl_vlc_bits_left(&bs->vlc) && vl_vlc_peekbits(&bs->vlc, 23));
 
    mb.num_skipped_macroblocks = 0;
-   bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base, &mb.base, 1);
+   emit_macroblock(bs, target, &mb);
+}
+
+/**
+ * Parse slices of the picture until there are none left.
+ */
+static void
+decode_slices(struct vl_mpg12_bs_worker *worker)
+{
+   struct vl_mpg12_bs_pool *pool = worker->pool;
+   unsigned index = worker - pool->workers;
+
+   worker->output.num_mbs = 0;
+
+   while (1) {
+      struct vl_mpg12_bs_slice *slice;
+      unsigned i;
+
+      pipe_mutex_lock(pool->mutex);
+      i = pool->next_slice++;
+      pipe_mutex_unlock(pool->mutex);
+
+      if (i >= pool->num_slices)
+         break;
+
+      slice = &pool->slices[i];
+      slice->worker = index;
+      slice->first_mb = worker->output.num_mbs;
+
+      worker->bs.vlc = slice->vlc;
+      decode_slice(&worker->bs, pool->target);
+
+      slice->num_mbs = worker->output.num_mbs - slice->first_mb;
+   }
+}
+
+static PIPE_THREAD_ROUTINE(worker_thread, param)
+{
+   struct vl_mpg12_bs_worker *worker = param;
+   struct vl_mpg12_bs_pool *pool = worker->pool;
+
+   while (1) {
+      pipe_semaphore_wait(&worker->start);
+      if (pool->quit)
+         break;
+
+      decode_slices(worker);
+      pipe_semaphore_signal(&pool->done);
+   }
+
+   return 0;
 }
 
 void
-vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder)
+vl_mpg12_bs_destroy_pool(struct vl_mpg12_bs_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   pool->quit = TRUE;
+   for (i = 1; i < pool->num_workers; ++i) {
+      pipe_semaphore_signal(&pool->workers[i].start);
+      pipe_thread_wait(pool->workers[i].thread);
+   }
+
+   for (i = 0; i < pool->num_workers; ++i) {
+      pipe_semaphore_destroy(&pool->workers[i].start);
+      FREE(pool->workers[i].output.mbs);
+      FREE(pool->workers[i].output.blocks);
+   }
+
+   pipe_semaphore_destroy(&pool->done);
+   pipe_mutex_destroy(pool->mutex);
+   FREE(pool->slices);
+   FREE(pool);
+}
+
+/**
+ * Start the slice parsing threads, the number of threads can be set with
+ * VL_MPEG12_THREADS. Returns NULL if slices should be parsed serially.
+ */
+struct vl_mpg12_bs_pool *
+vl_mpg12_bs_create_pool(struct pipe_video_codec *decoder)
+{
+   struct vl_mpg12_bs_pool *pool;
+   unsigned num_threads, i;
+
+   util_cpu_detect();
+   num_threads = debug_get_num_option("VL_MPEG12_THREADS",
+                                      util_cpu_caps.nr_cpus);
+   num_threads = MIN2(num_threads, VL_MPG12_BS_MAX_THREADS);
+   if (num_threads <= 1)
+      return NULL;
+
+   pool = CALLOC_STRUCT(vl_mpg12_bs_pool);
+   if (!pool)
+      return NULL;
+
+   pipe_mutex_init(pool->mutex);
+   pipe_semaphore_init(&pool->done, 0);
+
+   for (i = 0; i < num_threads; ++i) {
+      struct vl_mpg12_bs_worker *worker = &pool->workers[i];
+
+      worker->pool = pool;
+      worker->bs.decoder = decoder;
+      worker->bs.output = &worker->output;
+      pipe_semaphore_init(&worker->start, 0);
+
+      if (i > 0) {
+         worker->thread = pipe_thread_create(worker_thread, worker);
+         if (!worker->thread) {
+            pipe_semaphore_destroy(&worker->start);
+            break;
+         }
+      }
+      pool->num_workers++;
+   }
+
+   if (pool->num_workers <= 1) {
+      vl_mpg12_bs_destroy_pool(pool);
+      return NULL;
+   }
+
+   return pool;
+}
+
+static boolean
+add_slice(struct vl_mpg12_bs_pool *pool, const struct vl_vlc *vlc)
+{
+   if (pool->num_slices == pool->max_slices) {
+      unsigned max_slices = MAX2(pool->max_slices * 2, 64);
+      struct vl_mpg12_bs_slice *slices;
+
+      slices = REALLOC(pool->slices, pool->max_slices * sizeof(*slices),
+                       max_slices * sizeof(*slices));
+      if (!slices)
+         return FALSE;
+
+      pool->slices = slices;
+      pool->max_slices = max_slices;
+   }
+
+   pool->slices[pool->num_slices++].vlc = *vlc;
+   return TRUE;
+}
+
+/**
+ * Parse the collected slices on all threads and submit the macroblocks.
+ */
+static void
+decode_pool_slices(struct vl_mpg12_bs *bs, struct vl_mpg12_bs_pool *pool,
+                   struct pipe_video_buffer *target)
+{
+   unsigned num_workers = MIN2(pool->num_workers, pool->num_slices);
+   unsigned i, j;
+
+   for (i = 0; i < num_workers; ++i) {
+      pool->workers[i].bs.desc = bs->desc;
+      pool->workers[i].bs.intra_dct_tbl = bs->intra_dct_tbl;
+   }
+
+   pool->target = target;
+   pool->next_slice = 0;
+
+   for (i = 1; i < num_workers; ++i)
+      pipe_semaphore_signal(&pool->workers[i].start);
+
+   decode_slices(&pool->workers[0]);
+
+   for (i = 1; i < num_workers; ++i)
+      pipe_semaphore_wait(&pool->done);
+
+   for (i = 0; i < pool->num_slices; ++i) {
+      struct vl_mpg12_bs_slice *slice = &pool->slices[i];
+      struct vl_mpg12_bs_output *out = &pool->workers[slice->worker].output;
+
+      if (!slice->num_mbs)
+         continue;
+
+      for (j = slice->first_mb; j < slice->first_mb + slice->num_mbs; ++j)
+         out->mbs[j].blocks = out->blocks + j * VL_MPG12_BS_MB_BLOCKS;
+
+      bs->decoder->decode_macroblock(bs->decoder, target, &bs->desc->base,
+                                     &out->mbs[slice->first_mb].base,
+                                     slice->num_mbs);
+   }
+
+   pool->num_slices = 0;
+}
+
+void
+vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder,
+                 struct vl_mpg12_bs_pool *pool)
 {
    static bool tables_initialized = false;
 
@@ -974,6 +1275,7 @@ vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder)
    memset(bs, 0, sizeof(struct vl_mpg12_bs));
 
    bs->decoder = decoder;
+   bs->pool = pool;
 
    if (!tables_initialized) {
       init_tables();
@@ -989,6 +1291,8 @@ vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
                    const void * const *buffers,
                    const unsigned *sizes)
 {
+   struct vl_mpg12_bs_pool *pool = bs->pool;
+
    assert(bs);
 
    bs->desc = picture;
@@ -1000,10 +1304,15 @@ vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
 
       if (code >= 0x101 && code <= 0x1AF) {
          vl_vlc_eatbits(&bs->vlc, 24);
-         decode_slice(bs, target);
 
-         /* align to a byte again */
-         vl_vlc_eatbits(&bs->vlc, vl_vlc_valid_bits(&bs->vlc) & 7);
+         /* With threads only remember where the slice starts, the search
+          * for the next start code skips over its data. */
+         if (!pool || !add_slice(pool, &bs->vlc)) {
+            decode_slice(bs, target);
+
+            /* align to a byte again */
+            vl_vlc_eatbits(&bs->vlc, vl_vlc_valid_bits(&bs->vlc) & 7);
+         }
 
       } else {
          vl_vlc_eatbits(&bs->vlc, 8);
@@ -1011,4 +1320,7 @@ vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
 
       vl_vlc_fillbits(&bs->vlc);
    }
+
+   if (pool && pool->num_slices)
+      decode_pool_slices(bs, pool, target);
 }
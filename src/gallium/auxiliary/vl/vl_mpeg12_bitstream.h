@@ -40,10 +40,26 @@ struct vl_mpg12_bs
 
    struct vl_vlc vlc;
    short pred_dc[3];
+
+   /* where a slice parsing thread queues its macroblocks */
+   struct vl_mpg12_bs_output *output;
+
+   /* slice parsing threads, borrowed from the decoder */
+   struct vl_mpg12_bs_pool *pool;
 };
 
+/* Start the threads parsing the slices of the pictures decoded for
+ * decoder, which all its bitstream parsers can share. Returns NULL if
+ * slices should be parsed on the decoding thread. */
+struct vl_mpg12_bs_pool *
+vl_mpg12_bs_create_pool(struct pipe_video_codec *decoder);
+
+void
+vl_mpg12_bs_destroy_pool(struct vl_mpg12_bs_pool *pool);
+
 void
-vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder);
+vl_mpg12_bs_init(struct vl_mpg12_bs *bs, struct pipe_video_codec *decoder,
+                 struct vl_mpg12_bs_pool *pool);
 
 void
 vl_mpg12_bs_decode(struct vl_mpg12_bs *bs,
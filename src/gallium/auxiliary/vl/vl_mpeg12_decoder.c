@@ -498,6 +498,8 @@ vl_mpeg12_destroy(struct pipe_video_codec *decoder)
       if (dec->dec_buffers[i])
          vl_mpeg12_destroy_buffer(dec->dec_buffers[i]);
 
+   vl_mpg12_bs_destroy_pool(dec->bs_pool);
+
    dec->context->destroy(dec->context);
 
    FREE(dec);
@@ -539,7 +541,7 @@ vl_mpeg12_get_decode_buffer(struct vl_mpeg12_decoder *dec, struct pipe_video_buf
       goto error_zscan;
 
    if (dec->base.entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM)
-      vl_mpg12_bs_init(&buffer->bs, &dec->base);
+      vl_mpg12_bs_init(&buffer->bs, &dec->base, dec->bs_pool);
 
    if (dec->base.expect_chunked_decode)
       priv->buffer = buffer;
@@ -1187,6 +1189,9 @@ vl_create_mpeg12_decoder(struct pipe_context *context,
    if (!init_pipe_state(dec))
       goto error_pipe_state;
 
+   if (templat->entrypoint == PIPE_VIDEO_ENTRYPOINT_BITSTREAM)
+      dec->bs_pool = vl_mpg12_bs_create_pool(&dec->base);
+
    return &dec->base;
 
 error_pipe_state:
@@ -77,6 +77,9 @@ struct vl_mpeg12_decoder
 
    unsigned current_buffer;
    struct vl_mpeg12_buffer *dec_buffers[4];
+
+   /* slice parsing threads shared by the bitstream parsers of the buffers */
+   struct vl_mpg12_bs_pool *bs_pool;
 };
 
 struct vl_mpeg12_buffer
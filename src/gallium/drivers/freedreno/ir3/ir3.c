@@ -547,6 +547,8 @@ void * ir3_assemble(struct ir3 *shader, struct ir3_info *info)
 	info->max_half_reg  = -1;
 	info->max_const     = -1;
 	info->instrs_count  = 0;
+	info->nops_count    = 0;
+	info->ss = info->sy = 0;
 
 	/* need a integer number of instruction "groups" (sets of four
 	 * instructions), so pad out w/ NOPs if needed:
@@ -562,6 +564,12 @@ void * ir3_assemble(struct ir3 *shader, struct ir3_info *info)
 		if (ret)
 			goto fail;
 		info->instrs_count += 1 + instr->repeat;
+		if (is_nop(instr))
+			info->nops_count += 1 + instr->repeat;
+		if (instr->flags & IR3_INSTR_SS)
+			info->ss++;
+		if (instr->flags & IR3_INSTR_SY)
+			info->sy++;
 		dwords += 2;
 	}
 
@@ -41,6 +41,8 @@ struct ir3 * fd_asm_parse(const char *src);
 struct ir3_info {
 	uint16_t sizedwords;
 	uint16_t instrs_count;   /* expanded to account for rpt's */
+	uint16_t nops_count;     /* also expanded to account for rpt's */
+	uint16_t ss, sy;         /* # of instructions waiting on (ss)/(sy) */
 	/* NOTE: max_reg, etc, does not include registers not touched
 	 * by the shader (ie. vertex fetched via VFD_DECODE but not
 	 * touched by shader)
@@ -211,6 +213,10 @@ struct ir3_instruction {
 		 */
 		unsigned depth;
 	};
+	/* # of not yet scheduled instructions reading the value, used
+	 * by the scheduler to keep track of register pressure:
+	 */
+	unsigned use_count;
 	struct ir3_instruction *next;
 #ifdef DEBUG
 	uint32_t serialno;
@@ -406,7 +412,7 @@ void ir3_block_depth(struct ir3_block *block);
 void ir3_block_cp(struct ir3_block *block);
 
 /* scheduling: */
-void ir3_block_sched(struct ir3_block *block);
+int ir3_block_sched(struct ir3_block *block);
 
 /* register assignment: */
 int ir3_block_ra(struct ir3_block *block, enum shader_t type,
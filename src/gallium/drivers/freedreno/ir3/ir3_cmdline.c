@@ -0,0 +1,172 @@
+/* -*- mode: C; c-file-style: "k&r"; tab-width 4; indent-tabs-mode: t; -*- */
+
+/*
+ * Copyright (C) 2014 Rob Clark <robclark@freedesktop.org>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Authors:
+ *    Rob Clark <robclark@freedesktop.org>
+ */
+
+/*
+ * Standalone compiler, to compile TGSI shaders without the hardware and
+ * look at the result:
+ *
+ *   ir3_compiler [-d] [-h] [-b] [-v] file.tgsi...
+ *
+ * For each shader it prints the instruction and nop count, the # of
+ * instructions waiting on (ss)/(sy), and the register footprint.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_scan.h"
+#include "tgsi/tgsi_text.h"
+#include "tgsi/tgsi_dump.h"
+
+#include "freedreno_util.h"
+
+#include "ir3_compiler.h"
+#include "ir3_shader.h"
+
+static int
+compile_file(const char *filename, struct ir3_shader_key key, bool dump)
+{
+	static char text[65536];
+	static struct tgsi_token toks[65536];
+	struct tgsi_shader_info info;
+	struct ir3_shader_variant v;
+	size_t len;
+	void *bin;
+	FILE *f;
+	int ret;
+
+	f = fopen(filename, "r");
+	if (!f) {
+		fprintf(stderr, "%s: %s\n", filename, strerror(errno));
+		return -1;
+	}
+
+	len = fread(text, 1, sizeof(text) - 1, f);
+	fclose(f);
+	text[len] = '\0';
+
+	if (!tgsi_text_translate(text, toks, ARRAY_SIZE(toks))) {
+		fprintf(stderr, "%s: could not parse TGSI\n", filename);
+		return -1;
+	}
+
+	tgsi_scan_shader(toks, &info);
+
+	memset(&v, 0, sizeof(v));
+	v.key = key;
+
+	switch (info.processor) {
+	case TGSI_PROCESSOR_FRAGMENT:
+		v.type = SHADER_FRAGMENT;
+		break;
+	case TGSI_PROCESSOR_VERTEX:
+		v.type = SHADER_VERTEX;
+		break;
+	default:
+		fprintf(stderr, "%s: unsupported shader type\n", filename);
+		return -1;
+	}
+
+	if (dump)
+		tgsi_dump(toks, 0);
+
+	ret = ir3_compile_shader(&v, toks, key);
+	if (ret) {
+		fprintf(stderr, "%s: compile failed\n", filename);
+		return -1;
+	}
+
+	bin = ir3_assemble(v.ir, &v.info);
+	if (!bin) {
+		fprintf(stderr, "%s: assemble failed\n", filename);
+		ir3_destroy(v.ir);
+		return -1;
+	}
+
+	if (dump)
+		disasm_a3xx(bin, v.info.sizedwords, 0, v.type);
+
+	printf("%s: %u instructions, %u nops, %u (ss), %u (sy), "
+			"max_reg %d, max_half_reg %d, max_const %d\n", filename,
+			v.info.instrs_count, v.info.nops_count, v.info.ss, v.info.sy,
+			v.info.max_reg + 1, v.info.max_half_reg + 1, v.info.max_const + 1);
+
+	free(bin);
+	ir3_destroy(v.ir);
+
+	return 0;
+}
+
+static void
+usage(void)
+{
+	fprintf(stderr, "usage: ir3_compiler [-d] [-h] [-b] [-v] file.tgsi...\n"
+			"  -d  dump the TGSI and the disassembly\n"
+			"  -h  use half precision registers\n"
+			"  -b  compile the binning pass variant of the vertex shader\n"
+			"  -v  print the IR after each optimization pass\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct ir3_shader_key key;
+	bool dump = false;
+	int i, files = 0, failed = 0;
+
+	memset(&key, 0, sizeof(key));
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "-d")) {
+			dump = true;
+		} else if (!strcmp(argv[i], "-h")) {
+			key.half_precision = true;
+		} else if (!strcmp(argv[i], "-b")) {
+			key.binning_pass = true;
+		} else if (!strcmp(argv[i], "-v")) {
+			fd_mesa_debug |= FD_DBG_OPTMSGS;
+		} else if (argv[i][0] == '-') {
+			usage();
+			return 1;
+		} else {
+			files++;
+			if (compile_file(argv[i], key, dump))
+				failed++;
+		}
+	}
+
+	if (!files) {
+		usage();
+		return 1;
+	}
+
+	return failed ? 1 : 0;
+}
@@ -31,61 +31,61 @@
 
 #include "ir3.h"
 
-enum {
-	SCHEDULED = -1,
-	DELAYED = -2,
-};
-
 /*
  * Instruction Scheduling:
  *
- * Using the depth sorted list from depth pass, attempt to recursively
- * schedule deepest unscheduled path.  The first instruction that cannot
- * be scheduled, returns the required delay slots it needs, at which
- * point we return back up to the top and attempt to schedule by next
- * highest depth.  After a sufficient number of instructions have been
- * scheduled, return back to beginning of list and start again.  If you
- * reach the end of depth sorted list without being able to insert any
- * instruction, insert nop's.  Repeat until no more unscheduled
- * instructions.
+ * A list scheduler.  Using the depth sorted list from depth pass, the
+ * instructions whose src's have all been scheduled are the candidates,
+ * and at each step the best one is picked according to:
+ *
+ *   1) the number of delay slots it still needs, which would have to
+ *      be filled with nop's (see ir3_delayslots()),
+ *   2) the number of cycles it would wait on the result of an sfu or
+ *      texture fetch instruction.  These are synchronized with (ss)
+ *      and (sy), so scheduling the consumer early is still correct, but
+ *      it is better to find something else to do in the meantime,
+ *   3) it's depth, so the longest path to the outputs goes first.
+ *
+ * Meanwhile the number of live values is tracked, and once it goes over
+ * MAX_PRESSURE, instructions which end the live range of their src's
+ * are preferred over everything else, trading some nop's for a smaller
+ * register footprint (and therefore more threads in flight).  If the
+ * chosen instruction still needs delay slots, nop's are inserted.
  *
  * There are a few special cases that need to be handled, since sched
  * is currently independent of register allocation.  Usages of address
  * register (a0.x) or predicate register (p0.x) must be serialized.  Ie.
  * if you have two pairs of instructions that write the same special
  * register and then read it, then those pairs cannot be interleaved.
- * To solve this, when we are in such a scheduling "critical section",
- * and we encounter a conflicting write to a special register, we try
- * to schedule any remaining instructions that use that value first.
+ * To solve this, an instruction which writes a special register is not
+ * a candidate until the remaining users of the current value have been
+ * scheduled.
+ */
+
+/* estimated # of instructions before the result of a sfu (cat4) or
+ * texture fetch (cat5) instruction is available:
+ */
+#define SFU_LATENCY   8
+#define TEX_LATENCY   16
+
+/* # of live scalar values above which we try to reduce the register
+ * pressure rather than hide latency:
  */
+#define MAX_PRESSURE  (4 * 12)
 
 struct ir3_sched_ctx {
 	struct ir3_instruction *scheduled; /* last scheduled instr */
 	struct ir3_instruction *addr;      /* current a0.x user, if any */
 	struct ir3_instruction *pred;      /* current p0.x user, if any */
-	unsigned cnt;
+	unsigned live;                     /* # of live scalar values */
 };
 
-static struct ir3_instruction *
-deepest(struct ir3_instruction **srcs, unsigned nsrcs)
-{
-	struct ir3_instruction *d = NULL;
-	unsigned i = 0, id = 0;
-
-	while ((i < nsrcs) && !(d = srcs[id = i]))
-		i++;
-
-	if (!d)
-		return NULL;
-
-	for (; i < nsrcs; i++)
-		if (srcs[i] && (srcs[i]->depth > d->depth))
-			d = srcs[id = i];
-
-	srcs[id] = NULL;
-
-	return d;
-}
+/* what it would take to schedule a candidate instruction now: */
+struct ir3_sched_cost {
+	unsigned delay;                    /* # of nop's needed */
+	unsigned stall;                    /* # of cycles waiting on sfu/tex */
+	int pressure;                      /* change in # of live values */
+};
 
 static unsigned distance(struct ir3_sched_ctx *ctx,
 		struct ir3_instruction *instr, unsigned maxd)
@@ -109,6 +109,65 @@ static struct ir3_instruction * prev(struct ir3_instruction *instr)
 	return p;
 }
 
+/*
+ * Register pressure tracking.  Meta-instructions (other than inputs)
+ * don't get registers of their own, so the uses of their results are
+ * accounted to the values they are made of.
+ */
+
+/* # of scalar registers written by the instruction: */
+static unsigned value_size(struct ir3_instruction *instr)
+{
+	if (is_meta(instr) && (instr->opc != OPC_META_INPUT))
+		return 0;
+	if ((instr->regs_count == 0) || writes_addr(instr) || writes_pred(instr))
+		return 0;
+	return util_bitcount(instr->regs[0]->wrmask);
+}
+
+static unsigned update_uses(struct ir3_instruction *instr, int delta);
+
+static unsigned update_value_uses(struct ir3_instruction *value, int delta)
+{
+	if (is_meta(value) && (value->opc != OPC_META_INPUT))
+		return update_uses(value, delta);
+
+	value->use_count += delta;
+
+	if ((delta < 0) && (value->use_count == 0))
+		return value_size(value);
+
+	return 0;
+}
+
+/* adjust the use count of the instruction's src values, returning the
+ * # of registers which are no longer live:
+ */
+static unsigned update_uses(struct ir3_instruction *instr, int delta)
+{
+	unsigned i, freed = 0;
+
+	for (i = 1; i < instr->regs_count; i++) {
+		struct ir3_register *reg = instr->regs[i];
+		if (reg->flags & IR3_REG_SSA)
+			freed += update_value_uses(reg->instr, delta);
+	}
+
+	return freed;
+}
+
+static void init_uses(struct ir3_block *block)
+{
+	struct ir3_instruction *instr;
+
+	for (instr = block->head; instr; instr = instr->next)
+		instr->use_count = 0;
+
+	for (instr = block->head; instr; instr = instr->next)
+		if (!is_meta(instr))
+			update_uses(instr, 1);
+}
+
 static void schedule(struct ir3_sched_ctx *ctx,
 		struct ir3_instruction *instr, bool remove)
 {
@@ -149,12 +208,14 @@ static void schedule(struct ir3_sched_ctx *ctx,
 		ctx->pred = instr;
 	}
 
+	if (!is_meta(instr))
+		ctx->live -= update_uses(instr, -1);
+	ctx->live += value_size(instr);
+
 	instr->flags |= IR3_INSTR_MARK;
 
 	instr->next = ctx->scheduled;
 	ctx->scheduled = instr;
-
-	ctx->cnt++;
 }
 
 /*
@@ -202,58 +263,51 @@ static unsigned delay_calc(struct ir3_sched_ctx *ctx,
 	return delay;
 }
 
-/* A negative return value signals that an instruction has been newly
- * scheduled, return back up to the top of the stack (to block_sched())
+/*
+ * Stall calculation, for sfu/tex results.  Also follows fanin/fanout.
  */
-static int trysched(struct ir3_sched_ctx *ctx,
-		struct ir3_instruction *instr)
-{
-	struct ir3_instruction *srcs[ARRAY_SIZE(instr->regs) - 1];
-	struct ir3_instruction *src;
-	unsigned i, delay, nsrcs = 0;
 
-	/* if already scheduled: */
-	if (instr->flags & IR3_INSTR_MARK)
-		return 0;
+static unsigned stall_calc2(struct ir3_sched_ctx *ctx,
+		struct ir3_instruction *assigner)
+{
+	unsigned latency, stall = 0;
 
-	/* figure out our src's: */
-	for (i = 1; i < instr->regs_count; i++) {
-		struct ir3_register *reg = instr->regs[i];
-		if (reg->flags & IR3_REG_SSA)
-			srcs[nsrcs++] = reg->instr;
+	if (is_meta(assigner)) {
+		unsigned i;
+		for (i = 1; i < assigner->regs_count; i++) {
+			struct ir3_register *reg = assigner->regs[i];
+			if (reg->flags & IR3_REG_SSA) {
+				unsigned s = stall_calc2(ctx, reg->instr);
+				stall = MAX2(stall, s);
+			}
+		}
+		return stall;
 	}
 
-	/* for each src register in sorted order:
-	 */
-	delay = 0;
-	while ((src = deepest(srcs, nsrcs))) {
-		delay = trysched(ctx, src);
-		if (delay)
-			return delay;
-	}
+	if (is_tex(assigner))
+		latency = TEX_LATENCY;
+	else if (is_sfu(assigner))
+		latency = SFU_LATENCY;
+	else
+		return 0;
 
-	/* all our dependents are scheduled, figure out if
-	 * we have enough delay slots to schedule ourself:
-	 */
-	delay = delay_calc(ctx, instr);
-	if (delay)
-		return delay;
+	return latency - distance(ctx, assigner, latency);
+}
 
-	/* if this is a write to address/predicate register, and that
-	 * register is currently in use, we need to defer until it is
-	 * free:
-	 */
-	if (writes_addr(instr) && ctx->addr) {
-		assert(ctx->addr != instr);
-		return DELAYED;
-	}
-	if (writes_pred(instr) && ctx->pred) {
-		assert(ctx->pred != instr);
-		return DELAYED;
+static unsigned stall_calc(struct ir3_sched_ctx *ctx,
+		struct ir3_instruction *instr)
+{
+	unsigned i, stall = 0;
+
+	for (i = 1; i < instr->regs_count; i++) {
+		struct ir3_register *reg = instr->regs[i];
+		if (reg->flags & IR3_REG_SSA) {
+			unsigned s = stall_calc2(ctx, reg->instr);
+			stall = MAX2(stall, s);
+		}
 	}
 
-	schedule(ctx, instr, true);
-	return SCHEDULED;
+	return stall;
 }
 
 static struct ir3_instruction * reverse(struct ir3_instruction *instr)
@@ -298,36 +352,21 @@ static bool uses_current_pred(struct ir3_sched_ctx *ctx,
 	return false;
 }
 
-/* when we encounter an instruction that writes to the address register
- * when it is in use, we delay that instruction and try to schedule all
- * other instructions using the current address register:
+/* once the remaining instructions no longer use the current value of
+ * the address/predicate register, it can be overwritten:
  */
-static int block_sched_undelayed(struct ir3_sched_ctx *ctx,
+static void release_special_regs(struct ir3_sched_ctx *ctx,
 		struct ir3_block *block)
 {
-	struct ir3_instruction *instr = block->head;
+	struct ir3_instruction *instr;
 	bool addr_in_use = false;
 	bool pred_in_use = false;
-	unsigned cnt = ~0;
 
-	while (instr) {
-		struct ir3_instruction *next = instr->next;
-		bool addr = uses_current_addr(ctx, instr);
-		bool pred = uses_current_pred(ctx, instr);
-
-		if (addr || pred) {
-			int ret = trysched(ctx, instr);
-			if (ret == SCHEDULED)
-				cnt = 0;
-			else if (ret > 0)
-				cnt = MIN2(cnt, ret);
-			if (addr)
-				addr_in_use = true;
-			if (pred)
-				pred_in_use = true;
-		}
-
-		instr = next;
+	for (instr = block->head; instr; instr = instr->next) {
+		if (ctx->addr && uses_current_addr(ctx, instr))
+			addr_in_use = true;
+		if (ctx->pred && uses_current_pred(ctx, instr))
+			pred_in_use = true;
 	}
 
 	if (!addr_in_use)
@@ -335,13 +374,107 @@ static int block_sched_undelayed(struct ir3_sched_ctx *ctx,
 
 	if (!pred_in_use)
 		ctx->pred = NULL;
+}
+
+static bool is_ready(struct ir3_instruction *instr)
+{
+	unsigned i;
+	for (i = 1; i < instr->regs_count; i++) {
+		struct ir3_register *reg = instr->regs[i];
+		if ((reg->flags & IR3_REG_SSA) &&
+				!(reg->instr->flags & IR3_INSTR_MARK))
+			return false;
+	}
+	return true;
+}
+
+static void cost_calc(struct ir3_sched_ctx *ctx,
+		struct ir3_instruction *instr, struct ir3_sched_cost *cost)
+{
+	/* meta-instructions are free, and the delay slots are accounted
+	 * to the instructions consuming their result:
+	 */
+	if (is_meta(instr)) {
+		cost->delay = cost->stall = 0;
+		cost->pressure = value_size(instr);
+		return;
+	}
+
+	cost->delay = delay_calc(ctx, instr);
+	cost->stall = stall_calc(ctx, instr);
+
+	/* back to back sfu's need a nop in between: */
+	if (ctx->scheduled && is_sfu(ctx->scheduled) && is_sfu(instr))
+		cost->delay = MAX2(cost->delay, 1);
+
+	/* figure out which src's this would be the last use of: */
+	cost->pressure = (int)value_size(instr) - (int)update_uses(instr, -1);
+	update_uses(instr, 1);
+}
+
+static bool cost_better(struct ir3_sched_ctx *ctx,
+		const struct ir3_sched_cost *a, const struct ir3_sched_cost *b)
+{
+	if ((ctx->live >= MAX_PRESSURE) && (a->pressure != b->pressure))
+		return a->pressure < b->pressure;
+	if (a->delay != b->delay)
+		return a->delay < b->delay;
+	return a->stall < b->stall;
+}
+
+/* pick the best candidate, or NULL if none can be scheduled: */
+static struct ir3_instruction * choose_instr(struct ir3_sched_ctx *ctx,
+		struct ir3_block *block, struct ir3_sched_cost *best_cost)
+{
+	struct ir3_instruction *instr, *best = NULL;
+	bool released = false;
+
+	for (instr = block->head; instr; instr = instr->next) {
+		struct ir3_sched_cost cost;
+
+		if (!is_ready(instr))
+			continue;
+
+		/* if this is a write to address/predicate register, and that
+		 * register is currently in use, we need to defer until it is
+		 * free:
+		 */
+		if ((writes_addr(instr) && ctx->addr) ||
+				(writes_pred(instr) && ctx->pred)) {
+			if (!released) {
+				release_special_regs(ctx, block);
+				released = true;
+			}
+			if ((writes_addr(instr) && ctx->addr) ||
+					(writes_pred(instr) && ctx->pred))
+				continue;
+		}
+
+		if (is_meta(instr)) {
+			cost_calc(ctx, instr, best_cost);
+			return instr;
+		}
+
+		cost_calc(ctx, instr, &cost);
 
-	return cnt;
+		/* the list is depth sorted, so on a tie the deepest wins: */
+		if (!best || cost_better(ctx, &cost, best_cost)) {
+			best = instr;
+			*best_cost = cost;
+			if (!cost.delay && !cost.stall && (ctx->live < MAX_PRESSURE))
+				break;
+		}
+	}
+
+	return best;
 }
 
-static void block_sched(struct ir3_sched_ctx *ctx, struct ir3_block *block)
+static int block_sched(struct ir3_sched_ctx *ctx, struct ir3_block *block)
 {
 	struct ir3_instruction *instr;
+	struct ir3_sched_cost cost;
+
+	init_uses(block);
 
 	/* schedule all the shader input's (meta-instr) first so that
 	 * the RA step sees that the input registers contain a value
@@ -356,46 +489,33 @@ static void block_sched(struct ir3_sched_ctx *ctx, struct ir3_block *block)
 		}
 	}
 
-	while ((instr = block->head)) {
-		/* NOTE: always grab next *before* trysched(), in case the
-		 * instruction is actually scheduled (and therefore moved
-		 * from depth list into scheduled list)
-		 */
-		struct ir3_instruction *next = instr->next;
-		int cnt = trysched(ctx, instr);
-
-		if (cnt == DELAYED)
-			cnt = block_sched_undelayed(ctx, block);
-
-		/* -1 is signal to return up stack, but to us means same as 0: */
-		cnt = MAX2(0, cnt);
-		cnt += ctx->cnt;
-		instr = next;
+	while (block->head) {
+		instr = choose_instr(ctx, block, &cost);
 
-		/* if deepest remaining instruction cannot be scheduled, try
-		 * the increasingly more shallow instructions until needed
-		 * number of delay slots is filled:
+		/* everything left is waiting on a special register that
+		 * cannot be freed:
 		 */
-		while (instr && (cnt > ctx->cnt)) {
-			next = instr->next;
-			trysched(ctx, instr);
-			instr = next;
-		}
+		if (!instr)
+			return -1;
 
-		/* and if we run out of instructions that can be scheduled,
-		 * then it is time for nop's:
+		/* if the best candidate still needs some delay slots, then it
+		 * is time for nop's:
 		 */
-		while (cnt > ctx->cnt)
+		while (cost.delay--)
 			schedule(ctx, ir3_instr_create(block, 0, OPC_NOP), false);
+
+		schedule(ctx, instr, true);
 	}
 
 	/* at this point, scheduled list is in reverse order, so fix that: */
 	block->head = reverse(ctx->scheduled);
+
+	return 0;
 }
 
-void ir3_block_sched(struct ir3_block *block)
+int ir3_block_sched(struct ir3_block *block)
 {
 	struct ir3_sched_ctx ctx = {0};
 	ir3_clear_mark(block->shader);
-	block_sched(&ctx, block);
+	return block_sched(&ctx, block);
 }
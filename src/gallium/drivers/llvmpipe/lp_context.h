@@ -38,6 +38,7 @@
 
 #include "lp_tex_sample.h"
 #include "lp_jit.h"
+#include "lp_perf.h"
 #include "lp_setup.h"
 #include "lp_state_fs.h"
 #include "lp_state_setup.h"
@@ -149,6 +150,9 @@ struct llvmpipe_context {
    struct lp_setup_variant_list_item setup_variants_list;
    unsigned nr_setup_variants;
 
+   /** Statistics for the driver specific queries */
+   struct lp_stats stats;
+
    /** Conditional query object and mode */
    struct pipe_query *render_cond_query;
    uint render_cond_mode;
@@ -35,6 +35,7 @@
 #include "pipe/p_context.h"
 #include "util/u_draw.h"
 #include "util/u_prim.h"
+#include "os/os_time.h"
 
 #include "lp_context.h"
 #include "lp_state.h"
@@ -56,6 +57,7 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
    struct llvmpipe_context *lp = llvmpipe_context(pipe);
    struct draw_context *draw = lp->draw;
    const void *mapped_indices = NULL;
+   int64_t start;
    unsigned i;
 
    if (!llvmpipe_check_render_cond(lp))
@@ -66,6 +68,8 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
       return;
    }
 
+   start = os_time_get_nano();
+
    if (lp->dirty)
       llvmpipe_update_derived( lp );
 
@@ -159,6 +163,8 @@ llvmpipe_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
     * internally when this condition is seen?)
     */
    draw_flush(draw);
+
+   LP_STAT_ADD(&lp->stats, DRAW_TIME, os_time_get_nano() - start);
 }
 
 
@@ -80,6 +80,49 @@ extern struct lp_counters lp_count;
 #endif
 
 
+/**
+ * Statistics which are kept in release builds too, and exposed as driver
+ * specific queries (PIPE_QUERY_DRIVER_SPECIFIC + lp_stat).
+ *
+ * The times are in nanoseconds of CPU time, so the rasterization times are
+ * summed over all the rasterizer threads.
+ */
+enum lp_stat
+{
+   LP_STAT_DRAW_TIME,         /**< in llvmpipe_draw_vbo, includes state
+                                   validation, vertex processing and setup */
+   LP_STAT_SETUP_TIME,        /**< triangle setup and binning, including
+                                   the flushes of scenes filling up */
+   LP_STAT_RAST_TIME,         /**< rasterizing scenes */
+   LP_STAT_SHADE_TIME,        /**< shading fully covered tiles */
+   LP_STAT_COMPILE_TIME,      /**< LLVM compiles of shaders and setup */
+   LP_STAT_COMPILES,
+   LP_STAT_SCENES,
+   LP_STAT_SCENE_MEMORY,      /**< bytes of binned commands and data */
+   LP_STAT_BINS,              /**< non-empty bins rasterized */
+   LP_STAT_TRIANGLES,         /**< primitives reaching setup */
+   LP_STAT_CULLED_TRIANGLES,
+   LP_STAT_TILES_EMPTY,       /**< 64x64 tiles a triangle's bbox touches */
+   LP_STAT_TILES_PARTIAL,
+   LP_STAT_TILES_FULL,
+   LP_STAT_COUNT
+};
+
+struct lp_stats
+{
+   uint64_t counter[LP_STAT_COUNT];
+};
+
+#define LP_STAT(stats, stat) ((stats)->counter[LP_STAT_##stat]++)
+#define LP_STAT_ADD(stats, stat, incr) ((stats)->counter[LP_STAT_##stat] += (incr))
+
+static INLINE boolean
+lp_stat_is_time(enum lp_stat stat)
+{
+   return stat <= LP_STAT_COMPILE_TIME;
+}
+
+
 extern void
 lp_reset_counters(void);
 
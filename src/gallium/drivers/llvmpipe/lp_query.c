@@ -48,6 +48,16 @@ static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
    return (struct llvmpipe_query *)p;
 }
 
+/**
+ * Driver specific queries just sample one of the context's lp_stat
+ * counters at begin and end, see llvmpipe_get_driver_query_info().
+ */
+static boolean
+is_driver_query(unsigned type)
+{
+   return type >= PIPE_QUERY_DRIVER_SPECIFIC;
+}
+
 static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type,
@@ -55,7 +65,9 @@ llvmpipe_create_query(struct pipe_context *pipe,
 {
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= PIPE_QUERY_DRIVER_SPECIFIC &&
+           type < PIPE_QUERY_DRIVER_SPECIFIC + LP_STAT_COUNT));
 
    pq = CALLOC_STRUCT( llvmpipe_query );
 
@@ -101,6 +113,13 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
    uint64_t *result = (uint64_t *)vresult;
    int i;
 
+   if (is_driver_query(pq->type)) {
+      *result = pq->end[0] - pq->start[0];
+      if (lp_stat_is_time(pq->type - PIPE_QUERY_DRIVER_SPECIFIC))
+         *result /= 1000;
+      return TRUE;
+   }
+
    if (pq->fence) {
       /* only have a fence if there was a scene */
       if (!lp_fence_signalled(pq->fence)) {
@@ -190,6 +209,15 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   /* Work still binned when the query ends is counted in the next interval,
+    * there is no need to flush for these.
+    */
+   if (is_driver_query(pq->type)) {
+      pq->start[0] =
+         llvmpipe->stats.counter[pq->type - PIPE_QUERY_DRIVER_SPECIFIC];
+      return;
+   }
+
    /* Check if the query is already in the scene.  If so, we need to
     * flush the scene now.  Real apps shouldn't re-use a query in a
     * frame of rendering.
@@ -244,6 +272,12 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   if (is_driver_query(pq->type)) {
+      pq->end[0] =
+         llvmpipe->stats.counter[pq->type - PIPE_QUERY_DRIVER_SPECIFIC];
+      return;
+   }
+
    lp_setup_end_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -286,6 +286,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    struct lp_fragment_shader_variant *variant;
    const unsigned tile_x = task->x, tile_y = task->y;
    unsigned x, y;
+   int64_t start;
 
    if (inputs->disable) {
       /* This command was partially binned and has been disabled */
@@ -301,6 +302,8 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   start = os_time_get_nano();
+
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -350,6 +353,8 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          END_JIT_CALL();
       }
    }
+
+   LP_STAT_ADD(&task->stats, SHADE_TIME, os_time_get_nano() - start);
 }
 
 
@@ -649,6 +654,8 @@ static void
 rasterize_scene(struct lp_rasterizer_task *task,
                 struct lp_scene *scene)
 {
+   int64_t start = os_time_get_nano();
+
    task->scene = scene;
 
    if (!task->rast->no_rast && !scene->discard) {
@@ -659,12 +666,15 @@ rasterize_scene(struct lp_rasterizer_task *task,
 
          assert(scene);
          while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
-            if (!is_empty_bin( bin ))
+            if (!is_empty_bin( bin )) {
                rasterize_bin(task, bin, i, j);
+               LP_STAT(&task->stats, BINS);
+            }
          }
       }
    }
 
+   LP_STAT_ADD(&task->stats, RAST_TIME, os_time_get_nano() - start);
 
    if (scene->fence) {
       lp_fence_signal(scene->fence);
@@ -735,6 +745,26 @@ lp_rast_finish( struct lp_rasterizer *rast )
 }
 
 
+/**
+ * Add the statistics of all the tasks to \p stats and reset them.
+ * Must be called when the rasterizer is idle, i.e. after lp_rast_finish().
+ */
+void
+lp_rast_collect_stats( struct lp_rasterizer *rast,
+                       struct lp_stats *stats )
+{
+   unsigned i, j;
+
+   for (i = 0; i < MAX2(1, rast->num_threads); i++) {
+      struct lp_stats *task_stats = &rast->tasks[i].stats;
+
+      for (j = 0; j < LP_STAT_COUNT; j++)
+         stats->counter[j] += task_stats->counter[j];
+      memset(task_stats, 0, sizeof(*task_stats));
+   }
+}
+
+
 /**
  * This is the thread's main entrypoint.
  * It's a simple loop:
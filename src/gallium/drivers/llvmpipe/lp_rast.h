@@ -163,6 +163,12 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 void
 lp_rast_finish( struct lp_rasterizer *rast );
 
+struct lp_stats;
+
+void
+lp_rast_collect_stats( struct lp_rasterizer *rast,
+                       struct lp_stats *stats );
+
 
 union lp_rast_cmd_arg {
    const struct lp_rast_shader_inputs *shade_tile;
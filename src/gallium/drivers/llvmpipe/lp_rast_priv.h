@@ -37,6 +37,7 @@
 #include "lp_state.h"
 #include "lp_texture.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
 
 
 #define TILE_VECTOR_HEIGHT 4
@@ -102,6 +103,9 @@ struct lp_rasterizer_task
    uint64_t ps_invocations;
    uint8_t ps_inv_multiplier;
 
+   /** Statistics, collected by the context which queued the scene */
+   struct lp_stats stats;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -352,7 +352,7 @@ lp_scene_new_data_block( struct lp_scene *scene )
  * Return number of bytes used for all bin data within a scene.
  * This does not include resources (textures) referenced by the scene.
  */
-static unsigned
+unsigned
 lp_scene_data_size( const struct lp_scene *scene )
 {
    unsigned size = 0;
@@ -395,6 +395,9 @@ lp_scene_begin_binning( struct lp_scene *scene,
 void
 lp_scene_end_binning( struct lp_scene *scene );
 
+unsigned
+lp_scene_data_size( const struct lp_scene *scene );
+
 
 /* Begin/end rasterization of a scene
  */
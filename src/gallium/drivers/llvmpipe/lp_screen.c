@@ -508,6 +508,47 @@ llvmpipe_get_timestamp(struct pipe_screen *_screen)
    return os_time_get_nano();
 }
 
+/**
+ * The driver specific queries report the lp_stat counters over the query
+ * interval, the times in microseconds.
+ */
+static int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+#define STAT(name, stat, bytes) \
+   {name, PIPE_QUERY_DRIVER_SPECIFIC + LP_STAT_##stat, 0, bytes}
+   static const struct pipe_driver_query_info list[] = {
+      STAT("draw-time", DRAW_TIME, FALSE),
+      STAT("setup-time", SETUP_TIME, FALSE),
+      STAT("rast-time", RAST_TIME, FALSE),
+      STAT("shade-tile-time", SHADE_TIME, FALSE),
+      STAT("compile-time", COMPILE_TIME, FALSE),
+      STAT("compiles", COMPILES, FALSE),
+      STAT("scenes", SCENES, FALSE),
+      STAT("scene-memory", SCENE_MEMORY, TRUE),
+      STAT("bins", BINS, FALSE),
+      STAT("triangles", TRIANGLES, FALSE),
+      STAT("culled-triangles", CULLED_TRIANGLES, FALSE),
+      STAT("tiles-empty", TILES_EMPTY, FALSE),
+      STAT("tiles-partial", TILES_PARTIAL, FALSE),
+      STAT("tiles-full", TILES_FULL, FALSE),
+   };
+#undef STAT
+
+   STATIC_ASSERT(Elements(list) == LP_STAT_COUNT);
+
+   if (!info)
+      return Elements(list);
+
+   if (index >= Elements(list))
+      return 0;
+
+   *info = list[index];
+   return 1;
+}
+
 /**
  * Create a new pipe_screen object
  * Note: we're not presently subclassing pipe_screen (no llvmpipe_screen).
@@ -553,6 +594,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.fence_finish = llvmpipe_fence_finish;
 
    screen->base.get_timestamp = llvmpipe_get_timestamp;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
 
    llvmpipe_init_screen_resource_funcs(&screen->base);
 
@@ -157,6 +157,9 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    memcpy(scene->active_queries, setup->active_queries,
           scene->num_active_queries * sizeof(scene->active_queries[0]));
 
+   LP_STAT(setup->stats, SCENES);
+   LP_STAT_ADD(setup->stats, SCENE_MEMORY, lp_scene_data_size(scene));
+
    lp_scene_end_binning(scene);
 
    lp_fence_reference(&setup->last_fence, scene->fence);
@@ -167,6 +170,9 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    pipe_mutex_lock(screen->rast_mutex);
    lp_rast_queue_scene(screen->rast, scene);
    lp_rast_finish(screen->rast);
+   /* The rasterizer is shared by all contexts, so collect its statistics
+    * while we still own it. */
+   lp_rast_collect_stats(screen->rast, setup->stats);
    pipe_mutex_unlock(screen->rast_mutex);
 
    lp_scene_end_rasterization(setup->scene);
@@ -1294,6 +1300,7 @@ lp_setup_create( struct pipe_context *pipe,
    /* Used only in update_state():
     */
    setup->pipe = pipe;
+   setup->stats = &llvmpipe_context(pipe)->stats;
 
 
    setup->num_threads = screen->num_threads;
@@ -38,6 +38,7 @@
 #include "lp_setup.h"
 #include "lp_rast.h"
 #include "lp_scene.h"
+#include "lp_perf.h"
 #include "lp_bld_interp.h"	/* for struct lp_shader_input */
 
 #include "draw/draw_vbuf.h"
@@ -85,6 +86,7 @@ struct lp_setup_context
     * create/install this itself now.
     */
    struct draw_stage *vbuf;
+   struct lp_stats *stats;    /**< the context's statistics */
    unsigned num_threads;
    unsigned scene_idx;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
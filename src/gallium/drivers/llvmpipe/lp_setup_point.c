@@ -439,6 +439,7 @@ try_setup_point( struct lp_setup_context *setup,
    if (!u_rect_test_intersection(&setup->draw_regions[viewport_index], &bbox)) {
       if (0) debug_printf("offscreen\n");
       LP_COUNT(nr_culled_tris);
+      LP_STAT(setup->stats, CULLED_TRIANGLES);
       return TRUE;
    }
 
@@ -457,6 +458,7 @@ try_setup_point( struct lp_setup_context *setup,
 #endif
 
    LP_COUNT(nr_tris);
+   LP_STAT(setup->stats, TRIANGLES);
 
    if (lp_context->active_statistics_queries &&
        !llvmpipe_rasterization_disabled(lp_context)) {
@@ -320,12 +320,14 @@ do_triangle_ccw(struct lp_setup_context *setup,
        bbox.y1 < bbox.y0) {
       if (0) debug_printf("empty bounding box\n");
       LP_COUNT(nr_culled_tris);
+      LP_STAT(setup->stats, CULLED_TRIANGLES);
       return TRUE;
    }
 
    if (!u_rect_test_intersection(&setup->draw_regions[viewport_index], &bbox)) {
       if (0) debug_printf("offscreen\n");
       LP_COUNT(nr_culled_tris);
+      LP_STAT(setup->stats, CULLED_TRIANGLES);
       return TRUE;
    }
 
@@ -353,6 +355,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
 #endif
 
    LP_COUNT(nr_tris);
+   LP_STAT(setup->stats, TRIANGLES);
 
    /* Setup parameter interpolants:
     */
@@ -644,6 +647,8 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
       assert(iy0 == bbox->y1 / TILE_SIZE &&
 	     ix0 == bbox->x1 / TILE_SIZE);
 
+      LP_STAT(setup->stats, TILES_PARTIAL);
+
       if (nr_planes == 3) {
          if (sz < 4)
          {
@@ -769,6 +774,7 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
                if (in)
                   break;  /* exiting triangle, all done with this row */
                LP_COUNT(nr_empty_64);
+               LP_STAT(setup->stats, TILES_EMPTY);
             }
             else if (partial) {
                /* Not trivially accepted by at least one plane -
@@ -786,10 +792,12 @@ lp_setup_bin_triangle( struct lp_setup_context *setup,
                   goto fail;
 
                LP_COUNT(nr_partially_covered_64);
+               LP_STAT(setup->stats, TILES_PARTIAL);
             }
             else {
                /* triangle covers the whole tile- shade whole tile */
                LP_COUNT(nr_fully_covered_64);
+               LP_STAT(setup->stats, TILES_FULL);
                in = TRUE;
                if (!lp_setup_whole_tile(setup, &tri->inputs, x, y))
                   goto fail;
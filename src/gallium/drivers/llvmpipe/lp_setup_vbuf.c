@@ -41,6 +41,7 @@
 #include "draw/draw_vbuf.h"
 #include "draw/draw_vertex.h"
 #include "util/u_memory.h"
+#include "os/os_time.h"
 
 
 #define LP_MAX_VBUF_INDEXES 1024
@@ -140,12 +141,15 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    const void *vertex_buffer = setup->vertex_buffer;
    const boolean flatshade_first = setup->flatshade_first;
    unsigned i;
+   int64_t t0;
 
    assert(setup->setup.variant);
 
    if (!lp_setup_update_state(setup, TRUE))
       return;
 
+   t0 = os_time_get_nano();
+
    switch (setup->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
@@ -324,6 +328,8 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
    default:
       assert(0);
    }
+
+   LP_STAT_ADD(setup->stats, SETUP_TIME, os_time_get_nano() - t0);
 }
 
 
@@ -340,10 +346,13 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       (void *) get_vert(setup->vertex_buffer, start, stride);
    const boolean flatshade_first = setup->flatshade_first;
    unsigned i;
+   int64_t t0;
 
    if (!lp_setup_update_state(setup, TRUE))
       return;
 
+   t0 = os_time_get_nano();
+
    switch (setup->prim) {
    case PIPE_PRIM_POINTS:
       for (i = 0; i < nr; i++) {
@@ -519,6 +528,8 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    default:
       assert(0);
    }
+
+   LP_STAT_ADD(setup->stats, SETUP_TIME, os_time_get_nano() - t0);
 }
 
 
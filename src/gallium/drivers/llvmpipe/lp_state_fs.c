@@ -3162,12 +3162,14 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
       /*
        * Generate the new variant.
        */
-      t0 = os_time_get();
+      t0 = os_time_get_nano();
       variant = generate_variant(lp, shader, &key);
-      t1 = os_time_get();
+      t1 = os_time_get_nano();
       dt = t1 - t0;
-      LP_COUNT_ADD(llvm_compile_time, dt);
+      LP_COUNT_ADD(llvm_compile_time, dt / 1000);
       LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+      LP_STAT_ADD(&lp->stats, COMPILE_TIME, dt);
+      LP_STAT(&lp->stats, COMPILES);
 
       /* Put the new variant into the list */
       if (variant) {
@@ -717,7 +717,7 @@ generate_setup_variant(struct lp_setup_variant_key *key,
    LLVMTypeRef arg_types[7];
    LLVMBasicBlockRef block;
    LLVMBuilderRef builder;
-   int64_t t0 = 0, t1;
+   int64_t t0, t1;
 
    if (0)
       goto fail;
@@ -738,9 +738,7 @@ generate_setup_variant(struct lp_setup_variant_key *key,
 
    builder = gallivm->builder;
 
-   if (LP_DEBUG & DEBUG_COUNTERS) {
-      t0 = os_time_get();
-   }
+   t0 = os_time_get_nano();
 
    memcpy(&variant->key, key, key->size);
    variant->list_item_global.base = variant;
@@ -811,11 +809,11 @@ generate_setup_variant(struct lp_setup_variant_key *key,
    /*
     * Update timing information:
     */
-   if (LP_DEBUG & DEBUG_COUNTERS) {
-      t1 = os_time_get();
-      LP_COUNT_ADD(llvm_compile_time, t1 - t0);
-      LP_COUNT_ADD(nr_llvm_compiles, 1);
-   }
+   t1 = os_time_get_nano();
+   LP_COUNT_ADD(llvm_compile_time, (t1 - t0) / 1000);
+   LP_COUNT_ADD(nr_llvm_compiles, 1);
+   LP_STAT_ADD(&lp->stats, COMPILE_TIME, t1 - t0);
+   LP_STAT(&lp->stats, COMPILES);
 
    return variant;
 
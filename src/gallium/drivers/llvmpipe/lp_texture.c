@@ -308,7 +308,7 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    }
    else if (llvmpipe_resource_is_texture(pt)) {
       /* free linear image data */
-      if (lpr->tex_data) {
+      if (lpr->tex_data && !lpr->userBuffer) {
          align_free(lpr->tex_data);
          lpr->tex_data = NULL;
       }
@@ -415,6 +415,87 @@ llvmpipe_resource_data(struct pipe_resource *resource)
 }
 
 
+/**
+ * Create a texture or buffer which uses the caller's memory.
+ */
+static struct pipe_resource *
+llvmpipe_resource_from_user_memory(struct pipe_screen *_screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory,
+                                   unsigned stride)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+   struct llvmpipe_resource *lpr;
+
+   if (templat->last_level != 0 ||
+       templat->depth0 != 1 ||
+       templat->array_size != 1)
+      return NULL;
+
+   /* The generated code assumes 16 byte aligned rows, like those of
+    * llvmpipe_resource_create().
+    */
+   if (((uintptr_t)user_memory | stride) & 15)
+      return NULL;
+
+   if (llvmpipe_resource_is_texture(templat)) {
+      const unsigned bpp = util_format_get_blocksize(templat->format);
+
+      if (templat->target != PIPE_TEXTURE_2D &&
+          templat->target != PIPE_TEXTURE_RECT &&
+          templat->target != PIPE_TEXTURE_1D)
+         return NULL;
+
+      if (util_format_is_compressed(templat->format) ||
+          stride < templat->width0 * bpp)
+         return NULL;
+
+      /* When rendering we read/write whole LP_RASTER_BLOCK_SIZE blocks,
+       * which must not go past the end of the user's rows and image.
+       */
+      if ((templat->bind & (PIPE_BIND_RENDER_TARGET |
+                            PIPE_BIND_DEPTH_STENCIL)) &&
+          (stride < align(templat->width0, LP_RASTER_BLOCK_SIZE) * bpp ||
+           (!llvmpipe_resource_is_1d(templat) &&
+            templat->height0 % LP_RASTER_BLOCK_SIZE != 0)))
+         return NULL;
+   }
+   else if (templat->bind & PIPE_BIND_RENDER_TARGET) {
+      /* we'd need the extra storage llvmpipe_resource_create() reserves */
+      return NULL;
+   }
+
+   lpr = CALLOC_STRUCT(llvmpipe_resource);
+   if (!lpr)
+      return NULL;
+
+   lpr->base = *templat;
+   pipe_reference_init(&lpr->base.reference, 1);
+   lpr->base.screen = &screen->base;
+   lpr->userBuffer = TRUE;
+
+   if (llvmpipe_resource_is_texture(&lpr->base)) {
+      lpr->row_stride[0] = stride;
+      lpr->img_stride[0] = stride * templat->height0;
+      lpr->num_slices_faces[0] = 1;
+      lpr->mip_offsets[0] = 0;
+      lpr->tex_data = user_memory;
+   }
+   else {
+      lpr->row_stride[0] = templat->width0;
+      lpr->data = user_memory;
+   }
+
+   lpr->id = id_counter++;
+
+#ifdef DEBUG
+   insert_at_tail(&resource_list, lpr);
+#endif
+
+   return &lpr->base;
+}
+
+
 static struct pipe_resource *
 llvmpipe_resource_from_handle(struct pipe_screen *screen,
                               const struct pipe_resource *template,
@@ -851,6 +932,7 @@ llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
 
    screen->resource_create = llvmpipe_resource_create;
    screen->resource_destroy = llvmpipe_resource_destroy;
+   screen->resource_from_user_memory = llvmpipe_resource_from_user_memory;
    screen->resource_from_handle = llvmpipe_resource_from_handle;
    screen->resource_get_handle = llvmpipe_resource_get_handle;
    screen->can_create_resource = llvmpipe_can_create_resource;
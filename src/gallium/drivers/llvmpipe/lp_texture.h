@@ -85,7 +85,7 @@ struct llvmpipe_resource
     */
    void *data;
 
-   boolean userBuffer;  /** Is this a user-space buffer? */
+   boolean userBuffer;  /** Is the storage owned by the user? */
    unsigned timestamp;
 
    unsigned id;  /**< temporary, for debugging */
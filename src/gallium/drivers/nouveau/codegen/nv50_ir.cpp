@@ -25,6 +25,7 @@
 #include "codegen/nv50_ir_driver.h"
 
 extern "C" {
+#include "os/os_time.h"
 #include "nouveau_debug.h"
 #include "nv50/nv50_program.h"
 }
@@ -1060,6 +1061,12 @@ Program::Program(Type type, Target *arch)
 
    maxGPR = -1;
 
+   numInstructions = 0;
+   numSpills = 0;
+   numUnspills = 0;
+   numRARounds = 0;
+   linearScanRA = false;
+
    main = new Function(this, "MAIN", ~0);
    calls.insert(&main->call);
 
@@ -1139,10 +1146,29 @@ nv50_ir_init_prog_info(struct nv50_ir_prog_info *info)
    info->io.backFaceColor[0] = info->io.backFaceColor[1] = 0xff;
 }
 
+static void
+nv50_ir_time_pass(struct nv50_ir_prog_info *info, enum nv50_ir_pass pass,
+                  int64_t *start)
+{
+   int64_t now;
+
+   if (!info->stats)
+      return;
+   now = os_time_get();
+   info->stats->passTime[pass] += now - *start;
+   *start = now;
+}
+
 int
 nv50_ir_generate_code(struct nv50_ir_prog_info *info)
 {
    int ret = 0;
+   int64_t passStart = 0;
+
+   if (info->stats) {
+      memset(info->stats, 0, sizeof(*info->stats));
+      passStart = os_time_get();
+   }
 
    nv50_ir::Program::Type type;
 
@@ -1189,6 +1215,7 @@ nv50_ir_generate_code(struct nv50_ir_prog_info *info)
       ret = prog->makeFromTGSI(info) ? 0 : -2;
       break;
    }
+   nv50_ir_time_pass(info, NV50_IR_PASS_FROM_SOURCE, &passStart);
    if (ret < 0)
       goto out;
    if (prog->dbgFlags & NV50_IR_DEBUG_VERBOSE)
@@ -1196,14 +1223,18 @@ nv50_ir_generate_code(struct nv50_ir_prog_info *info)
 
    targ->parseDriverInfo(info);
    prog->getTarget()->runLegalizePass(prog, nv50_ir::CG_STAGE_PRE_SSA);
+   nv50_ir_time_pass(info, NV50_IR_PASS_LEGALIZE_PRE_SSA, &passStart);
 
    prog->convertToSSA();
+   nv50_ir_time_pass(info, NV50_IR_PASS_TO_SSA, &passStart);
 
    if (prog->dbgFlags & NV50_IR_DEBUG_VERBOSE)
       prog->print();
 
    prog->optimizeSSA(info->optLevel);
+   nv50_ir_time_pass(info, NV50_IR_PASS_OPTIMIZE_SSA, &passStart);
    prog->getTarget()->runLegalizePass(prog, nv50_ir::CG_STAGE_SSA);
+   nv50_ir_time_pass(info, NV50_IR_PASS_LEGALIZE_SSA, &passStart);
 
    if (prog->dbgFlags & NV50_IR_DEBUG_BASIC)
       prog->print();
@@ -1212,14 +1243,18 @@ nv50_ir_generate_code(struct nv50_ir_prog_info *info)
       ret = -4;
       goto out;
    }
+   nv50_ir_time_pass(info, NV50_IR_PASS_REG_ALLOC, &passStart);
    prog->getTarget()->runLegalizePass(prog, nv50_ir::CG_STAGE_POST_RA);
+   nv50_ir_time_pass(info, NV50_IR_PASS_LEGALIZE_POST_RA, &passStart);
 
    prog->optimizePostRA(info->optLevel);
+   nv50_ir_time_pass(info, NV50_IR_PASS_OPTIMIZE_POST_RA, &passStart);
 
    if (!prog->emitBinary(info)) {
       ret = -5;
       goto out;
    }
+   nv50_ir_time_pass(info, NV50_IR_PASS_EMIT, &passStart);
 
 out:
    INFO_DBG(prog->dbgFlags, VERBOSE, "nv50_ir_generate_code: ret = %i\n", ret);
@@ -1229,6 +1264,14 @@ out:
    info->bin.codeSize = prog->binSize;
    info->bin.tlsSpace = prog->tlsSize;
 
+   if (info->stats) {
+      info->stats->numInstructions = prog->numInstructions;
+      info->stats->numSpills = prog->numSpills;
+      info->stats->numUnspills = prog->numUnspills;
+      info->stats->numRARounds = prog->numRARounds;
+      info->stats->linearScanRA = prog->linearScanRA;
+   }
+
    delete prog;
    nv50_ir::Target::destroy(targ);
 
@@ -1176,6 +1176,13 @@ public:
 
    int maxGPR;
 
+   // statistics, reported through nv50_ir_prog_info::stats
+   uint32_t numInstructions;
+   uint32_t numSpills;
+   uint32_t numUnspills;
+   uint32_t numRARounds;
+   bool linearScanRA;
+
    MemoryPool mem_Instruction;
    MemoryPool mem_CmpInstruction;
    MemoryPool mem_TexInstruction;
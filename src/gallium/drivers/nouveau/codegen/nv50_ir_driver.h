@@ -87,6 +87,36 @@ struct nv50_ir_prog_symbol
    uint32_t offset;
 };
 
+/* stages of nv50_ir_generate_code, timed if nv50_ir_prog_info::stats is set */
+enum nv50_ir_pass
+{
+   NV50_IR_PASS_FROM_SOURCE,
+   NV50_IR_PASS_LEGALIZE_PRE_SSA,
+   NV50_IR_PASS_TO_SSA,
+   NV50_IR_PASS_OPTIMIZE_SSA,
+   NV50_IR_PASS_LEGALIZE_SSA,
+   NV50_IR_PASS_REG_ALLOC,
+   NV50_IR_PASS_LEGALIZE_POST_RA,
+   NV50_IR_PASS_OPTIMIZE_POST_RA,
+   NV50_IR_PASS_EMIT,
+   NV50_IR_PASS_COUNT
+};
+
+struct nv50_ir_prog_stats
+{
+   int64_t passTime[NV50_IR_PASS_COUNT]; /* in microseconds */
+   uint32_t numInstructions; /* emitted instructions */
+   uint32_t numSpills;       /* spill stores/moves inserted by RA */
+   uint32_t numUnspills;     /* unspill loads/moves inserted by RA */
+   uint32_t numRARounds;     /* RA attempts, more than one if it spilled */
+   boolean linearScanRA;     /* linear scan RA was used */
+};
+
+/* functions with more instructions than this are register allocated by linear
+ * scan instead of graph colouring, unless overridden by raScanThreshold
+ */
+#define NV50_IR_RA_SCAN_THRESHOLD 2000
+
 #define NVISA_GF100_CHIPSET_C0 0xc0
 #define NVISA_GF100_CHIPSET_D0 0xd0
 #define NVISA_GK104_CHIPSET    0xe0
@@ -102,6 +132,8 @@ struct nv50_ir_prog_info
    uint8_t optLevel; /* optimization level (0 to 3) */
    uint8_t dbgFlags;
 
+   uint32_t raScanThreshold; /* 0 for the default */
+
    struct {
       int16_t maxGPR;     /* may be -1 if none used */
       int16_t maxOutput;
@@ -197,6 +229,9 @@ struct nv50_ir_prog_info
    int (*assignSlots)(struct nv50_ir_prog_info *);
 
    void *driverPriv;
+
+   /* filled in by the compiler if not NULL, for offline tools */
+   struct nv50_ir_prog_stats *stats;
 };
 
 #ifdef __cplusplus
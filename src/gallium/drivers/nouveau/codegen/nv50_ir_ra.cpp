@@ -25,6 +25,7 @@
 
 #include <stack>
 #include <limits>
+#include <vector>
 
 namespace nv50_ir {
 
@@ -633,7 +634,7 @@ public:
    GCRA(Function *, SpillCodeInserter&);
    ~GCRA();
 
-   bool allocateRegisters(ArrayList& insns);
+   bool allocateRegisters(ArrayList& insns, bool linearScan);
 
    void printNodeInfo() const;
 
@@ -688,12 +689,17 @@ private:
 private:
    inline RIG_Node *getNode(const LValue *v) const { return &nodes[v->id]; }
 
+   void collectValues(std::list<RIG_Node *>&, ArrayList&);
    void buildRIG(ArrayList&);
    bool coalesce(ArrayList&);
    bool doCoalesce(ArrayList&, unsigned int mask);
+   void computeLoopDepths();
+   inline float useWeight(const Instruction *) const;
    void calculateSpillWeights();
    void simplify();
    bool selectRegisters();
+   bool scanRegisters(ArrayList&);
+   bool commitRegisters();
    void cleanup(const bool success);
 
    void simplifyEdge(RIG_Node *, RIG_Node *);
@@ -703,7 +709,7 @@ private:
    void resolveSplitsAndMerges();
    void makeCompound(Instruction *, bool isSplit);
 
-   inline void checkInterference(const RIG_Node *, Graph::EdgeIterator&);
+   inline void checkInterference(const RIG_Node *, const RIG_Node *);
 
    inline void insertOrderedTail(std::list<RIG_Node *>&, RIG_Node *);
    void checkList(std::list<RIG_Node *>&);
@@ -732,6 +738,12 @@ private:
 
    SpillCodeInserter& spill;
    std::list<ValuePair> mustSpill;
+
+   // loop nesting depth of each basic block, by id
+   std::vector<uint8_t> loopDepth;
+
+   // allocate in order of live intervals instead of colouring the RIG
+   bool linearScan;
 };
 
 uint8_t GCRA::relDegree[17][17];
@@ -1034,7 +1046,8 @@ GCRA::RIG_Node::addRegPreference(RIG_Node *node)
 GCRA::GCRA(Function *fn, SpillCodeInserter& spill) :
    func(fn),
    regs(fn->getProgram()->getTarget()),
-   spill(spill)
+   spill(spill),
+   linearScan(false)
 {
    prog = func->getProgram();
 
@@ -1081,11 +1094,10 @@ GCRA::insertOrderedTail(std::list<RIG_Node *>& list, RIG_Node *node)
    list.insert(it, node);
 }
 
+// Gather the values to allocate, ordered by the start of their live interval.
 void
-GCRA::buildRIG(ArrayList& insns)
+GCRA::collectValues(std::list<RIG_Node *>& values, ArrayList& insns)
 {
-   std::list<RIG_Node *> values, active;
-
    for (std::deque<ValueDef>::iterator it = func->ins.begin();
         it != func->ins.end(); ++it)
       insertOrderedTail(values, getNode(it->get()->asLValue()));
@@ -1097,6 +1109,14 @@ GCRA::buildRIG(ArrayList& insns)
             insertOrderedTail(values, getNode(insn->getDef(d)->asLValue()));
    }
    checkList(values);
+}
+
+void
+GCRA::buildRIG(ArrayList& insns)
+{
+   std::list<RIG_Node *> values, active;
+
+   collectValues(values, insns);
 
    while (!values.empty()) {
       RIG_Node *cur = values.front();
@@ -1118,6 +1138,56 @@ GCRA::buildRIG(ArrayList& insns)
    }
 }
 
+// The body of a natural loop is found by walking up the predecessors of the
+// origins of its back edges until the loop header.
+void
+GCRA::computeLoopDepths()
+{
+   std::vector<bool> inLoop;
+   std::stack<BasicBlock *> work;
+
+   loopDepth.assign(func->allBBlocks.getSize(), 0);
+
+   for (ArrayList::Iterator bi = func->allBBlocks.iterator();
+        !bi.end(); bi.next()) {
+      BasicBlock *header = BasicBlock::get(bi);
+
+      for (Graph::EdgeIterator ei = header->cfg.incident(); !ei.end();
+           ei.next())
+         if (ei.getType() == Graph::Edge::BACK)
+            work.push(BasicBlock::get(ei.getNode()));
+      if (work.empty())
+         continue;
+
+      inLoop.assign(loopDepth.size(), false);
+      inLoop[header->getId()] = true;
+      while (!work.empty()) {
+         BasicBlock *bb = work.top();
+         work.pop();
+         if (inLoop[bb->getId()])
+            continue;
+         inLoop[bb->getId()] = true;
+         for (Graph::EdgeIterator ei = bb->cfg.incident(); !ei.end();
+              ei.next())
+            work.push(BasicBlock::get(ei.getNode()));
+      }
+      for (unsigned int i = 0; i < loopDepth.size(); ++i)
+         if (inLoop[i] && loopDepth[i] < 255)
+            ++loopDepth[i];
+   }
+}
+
+// A use inside a loop costs 8 times as much as one outside of it.
+float
+GCRA::useWeight(const Instruction *insn) const
+{
+   unsigned int depth = 0;
+
+   if (insn->bb && insn->bb->getId() < (int)loopDepth.size())
+      depth = MIN2(loopDepth[insn->bb->getId()], 8);
+   return (float)(1 << (3 * depth));
+}
+
 void
 GCRA::calculateSpillWeights()
 {
@@ -1134,15 +1204,23 @@ GCRA::calculateSpillWeights()
 
       if (!val->noSpill) {
          int rc = 0;
+         float cost = 0.0f;
          for (Value::DefIterator it = val->defs.begin();
               it != val->defs.end();
-              ++it)
-            rc += (*it)->get()->refCount();
+              ++it) {
+            Value *def = (*it)->get();
+            rc += def->refCount();
+            for (Value::UseCIterator u = def->uses.begin();
+                 u != def->uses.end(); ++u)
+               cost += useWeight((*u)->getInsn());
+         }
 
          nodes[i].weight =
-            (float)rc * (float)rc / (float)nodes[i].livei.extent();
+            cost * (float)rc / (float)nodes[i].livei.extent();
       }
 
+      if (linearScan)
+         continue;
       if (nodes[i].degree < nodes[i].degreeLimit) {
          int l = 0;
          if (val->reg.size > 4)
@@ -1228,10 +1306,8 @@ GCRA::simplify()
 }
 
 void
-GCRA::checkInterference(const RIG_Node *node, Graph::EdgeIterator& ei)
+GCRA::checkInterference(const RIG_Node *node, const RIG_Node *intf)
 {
-   const RIG_Node *intf = RIG_Node::get(ei);
-
    if (intf->reg < 0)
       return;
    const LValue *vA = node->getValue();
@@ -1294,9 +1370,9 @@ GCRA::selectRegisters()
                node->getValue()->id, node->colors);
 
       for (Graph::EdgeIterator ei = node->outgoing(); !ei.end(); ei.next())
-         checkInterference(node, ei);
+         checkInterference(node, RIG_Node::get(ei));
       for (Graph::EdgeIterator ei = node->incident(); !ei.end(); ei.next())
-         checkInterference(node, ei);
+         checkInterference(node, RIG_Node::get(ei));
 
       if (!node->prefRegs.empty()) {
          for (std::list<RIG_Node *>::const_iterator it = node->prefRegs.begin();
@@ -1327,6 +1403,111 @@ GCRA::selectRegisters()
          mustSpill.push_back(ValuePair(lval, slot));
       }
    }
+   return commitRegisters();
+}
+
+// Linear scan over the live intervals of the coalesced values, for large
+// functions where building and colouring the interference graph takes too
+// long.  Values are assigned registers in order of the start of their live
+// interval, checking only against those still live.  If no register is free,
+// the value with the lowest spill weight is spilled, either the current one
+// or one it conflicts with.
+bool
+GCRA::scanRegisters(ArrayList& insns)
+{
+   std::list<RIG_Node *> values, active, fixed;
+   std::list<RIG_Node *>::iterator it;
+
+   INFO_DBG(prog->dbgFlags, REG_ALLOC, "\nSCAN phase\n");
+
+   collectValues(values, insns);
+
+   for (it = values.begin(); it != values.end(); ++it)
+      if ((*it)->reg >= 0)
+         fixed.push_back(*it);
+
+   while (!values.empty()) {
+      RIG_Node *cur = values.front();
+      values.pop_front();
+
+      for (it = active.begin(); it != active.end();) {
+         if ((*it)->livei.end() <= cur->livei.begin())
+            it = active.erase(it);
+         else
+            ++it;
+      }
+
+      if (cur->reg >= 0 || !cur->colors) {
+         active.push_back(cur);
+         continue;
+      }
+
+      INFO_DBG(prog->dbgFlags, REG_ALLOC, "\nNODE[%%%i, %u colors]\n",
+               cur->getValue()->id, cur->colors);
+
+      for (;;) {
+         RIG_Node *victim = NULL;
+
+         regs.reset(cur->f);
+         for (it = active.begin(); it != active.end(); ++it)
+            if ((*it)->f == cur->f && (*it)->livei.overlaps(cur->livei))
+               checkInterference(cur, *it);
+         // pre-coloured values that only become live later
+         for (it = fixed.begin(); it != fixed.end(); ++it)
+            if ((*it)->livei.begin() > cur->livei.begin() &&
+                (*it)->f == cur->f && (*it)->livei.overlaps(cur->livei))
+               checkInterference(cur, *it);
+
+         for (std::list<RIG_Node *>::const_iterator p = cur->prefRegs.begin();
+              p != cur->prefRegs.end(); ++p) {
+            if ((*p)->reg >= 0 &&
+                regs.testOccupy(cur->f, (*p)->reg, cur->colors)) {
+               cur->reg = (*p)->reg;
+               break;
+            }
+         }
+         if (cur->reg >= 0 || regs.assign(cur->reg, cur->f, cur->colors))
+            break;
+
+         for (it = active.begin(); it != active.end(); ++it) {
+            RIG_Node *n = *it;
+            if (n->f != cur->f || n->reg < 0 || n->getValue()->fixedReg ||
+                !n->livei.overlaps(cur->livei))
+               continue;
+            if (!victim || n->weight < victim->weight)
+               victim = n;
+         }
+         if (victim && victim->weight < cur->weight) {
+            active.remove(victim);
+            victim->reg = -1;
+         } else {
+            victim = cur;
+         }
+
+         LValue *lval = victim->getValue();
+         INFO_DBG(prog->dbgFlags, REG_ALLOC, "must spill: %%%i (size %u)\n",
+                  lval->id, lval->reg.size);
+         Symbol *slot = NULL;
+         if (lval->reg.file == FILE_GPR)
+            slot = spill.assignSlot(victim->livei, lval->reg.size);
+         mustSpill.push_back(ValuePair(lval, slot));
+
+         if (victim == cur)
+            break;
+      }
+
+      if (cur->reg >= 0) {
+         INFO_DBG(prog->dbgFlags, REG_ALLOC, "assigned reg %i\n", cur->reg);
+         cur->getValue()->compMask = cur->getCompMask();
+         active.push_back(cur);
+      }
+   }
+   return commitRegisters();
+}
+
+bool
+GCRA::commitRegisters()
+{
    if (!mustSpill.empty())
       return false;
    for (unsigned int i = 0; i < nodeCount; ++i) {
@@ -1339,12 +1520,17 @@ GCRA::selectRegisters()
 }
 
 bool
-GCRA::allocateRegisters(ArrayList& insns)
+GCRA::allocateRegisters(ArrayList& insns, bool linearScan)
 {
    bool ret;
 
    INFO_DBG(prog->dbgFlags, REG_ALLOC,
-            "allocateRegisters to %u instructions\n", insns.getSize());
+            "allocateRegisters to %u instructions%s\n", insns.getSize(),
+            linearScan ? " (linear scan)" : "");
+
+   this->linearScan = linearScan;
+   prog->linearScanRA |= linearScan;
+   ++prog->numRARounds;
 
    nodeCount = func->allLValues.getSize();
    nodes = new RIG_Node[nodeCount];
@@ -1366,11 +1552,17 @@ GCRA::allocateRegisters(ArrayList& insns)
    if (func->getProgram()->dbgFlags & NV50_IR_DEBUG_REG_ALLOC)
       func->printLiveIntervals();
 
-   buildRIG(insns);
-   calculateSpillWeights();
-   simplify();
+   computeLoopDepths();
 
-   ret = selectRegisters();
+   if (linearScan) {
+      calculateSpillWeights();
+      ret = scanRegisters(insns);
+   } else {
+      buildRIG(insns);
+      calculateSpillWeights();
+      simplify();
+      ret = selectRegisters();
+   }
    if (!ret) {
       INFO_DBG(prog->dbgFlags, REG_ALLOC,
                "selectRegisters failed, inserting spill code ...\n");
@@ -1505,6 +1697,7 @@ SpillCodeInserter::spill(Instruction *defi, Value *slot, LValue *lval)
       st->setSrc(0, lval);
    }
    defi->bb->insertAfter(defi, st);
+   ++func->getProgram()->numSpills;
 }
 
 LValue *
@@ -1526,6 +1719,7 @@ SpillCodeInserter::unspill(Instruction *usei, LValue *lval, Value *slot)
    ld->setSrc(0, slot);
 
    usei->bb->insertBefore(usei, ld);
+   ++func->getProgram()->numUnspills;
    return lval;
 }
 
@@ -1625,6 +1819,9 @@ RegAlloc::execFunc()
    unsigned int i, retries;
    bool ret;
 
+   const unsigned int scanThreshold = prog->driver->raScanThreshold ?
+      prog->driver->raScanThreshold : NV50_IR_RA_SCAN_THRESHOLD;
+
    if (!func->ins.empty()) {
       // Insert a nop at the entry so inputs only used by the first instruction
       // don't count as having an empty live range.
@@ -1664,7 +1861,8 @@ RegAlloc::execFunc()
       ret = buildIntervals.run(func);
       if (!ret)
          break;
-      ret = gcra.allocateRegisters(insns);
+      ret = gcra.allocateRegisters(insns,
+                                   insns.getSize() > (int)scanThreshold);
       if (ret)
          break; // success
    }
@@ -101,34 +101,98 @@ dummy_assign_slots(struct nv50_ir_prog_info *info)
    return 0;
 }
 
+static const char *const pass_names[NV50_IR_PASS_COUNT] = {
+   [NV50_IR_PASS_FROM_SOURCE]       = "from TGSI",
+   [NV50_IR_PASS_LEGALIZE_PRE_SSA]  = "legalize (pre-SSA)",
+   [NV50_IR_PASS_TO_SSA]            = "convert to SSA",
+   [NV50_IR_PASS_OPTIMIZE_SSA]      = "optimize (SSA)",
+   [NV50_IR_PASS_LEGALIZE_SSA]      = "legalize (SSA)",
+   [NV50_IR_PASS_REG_ALLOC]         = "register allocation",
+   [NV50_IR_PASS_LEGALIZE_POST_RA]  = "legalize (post-RA)",
+   [NV50_IR_PASS_OPTIMIZE_POST_RA]  = "optimize (post-RA)",
+   [NV50_IR_PASS_EMIT]              = "emit",
+};
+
+static void
+print_stats(const struct nv50_ir_prog_info *info,
+            const struct nv50_ir_prog_stats *stats, int runs)
+{
+   int64_t total = 0;
+   int i;
+
+   _debug_printf("instructions: %u\n", stats->numInstructions);
+   _debug_printf("GPRs: %d\n", info->bin.maxGPR + 1);
+   _debug_printf("spills: %u, unspills: %u, local memory: %u bytes\n",
+                 stats->numSpills, stats->numUnspills, info->bin.tlsSpace);
+   _debug_printf("code size: %u bytes\n", info->bin.codeSize);
+   _debug_printf("register allocation: %s, %u round%s\n",
+                 stats->linearScanRA ? "linear scan" : "graph colouring",
+                 stats->numRARounds, stats->numRARounds == 1 ? "" : "s");
+
+   _debug_printf("compile time (average of %d run%s):\n",
+                 runs, runs == 1 ? "" : "s");
+   for (i = 0; i < NV50_IR_PASS_COUNT; ++i) {
+      _debug_printf("  %-20s %10.1f us\n", pass_names[i],
+                    (double)stats->passTime[i] / runs);
+      total += stats->passTime[i];
+   }
+   _debug_printf("  %-20s %10.1f us\n", "total", (double)total / runs);
+}
+
 static int
 nouveau_codegen(int chipset, int type, struct tgsi_token tokens[],
-                unsigned *size, unsigned **code) {
-   struct nv50_ir_prog_info info = {0};
-   int ret;
-
-   info.type = type;
-   info.target = chipset;
-   info.bin.sourceRep = NV50_PROGRAM_IR_TGSI;
-   info.bin.source = tokens;
-
-   info.io.ucpCBSlot = 15;
-   info.io.ucpBase = NV50_CB_AUX_UCP_OFFSET;
-
-   info.io.resInfoCBSlot = 15;
-   info.io.suInfoBase = NV50_CB_AUX_TEX_MS_OFFSET;
-   info.io.msInfoCBSlot = 15;
-   info.io.msInfoBase = NV50_CB_AUX_MS_OFFSET;
-
-   info.assignSlots = dummy_assign_slots;
-
-   info.optLevel = debug_get_num_option("NV50_PROG_OPTIMIZE", 3);
-   info.dbgFlags = debug_get_num_option("NV50_PROG_DEBUG", 0);
+                unsigned *size, unsigned **code,
+                boolean stats, int runs) {
+   struct nv50_ir_prog_info tmpl = {0}, info;
+   struct nv50_ir_prog_stats run_stats, sum = {{0}};
+   int ret, run, i;
+
+   tmpl.type = type;
+   tmpl.target = chipset;
+   tmpl.bin.sourceRep = NV50_PROGRAM_IR_TGSI;
+   tmpl.bin.source = tokens;
+
+   tmpl.io.ucpCBSlot = 15;
+   tmpl.io.ucpBase = NV50_CB_AUX_UCP_OFFSET;
+
+   tmpl.io.resInfoCBSlot = 15;
+   tmpl.io.suInfoBase = NV50_CB_AUX_TEX_MS_OFFSET;
+   tmpl.io.msInfoCBSlot = 15;
+   tmpl.io.msInfoBase = NV50_CB_AUX_MS_OFFSET;
+
+   tmpl.assignSlots = dummy_assign_slots;
+
+   tmpl.optLevel = debug_get_num_option("NV50_PROG_OPTIMIZE", 3);
+   tmpl.dbgFlags = debug_get_num_option("NV50_PROG_DEBUG", 0);
+   tmpl.raScanThreshold = debug_get_num_option("NV50_PROG_RA_SCAN", 0);
+
+   if (stats)
+      tmpl.stats = &run_stats;
+
+   /* When benchmarking, compile the program repeatedly from a fresh info
+    * and keep the binary of the last run.
+    */
+   for (run = 0; run < runs; ++run) {
+      if (run) {
+         FREE(info.bin.code);
+         FREE(info.bin.relocData);
+         FREE(info.bin.syms);
+      }
+      info = tmpl;
+
+      ret = nv50_ir_generate_code(&info);
+      if (ret) {
+         _debug_printf("Error compiling program: %d\n", ret);
+         return ret;
+      }
+
+      for (i = 0; stats && i < NV50_IR_PASS_COUNT; ++i)
+         sum.passTime[i] += run_stats.passTime[i];
+   }
 
-   ret = nv50_ir_generate_code(&info);
-   if (ret) {
-      _debug_printf("Error compiling program: %d\n", ret);
-      return ret;
+   if (stats) {
+      memcpy(run_stats.passTime, sum.passTime, sizeof(sum.passTime));
+      print_stats(&info, &run_stats, runs);
    }
 
    *size = info.bin.codeSize;
@@ -136,30 +200,47 @@ nouveau_codegen(int chipset, int type, struct tgsi_token tokens[],
    return 0;
 }
 
+static void
+usage(void)
+{
+   _debug_printf("usage: nouveau_compiler -a <chipset> [-s] [-r <runs>] "
+                 "<file|->\n"
+                 "  -a  target chipset, in hex (e.g. 50, c0, e4, 117)\n"
+                 "  -s  print code statistics and per-pass compile times\n"
+                 "  -r  compile the program <runs> times, for benchmarking\n");
+}
+
 int
 main(int argc, char *argv[])
 {
    struct tgsi_token tokens[1024];
-   int i, chipset = 0, type = -1;
+   int i, chipset = 0, type = -1, runs = 1;
+   boolean stats = FALSE;
    const char *filename = NULL;
    FILE *f;
    char text[65536] = {0};
    unsigned size, *code;
 
    for (i = 1; i < argc; i++) {
-      if (!strcmp(argv[i], "-a"))
+      if (!strcmp(argv[i], "-a") && i + 1 < argc)
          chipset = strtol(argv[++i], NULL, 16);
+      else if (!strcmp(argv[i], "-s"))
+         stats = TRUE;
+      else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+         runs = MAX2(atoi(argv[++i]), 1);
       else
          filename = argv[i];
    }
 
    if (!chipset) {
       _debug_printf("Must specify a chipset (-a)\n");
+      usage();
       return 1;
    }
 
    if (!filename) {
       _debug_printf("Must specify a filename\n");
+      usage();
       return 1;
    }
 
@@ -199,8 +280,10 @@ main(int argc, char *argv[])
       return 1;
 
    if (chipset >= 0x50) {
-      i = nouveau_codegen(chipset, type, tokens, &size, &code);
+      i = nouveau_codegen(chipset, type, tokens, &size, &code, stats, runs);
    } else if (chipset >= 0x30) {
+      if (stats || runs > 1)
+         _debug_printf("statistics are only available for NV50 and later\n");
       i = nv30_codegen(chipset, type, tokens, &size, &code);
    } else {
       _debug_printf("chipset NV%02X not supported\n", chipset);
@@ -359,6 +359,7 @@ nv50_program_translate(struct nv50_program *prog, uint16_t chipset)
 #ifdef DEBUG
    info->optLevel = debug_get_num_option("NV50_PROG_OPTIMIZE", 3);
    info->dbgFlags = debug_get_num_option("NV50_PROG_DEBUG", 0);
+   info->raScanThreshold = debug_get_num_option("NV50_PROG_RA_SCAN", 0);
 #else
    info->optLevel = 3;
 #endif
@@ -256,8 +256,10 @@ nv84_decoder_destroy(struct pipe_video_codec *decoder)
 
    nouveau_client_del(&dec->client);
 
-   if (dec->mpeg12_bs)
+   if (dec->mpeg12_bs) {
+      vl_mpg12_bs_destroy_pool(dec->mpeg12_bs_pool);
       FREE(dec->mpeg12_bs);
+   }
    FREE(dec);
 }
 
@@ -318,7 +320,8 @@ nv84_create_decoder(struct pipe_context *context,
          dec->mpeg12_bs = CALLOC_STRUCT(vl_mpg12_bs);
          if (!dec->mpeg12_bs)
             goto fail;
-         vl_mpg12_bs_init(dec->mpeg12_bs, &dec->base);
+         dec->mpeg12_bs_pool = vl_mpg12_bs_create_pool(&dec->base);
+         vl_mpg12_bs_init(dec->mpeg12_bs, &dec->base, dec->mpeg12_bs_pool);
          dec->base.decode_bitstream = nv84_decoder_decode_bitstream_mpeg12;
       }
    } else {
@@ -93,6 +93,7 @@ struct nv84_decoder {
 
 
    struct vl_mpg12_bs *mpeg12_bs;
+   struct vl_mpg12_bs_pool *mpeg12_bs_pool;
 
    struct nouveau_bo *mpeg12_bo;
    void *mpeg12_mb_info;
@@ -568,6 +568,7 @@ nvc0_program_translate(struct nvc0_program *prog, uint16_t chipset)
 #ifdef DEBUG
    info->optLevel = debug_get_num_option("NV50_PROG_OPTIMIZE", 3);
    info->dbgFlags = debug_get_num_option("NV50_PROG_DEBUG", 0);
+   info->raScanThreshold = debug_get_num_option("NV50_PROG_RA_SCAN", 0);
 #else
    info->optLevel = 3;
 #endif
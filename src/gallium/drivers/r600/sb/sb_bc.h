@@ -586,11 +586,12 @@ struct shader_stats {
 	unsigned	fetch_clauses;
 	unsigned	fetch;
 	unsigned	alu_groups;
+	unsigned	alu_slots;		// slots available in alu_groups
 
 	unsigned	shaders;		// number of shaders (for accumulated stats)
 
 	shader_stats() : ndw(), ngpr(), nstack(), cf(), alu(), alu_clauses(),
-			fetch_clauses(), fetch(), alu_groups(), shaders() {}
+			fetch_clauses(), fetch(), alu_groups(), alu_slots(), shaders() {}
 
 	void collect(node *n);
 	void accumulate(shader_stats &s);
@@ -598,12 +599,21 @@ struct shader_stats {
 	void dump_diff(shader_stats &s);
 };
 
+struct sb_pass_time {
+	const char *name;
+	unsigned runs;
+	int64_t time;	// ns
+};
+
 class sb_context {
 
 public:
 
 	shader_stats src_stats, opt_stats;
 
+	// accumulated time spent in each pass, collected with time_passes
+	std::vector<sb_pass_time> pass_times;
+
 	r600_isa *isa;
 
 	sb_hw_chip hw_chip;
@@ -624,6 +634,7 @@ public:
 
 	static unsigned dump_pass;
 	static unsigned dump_stat;
+	static unsigned time_passes;
 
 	static unsigned dry_run;
 	static unsigned no_fallback;
@@ -633,7 +644,10 @@ public:
 	static unsigned dskip_end;
 	static unsigned dskip_mode;
 
-	sb_context() : src_stats(), opt_stats(), isa(0),
+	// directory to save the source bytecode of the shaders to
+	static const char *capture_dir;
+
+	sb_context() : src_stats(), opt_stats(), pass_times(), isa(0),
 			hw_chip(HW_CHIP_UNKNOWN), hw_class(HW_CLASS_UNKNOWN) {}
 
 	int init(r600_isa *isa, sb_hw_chip chip, sb_hw_class cclass);
@@ -709,6 +723,9 @@ public:
 	const char * get_hw_class_name();
 	const char * get_hw_chip_name();
 
+	void add_pass_time(const char *name, int64_t time);
+	void dump_pass_times();
+
 };
 
 #define SB_DUMP_STAT(a) do { if (sb_context::dump_stat) { a } } while (0)
@@ -854,6 +871,21 @@ private:
 
 };
 
+// runs the optimization pipeline on the bytecode, see r600_sb_bytecode_process
+int optimize_bytecode(sb_context &ctx, r600_bytecode *bc,
+                      r600_shader *pshader, int dump_bytecode, int optimize);
+
+// bytecode files contain the source bytecode of a shader along with the parts
+// of r600_shader the parser needs, to run the optimizer offline (see
+// sb_offline.cpp).  pshader may be NULL for fetch shaders.
+int write_bytecode_file(sb_context &ctx, const char *path,
+                        r600_bytecode *bc, r600_shader *pshader);
+
+// on success, pshader->bc.bytecode and pshader->arrays are malloc'ed and
+// has_pshader tells whether a pshader was saved
+int read_bytecode_file(const char *path, sb_hw_chip &chip,
+                       r600_shader *pshader, bool &has_pshader);
+
 
 
 
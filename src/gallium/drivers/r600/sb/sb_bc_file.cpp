@@ -0,0 +1,215 @@
+/*
+ * Copyright 2014 The Mesa Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Bytecode files are plain text:
+ *
+ *   r600_sb 1
+ *   chip CYPRESS
+ *   type 0
+ *   debug_id 12
+ *   ngpr 5
+ *   nstack 1
+ *   shader 1
+ *   vs_as_es 0
+ *   indirect_files 0
+ *   arrays 1
+ *   array <gpr_start> <gpr_count> <comp_mask>
+ *   inputs 2
+ *   input <gpr> <spi_sid> <interpolate> <centroid>
+ *   ...
+ *   ndw 64
+ *   <ndw dwords in hex>
+ *
+ * Everything after "shader" is only present if the r600_shader was saved.
+ */
+
+extern "C" {
+#include "r600_pipe.h"
+#include "r600_shader.h"
+}
+
+#include <cstring>
+
+#include "sb_bc.h"
+
+namespace r600_sb {
+
+#define SB_BC_FILE_VERSION 1
+
+int write_bytecode_file(sb_context &ctx, const char *path,
+                        r600_bytecode *bc, r600_shader *pshader) {
+	FILE *f = fopen(path, "w");
+	if (!f)
+		return -1;
+
+	fprintf(f, "r600_sb %d\n", SB_BC_FILE_VERSION);
+	fprintf(f, "chip %s\n", ctx.get_hw_chip_name());
+	fprintf(f, "type %d\n", bc->type);
+	fprintf(f, "debug_id %u\n", bc->debug_id);
+	fprintf(f, "ngpr %u\n", bc->ngpr);
+	fprintf(f, "nstack %u\n", bc->nstack);
+	fprintf(f, "shader %d\n", pshader ? 1 : 0);
+
+	if (pshader) {
+		fprintf(f, "vs_as_es %u\n", pshader->vs_as_es);
+		fprintf(f, "indirect_files %u\n", pshader->indirect_files);
+		fprintf(f, "arrays %u\n", pshader->num_arrays);
+		for (unsigned i = 0; i < pshader->num_arrays; ++i) {
+			r600_shader_array &a = pshader->arrays[i];
+			fprintf(f, "array %u %u %u\n", a.gpr_start, a.gpr_count,
+					a.comp_mask);
+		}
+		fprintf(f, "inputs %u\n", pshader->ninput);
+		for (unsigned i = 0; i < pshader->ninput; ++i) {
+			r600_shader_io &in = pshader->input[i];
+			fprintf(f, "input %u %d %u %d\n", in.gpr, in.spi_sid,
+					in.interpolate, in.centroid ? 1 : 0);
+		}
+	}
+
+	fprintf(f, "ndw %u\n", bc->ndw);
+	for (unsigned i = 0; i < bc->ndw; ++i)
+		fprintf(f, "%08x%c", bc->bytecode[i], (i % 8 == 7) ? '\n' : ' ');
+	if (bc->ndw % 8)
+		fprintf(f, "\n");
+
+	return fclose(f) ? -1 : 0;
+}
+
+static bool read_field(FILE *f, const char *name, unsigned &val) {
+	char key[32];
+
+	if (fscanf(f, "%31s %u", key, &val) != 2 || strcmp(key, name)) {
+		sblog << "sb: expected '" << name << "'\n";
+		return false;
+	}
+	return true;
+}
+
+static sb_hw_chip find_chip(const char *name) {
+	sb_context tmp;
+
+	for (unsigned c = HW_CHIP_R600; c <= HW_CHIP_ARUBA; ++c) {
+		tmp.hw_chip = (sb_hw_chip)c;
+		if (!strcmp(tmp.get_hw_chip_name(), name))
+			return tmp.hw_chip;
+	}
+	return HW_CHIP_UNKNOWN;
+}
+
+int read_bytecode_file(const char *path, sb_hw_chip &chip,
+                       r600_shader *pshader, bool &has_pshader) {
+	r600_bytecode *bc = &pshader->bc;
+	char chip_name[32];
+	unsigned version, type, shader, n;
+	int r = -1;
+
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		sblog << "sb: can't open " << path << "\n";
+		return -1;
+	}
+
+	memset(pshader, 0, sizeof(*pshader));
+
+	if (!read_field(f, "r600_sb", version) ||
+			version != SB_BC_FILE_VERSION) {
+		sblog << "sb: " << path << " is not a bytecode file\n";
+		goto out;
+	}
+
+	if (fscanf(f, " chip %31s", chip_name) != 1 ||
+			(chip = find_chip(chip_name)) == HW_CHIP_UNKNOWN) {
+		sblog << "sb: unknown chip in " << path << "\n";
+		goto out;
+	}
+
+	if (!read_field(f, "type", type) ||
+			!read_field(f, "debug_id", bc->debug_id) ||
+			!read_field(f, "ngpr", bc->ngpr) ||
+			!read_field(f, "nstack", bc->nstack) ||
+			!read_field(f, "shader", shader))
+		goto out;
+
+	bc->type = type;
+	pshader->processor_type = type;
+	has_pshader = shader;
+
+	if (has_pshader) {
+		if (!read_field(f, "vs_as_es", pshader->vs_as_es) ||
+				!read_field(f, "indirect_files", pshader->indirect_files) ||
+				!read_field(f, "arrays", n))
+			goto out;
+
+		if (n) {
+			pshader->arrays = (r600_shader_array *)
+					calloc(n, sizeof(r600_shader_array));
+			if (!pshader->arrays)
+				goto out;
+			pshader->max_arrays = pshader->num_arrays = n;
+		}
+		for (unsigned i = 0; i < n; ++i) {
+			r600_shader_array &a = pshader->arrays[i];
+			if (fscanf(f, " array %u %u %u", &a.gpr_start, &a.gpr_count,
+					&a.comp_mask) != 3)
+				goto out;
+		}
+
+		if (!read_field(f, "inputs", n) || n > Elements(pshader->input))
+			goto out;
+		pshader->ninput = n;
+		for (unsigned i = 0; i < n; ++i) {
+			r600_shader_io &in = pshader->input[i];
+			int centroid;
+			if (fscanf(f, " input %u %d %u %d", &in.gpr, &in.spi_sid,
+					&in.interpolate, &centroid) != 4)
+				goto out;
+			in.centroid = centroid;
+		}
+	}
+
+	if (!read_field(f, "ndw", bc->ndw) || !bc->ndw)
+		goto out;
+
+	bc->bytecode = (uint32_t *)malloc(bc->ndw * 4);
+	if (!bc->bytecode)
+		goto out;
+	for (unsigned i = 0; i < bc->ndw; ++i) {
+		if (fscanf(f, "%x", &bc->bytecode[i]) != 1) {
+			sblog << "sb: truncated bytecode in " << path << "\n";
+			goto out;
+		}
+	}
+
+	r = 0;
+out:
+	if (r) {
+		free(bc->bytecode);
+		free(pshader->arrays);
+		memset(pshader, 0, sizeof(*pshader));
+	}
+	fclose(f);
+	return r;
+}
+
+} // namespace r600_sb
@@ -24,6 +24,8 @@
  *      Vadim Girlin
  */
 
+#include <cstring>
+
 #include "sb_bc.h"
 
 namespace r600_sb {
@@ -32,6 +34,7 @@ sb_log sblog;
 
 unsigned sb_context::dump_pass = 0;
 unsigned sb_context::dump_stat = 0;
+unsigned sb_context::time_passes = 0;
 unsigned sb_context::dry_run = 0;
 unsigned sb_context::no_fallback = 0;
 unsigned sb_context::safe_math = 0;
@@ -40,6 +43,8 @@ unsigned sb_context::dskip_start = 0;
 unsigned sb_context::dskip_end = 0;
 unsigned sb_context::dskip_mode = 0;
 
+const char *sb_context::capture_dir = NULL;
+
 int sb_context::init(r600_isa *isa, sb_hw_chip chip, sb_hw_class cclass) {
 	if (chip == HW_CHIP_UNKNOWN || cclass == HW_CLASS_UNKNOWN)
 		return -1;
@@ -140,4 +145,32 @@ const char* sb_context::get_hw_chip_name() {
 	}
 }
 
+void sb_context::add_pass_time(const char *name, int64_t time) {
+	for (unsigned i = 0; i < pass_times.size(); ++i) {
+		if (!strcmp(pass_times[i].name, name)) {
+			++pass_times[i].runs;
+			pass_times[i].time += time;
+			return;
+		}
+	}
+
+	sb_pass_time t = { name, 1, time };
+	pass_times.push_back(t);
+}
+
+void sb_context::dump_pass_times() {
+	int64_t total = 0;
+
+	sblog << "pass times:\n";
+	for (unsigned i = 0; i < pass_times.size(); ++i) {
+		sb_pass_time &t = pass_times[i];
+		sblog << "  ";
+		sblog.print_wl(t.name, 20);
+		sblog << ((double)t.time) / 1000000.0 << " ms (" << t.runs
+				<< " runs)\n";
+		total += t.time;
+	}
+	sblog << "  total: " << ((double)total) / 1000000.0 << " ms\n";
+}
+
 } // namespace r600_sb
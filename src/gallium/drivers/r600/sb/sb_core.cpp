@@ -61,6 +61,7 @@ sb_context *r600_sb_context_create(struct r600_context *rctx) {
 
 	sb_context::dump_pass = df & DBG_SB_DUMP;
 	sb_context::dump_stat = df & DBG_SB_STAT;
+	sb_context::time_passes = sb_context::dump_stat;
 	sb_context::dry_run = df & DBG_SB_DRY_RUN;
 	sb_context::no_fallback = df & DBG_SB_NO_FALLBACK;
 	sb_context::safe_math = df & DBG_SB_SAFEMATH;
@@ -69,6 +70,8 @@ sb_context *r600_sb_context_create(struct r600_context *rctx) {
 	sb_context::dskip_end = debug_get_num_option("R600_SB_DSKIP_END", 0);
 	sb_context::dskip_mode = debug_get_num_option("R600_SB_DSKIP_MODE", 0);
 
+	sb_context::capture_dir = debug_get_option("R600_SB_CAPTURE_DIR", NULL);
+
 	return sctx;
 }
 
@@ -84,6 +87,8 @@ void r600_sb_context_destroy(void * sctx) {
 			sblog << "context diff: ";
 			ctx->src_stats.dump_diff(ctx->opt_stats);
 		}
+		if (sb_context::time_passes)
+			ctx->dump_pass_times();
 
 		delete ctx;
 	}
@@ -94,14 +99,28 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
                              struct r600_shader *pshader,
                              int dump_bytecode,
                              int optimize) {
-	int r = 0;
-	unsigned shader_id = bc->debug_id;
-
 	sb_context *ctx = (sb_context *)rctx->sb_context;
 	if (!ctx) {
 		rctx->sb_context = ctx = r600_sb_context_create(rctx);
 	}
 
+	return optimize_bytecode(*ctx, bc, pshader, dump_bytecode, optimize);
+}
+
+int r600_sb::optimize_bytecode(sb_context &ctx, r600_bytecode *bc,
+                               r600_shader *pshader, int dump_bytecode,
+                               int optimize) {
+	int r = 0;
+	unsigned shader_id = bc->debug_id;
+
+	if (sb_context::capture_dir && optimize) {
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/shader_%u.sb",
+				sb_context::capture_dir, shader_id);
+		if (write_bytecode_file(ctx, path, bc, pshader))
+			sblog << "sb: failed to write " << path << "\n";
+	}
+
 	int64_t time_start = 0;
 	if (sb_context::dump_stat) {
 		time_start = os_time_get_nano();
@@ -109,7 +128,7 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 
 	SB_DUMP_STAT( sblog << "\nsb: shader " << shader_id << "\n"; );
 
-	bc_parser parser(*ctx, bc, pshader);
+	bc_parser parser(ctx, bc, pshader);
 
 	if ((r = parser.decode())) {
 		assert(!"sb: bytecode decoding error");
@@ -161,7 +180,12 @@ int r600_sb_bytecode_process(struct r600_context *rctx,
 
 #define SB_RUN_PASS(n, dump) \
 	do { \
+		int64_t pass_start = 0; \
+		if (sb_context::time_passes) \
+			pass_start = os_time_get_nano(); \
 		r = n(*sh).run(); \
+		if (sb_context::time_passes) \
+			ctx.add_pass_time(#n, os_time_get_nano() - pass_start); \
 		if (r) { \
 			sblog << "sb: error (" << r << ") in the " << #n << " pass.\n"; \
 			if (sb_context::no_fallback) \
@@ -0,0 +1,194 @@
+/*
+ * Copyright 2014 The Mesa Project
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Runs the sb optimizer on bytecode files saved by the driver with
+ * R600_SB_CAPTURE_DIR, without the hardware, and reports the statistics of
+ * the source and optimized code and the time spent in each pass.
+ *
+ * usage: r600_sb_offline [-d] [-p] [-r <runs>] <file>...
+ */
+
+extern "C" {
+#include "r600_pipe.h"
+#include "r600_shader.h"
+}
+
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+#include "sb_bc.h"
+
+using namespace r600_sb;
+
+struct chip_context {
+	r600_isa isa;
+	sb_context sctx;
+};
+
+typedef std::map<sb_hw_chip, chip_context*> context_map;
+
+static sb_hw_class chip_to_class(sb_hw_chip chip) {
+	if (chip <= HW_CHIP_RS880)
+		return HW_CLASS_R600;
+	if (chip <= HW_CHIP_RV740)
+		return HW_CLASS_R700;
+	if (chip <= HW_CHIP_CAICOS)
+		return HW_CLASS_EVERGREEN;
+	return HW_CLASS_CAYMAN;
+}
+
+static chip_context *get_context(context_map &contexts, sb_hw_chip chip) {
+	context_map::iterator I = contexts.find(chip);
+	if (I != contexts.end())
+		return I->second;
+
+	sb_hw_class cclass = chip_to_class(chip);
+	chip_context *c = new chip_context();
+
+	/* r600_isa_init only looks at the chip class */
+	r600_context *rctx = (r600_context *)calloc(1, sizeof(r600_context));
+	rctx->b.chip_class = (enum chip_class)(R600 + (cclass - HW_CLASS_R600));
+	int r = r600_isa_init(rctx, &c->isa);
+	free(rctx);
+
+	if (r || c->sctx.init(&c->isa, chip, cclass)) {
+		r600_isa_destroy(&c->isa);
+		delete c;
+		c = NULL;
+	}
+
+	contexts[chip] = c;
+	return c;
+}
+
+static int process_file(context_map &contexts, const char *path,
+                        int dump_bytecode, int runs) {
+	r600_shader shader;
+	sb_hw_chip chip;
+	bool has_pshader;
+	int r;
+
+	if (read_bytecode_file(path, chip, &shader, has_pshader))
+		return -1;
+
+	chip_context *c = get_context(contexts, chip);
+	if (!c) {
+		sblog << "sb: can't initialize the " << path << " chip\n";
+		r = -1;
+		goto out;
+	}
+
+	{
+		r600_bytecode &bc = shader.bc;
+		uint32_t *src = bc.bytecode;
+		unsigned ndw = bc.ndw, ngpr = bc.ngpr, nstack = bc.nstack;
+
+		sblog << "\n" << path << " (" << c->sctx.get_hw_chip_name() << ")";
+
+		/* only report the statistics of the first run */
+		for (int i = 0; i < runs; ++i) {
+			sb_context::dump_stat = i == 0;
+
+			bc.bytecode = (uint32_t *)malloc(ndw * 4);
+			memcpy(bc.bytecode, src, ndw * 4);
+			bc.ndw = ndw;
+			bc.ngpr = ngpr;
+			bc.nstack = nstack;
+
+			r = optimize_bytecode(c->sctx, &bc,
+					has_pshader ? &shader : NULL, dump_bytecode && i == 0, 1);
+			free(bc.bytecode);
+			if (r) {
+				sblog << "sb: optimizing " << path << " failed (" << r << ")\n";
+				break;
+			}
+		}
+		bc.bytecode = src;
+	}
+
+out:
+	free(shader.bc.bytecode);
+	free(shader.arrays);
+	return r;
+}
+
+static void usage() {
+	sblog << "usage: r600_sb_offline [-d] [-p] [-r <runs>] <file>...\n"
+			"  -d  dump the source and optimized bytecode\n"
+			"  -p  dump the IR after each pass\n"
+			"  -r  optimize each shader <runs> times, for benchmarking\n";
+}
+
+int main(int argc, char *argv[]) {
+	context_map contexts;
+	int dump_bytecode = 0, runs = 1, failed = 0, files = 0;
+
+	sb_context::time_passes = 1;
+
+	for (int i = 1; i < argc; ++i) {
+		if (!strcmp(argv[i], "-d"))
+			dump_bytecode = 1;
+		else if (!strcmp(argv[i], "-p"))
+			sb_context::dump_pass = 1;
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+			runs = MAX2(atoi(argv[++i]), 1);
+		else if (argv[i][0] == '-') {
+			usage();
+			return 1;
+		} else {
+			++files;
+			if (process_file(contexts, argv[i], dump_bytecode, runs))
+				++failed;
+		}
+	}
+
+	if (!files) {
+		usage();
+		return 1;
+	}
+
+	for (context_map::iterator I = contexts.begin(), E = contexts.end();
+			I != E; ++I) {
+		chip_context *c = I->second;
+		if (!c)
+			continue;
+
+		sblog << "\n" << c->sctx.get_hw_chip_name() << " totals\n";
+		sblog << "src stats: ";
+		c->sctx.src_stats.dump();
+		sblog << "opt stats: ";
+		c->sctx.opt_stats.dump();
+		sblog << "diff: ";
+		c->sctx.src_stats.dump_diff(c->sctx.opt_stats);
+		c->sctx.dump_pass_times();
+
+		r600_isa_destroy(&c->isa);
+		delete c;
+	}
+
+	if (failed)
+		sblog << "\n" << failed << " of " << files << " shaders failed\n";
+
+	return failed ? 1 : 0;
+}
@@ -498,6 +498,7 @@ void shader::collect_stats(bool opt) {
 	s.ngpr = ngpr;
 	s.nstack = nstack;
 	s.collect(root);
+	s.alu_slots = s.alu_groups * ctx.num_slots;
 
 	if (opt)
 		ctx.opt_stats.accumulate(s);
@@ -638,6 +639,7 @@ void shader_stats::accumulate(shader_stats& s) {
 
 	alu += s.alu;
 	alu_groups += s.alu_groups;
+	alu_slots += s.alu_slots;
 	alu_clauses += s.alu_clauses;
 	fetch += s.fetch;
 	fetch_clauses += s.fetch_clauses;
@@ -651,6 +653,9 @@ void shader_stats::dump() {
 			<< ", fetch clauses:" << fetch_clauses
 			<< ", cf:" << cf;
 
+	if (alu_slots)
+		sblog << ", alu fill:" << alu * 100 / alu_slots << "%";
+
 	if (shaders > 1)
 		sblog << ", shaders:" << shaders;
 
@@ -196,6 +196,47 @@ softpipe_resource_destroy(struct pipe_screen *pscreen,
 }
 
 
+/**
+ * Create a texture or buffer which uses the caller's memory.
+ */
+static struct pipe_resource *
+softpipe_resource_from_user_memory(struct pipe_screen *screen,
+                                   const struct pipe_resource *templat,
+                                   void *user_memory,
+                                   unsigned stride)
+{
+   struct softpipe_resource *spr;
+
+   if (templat->last_level != 0 ||
+       templat->depth0 != 1 ||
+       templat->array_size != 1)
+      return NULL;
+
+   if (templat->target != PIPE_BUFFER &&
+       stride < util_format_get_stride(templat->format, templat->width0))
+      return NULL;
+
+   spr = CALLOC_STRUCT(softpipe_resource);
+   if (!spr)
+      return NULL;
+
+   spr->base = *templat;
+   pipe_reference_init(&spr->base.reference, 1);
+   spr->base.screen = screen;
+
+   spr->pot = (util_is_power_of_two(templat->width0) &&
+               util_is_power_of_two(templat->height0) &&
+               util_is_power_of_two(templat->depth0));
+
+   spr->stride[0] = templat->target == PIPE_BUFFER ? templat->width0 : stride;
+   spr->level_offset[0] = 0;
+   spr->userBuffer = TRUE;
+   spr->data = user_memory;
+
+   return &spr->base;
+}
+
+
 static struct pipe_resource *
 softpipe_resource_from_handle(struct pipe_screen *screen,
                               const struct pipe_resource *templat,
@@ -520,6 +561,7 @@ softpipe_init_screen_texture_funcs(struct pipe_screen *screen)
 {
    screen->resource_create = softpipe_resource_create;
    screen->resource_destroy = softpipe_resource_destroy;
+   screen->resource_from_user_memory = softpipe_resource_from_user_memory;
    screen->resource_from_handle = softpipe_resource_from_handle;
    screen->resource_get_handle = softpipe_resource_get_handle;
    screen->can_create_resource = softpipe_can_create_resource;
@@ -30,10 +30,10 @@
  * @file
  * Trace dumping functions.
  *
- * For now we just use standard XML for dumping the trace calls, as this is
- * simple to write, parse, and visually inspect, but the actual representation
- * is abstracted out of this file, so that we can switch to a binary
- * representation if/when it becomes justified.
+ * By default we use standard XML for dumping the trace calls, as this is
+ * simple to write, parse, and visually inspect. With GALLIUM_TRACE_BINARY
+ * the calls are handed to the much cheaper binary encoding in
+ * tr_dump_binary.c instead.
  *
  * @author Jose Fonseca <jfonseca@vmware.com>
  */
@@ -53,6 +53,7 @@
 #include "util/u_format.h"
 
 #include "tr_dump.h"
+#include "tr_dump_binary.h"
 #include "tr_screen.h"
 #include "tr_texture.h"
 
@@ -62,6 +63,9 @@ static FILE *stream = NULL;
 pipe_static_mutex(call_mutex);
 static long unsigned call_no = 0;
 static boolean dumping = FALSE;
+static boolean binary = FALSE;
+
+DEBUG_GET_ONCE_BOOL_OPTION(trace_contents, "GALLIUM_TRACE_CONTENTS", FALSE)
 
 
 static INLINE void
@@ -218,7 +222,9 @@ trace_dump_tag_end(const char *name)
 void
 trace_dump_trace_flush(void)
 {
-   if(stream) {
+   /* The binary writer thread writes out whole chunks; flushing at every
+    * draw would defeat the point. */
+   if(stream && !binary) {
       fflush(stream);
    }
 }
@@ -227,7 +233,10 @@ static void
 trace_dump_trace_close(void)
 {
    if(stream) {
-      trace_dump_writes("</trace>\n");
+      if (binary)
+         trace_bin_end();
+      else
+         trace_dump_writes("</trace>\n");
       if (close_stream) {
          fclose(stream);
          close_stream = FALSE;
@@ -262,6 +271,8 @@ trace_dump_trace_begin(void)
 
    if(!stream) {
 
+      binary = debug_get_bool_option("GALLIUM_TRACE_BINARY", FALSE);
+
       if (strcmp(filename, "stderr") == 0) {
          close_stream = FALSE;
          stream = stderr;
@@ -272,14 +283,24 @@ trace_dump_trace_begin(void)
       }
       else {
          close_stream = TRUE;
-         stream = fopen(filename, "wt");
+         stream = fopen(filename, binary ? "wb" : "wt");
          if (!stream)
             return FALSE;
       }
 
-      trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
-      trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
-      trace_dump_writes("<trace version='0.1'>\n");
+      if (binary) {
+         if (!trace_bin_begin(stream)) {
+            if (close_stream)
+               fclose(stream);
+            stream = NULL;
+            return FALSE;
+         }
+      }
+      else {
+         trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
+         trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
+         trace_dump_writes("<trace version='0.1'>\n");
+      }
 
       /* Many applications don't exit cleanly, others may create and destroy a
        * screen multiple times, so we only write </trace> tag and close at exit
@@ -364,6 +385,13 @@ void trace_dump_call_begin_locked(const char *klass, const char *method)
       return;
 
    ++call_no;
+
+   if (binary) {
+      trace_bin_call_begin(call_no, klass, method);
+      call_start_time = os_time_get();
+      return;
+   }
+
    trace_dump_indent(1);
    trace_dump_writes("<call no=\'");
    trace_dump_writef("%lu", call_no);
@@ -386,6 +414,11 @@ void trace_dump_call_end_locked(void)
 
    call_end_time = os_time_get();
 
+   if (binary) {
+      trace_bin_call_end(call_end_time - call_start_time);
+      return;
+   }
+
    trace_dump_call_time(call_end_time - call_start_time);
    trace_dump_indent(1);
    trace_dump_tag_end("call");
@@ -410,13 +443,18 @@ void trace_dump_arg_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_arg_begin(name);
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin1("arg", "name", name);
 }
 
 void trace_dump_arg_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_tag_end("arg");
@@ -428,13 +466,18 @@ void trace_dump_ret_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_ret_begin();
+      return;
+   }
+
    trace_dump_indent(2);
    trace_dump_tag_begin("ret");
 }
 
 void trace_dump_ret_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_tag_end("ret");
@@ -446,6 +489,11 @@ void trace_dump_bool(int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_bool(value);
+      return;
+   }
+
    trace_dump_writef("<bool>%c</bool>", value ? '1' : '0');
 }
 
@@ -454,6 +502,11 @@ void trace_dump_int(long long int value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_int(value);
+      return;
+   }
+
    trace_dump_writef("<int>%lli</int>", value);
 }
 
@@ -462,6 +515,11 @@ void trace_dump_uint(long long unsigned value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_uint(value);
+      return;
+   }
+
    trace_dump_writef("<uint>%llu</uint>", value);
 }
 
@@ -470,6 +528,11 @@ void trace_dump_float(double value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_float(value);
+      return;
+   }
+
    trace_dump_writef("<float>%g</float>", value);
 }
 
@@ -483,6 +546,11 @@ void trace_dump_bytes(const void *data,
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_bytes(data, size);
+      return;
+   }
+
    trace_dump_writes("<bytes>");
    for(i = 0; i < size; ++i) {
       uint8_t byte = *p++;
@@ -500,16 +568,25 @@ void trace_dump_box_bytes(const void *data,
 			  unsigned stride,
 			  unsigned slice_stride)
 {
+   enum pipe_format format = resource->format;
    size_t size;
 
    /*
-    * Only dump buffer transfers to avoid huge files.
-    * TODO: Make this run-time configurable
+    * Only dump buffer transfers to avoid huge files, unless
+    * GALLIUM_TRACE_CONTENTS is set.
     */
    if (resource->target != PIPE_BUFFER) {
-      size = 0;
+      if (debug_get_option_trace_contents()) {
+         /* up to the last byte of the box, ignoring the padding after it */
+         size = (box->depth - 1) * slice_stride +
+                (util_format_get_nblocksy(format, box->height) - 1) * stride +
+                util_format_get_nblocksx(format, box->width) *
+                util_format_get_blocksize(format);
+      }
+      else {
+         size = 0;
+      }
    } else {
-      enum pipe_format format = resource->format;
       if (slice_stride)
          size = box->depth * slice_stride;
       else if (stride)
@@ -527,6 +604,11 @@ void trace_dump_string(const char *str)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_string(str);
+      return;
+   }
+
    trace_dump_writes("<string>");
    trace_dump_escape(str);
    trace_dump_writes("</string>");
@@ -537,6 +619,11 @@ void trace_dump_enum(const char *value)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_enum(value);
+      return;
+   }
+
    trace_dump_writes("<enum>");
    trace_dump_escape(value);
    trace_dump_writes("</enum>");
@@ -547,6 +634,11 @@ void trace_dump_array_begin(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_array_begin();
+      return;
+   }
+
    trace_dump_writes("<array>");
 }
 
@@ -555,12 +647,17 @@ void trace_dump_array_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_array_end();
+      return;
+   }
+
    trace_dump_writes("</array>");
 }
 
 void trace_dump_elem_begin(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("<elem>");
@@ -568,7 +665,7 @@ void trace_dump_elem_begin(void)
 
 void trace_dump_elem_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("</elem>");
@@ -579,6 +676,11 @@ void trace_dump_struct_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_struct_begin(name);
+      return;
+   }
+
    trace_dump_writef("<struct name='%s'>", name);
 }
 
@@ -587,6 +689,11 @@ void trace_dump_struct_end(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_struct_end();
+      return;
+   }
+
    trace_dump_writes("</struct>");
 }
 
@@ -595,12 +702,17 @@ void trace_dump_member_begin(const char *name)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_member_begin(name);
+      return;
+   }
+
    trace_dump_writef("<member name='%s'>", name);
 }
 
 void trace_dump_member_end(void)
 {
-   if (!dumping)
+   if (!dumping || binary)
       return;
 
    trace_dump_writes("</member>");
@@ -611,6 +723,11 @@ void trace_dump_null(void)
    if (!dumping)
       return;
 
+   if (binary) {
+      trace_bin_null();
+      return;
+   }
+
    trace_dump_writes("<null/>");
 }
 
@@ -619,6 +736,11 @@ void trace_dump_ptr(const void *value)
    if (!dumping)
       return;
 
+   if (binary && value) {
+      trace_bin_ptr(value);
+      return;
+   }
+
    if(value)
       trace_dump_writef("<ptr>0x%08lx</ptr>", (unsigned long)(uintptr_t)value);
    else
@@ -0,0 +1,663 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Binary trace encoding.
+ *
+ * Each call is encoded into a scratch buffer on the calling thread, then
+ * copied into a ring of chunks. Full chunks are handed to a writer thread,
+ * so the application only waits on I/O when the writer falls a whole ring
+ * behind.
+ *
+ * Strings are written once and then referred to by id. Top level structs,
+ * which is how all the pipe state is dumped, are interned the same way, and
+ * large byte arrays are written once per content hash.
+ */
+
+#include <string.h>
+
+#include "os/os_thread.h"
+#include "util/u_debug.h"
+#include "util/u_hash_table.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "tr_dump_binary.h"
+
+
+#define TRACE_BIN_CHUNK_SIZE (64 * 1024)
+#define TRACE_BIN_NUM_CHUNKS 16
+
+/* byte arrays at least this big are deduplicated */
+#define TRACE_BIN_MIN_BLOB_SIZE 64
+
+/* stop remembering new states after this much memory */
+#define TRACE_BIN_MAX_STATE_MEMORY (16 * 1024 * 1024)
+
+
+struct trace_bin_chunk
+{
+   size_t used;
+   uint8_t data[TRACE_BIN_CHUNK_SIZE];
+};
+
+/* Key of the state and blob tables. States keep a copy of their encoding,
+ * blobs only the hash. */
+struct trace_bin_key
+{
+   uint64_t hash;
+   size_t size;
+   const uint8_t *data;
+};
+
+
+static FILE *bin_stream = NULL;
+static boolean bin_failed = FALSE;
+
+/* Ring of chunks. The chunk at chunk_head is filled by the traced threads
+ * (which hold the call mutex), the ones from chunk_tail to chunk_head are
+ * owned by the writer thread. Both counters are free-running. */
+static struct trace_bin_chunk *chunks = NULL;
+static unsigned chunk_head = 0, chunk_tail = 0;
+static pipe_semaphore chunks_full, chunks_free;
+static pipe_thread writer;
+
+/* encoding of the current call */
+static uint8_t *call_buf = NULL;
+static size_t call_buf_size = 0, call_buf_used = 0;
+
+static struct util_hash_table *strings = NULL;
+static unsigned num_strings = 0;
+
+static struct util_hash_table *states = NULL;
+static unsigned num_states = 0;
+static size_t state_memory = 0;
+static unsigned struct_depth = 0;
+static size_t state_start = 0;
+
+static struct util_hash_table *blobs = NULL;
+
+
+static PIPE_THREAD_ROUTINE(trace_bin_writer, param)
+{
+   while (1) {
+      struct trace_bin_chunk *chunk;
+
+      pipe_semaphore_wait(&chunks_full);
+      chunk = &chunks[chunk_tail % TRACE_BIN_NUM_CHUNKS];
+
+      /* an empty chunk is only queued by trace_bin_end */
+      if (!chunk->used)
+         break;
+
+      fwrite(chunk->data, chunk->used, 1, bin_stream);
+      chunk_tail++;
+      pipe_semaphore_signal(&chunks_free);
+   }
+
+   fflush(bin_stream);
+   return 0;
+}
+
+
+/** Hand the current chunk to the writer and wait for a free one. */
+static void
+trace_bin_queue_chunk(void)
+{
+   pipe_semaphore_signal(&chunks_full);
+   chunk_head++;
+   pipe_semaphore_wait(&chunks_free);
+   chunks[chunk_head % TRACE_BIN_NUM_CHUNKS].used = 0;
+}
+
+
+static void
+trace_bin_ring_write(const void *data, size_t size)
+{
+   const uint8_t *p = data;
+
+   while (size) {
+      struct trace_bin_chunk *chunk =
+         &chunks[chunk_head % TRACE_BIN_NUM_CHUNKS];
+      size_t n = MIN2(size, TRACE_BIN_CHUNK_SIZE - chunk->used);
+
+      memcpy(chunk->data + chunk->used, p, n);
+      chunk->used += n;
+      p += n;
+      size -= n;
+
+      if (chunk->used == TRACE_BIN_CHUNK_SIZE)
+         trace_bin_queue_chunk();
+   }
+}
+
+
+static uint64_t
+trace_bin_hash(const void *data, size_t size)
+{
+   const uint8_t *p = data;
+   uint64_t hash = 0xcbf29ce484222325ull;
+   size_t i;
+
+   /* FNV-1a */
+   for (i = 0; i < size; i++) {
+      hash ^= p[i];
+      hash *= 0x100000001b3ull;
+   }
+   return hash;
+}
+
+
+static unsigned
+trace_bin_string_hash(void *key)
+{
+   return (unsigned)trace_bin_hash(key, strlen(key));
+}
+
+
+static int
+trace_bin_string_compare(void *key1, void *key2)
+{
+   return strcmp(key1, key2);
+}
+
+
+static unsigned
+trace_bin_key_hash(void *key)
+{
+   struct trace_bin_key *k = key;
+   return (unsigned)(k->hash ^ (k->hash >> 32));
+}
+
+
+static int
+trace_bin_state_compare(void *key1, void *key2)
+{
+   struct trace_bin_key *k1 = key1, *k2 = key2;
+
+   if (k1->hash != k2->hash || k1->size != k2->size)
+      return 1;
+   return memcmp(k1->data, k2->data, k1->size);
+}
+
+
+static int
+trace_bin_blob_compare(void *key1, void *key2)
+{
+   struct trace_bin_key *k1 = key1, *k2 = key2;
+
+   return k1->hash != k2->hash || k1->size != k2->size;
+}
+
+
+static enum pipe_error
+trace_bin_free_key(void *key, void *value, void *data)
+{
+   FREE(key);
+   return PIPE_OK;
+}
+
+
+static void
+trace_bin_fail(void)
+{
+   if (!bin_failed) {
+      debug_printf("trace: out of memory, the binary trace is truncated\n");
+      bin_failed = TRUE;
+   }
+}
+
+
+/*
+ * Encoding of the current call.
+ */
+
+static INLINE void
+trace_bin_write(const void *data, size_t size)
+{
+   if (call_buf_used + size > call_buf_size) {
+      size_t new_size = MAX2(call_buf_size * 2, call_buf_used + size);
+      uint8_t *new_buf = REALLOC(call_buf, call_buf_size, new_size);
+
+      if (!new_buf) {
+         trace_bin_fail();
+         return;
+      }
+      call_buf = new_buf;
+      call_buf_size = new_size;
+   }
+
+   memcpy(call_buf + call_buf_used, data, size);
+   call_buf_used += size;
+}
+
+
+static INLINE void
+trace_bin_token(enum trace_bin_token token)
+{
+   uint8_t b = token;
+   trace_bin_write(&b, 1);
+}
+
+
+static INLINE void
+trace_bin_varint(uint64_t value)
+{
+   uint8_t buf[10];
+   unsigned n = 0;
+
+   do {
+      buf[n] = value & 0x7f;
+      value >>= 7;
+      if (value)
+         buf[n] |= 0x80;
+      n++;
+   } while (value);
+
+   trace_bin_write(buf, n);
+}
+
+
+static INLINE void
+trace_bin_u64(uint64_t value)
+{
+   uint8_t buf[8];
+   unsigned i;
+
+   for (i = 0; i < 8; i++)
+      buf[i] = (value >> (i * 8)) & 0xff;
+
+   trace_bin_write(buf, 8);
+}
+
+
+/** Return the id of a string, defining it first if it is new. */
+static unsigned
+trace_bin_string_id(const char *str)
+{
+   void *value = util_hash_table_get(strings, (void *)str);
+   size_t len;
+   char *key;
+
+   if (value)
+      return (unsigned)(uintptr_t)value - 1;
+
+   len = strlen(str);
+   key = MALLOC(len + 1);
+   if (!key) {
+      trace_bin_fail();
+      return 0;
+   }
+   memcpy(key, str, len + 1);
+   util_hash_table_set(strings, key, (void *)(uintptr_t)(num_strings + 1));
+
+   trace_bin_token(TRACE_BIN_STRING_DEF);
+   trace_bin_varint(len);
+   trace_bin_write(str, len);
+
+   return num_strings++;
+}
+
+
+/*
+ * Setup and teardown.
+ */
+
+boolean
+trace_bin_begin(FILE *stream)
+{
+   static const uint8_t header[8] = {
+      'G', 'T', 'R', 'B',
+      TRACE_BIN_VERSION & 0xff, (TRACE_BIN_VERSION >> 8) & 0xff, 0, 0
+   };
+
+   chunks = MALLOC(TRACE_BIN_NUM_CHUNKS * sizeof(*chunks));
+   strings = util_hash_table_create(trace_bin_string_hash,
+                                    trace_bin_string_compare);
+   states = util_hash_table_create(trace_bin_key_hash,
+                                   trace_bin_state_compare);
+   blobs = util_hash_table_create(trace_bin_key_hash,
+                                  trace_bin_blob_compare);
+   if (!chunks || !strings || !states || !blobs)
+      goto fail;
+
+   bin_stream = stream;
+   chunks[0].used = 0;
+   pipe_semaphore_init(&chunks_full, 0);
+   pipe_semaphore_init(&chunks_free, TRACE_BIN_NUM_CHUNKS - 1);
+
+   writer = pipe_thread_create(trace_bin_writer, NULL);
+   if (!writer) {
+      pipe_semaphore_destroy(&chunks_full);
+      pipe_semaphore_destroy(&chunks_free);
+      goto fail;
+   }
+
+   trace_bin_ring_write(header, sizeof(header));
+   return TRUE;
+
+fail:
+   if (blobs)
+      util_hash_table_destroy(blobs);
+   if (states)
+      util_hash_table_destroy(states);
+   if (strings)
+      util_hash_table_destroy(strings);
+   FREE(chunks);
+   blobs = states = strings = NULL;
+   chunks = NULL;
+   bin_stream = NULL;
+   return FALSE;
+}
+
+
+/** Write everything still queued and stop the writer thread. */
+void
+trace_bin_end(void)
+{
+   if (!bin_stream)
+      return;
+
+   if (chunks[chunk_head % TRACE_BIN_NUM_CHUNKS].used)
+      trace_bin_queue_chunk();
+
+   chunks[chunk_head % TRACE_BIN_NUM_CHUNKS].used = 0;
+   pipe_semaphore_signal(&chunks_full);
+   pipe_thread_wait(writer);
+
+   pipe_semaphore_destroy(&chunks_full);
+   pipe_semaphore_destroy(&chunks_free);
+
+   util_hash_table_foreach(strings, trace_bin_free_key, NULL);
+   util_hash_table_destroy(strings);
+   util_hash_table_foreach(states, trace_bin_free_key, NULL);
+   util_hash_table_destroy(states);
+   util_hash_table_foreach(blobs, trace_bin_free_key, NULL);
+   util_hash_table_destroy(blobs);
+   strings = states = blobs = NULL;
+
+   FREE(call_buf);
+   call_buf = NULL;
+   call_buf_size = call_buf_used = 0;
+
+   FREE(chunks);
+   chunks = NULL;
+   bin_stream = NULL;
+}
+
+
+/*
+ * Dumping primitives.
+ */
+
+void
+trace_bin_call_begin(unsigned long no, const char *klass, const char *method)
+{
+   unsigned klass_id, method_id;
+
+   call_buf_used = 0;
+   struct_depth = 0;
+
+   if (bin_failed)
+      return;
+
+   klass_id = trace_bin_string_id(klass);
+   method_id = trace_bin_string_id(method);
+
+   trace_bin_token(TRACE_BIN_CALL);
+   trace_bin_varint(no);
+   trace_bin_varint(klass_id);
+   trace_bin_varint(method_id);
+}
+
+
+void
+trace_bin_call_end(int64_t time)
+{
+   if (bin_failed)
+      return;
+
+   trace_bin_token(TRACE_BIN_CALL_END);
+   trace_bin_varint(((uint64_t)time << 1) ^ (uint64_t)(time >> 63));
+
+   if (!bin_failed)
+      trace_bin_ring_write(call_buf, call_buf_used);
+}
+
+
+void
+trace_bin_arg_begin(const char *name)
+{
+   unsigned id = trace_bin_string_id(name);
+
+   trace_bin_token(TRACE_BIN_ARG);
+   trace_bin_varint(id);
+}
+
+
+void
+trace_bin_ret_begin(void)
+{
+   trace_bin_token(TRACE_BIN_RET);
+}
+
+
+void
+trace_bin_bool(int value)
+{
+   uint8_t b = value ? 1 : 0;
+
+   trace_bin_token(TRACE_BIN_BOOL);
+   trace_bin_write(&b, 1);
+}
+
+
+void
+trace_bin_int(long long int value)
+{
+   int64_t v = value;
+
+   trace_bin_token(TRACE_BIN_INT);
+   trace_bin_varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+
+void
+trace_bin_uint(long long unsigned value)
+{
+   trace_bin_token(TRACE_BIN_UINT);
+   trace_bin_varint(value);
+}
+
+
+void
+trace_bin_float(double value)
+{
+   union {
+      double d;
+      uint64_t u;
+   } v;
+
+   v.d = value;
+   trace_bin_token(TRACE_BIN_FLOAT);
+   trace_bin_u64(v.u);
+}
+
+
+void
+trace_bin_bytes(const void *data, size_t size)
+{
+   struct trace_bin_key key, *stored;
+
+   if (size < TRACE_BIN_MIN_BLOB_SIZE) {
+      trace_bin_token(TRACE_BIN_BYTES);
+      trace_bin_varint(size);
+      trace_bin_write(data, size);
+      return;
+   }
+
+   key.hash = trace_bin_hash(data, size);
+   key.size = size;
+   key.data = NULL;
+
+   if (util_hash_table_get(blobs, &key)) {
+      trace_bin_token(TRACE_BIN_BLOB_REF);
+      trace_bin_u64(key.hash);
+      return;
+   }
+
+   stored = MALLOC_STRUCT(trace_bin_key);
+   if (stored) {
+      *stored = key;
+      util_hash_table_set(blobs, stored, (void *)1);
+   }
+
+   trace_bin_token(TRACE_BIN_BLOB_DEF);
+   trace_bin_u64(key.hash);
+   trace_bin_varint(size);
+   trace_bin_write(data, size);
+}
+
+
+void
+trace_bin_string(const char *str)
+{
+   size_t len = strlen(str);
+
+   trace_bin_token(TRACE_BIN_STRING);
+   trace_bin_varint(len);
+   trace_bin_write(str, len);
+}
+
+
+void
+trace_bin_enum(const char *value)
+{
+   unsigned id = trace_bin_string_id(value);
+
+   trace_bin_token(TRACE_BIN_ENUM);
+   trace_bin_varint(id);
+}
+
+
+void
+trace_bin_array_begin(void)
+{
+   trace_bin_token(TRACE_BIN_ARRAY);
+}
+
+
+void
+trace_bin_array_end(void)
+{
+   trace_bin_token(TRACE_BIN_END);
+}
+
+
+void
+trace_bin_struct_begin(const char *name)
+{
+   unsigned id;
+
+   /* Top level structs may be replaced by a reference to an identical
+    * one when they end. */
+   if (struct_depth++ == 0) {
+      state_start = call_buf_used;
+      trace_bin_token(TRACE_BIN_STATE_DEF);
+   }
+
+   id = trace_bin_string_id(name);
+   trace_bin_token(TRACE_BIN_STRUCT);
+   trace_bin_varint(id);
+}
+
+
+void
+trace_bin_struct_end(void)
+{
+   struct trace_bin_key key, *stored;
+   void *value;
+
+   trace_bin_token(TRACE_BIN_END);
+
+   if (--struct_depth != 0 || bin_failed)
+      return;
+
+   /* skip the STATE_DEF token */
+   key.data = call_buf + state_start + 1;
+   key.size = call_buf_used - state_start - 1;
+   key.hash = trace_bin_hash(key.data, key.size);
+
+   value = util_hash_table_get(states, &key);
+   if (value) {
+      call_buf_used = state_start;
+      trace_bin_token(TRACE_BIN_STATE_REF);
+      trace_bin_varint((uintptr_t)value - 1);
+      return;
+   }
+
+   /* The reader numbers every STATE_DEF, remembered or not. */
+   if (state_memory + key.size <= TRACE_BIN_MAX_STATE_MEMORY) {
+      stored = MALLOC(sizeof(*stored) + key.size);
+      if (stored) {
+         stored->hash = key.hash;
+         stored->size = key.size;
+         stored->data = (const uint8_t *)(stored + 1);
+         memcpy(stored + 1, key.data, key.size);
+         util_hash_table_set(states, stored,
+                             (void *)(uintptr_t)(num_states + 1));
+         state_memory += key.size;
+      }
+   }
+   num_states++;
+}
+
+
+void
+trace_bin_member_begin(const char *name)
+{
+   unsigned id = trace_bin_string_id(name);
+
+   trace_bin_token(TRACE_BIN_MEMBER);
+   trace_bin_varint(id);
+}
+
+
+void
+trace_bin_null(void)
+{
+   trace_bin_token(TRACE_BIN_NULL);
+}
+
+
+void
+trace_bin_ptr(const void *value)
+{
+   trace_bin_token(TRACE_BIN_PTR);
+   trace_bin_varint((uintptr_t)value);
+}
@@ -0,0 +1,110 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Binary trace encoding, used by tr_dump.c when GALLIUM_TRACE_BINARY is set.
+ *
+ * The functions mirror the XML dumping primitives, and must be called with
+ * the call mutex held.
+ */
+
+#ifndef TR_DUMP_BINARY_H
+#define TR_DUMP_BINARY_H
+
+
+#include <stdio.h>
+
+#include "pipe/p_compiler.h"
+
+
+#define TRACE_BIN_VERSION 1
+
+/*
+ * The file starts with the 4 bytes "GTRB" and TRACE_BIN_VERSION as a 32 bit
+ * little endian integer, followed by tokens. Each token is one byte, and
+ * the data after it uses these encodings:
+ *
+ *  - varint: unsigned LEB128;
+ *  - sint: zigzag encoded varint;
+ *  - str: varint id of a string previously defined with STRING_DEF;
+ *  - u64: 8 bytes, little endian.
+ *
+ * STRING_DEF can appear wherever a token is expected. Values are one of the
+ * value tokens; arrays and structs are terminated by END.
+ */
+enum trace_bin_token {
+   TRACE_BIN_STRING_DEF = 1,  /* varint size, bytes; takes the next id */
+   TRACE_BIN_CALL,            /* varint no, str class, str method */
+   TRACE_BIN_CALL_END,        /* sint time */
+   TRACE_BIN_ARG,             /* str name, value */
+   TRACE_BIN_RET,             /* value */
+   TRACE_BIN_NULL,
+   TRACE_BIN_BOOL,            /* 1 byte */
+   TRACE_BIN_INT,             /* sint */
+   TRACE_BIN_UINT,            /* varint */
+   TRACE_BIN_FLOAT,           /* 8 bytes, IEEE double, little endian */
+   TRACE_BIN_STRING,          /* varint size, bytes */
+   TRACE_BIN_ENUM,            /* str */
+   TRACE_BIN_ARRAY,           /* values, END */
+   TRACE_BIN_STRUCT,          /* str name, MEMBER..., END */
+   TRACE_BIN_MEMBER,          /* str name, value */
+   TRACE_BIN_END,
+   TRACE_BIN_PTR,             /* varint */
+   TRACE_BIN_BYTES,           /* varint size, bytes */
+   TRACE_BIN_BLOB_DEF,        /* u64 content hash, varint size, bytes */
+   TRACE_BIN_BLOB_REF,        /* u64 content hash of a previous BLOB_DEF */
+   TRACE_BIN_STATE_DEF,       /* STRUCT value; takes the next state id */
+   TRACE_BIN_STATE_REF        /* varint id of a previous STATE_DEF */
+};
+
+
+boolean trace_bin_begin(FILE *stream);
+void trace_bin_end(void);
+
+void trace_bin_call_begin(unsigned long no, const char *klass,
+                          const char *method);
+void trace_bin_call_end(int64_t time);
+void trace_bin_arg_begin(const char *name);
+void trace_bin_ret_begin(void);
+void trace_bin_bool(int value);
+void trace_bin_int(long long int value);
+void trace_bin_uint(long long unsigned value);
+void trace_bin_float(double value);
+void trace_bin_bytes(const void *data, size_t size);
+void trace_bin_string(const char *str);
+void trace_bin_enum(const char *value);
+void trace_bin_array_begin(void);
+void trace_bin_array_end(void);
+void trace_bin_struct_begin(const char *name);
+void trace_bin_struct_end(void);
+void trace_bin_member_begin(const char *name);
+void trace_bin_null(void);
+void trace_bin_ptr(const void *value);
+
+
+#endif /* TR_DUMP_BINARY_H */
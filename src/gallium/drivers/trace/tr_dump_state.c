@@ -662,6 +662,8 @@ void trace_dump_vertex_element(const struct pipe_vertex_element *state)
 
    trace_dump_member(uint, state, src_offset);
 
+   trace_dump_member(uint, state, instance_divisor);
+
    trace_dump_member(uint, state, vertex_buffer_index);
 
    trace_dump_member(format, state, src_format);
@@ -684,6 +686,15 @@ void trace_dump_constant_buffer(const struct pipe_constant_buffer *state)
    trace_dump_member(ptr, state, buffer);
    trace_dump_member(uint, state, buffer_offset);
    trace_dump_member(uint, state, buffer_size);
+
+   /* user constants can't be found anywhere else in the trace */
+   trace_dump_member_begin("user_buffer");
+   if (state->user_buffer)
+      trace_dump_bytes(state->user_buffer, state->buffer_size);
+   else
+      trace_dump_null();
+   trace_dump_member_end();
+
    trace_dump_struct_end();
 }
 
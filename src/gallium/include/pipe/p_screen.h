@@ -163,6 +163,21 @@ struct pipe_screen {
 						  const struct pipe_resource *templat,
 						  struct winsys_handle *handle);
 
+   /**
+    * Create a resource which uses memory provided by the caller as its
+    * storage instead of allocating its own.  The memory must stay valid
+    * until the resource is destroyed.  Only resources with a single level
+    * and layer can be created this way.
+    * \param stride  bytes between rows of a texture, ignored for buffers
+    * \return NULL if the driver can't use the memory, for instance
+    *         because of its size or alignment.
+    * This is optional and may be NULL.
+    */
+   struct pipe_resource * (*resource_from_user_memory)(struct pipe_screen *,
+                                                       const struct pipe_resource *templat,
+                                                       void *user_memory,
+                                                       unsigned stride);
+
    /**
     * Get a winsys_handle from a texture. Some platforms/winsys requires
     * that the texture is created with a special usage flag like
@@ -191,7 +191,8 @@ clEnqueueMarkerWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
    // Create a hard event that depends on the events in the wait list:
    // previous commands in the same queue are implicitly serialized
-   // with respect to it -- hard events always are.
+   // with respect to it -- in an out-of-order queue only if the wait
+   // list is empty.
    auto hev = create<hard_event>(q, CL_COMMAND_MARKER, deps);
 
    ret_object(rd_ev, hev);
@@ -203,9 +204,12 @@ clEnqueueMarkerWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
 CLOVER_API cl_int
 clEnqueueBarrier(cl_command_queue d_q) try {
-   obj(d_q);
+   auto &q = obj(d_q);
 
-   // No need to do anything, q preserves data ordering strictly.
+   // No need to do anything if q preserves data ordering strictly,
+   // otherwise the commands enqueued after this one wait for it.
+   if (q.out_of_order())
+      create<hard_event>(q, CL_COMMAND_BARRIER, ref_vector<event> {});
 
    return CL_SUCCESS;
 
@@ -226,7 +230,7 @@ clEnqueueBarrierWithWaitList(cl_command_queue d_q, cl_uint num_deps,
 
    // Create a hard event that depends on the events in the wait list:
    // subsequent commands in the same queue will be implicitly
-   // serialized with respect to it -- hard events always are.
+   // serialized with respect to it, in an out-of-order queue too.
    auto hev = create<hard_event>(q, CL_COMMAND_BARRIER, deps);
 
    ret_object(rd_ev, hev);
@@ -294,9 +298,9 @@ CLOVER_API cl_int
 clFinish(cl_command_queue d_q) try {
    auto &q = obj(d_q);
 
-   // Create a temporary hard event -- it implicitly depends on all
-   // the previously queued hard events.
-   auto hev = create<hard_event>(q, 0, ref_vector<event> {});
+   // Create a temporary marker -- it implicitly depends on all the
+   // previously queued hard events.
+   auto hev = create<hard_event>(q, CL_COMMAND_MARKER, ref_vector<event> {});
 
    // And wait on it.
    hev().wait();
@@ -49,7 +49,7 @@ clCreateCommandQueue(cl_context d_ctx, cl_device_id d_dev,
 
 CLOVER_API cl_int
 clRetainCommandQueue(cl_command_queue d_q) try {
-   obj(d_q).retain();
+   obj(d_q).retain_api();
    return CL_SUCCESS;
 
 } catch (error &e) {
@@ -58,7 +58,11 @@ clRetainCommandQueue(cl_command_queue d_q) try {
 
 CLOVER_API cl_int
 clReleaseCommandQueue(cl_command_queue d_q) try {
-   if (obj(d_q).release())
+   auto &q = obj(d_q);
+
+   q.flush();
+
+   if (q.release_api())
       delete pobj(d_q);
 
    return CL_SUCCESS;
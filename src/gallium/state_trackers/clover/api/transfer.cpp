@@ -219,6 +219,13 @@ namespace {
                                  size(src_pitch, region));
          vector_t v = {};
 
+         // Nothing to copy if both sides are the same memory, e.g. when
+         // a CL_MEM_USE_HOST_PTR buffer the driver uses in place is
+         // read back into its host_ptr.
+         if (static_cast<const void *>(dst) ==
+             static_cast<const void *>(src) && dst_pitch == src_pitch)
+            return;
+
          for (v[2] = 0; v[2] < region[2]; ++v[2]) {
             for (v[1] = 0; v[1] < region[1]; ++v[1]) {
                std::memcpy(
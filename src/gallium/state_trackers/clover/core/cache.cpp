@@ -0,0 +1,221 @@
+//
+// Copyright 2014 The Mesa Project
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "core/cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <tuple>
+#include <vector>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+using namespace clover;
+
+namespace {
+   const char magic[] = "clover-cache-2";
+   const uint64_t max_size = 64 << 20;
+
+   std::string
+   cache_dir() {
+      const char *dir = std::getenv("CLOVER_CACHE_DIR");
+      const char *home;
+
+      if (dir)
+         return dir;
+      else if ((home = std::getenv("XDG_CACHE_HOME")) && *home)
+         return std::string(home) + "/mesa/clover";
+      else if ((home = std::getenv("HOME")) && *home)
+         return std::string(home) + "/.cache/mesa/clover";
+      else
+         return "";
+   }
+
+   bool
+   make_dirs(const std::string &path) {
+      size_t pos = 0;
+
+      do {
+         pos = path.find('/', pos + 1);
+
+         if (mkdir(path.substr(0, pos).c_str(), 0755) && errno != EEXIST)
+            return false;
+      } while (pos != std::string::npos);
+
+      return true;
+   }
+
+   ///
+   /// The file name of the entry for \a key.  Different keys may
+   /// collide, so the whole key is stored in the entry and compared on
+   /// lookup.
+   ///
+   std::string
+   entry_path(const std::string &dir, const std::string &key) {
+      // 64-bit FNV-1a.
+      uint64_t hash = 0xcbf29ce484222325ull;
+      char name[17];
+
+      for (unsigned char c : key)
+         hash = (hash ^ c) * 0x100000001b3ull;
+
+      std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+      return dir + "/" + name;
+   }
+
+   ///
+   /// Remove the least recently used entries of \a dir until it's
+   /// below max_size.  Lookups update the modification time of the
+   /// entries they hit.
+   ///
+   void
+   evict(const std::string &dir) {
+      std::vector<std::tuple<time_t, long, std::string>> entries;
+      uint64_t size = 0;
+      DIR *d = opendir(dir.c_str());
+      struct dirent *e;
+
+      if (!d)
+         return;
+
+      while ((e = readdir(d))) {
+         const std::string path = dir + "/" + e->d_name;
+         struct stat st;
+
+         // Skip the temporary files of the entries being stored.
+         if (std::strlen(e->d_name) != 16 ||
+             stat(path.c_str(), &st) || !S_ISREG(st.st_mode))
+            continue;
+
+         entries.emplace_back(st.st_mtim.tv_sec, st.st_mtim.tv_nsec, path);
+         size += st.st_size;
+      }
+
+      closedir(d);
+
+      if (size <= max_size)
+         return;
+
+      std::sort(entries.begin(), entries.end());
+
+      for (auto &entry : entries) {
+         struct stat st;
+
+         if (size <= max_size)
+            break;
+
+         const std::string &path = std::get<2>(entry);
+
+         if (!stat(path.c_str(), &st) && !std::remove(path.c_str()))
+            size -= std::min<uint64_t>(size, st.st_size);
+      }
+   }
+}
+
+bool
+cache::lookup(const std::string &key, module &m, std::string &log) {
+   const std::string dir = cache_dir();
+
+   if (dir.empty())
+      return false;
+
+   const std::string path = entry_path(dir, key);
+   std::ifstream f(path, std::ios::binary);
+   std::string entry_magic, entry_key, entry_log;
+   uint32_t key_size, log_size;
+
+   if (!std::getline(f, entry_magic) || entry_magic != magic ||
+       !f.read(reinterpret_cast<char *>(&key_size), sizeof(key_size)) ||
+       key_size != key.size())
+      return false;
+
+   entry_key.resize(key_size);
+   if (!f.read(&entry_key[0], key_size) || entry_key != key ||
+       !f.read(reinterpret_cast<char *>(&log_size), sizeof(log_size)) ||
+       log_size > max_size)
+      return false;
+
+   entry_log.resize(log_size);
+   if (log_size && !f.read(&entry_log[0], log_size))
+      return false;
+
+   std::vector<unsigned char> data((std::istreambuf_iterator<char>(f)),
+                                   std::istreambuf_iterator<char>());
+
+   try {
+      compat::istream::buffer_t bin(data.data(), data.size());
+      compat::istream s(bin);
+
+      m = module::deserialize(s);
+      log = entry_log;
+      utime(path.c_str(), NULL);
+      return true;
+
+   } catch (compat::istream::error &e) {
+      return false;
+   }
+}
+
+void
+cache::store(const std::string &key, const module &m,
+             const std::string &log) {
+   const std::string dir = cache_dir();
+
+   if (dir.empty() || !make_dirs(dir))
+      return;
+
+   const std::string path = entry_path(dir, key);
+   std::ostringstream tmp_path;
+   compat::ostream::buffer_t bin;
+   compat::ostream s(bin);
+   const uint32_t key_size = key.size();
+   const uint32_t log_size = log.size();
+
+   m.serialize(s);
+
+   // Write to a temporary file and rename it, so other processes never
+   // see a partial entry.
+   tmp_path << path << ".tmp" << getpid();
+
+   std::ofstream f(tmp_path.str(), std::ios::binary);
+
+   f << magic << '\n';
+   f.write(reinterpret_cast<const char *>(&key_size), sizeof(key_size));
+   f.write(key.data(), key.size());
+   f.write(reinterpret_cast<const char *>(&log_size), sizeof(log_size));
+   f.write(log.data(), log.size());
+   f.write(reinterpret_cast<const char *>(bin.begin()), bin.size());
+   f.close();
+
+   if (!f || std::rename(tmp_path.str().c_str(), path.c_str()))
+      std::remove(tmp_path.str().c_str());
+   else
+      evict(dir);
+}
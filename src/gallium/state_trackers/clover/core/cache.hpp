@@ -0,0 +1,61 @@
+//
+// Copyright 2014 The Mesa Project
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef CLOVER_CORE_CACHE_HPP
+#define CLOVER_CORE_CACHE_HPP
+
+#include <string>
+
+#include "core/module.hpp"
+
+namespace clover {
+   ///
+   /// On-disk cache of compiled programs, so the same source doesn't
+   /// have to go through the compiler again in every process.
+   ///
+   /// Entries are stored in CLOVER_CACHE_DIR, which defaults to
+   /// $XDG_CACHE_HOME/mesa/clover or ~/.cache/mesa/clover; setting it to
+   /// an empty string disables the cache.  \a key must identify
+   /// everything the compilation depends on: source, build options,
+   /// target and compiler version.
+   ///
+   /// The directory is kept below 64 MB by evicting the least recently
+   /// used entries when a new one is stored.
+   ///
+   namespace cache {
+      ///
+      /// Look up the module built for \a key and the log of its build,
+      /// returns false if there isn't any valid entry for it.
+      ///
+      bool lookup(const std::string &key, module &m, std::string &log);
+
+      ///
+      /// Store the module built for \a key along with the log of its
+      /// build.  Failures are ignored, the cache is just an
+      /// optimization.
+      ///
+      void store(const std::string &key, const module &m,
+                 const std::string &log);
+   }
+}
+
+#endif
@@ -35,6 +35,13 @@ namespace clover {
                                const compat::string &opts,
                                compat::string &r_log);
 
+   ///
+   /// Identify the compiler and the libclc library used to build
+   /// programs for \a target, so cached binaries built by a different
+   /// version aren't used.
+   ///
+   compat::string compiler_version_llvm(const compat::string &target);
+
    module compile_program_tgsi(const compat::string &source);
 }
 
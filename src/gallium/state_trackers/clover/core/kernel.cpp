@@ -66,15 +66,20 @@ kernel::launch(command_queue &q,
                const std::vector<size_t> &grid_offset,
                const std::vector<size_t> &grid_size,
                const std::vector<size_t> &block_size) {
-   const auto m = program().binary(q.device());
+   const auto &m = program().binary(q.device());
    const auto reduced_grid_size =
       map(divides(), grid_size, block_size);
    void *st = exec.bind(&q);
 
+   // The driver replaces the buffer offsets at the global handles with
+   // the addresses of the buffers, which may move from one launch to the
+   // next.  Give it a copy so exec.input keeps the offsets.
+   std::vector<uint8_t> input = exec.input;
+
    // The handles are created during exec_context::bind(), so we need make
    // sure to call exec_context::bind() before retrieving them.
    std::vector<uint32_t *> g_handles = map([&](size_t h) {
-         return (uint32_t *)&exec.input[h];
+         return (uint32_t *)&input[h];
       }, exec.g_handles);
 
    q.pipe->bind_compute_state(q.pipe, st);
@@ -93,7 +98,7 @@ kernel::launch(command_queue &q,
                        pad_vector(q, block_size, 1).data(),
                        pad_vector(q, reduced_grid_size, 1).data(),
                        find(name_equals(_name), m.syms).offset,
-                       exec.input.data());
+                       input.data());
 
    q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(), NULL, NULL);
    q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(), NULL);
@@ -101,7 +106,8 @@ kernel::launch(command_queue &q,
                              exec.sviews.size(), NULL);
    q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE, 0,
                                exec.samplers.size(), NULL);
-   exec.unbind();
+
+   // The argument state stays in exec, for the next launch to reuse.
 }
 
 size_t
@@ -155,16 +161,35 @@ kernel::module(const command_queue &q) const {
 }
 
 kernel::exec_context::exec_context(kernel &kern) :
-   kern(kern), q(NULL), mem_local(0), st(NULL), cs() {
+   kern(kern), q(NULL), bound(false), mem_local(0), st(NULL), cs() {
 }
 
 kernel::exec_context::~exec_context() {
+   if (bound)
+      unbind();
+
    if (st)
       q->pipe->delete_compute_state(q->pipe, st);
 }
 
 void *
 kernel::exec_context::bind(intrusive_ptr<command_queue> _q) {
+   // The state of the previous launch can be reused if it was for the
+   // same queue, after updating the arguments set since then, if they
+   // can be updated in place.
+   if (bound && q == _q &&
+       all_of([&](kernel::argument &karg) {
+             return !karg._dirty || karg.rebind(*this);
+          }, kern.args())) {
+      for (auto &karg : kern.args())
+         karg._dirty = false;
+
+      return st;
+   }
+
+   if (bound)
+      unbind();
+
    std::swap(q, _q);
 
    // Bind kernel arguments.
@@ -174,8 +199,11 @@ kernel::exec_context::bind(intrusive_ptr<command_queue> _q) {
 
    for_each([=](kernel::argument &karg, const module::argument &marg) {
                karg.bind(*this, marg);
+               karg._dirty = false;
             }, kern.args(), margs);
 
+   bound = true;
+
    // Create a new compute state if anything changed.
    if (!st || q != _q ||
        cs.req_local_mem != mem_local ||
@@ -204,6 +232,7 @@ kernel::exec_context::unbind() {
    g_buffers.clear();
    g_handles.clear();
    mem_local = 0;
+   bound = false;
 }
 
 namespace {
@@ -282,7 +311,7 @@ namespace {
    }
 }
 
-kernel::argument::argument() : _set(false) {
+kernel::argument::argument() : _set(false), _dirty(false) {
 }
 
 bool
@@ -290,6 +319,16 @@ kernel::argument::set() const {
    return _set;
 }
 
+bool
+kernel::argument::dirty() const {
+   return _dirty;
+}
+
+bool
+kernel::argument::rebind(exec_context &ctx) {
+   return false;
+}
+
 size_t
 kernel::argument::storage() const {
    return 0;
@@ -304,7 +343,7 @@ kernel::scalar_argument::set(size_t size, const void *value) {
       throw error(CL_INVALID_ARG_SIZE);
 
    v = { (uint8_t *)value, (uint8_t *)value + size };
-   _set = true;
+   _set = _dirty = true;
 }
 
 void
@@ -315,9 +354,22 @@ kernel::scalar_argument::bind(exec_context &ctx,
    extend(w, marg.ext_type, marg.target_size);
    byteswap(w, ctx.q->device().endianness());
    align(ctx.input, marg.target_align);
+   this->marg = marg;
+   offset = ctx.input.size();
    insert(ctx.input, w);
 }
 
+bool
+kernel::scalar_argument::rebind(exec_context &ctx) {
+   auto w = v;
+
+   // The size of the argument can't change, overwrite it in place.
+   extend(w, marg.ext_type, marg.target_size);
+   byteswap(w, ctx.q->device().endianness());
+   std::copy(w.begin(), w.end(), ctx.input.begin() + offset);
+   return true;
+}
+
 void
 kernel::scalar_argument::unbind(exec_context &ctx) {
 }
@@ -328,7 +380,7 @@ kernel::global_argument::set(size_t size, const void *value) {
       throw error(CL_INVALID_ARG_SIZE);
 
    buf = pobj<buffer>(value ? *(cl_mem *)value : NULL);
-   _set = true;
+   _set = _dirty = true;
 }
 
 void
@@ -369,7 +421,7 @@ kernel::local_argument::set(size_t size, const void *value) {
       throw error(CL_INVALID_ARG_VALUE);
 
    _storage = size;
-   _set = true;
+   _set = _dirty = true;
 }
 
 void
@@ -395,7 +447,7 @@ kernel::constant_argument::set(size_t size, const void *value) {
       throw error(CL_INVALID_ARG_SIZE);
 
    buf = pobj<buffer>(value ? *(cl_mem *)value : NULL);
-   _set = true;
+   _set = _dirty = true;
 }
 
 void
@@ -416,13 +468,14 @@ kernel::constant_argument::bind(exec_context &ctx,
    } else {
       // Null pointer.
       allocate(ctx.input, marg.target_size);
+      st = NULL;
    }
 }
 
 void
 kernel::constant_argument::unbind(exec_context &ctx) {
-   if (buf)
-      buf->resource(*ctx.q).unbind_surface(*ctx.q, st);
+   if (st)
+      resource::unbind_surface(*ctx.q, st);
 }
 
 void
@@ -431,7 +484,7 @@ kernel::image_rd_argument::set(size_t size, const void *value) {
       throw error(CL_INVALID_ARG_SIZE);
 
    img = &obj<image>(*(cl_mem *)value);
-   _set = true;
+   _set = _dirty = true;
 }
 
 void
@@ -450,7 +503,7 @@ kernel::image_rd_argument::bind(exec_context &ctx,
 
 void
 kernel::image_rd_argument::unbind(exec_context &ctx) {
-   img->resource(*ctx.q).unbind_sampler_view(*ctx.q, st);
+   resource::unbind_sampler_view(*ctx.q, st);
 }
 
 void
@@ -459,7 +512,7 @@ kernel::image_wr_argument::set(size_t size, const void *value) {
       throw error(CL_INVALID_ARG_SIZE);
 
    img = &obj<image>(*(cl_mem *)value);
-   _set = true;
+   _set = _dirty = true;
 }
 
 void
@@ -478,7 +531,7 @@ kernel::image_wr_argument::bind(exec_context &ctx,
 
 void
 kernel::image_wr_argument::unbind(exec_context &ctx) {
-   img->resource(*ctx.q).unbind_surface(*ctx.q, st);
+   resource::unbind_surface(*ctx.q, st);
 }
 
 void
@@ -487,7 +540,7 @@ kernel::sampler_argument::set(size_t size, const void *value) {
       throw error(CL_INVALID_ARG_SIZE);
 
    s = &obj(*(cl_sampler *)value);
-   _set = true;
+   _set = _dirty = true;
 }
 
 void
@@ -499,5 +552,5 @@ kernel::sampler_argument::bind(exec_context &ctx,
 
 void
 kernel::sampler_argument::unbind(exec_context &ctx) {
-   s->unbind(*ctx.q, st);
+   sampler::unbind(*ctx.q, st);
 }
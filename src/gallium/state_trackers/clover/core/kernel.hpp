@@ -51,6 +51,7 @@ namespace clover {
 
          kernel &kern;
          intrusive_ptr<command_queue> q;
+         bool bound;
 
          std::vector<uint8_t> input;
          std::vector<void *> samplers;
@@ -77,6 +78,10 @@ namespace clover {
          /// \a true if the argument has been set.
          bool set() const;
 
+         /// \a true if the argument has been set since it was last
+         /// bound.
+         bool dirty() const;
+
          /// Storage space required for the referenced object.
          virtual size_t storage() const;
 
@@ -88,11 +93,20 @@ namespace clover {
          virtual void bind(exec_context &ctx,
                            const module::argument &marg) = 0;
 
-         /// Free any resources that were allocated in bind().
+         /// Update the already bound \a ctx with the new value of
+         /// this argument, returns false if it has to be bound again
+         /// with all the other arguments instead.
+         virtual bool rebind(exec_context &ctx);
+
+         /// Free any resources that were allocated in bind().  The
+         /// object the argument is set to may not exist anymore.
          virtual void unbind(exec_context &ctx) = 0;
 
+         friend struct exec_context;
+
       protected:
          bool _set;
+         bool _dirty;
       };
 
    private:
@@ -143,11 +157,14 @@ namespace clover {
          virtual void set(size_t size, const void *value);
          virtual void bind(exec_context &ctx,
                            const module::argument &marg);
+         virtual bool rebind(exec_context &ctx);
          virtual void unbind(exec_context &ctx);
 
       private:
          size_t size;
          std::vector<uint8_t> v;
+         module::argument marg;
+         size_t offset;
       };
 
       class global_argument : public argument {
@@ -31,7 +31,9 @@ memory_obj::memory_obj(clover::context &ctx, cl_mem_flags flags,
    context(ctx), _flags(flags),
    _size(size), _host_ptr(host_ptr),
    _destroy_notify([]{}) {
-   if (flags & (CL_MEM_COPY_HOST_PTR | CL_MEM_USE_HOST_PTR))
+   // With CL_MEM_USE_HOST_PTR the application keeps host_ptr valid for
+   // the lifetime of the object, so there is no need for a copy.
+   if (flags & CL_MEM_COPY_HOST_PTR)
       data.append((char *)host_ptr, size);
 }
 
@@ -21,10 +21,61 @@
 //
 
 #include "core/program.hpp"
+#include "core/cache.hpp"
 #include "core/compiler.hpp"
 
+#include <sstream>
+
 using namespace clover;
 
+namespace {
+   ///
+   /// Whether the result of building \a source may depend on files
+   /// which aren't part of the cache key.
+   ///
+   bool
+   has_includes(const std::string &source, const std::string &opts) {
+      return source.find("#include") != std::string::npos ||
+         (" " + opts).find(" -I") != std::string::npos;
+   }
+
+   ///
+   /// Build \a source with LLVM unless the same program was already
+   /// built for the same device and options, by this or any other
+   /// process.  Programs including headers are always built, since the
+   /// headers could have changed since.
+   ///
+   module
+   compile_program_cached(const device &dev, const std::string &source,
+                          const std::string &opts, compat::string &log) {
+      if (has_includes(source, opts))
+         return compile_program_llvm(source, dev.ir_format(),
+                                     dev.ir_target(), opts, log);
+
+      std::ostringstream key;
+      std::string cached_log;
+      module m;
+
+      key << "clover " << PACKAGE_VERSION << "\n"
+          << dev.ir_format() << " " << dev.ir_target() << "\n"
+          << std::string(compiler_version_llvm(dev.ir_target())) << "\n"
+          << opts << "\n"
+          << source;
+
+      // The log of a successful build may hold warnings, the
+      // application gets it back even when the build is skipped.
+      if (cache::lookup(key.str(), m, cached_log)) {
+         log = cached_log;
+      } else {
+         m = compile_program_llvm(source, dev.ir_format(), dev.ir_target(),
+                                  opts, log);
+         cache::store(key.str(), m, log);
+      }
+
+      return m;
+   }
+}
+
 program::program(clover::context &ctx, const std::string &source) :
    has_source(true), context(ctx), _source(source) {
 }
@@ -57,9 +108,8 @@ program::build(const ref_vector<device> &devs, const char *opts) {
          try {
             auto module = (dev.ir_format() == PIPE_SHADER_IR_TGSI ?
                            compile_program_tgsi(_source) :
-                           compile_program_llvm(_source, dev.ir_format(),
-                                                dev.ir_target(), build_opts(dev),
-                                                log));
+                           compile_program_cached(dev, _source,
+                                                  build_opts(dev), log));
             _binaries.insert({ &dev, module });
             _logs.insert({ &dev, std::string(log.c_str()) });
          } catch (const build_error &) {
@@ -29,7 +29,7 @@ using namespace clover;
 
 command_queue::command_queue(clover::context &ctx, clover::device &dev,
                              cl_command_queue_properties props) :
-   context(ctx), device(dev), props(props) {
+   context(ctx), device(dev), props(props), api_refs(1) {
    pipe = dev.pipe->context_create(dev.pipe, NULL);
    if (!pipe)
       throw error(CL_INVALID_DEVICE);
@@ -45,16 +45,46 @@ command_queue::flush() {
    pipe_fence_handle *fence = NULL;
 
    if (!queued_events.empty()) {
+      std::deque<intrusive_ref<hard_event>> pending;
+
       pipe->flush(pipe, &fence, 0);
 
-      while (!queued_events.empty() &&
-             queued_events.front()().signalled()) {
-         queued_events.front()().fence(fence);
-         queued_events.pop_front();
+      // Events still waiting for their dependencies stay queued.  In an
+      // in-order queue they are always at the end of the list, in an
+      // out-of-order queue they don't hold back the ones behind them.
+      for (auto &ev : queued_events) {
+         if (ev().signalled())
+            ev().fence(fence);
+         else
+            pending.push_back(ev);
       }
 
+      queued_events.swap(pending);
       screen->fence_reference(screen, &fence, NULL);
    }
+
+   // The barrier holds a reference to the queue, drop it as soon as
+   // nothing can depend on it anymore.
+   if (barrier && barrier->signalled())
+      barrier = NULL;
+}
+
+void
+command_queue::retain_api() {
+   api_refs++;
+   retain();
+}
+
+bool
+command_queue::release_api() {
+   // Once the application is done with the queue no command can be
+   // enqueued after the barrier anymore.  Drop it even if it hasn't
+   // signalled yet, otherwise the queue and the barrier would keep
+   // each other alive.
+   if (--api_refs == 0)
+      barrier = NULL;
+
+   return release();
 }
 
 cl_command_queue_properties
@@ -67,10 +97,41 @@ command_queue::profiling_enabled() const {
    return props & CL_QUEUE_PROFILING_ENABLE;
 }
 
+bool
+command_queue::out_of_order() const {
+   return props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+}
+
 void
 command_queue::sequence(hard_event &ev) {
-   if (!queued_events.empty())
-      queued_events.back()().chain(ev);
+   if (!out_of_order()) {
+      if (!queued_events.empty())
+         queued_events.back()().chain(ev);
+
+   } else {
+      // Commands are executed as soon as the events in their wait
+      // list are, which is all the ordering an out-of-order queue
+      // guarantees -- except for markers and barriers without a wait
+      // list, which wait for all the commands enqueued before them,
+      // and barriers, which the commands after them wait for.
+      const bool sync = (ev.command() == CL_COMMAND_MARKER ||
+                         ev.command() == CL_COMMAND_BARRIER);
+
+      if (sync && ev.deps.empty()) {
+         for (auto &qev : queued_events) {
+            if (!qev().signalled())
+               qev().chain(ev);
+         }
+      }
+
+      if (barrier && !barrier->signalled())
+         barrier->chain(ev);
+      else
+         barrier = NULL;
+
+      if (ev.command() == CL_COMMAND_BARRIER)
+         barrier = &ev;
+   }
 
    queued_events.push_back(ev);
 }
@@ -23,6 +23,7 @@
 #ifndef CLOVER_CORE_QUEUE_HPP
 #define CLOVER_CORE_QUEUE_HPP
 
+#include <atomic>
 #include <deque>
 
 #include "core/object.hpp"
@@ -47,8 +48,17 @@ namespace clover {
 
       void flush();
 
+      /// Count a reference held by the application, on top of the
+      /// ones held by the queue's own events.
+      void retain_api();
+
+      /// Drop a reference held by the application.  Returns true if
+      /// the queue has to be destroyed.
+      bool release_api();
+
       cl_command_queue_properties properties() const;
       bool profiling_enabled() const;
+      bool out_of_order() const;
 
       const intrusive_ref<clover::context> context;
       const intrusive_ref<clover::device> device;
@@ -69,7 +79,12 @@ namespace clover {
 
       cl_command_queue_properties props;
       pipe_context *pipe;
+      std::atomic<unsigned> api_refs;
       std::deque<intrusive_ref<hard_event>> queued_events;
+
+      /// Last barrier of an out-of-order queue, all the commands
+      /// enqueued after it depend on it.
+      intrusive_ptr<hard_event> barrier;
    };
 }
 
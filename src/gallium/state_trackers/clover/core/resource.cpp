@@ -118,16 +118,24 @@ root_resource::root_resource(clover::device &dev, memory_obj &obj,
                              command_queue &q, const std::string &data) :
    resource(dev, obj) {
    pipe_resource info {};
+   const void *init = (obj.flags() & CL_MEM_USE_HOST_PTR ? obj.host_ptr() :
+                       !data.empty() ? data.data() : NULL);
+   unsigned stride, layer_stride;
 
    if (image *img = dynamic_cast<image *>(&obj)) {
       info.format = translate_format(img->format());
       info.width0 = img->width();
       info.height0 = img->height();
       info.depth0 = img->depth();
+      stride = (img->row_pitch() ? img->row_pitch() :
+                img->width() * img->pixel_size());
+      layer_stride = (img->slice_pitch() ? img->slice_pitch() :
+                      stride * img->height());
    } else {
       info.width0 = obj.size();
       info.height0 = 1;
       info.depth0 = 1;
+      stride = layer_stride = obj.size();
    }
 
    info.target = translate_target(obj.type());
@@ -137,17 +145,25 @@ root_resource::root_resource(clover::device &dev, memory_obj &obj,
                 PIPE_BIND_TRANSFER_READ |
                 PIPE_BIND_TRANSFER_WRITE);
 
+   // Drivers which can use the application's memory directly don't need
+   // the upload below, and mapping the object returns host_ptr itself.
+   if ((obj.flags() & CL_MEM_USE_HOST_PTR) &&
+       dev.pipe->resource_from_user_memory) {
+      pipe = dev.pipe->resource_from_user_memory(dev.pipe, &info,
+                                                 obj.host_ptr(), stride);
+      if (pipe)
+         return;
+   }
+
    pipe = dev.pipe->resource_create(dev.pipe, &info);
    if (!pipe)
       throw error(CL_OUT_OF_RESOURCES);
 
-   if (!data.empty()) {
+   if (init) {
       box rect { {{ 0, 0, 0 }}, {{ info.width0, info.height0, info.depth0 }} };
-      unsigned cpp = util_format_get_blocksize(info.format);
 
       q.pipe->transfer_inline_write(q.pipe, pipe, 0, PIPE_TRANSFER_WRITE,
-                                    rect, data.data(), cpp * info.width0,
-                                    cpp * info.width0 * info.height0);
+                                    rect, init, stride, layer_stride);
    }
 }
 
@@ -66,11 +66,11 @@ namespace clover {
       resource(clover::device &dev, memory_obj &obj);
 
       pipe_sampler_view *bind_sampler_view(command_queue &q);
-      void unbind_sampler_view(command_queue &q,
-                               pipe_sampler_view *st);
+      static void unbind_sampler_view(command_queue &q,
+                                      pipe_sampler_view *st);
 
       pipe_surface *bind_surface(command_queue &q, bool rw);
-      void unbind_surface(command_queue &q, pipe_surface *st);
+      static void unbind_surface(command_queue &q, pipe_surface *st);
 
       pipe_resource *pipe;
       vector offset;
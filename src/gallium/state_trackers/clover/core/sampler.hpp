@@ -47,7 +47,7 @@ namespace clover {
 
    private:
       void *bind(command_queue &q);
-      void unbind(command_queue &q, void *st);
+      static void unbind(command_queue &q, void *st);
 
       bool _norm_mode;
       cl_addressing_mode _addr_mode;
@@ -71,10 +71,25 @@
 #include <fstream>
 #include <cstdio>
 #include <sstream>
+#include <sys/stat.h>
 
 using namespace clover;
 
 namespace {
+   std::string
+   libclc_library(const std::string &processor, const std::string &triple) {
+      return LIBCLC_LIBEXECDIR + processor + "-" + triple + ".bc";
+   }
+
+   void
+   split_target(const compat::string &target, std::string &processor,
+                std::string &triple) {
+      size_t processor_str_len = std::string(target.begin()).find_first_of("-");
+      processor = std::string(target.begin(), 0, processor_str_len);
+      triple = std::string(target.begin(), processor_str_len + 1,
+                           target.size() - processor_str_len - 1);
+   }
+
 #if 0
    void
    build_binary(const std::string &source, const std::string &target,
@@ -126,8 +141,7 @@ namespace {
       clang::EmitLLVMOnlyAction act(&llvm_ctx);
       std::string log;
       llvm::raw_string_ostream s_log(log);
-      std::string libclc_path = LIBCLC_LIBEXECDIR + processor + "-"
-                                                  + triple + ".bc";
+      std::string libclc_path = libclc_library(processor, triple);
 
       // Parse the compiler options:
       std::vector<std::string> opts_array;
@@ -398,12 +412,11 @@ clover::compile_program_llvm(const compat::string &source,
                              compat::string &r_log) {
 
    std::vector<llvm::Function *> kernels;
-   size_t processor_str_len = std::string(target.begin()).find_first_of("-");
-   std::string processor(target.begin(), 0, processor_str_len);
-   std::string triple(target.begin(), processor_str_len + 1,
-                      target.size() - processor_str_len - 1);
+   std::string processor, triple;
    clang::LangAS::Map address_spaces;
 
+   split_target(target, processor, triple);
+
    llvm::LLVMContext llvm_ctx;
 
    // The input file name must have the .cl extension in order for the
@@ -425,3 +438,24 @@ clover::compile_program_llvm(const compat::string &source,
          return build_module_llvm(mod, kernels, address_spaces);
    }
 }
+
+compat::string
+clover::compiler_version_llvm(const compat::string &target) {
+   std::string processor, triple;
+   std::ostringstream version;
+   struct stat st;
+
+   split_target(target, processor, triple);
+
+   // libclc doesn't have a version number we could check, use the size
+   // and modification time of the library instead.
+   const std::string libclc_path = libclc_library(processor, triple);
+
+   version << "llvm " << std::hex << HAVE_LLVM << std::dec
+           << " libclc " << libclc_path;
+
+   if (!stat(libclc_path.c_str(), &st))
+      version << " " << st.st_size << " " << st.st_mtime;
+
+   return version.str().c_str();
+}
@@ -439,17 +439,11 @@ dri_init_screen_helper(struct dri_screen *screen,
                        screen->sPriv->myNum,
                        driver_name);
 
-   /* Handle force_s3tc_enable. */
+   /* Handle force_s3tc_enable.  The DXTn codec is built in, so S3TC is
+    * always enabled unless a driver turned it off.
+    */
    if (!util_format_s3tc_enabled &&
        driQueryOptionb(&screen->optionCache, "force_s3tc_enable")) {
-      /* Ensure libtxc_dxtn has been loaded if available.
-       * Forcing S3TC on before calling this would prevent loading
-       * the library.
-       * This is just a precaution, the driver should have called it
-       * already.
-       */
-      util_format_s3tc_init();
-
       util_format_s3tc_enabled = TRUE;
    }
 
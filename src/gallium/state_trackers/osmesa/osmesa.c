@@ -31,16 +31,18 @@
  * Otherwise we use softpipe.  The GALLIUM_DRIVER environment variable
  * may be set to "softpipe" or "llvmpipe" to override.
  *
- * With softpipe we could render directly into the user's buffer by using a
- * display target resource.  However, softpipe doesn't suport "upside-down"
- * rendering which would be needed for the OSMESA_Y_UP=TRUE case.
+ * When the driver can wrap the user's buffer in a resource (see
+ * pipe_screen::resource_from_user_memory) we render directly into it.
+ * Gallium surfaces can't be "upside-down" though, which would be needed
+ * for the OSMESA_Y_UP=TRUE case (the default), so there we render into an
+ * ordinary texture and blit it upside down into the wrapped buffer in the
+ * flush_front() function which is called when the app calls glFlush/Finish.
+ * llvmpipe needs the buffer to be a multiple of 4 pixels in both directions
+ * and 16 byte aligned.
  *
- * With llvmpipe we could only render directly into the user's buffer when its
- * width and height is a multiple of the tile size (64 pixels).
- *
- * Because of these constraints we always render into ordinary resources then
- * copy the results to the user's buffer in the flush_front() function which
- * is called when the app calls glFlush/Finish.
+ * Otherwise we render into ordinary resources then copy the results to the
+ * user's buffer with the CPU in flush_front().  OSMesaFlushAsync() defers
+ * that copy until OSMesaWaitFlush() is called.
  *
  * In general, the OSMesa interface is pretty ugly and not a good match
  * for Gallium.  But we're interested in doing the best we can to preserve
@@ -61,6 +63,7 @@
 #include "util/u_box.h"
 #include "util/u_debug.h"
 #include "util/u_format.h"
+#include "util/u_inlines.h"
 #include "util/u_memory.h"
 
 #include "postprocess/filters.h"
@@ -86,6 +89,15 @@ struct osmesa_buffer
 
    void *map;
 
+   /** Does the color texture wrap the user's buffer (map)? */
+   boolean direct;
+
+   /**
+    * With OSMESA_Y_UP, a render target wrapping the user's buffer, which the
+    * color texture is blitted to upside down.
+    */
+   struct pipe_resource *flip_target;
+
    struct osmesa_buffer *next;  /**< next in linked list */
 };
 
@@ -109,6 +121,13 @@ struct osmesa_context
    /** Which postprocessing filters are enabled. */
    unsigned pp_enabled[PP_FILTERS];
    struct pp_queue_t *pp;
+
+   /** State of OSMesaFlushAsync() */
+   boolean async_flush;                  /*< inside OSMesaFlushAsync() */
+   struct pipe_fence_handle *flush_fence;
+   struct osmesa_buffer *pending_copy;   /*< buffer still to be copied */
+   GLint pending_row_length;             /*< user_row_length at the flush */
+   GLboolean pending_y_up;               /*< y_up at the flush */
 };
 
 
@@ -298,9 +317,82 @@ stfbi_to_osbuffer(struct st_framebuffer_iface *stfbi)
 }
 
 
+/**
+ * Copy the contents of the driver's color buffer into the user-specified
+ * buffer, with the given row length and flipping it if y_up is set.
+ */
+static void
+osmesa_copy_to_user(OSMesaContext osmesa, struct osmesa_buffer *osbuffer,
+                    GLint row_length, GLboolean y_up)
+{
+   struct pipe_context *pipe = osmesa->stctx->pipe;
+   struct pipe_resource *res = osbuffer->textures[ST_ATTACHMENT_FRONT_LEFT];
+   struct pipe_transfer *transfer = NULL;
+   struct pipe_box box;
+   void *map;
+   ubyte *src, *dst;
+   unsigned y, bytes, bpp;
+   int dst_stride;
+
+   u_box_2d(0, 0, res->width0, res->height0, &box);
+
+   map = pipe->transfer_map(pipe, res, 0, PIPE_TRANSFER_READ, &box,
+                            &transfer);
+   if (!map)
+      return;
+
+   bpp = util_format_get_blocksize(osbuffer->visual.color_format);
+   src = map;
+   dst = osbuffer->map;
+   if (row_length)
+      dst_stride = bpp * row_length;
+   else
+      dst_stride = bpp * osbuffer->width;
+   bytes = bpp * res->width0;
+
+   if (y_up) {
+      /* need to flip image upside down */
+      dst = dst + (res->height0 - 1) * dst_stride;
+      dst_stride = -dst_stride;
+   }
+
+   for (y = 0; y < res->height0; y++) {
+      memcpy(dst, src, bytes);
+      dst += dst_stride;
+      src += transfer->stride;
+   }
+
+   pipe->transfer_unmap(pipe, transfer);
+}
+
+
+/**
+ * Wait for the rendering started by OSMesaFlushAsync() and do the copy
+ * it deferred, if any.
+ */
+static void
+osmesa_wait_flush(OSMesaContext osmesa)
+{
+   if (osmesa->flush_fence) {
+      struct pipe_screen *screen = get_st_manager()->screen;
+
+      screen->fence_finish(screen, osmesa->flush_fence,
+                           PIPE_TIMEOUT_INFINITE);
+      screen->fence_reference(screen, &osmesa->flush_fence, NULL);
+   }
+
+   if (osmesa->pending_copy) {
+      osmesa_copy_to_user(osmesa, osmesa->pending_copy,
+                          osmesa->pending_row_length, osmesa->pending_y_up);
+      osmesa->pending_copy = NULL;
+   }
+}
+
+
 /**
  * Called via glFlush/glFinish.  This is where we copy the contents
- * of the driver's color buffer into the user-specified buffer.
+ * of the driver's color buffer into the user-specified buffer, unless
+ * we render directly into it.
  */
 static boolean
 osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
@@ -311,12 +403,6 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
    struct osmesa_buffer *osbuffer = stfbi_to_osbuffer(stfbi);
    struct pipe_context *pipe = stctx->pipe;
    struct pipe_resource *res = osbuffer->textures[statt];
-   struct pipe_transfer *transfer = NULL;
-   struct pipe_box box;
-   void *map;
-   ubyte *src, *dst;
-   unsigned y, bytes, bpp;
-   int dst_stride;
 
    if (osmesa->pp) {
       struct pipe_resource *zsbuf = NULL;
@@ -340,41 +426,83 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
       pp_run(osmesa->pp, res, res, zsbuf);
    }
 
-   u_box_2d(0, 0, res->width0, res->height0, &box);
+   if (osbuffer->flip_target) {
+      struct pipe_blit_info blit;
+
+      memset(&blit, 0, sizeof(blit));
+      blit.src.resource = res;
+      blit.src.format = res->format;
+      /* read the rows bottom-up */
+      u_box_2d(0, 0, res->width0, res->height0, &blit.src.box);
+      blit.src.box.y = res->height0;
+      blit.src.box.height = -(int) res->height0;
+      blit.dst.resource = osbuffer->flip_target;
+      blit.dst.format = osbuffer->flip_target->format;
+      u_box_2d(0, 0, res->width0, res->height0, &blit.dst.box);
+      blit.mask = PIPE_MASK_RGBA;
+      blit.filter = PIPE_TEX_FILTER_NEAREST;
+
+      pipe->blit(pipe, &blit);
+   }
 
-   map = pipe->transfer_map(pipe, res, 0, PIPE_TRANSFER_READ, &box,
-                            &transfer);
+   if (osmesa->async_flush) {
+      /* OSMesaFlushAsync() fences the rendering, OSMesaWaitFlush() waits
+       * for it and does the copy, laid out as the user asked for now.
+       */
+      osmesa->pending_copy = osbuffer->direct || osbuffer->flip_target ?
+                             NULL : osbuffer;
+      osmesa->pending_row_length = osmesa->user_row_length;
+      osmesa->pending_y_up = osmesa->y_up;
+      return TRUE;
+   }
 
-   /*
-    * Copy the color buffer from the resource to the user's buffer.
-    */
-   bpp = util_format_get_blocksize(osbuffer->visual.color_format);
-   src = map;
-   dst = osbuffer->map;
-   if (osmesa->user_row_length)
-      dst_stride = bpp * osmesa->user_row_length;
-   else
-      dst_stride = bpp * osbuffer->width;
-   bytes = bpp * res->width0;
+   osmesa->pending_copy = NULL;
 
-   if (osmesa->y_up) {
-      /* need to flip image upside down */
-      dst = dst + (res->height0 - 1) * dst_stride;
-      dst_stride = -dst_stride;
-   }
+   if (osbuffer->direct || osbuffer->flip_target) {
+      /* The rendering lands in the user's buffer, just wait for it. */
+      struct pipe_screen *screen = get_st_manager()->screen;
+      struct pipe_fence_handle *fence = NULL;
 
-   for (y = 0; y < res->height0; y++) {
-      memcpy(dst, src, bytes);
-      dst += dst_stride;
-      src += transfer->stride;
+      pipe->flush(pipe, &fence, 0);
+      if (fence) {
+         screen->fence_finish(screen, fence, PIPE_TIMEOUT_INFINITE);
+         screen->fence_reference(screen, &fence, NULL);
+      }
+   }
+   else {
+      osmesa_copy_to_user(osmesa, osbuffer, osmesa->user_row_length,
+                          osmesa->y_up);
    }
-
-   pipe->transfer_unmap(pipe, transfer);
 
    return TRUE;
 }
 
 
+/**
+ * Try to create a color texture which uses the user's buffer as storage.
+ */
+static struct pipe_resource *
+osmesa_create_direct_texture(OSMesaContext osmesa,
+                             struct osmesa_buffer *osbuffer,
+                             const struct pipe_resource *templat)
+{
+   struct pipe_screen *screen = get_st_manager()->screen;
+   unsigned bpp = util_format_get_blocksize(templat->format);
+   unsigned stride;
+
+   if (!screen->resource_from_user_memory)
+      return NULL;
+
+   if (osmesa->user_row_length)
+      stride = bpp * osmesa->user_row_length;
+   else
+      stride = bpp * osbuffer->width;
+
+   return screen->resource_from_user_memory(screen, templat,
+                                            osbuffer->map, stride);
+}
+
+
 /**
  * Called by the st manager to validate the framebuffer (allocate
  * its resources).
@@ -387,6 +515,7 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
                                struct pipe_resource **out)
 {
    struct pipe_screen *screen = get_st_manager()->screen;
+   OSMesaContext osmesa = (OSMesaContext) stctx->st_manager_private;
    enum st_attachment_type i;
    struct osmesa_buffer *osbuffer = stfbi_to_osbuffer(stfbi);
    struct pipe_resource templat;
@@ -404,6 +533,7 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
    templat.flags = 0;
 
    for (i = 0; i < count; i++) {
+      struct pipe_resource **tex = &osbuffer->textures[statts[i]];
       enum pipe_format format = PIPE_FORMAT_NONE;
       unsigned bind = 0;
 
@@ -431,8 +561,42 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
 
       templat.format = format;
       templat.bind = bind;
-      out[i] = osbuffer->textures[i] =
-         screen->resource_create(screen, &templat);
+
+      if (statts[i] == ST_ATTACHMENT_FRONT_LEFT) {
+         /* The user's buffer may have changed since we were last called.
+          * Render directly into it if we can, else into a private texture
+          * which is blitted or copied in flush_front().
+          */
+         struct pipe_resource *direct =
+            osmesa_create_direct_texture(osmesa, osbuffer, &templat);
+
+         pipe_resource_reference(&osbuffer->flip_target, NULL);
+
+         if (direct && osmesa->y_up) {
+            osbuffer->flip_target = direct;
+            direct = NULL;
+            /* the blit samples the private texture */
+            templat.bind |= PIPE_BIND_SAMPLER_VIEW;
+         }
+
+         if (direct || osbuffer->direct ||
+             (*tex && (*tex)->bind != templat.bind)) {
+            pipe_resource_reference(tex, NULL);
+         }
+         if (direct) {
+            *tex = direct;
+         }
+         osbuffer->direct = direct != NULL;
+      }
+
+      /* The other buffers are kept when we get revalidated because the
+       * user's buffer changed.
+       */
+      if (!*tex)
+         *tex = screen->resource_create(screen, &templat);
+
+      out[i] = NULL;
+      pipe_resource_reference(&out[i], *tex);
    }
 
    return TRUE;
@@ -507,6 +671,13 @@ osmesa_find_buffer(enum pipe_format color_format,
 static void
 osmesa_destroy_buffer(struct osmesa_buffer *osbuffer)
 {
+   unsigned i;
+
+   for (i = 0; i < Elements(osbuffer->textures); i++)
+      pipe_resource_reference(&osbuffer->textures[i], NULL);
+
+   pipe_resource_reference(&osbuffer->flip_target, NULL);
+
    FREE(osbuffer->stfb);
    FREE(osbuffer);
 }
@@ -622,6 +793,10 @@ GLAPI void GLAPIENTRY
 OSMesaDestroyContext(OSMesaContext osmesa)
 {
    if (osmesa) {
+      if (osmesa->flush_fence) {
+         struct pipe_screen *screen = get_st_manager()->screen;
+         screen->fence_reference(screen, &osmesa->flush_fence, NULL);
+      }
       pp_free(osmesa->pp);
       osmesa->stctx->destroy(osmesa->stctx);
       FREE(osmesa);
@@ -656,6 +831,7 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
                   GLsizei width, GLsizei height)
 {
    struct st_api *stapi = get_st_api();
+   OSMesaContext current = OSMesaGetCurrentContext();
    struct osmesa_buffer *osbuffer;
    enum pipe_format color_format;
 
@@ -673,6 +849,13 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
       return GL_FALSE;
    }
 
+   /* finish an OSMesaFlushAsync() into the previous buffer, which
+    * OSMesaWaitFlush() can't do once the context isn't current
+    */
+   if (current && current != osmesa)
+      osmesa_wait_flush(current);
+   osmesa_wait_flush(osmesa);
+
    /* See if we already have a buffer that uses these pixel formats */
    osbuffer = osmesa_find_buffer(color_format,
                                  osmesa->depth_stencil_format,
@@ -684,6 +867,11 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
                                       osmesa->accum_format);
    }
 
+   if (osbuffer->map != buffer) {
+      /* the color texture may have to wrap the new buffer */
+      p_atomic_inc(&osbuffer->stfb->stamp);
+   }
+
    osbuffer->width = width;
    osbuffer->height = height;
    osbuffer->map = buffer;
@@ -750,6 +938,10 @@ OSMesaPixelStore(GLint pname, GLint value)
       fprintf(stderr, "Invalid pname in OSMesaPixelStore()\n");
       return;
    }
+
+   /* whether and how we can render into the user's buffer may change */
+   if (osmesa->current_buffer)
+      p_atomic_inc(&osmesa->current_buffer->stfb->stamp);
 }
 
 
@@ -892,6 +1084,8 @@ static struct name_function functions[] = {
    { "OSMesaGetProcAddress", (OSMESAproc) OSMesaGetProcAddress },
    { "OSMesaColorClamp", (OSMESAproc) OSMesaColorClamp },
    { "OSMesaPostprocess", (OSMESAproc) OSMesaPostprocess },
+   { "OSMesaFlushAsync", (OSMESAproc) OSMesaFlushAsync },
+   { "OSMesaWaitFlush", (OSMESAproc) OSMesaWaitFlush },
    { NULL, NULL }
 };
 
@@ -940,3 +1134,36 @@ OSMesaPostprocess(OSMesaContext osmesa, const char *filter,
       debug_warning("Calling OSMesaPostprocess() after OSMesaMakeCurrent()\n");
    }
 }
+
+
+GLAPI void GLAPIENTRY
+OSMesaFlushAsync(void)
+{
+   OSMesaContext osmesa = OSMesaGetCurrentContext();
+   struct pipe_context *pipe;
+
+   if (!osmesa)
+      return;
+
+   pipe = osmesa->stctx->pipe;
+
+   /* only one flush can be outstanding */
+   osmesa_wait_flush(osmesa);
+
+   osmesa->async_flush = TRUE;
+   osmesa->stctx->flush(osmesa->stctx, ST_FLUSH_FRONT, NULL);
+   osmesa->async_flush = FALSE;
+
+   /* fence the postprocessing too */
+   pipe->flush(pipe, &osmesa->flush_fence, 0);
+}
+
+
+GLAPI void GLAPIENTRY
+OSMesaWaitFlush(void)
+{
+   OSMesaContext osmesa = OSMesaGetCurrentContext();
+
+   if (osmesa)
+      osmesa_wait_flush(osmesa);
+}
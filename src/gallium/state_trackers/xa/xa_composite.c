@@ -465,11 +465,49 @@ bind_samplers(struct xa_context *ctx,
 				   ctx->bound_sampler_views);
 }
 
+static void
+composite_key_picture(struct xa_composite_key_picture *key,
+		      const struct xa_picture *pic)
+{
+    key->tex = pic->srf ? pic->srf->tex : NULL;
+    key->pict_format = pic->pict_format;
+    key->has_transform = pic->has_transform;
+    key->component_alpha = pic->component_alpha;
+    key->wrap = pic->wrap;
+    key->filter = pic->filter;
+    if (pic->src_pict && pic->src_pict->type == xa_src_pict_solid_fill) {
+	key->solid_fill = TRUE;
+	key->solid_color = pic->src_pict->solid_fill.color;
+    }
+}
+
+/*
+ * Everything bind_composite_blend_state, bind_shaders and bind_samplers
+ * look at. The transforms only matter for the vertices.
+ */
+static void
+composite_key(struct xa_composite_key *key, const struct xa_context *ctx,
+	      const struct xa_composite *comp)
+{
+    memset(key, 0, sizeof(*key));
+
+    key->op = comp->op;
+    key->has_src = comp->src != NULL;
+    key->has_mask = comp->mask != NULL;
+    if (comp->src)
+	composite_key_picture(&key->src, comp->src);
+    if (comp->mask)
+	composite_key_picture(&key->mask, comp->mask);
+    key->dst_format = ctx->srf->format;
+    key->dst_pict_format = comp->dst->pict_format;
+}
+
 XA_EXPORT int
 xa_composite_prepare(struct xa_context *ctx,
 		     const struct xa_composite *comp)
 {
     struct xa_surface *dst_srf = comp->dst->srf;
+    struct xa_composite_key key;
     int ret;
 
     if (comp->mask && !comp->mask->srf)
@@ -482,13 +520,32 @@ xa_composite_prepare(struct xa_context *ctx,
     ctx->dst = dst_srf;
     renderer_bind_destination(ctx, ctx->srf);
 
-    ret = bind_composite_blend_state(ctx, comp);
-    if (ret != XA_ERR_NONE)
-	return ret;
-    ret = bind_shaders(ctx, comp);
-    if (ret != XA_ERR_NONE)
-	return ret;
-    bind_samplers(ctx, comp);
+    /*
+     * The X server tends to issue long runs of composites with the same
+     * operator and pictures, only bind the state if anything changed.
+     * The sampler views of the last composite are kept around for this.
+     */
+    composite_key(&key, ctx, comp);
+    if (ctx->composite_key_valid &&
+	memcmp(&key, &ctx->composite_key, sizeof(key)) == 0) {
+	ctx->has_solid_color = key.src.solid_fill;
+	if (key.src.solid_fill)
+	    xa_pixel_to_float4(key.src.solid_color, ctx->solid_color);
+    } else {
+	ctx->composite_key_valid = FALSE;
+	xa_ctx_sampler_views_destroy(ctx);
+
+	ret = bind_composite_blend_state(ctx, comp);
+	if (ret != XA_ERR_NONE)
+	    return ret;
+	ret = bind_shaders(ctx, comp);
+	if (ret != XA_ERR_NONE)
+	    return ret;
+	bind_samplers(ctx, comp);
+
+	ctx->composite_key = key;
+	ctx->composite_key_valid = TRUE;
+    }
 
     if (ctx->num_bound_samplers == 0 ) { /* solid fill */
 	renderer_begin_solid(ctx);
@@ -534,7 +591,6 @@ xa_composite_done(struct xa_context *ctx)
 
     ctx->comp = NULL;
     ctx->has_solid_color = FALSE;
-    xa_ctx_sampler_views_destroy(ctx);
 }
 
 static const struct xa_composite_allocation a = {
@@ -32,6 +32,7 @@
 #include "util/u_inlines.h"
 #include "util/u_rect.h"
 #include "util/u_surface.h"
+#include "util/u_upload_mgr.h"
 #include "pipe/p_context.h"
 
 XA_EXPORT void
@@ -55,6 +56,8 @@ xa_context_create(struct xa_tracker *xa)
     ctx->pipe = xa->screen->context_create(xa->screen, NULL);
     ctx->cso = cso_create_context(ctx->pipe);
     ctx->shaders = xa_shaders_create(ctx);
+    ctx->upload = u_upload_create(ctx->pipe, XA_UPLOAD_SIZE, 4,
+				  PIPE_BIND_VERTEX_BUFFER);
     renderer_init_state(ctx);
 
     return ctx;
@@ -81,6 +84,11 @@ xa_context_destroy(struct xa_context *r)
     if (r->srf)
         pipe_surface_reference(&r->srf, NULL);
 
+    if (r->upload) {
+	u_upload_destroy(r->upload);
+	r->upload = NULL;
+    }
+
     if (r->cso) {
 	cso_release_all(r->cso);
 	cso_destroy_context(r->cso);
@@ -321,6 +329,8 @@ xa_solid_prepare(struct xa_context *ctx, struct xa_surface *dst,
     fs_traits = FS_SOLID_FILL;
 
     renderer_bind_destination(ctx, ctx->srf);
+    ctx->composite_key_valid = FALSE;
+    xa_ctx_sampler_views_destroy(ctx);
     bind_solid_blend_state(ctx);
     cso_set_samplers(ctx->cso, PIPE_SHADER_FRAGMENT, 0, NULL);
     cso_set_sampler_views(ctx->cso, PIPE_SHADER_FRAGMENT, 0, NULL);
@@ -409,7 +419,9 @@ xa_ctx_sampler_views_destroy(struct xa_context *ctx)
 {
     int i;
 
-    for (i = 0; i < ctx->num_bound_samplers; ++i)
+    /* Release all slots, a copy or solid fill may have lowered
+     * num_bound_samplers below the views of the last composite. */
+    for (i = 0; i < XA_MAX_SAMPLERS; ++i)
 	pipe_sampler_view_reference(&ctx->bound_sampler_views[i], NULL);
     ctx->num_bound_samplers = 0;
 }
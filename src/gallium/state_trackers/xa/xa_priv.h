@@ -46,7 +46,8 @@
 #define XA_EXPORT
 #endif
 
-#define XA_VB_SIZE (100 * 4 * 3 * 4)
+#define XA_VB_SIZE (1024 * 4 * 3 * 4)
+#define XA_UPLOAD_SIZE (1024 * 1024)
 #define XA_LAST_SURFACE_TYPE (xa_type_yuv_component + 1)
 #define XA_MAX_SAMPLERS 3
 
@@ -71,6 +72,29 @@ struct xa_surface {
     struct pipe_context *mapping_pipe;
 };
 
+/*
+ * The state a composite operation binds, xa_composite_prepare skips
+ * binding it if it's the same as for the previous composite.
+ */
+struct xa_composite_key_picture {
+    struct pipe_resource *tex;
+    enum xa_formats pict_format;
+    int has_transform;
+    int component_alpha;
+    int wrap;
+    int filter;
+    int solid_fill;
+    uint32_t solid_color;
+};
+
+struct xa_composite_key {
+    int op;
+    int has_src, has_mask;
+    struct xa_composite_key_picture src, mask;
+    enum pipe_format dst_format;
+    enum xa_formats dst_pict_format;
+};
+
 struct xa_tracker {
     enum xa_formats *supported_formats;
     unsigned int format_map[XA_LAST_SURFACE_TYPE][2];
@@ -94,6 +118,7 @@ struct xa_context {
     float buffer[XA_VB_SIZE];
     unsigned int buffer_size;
     struct pipe_vertex_element velems[3];
+    struct u_upload_mgr *upload;
 
     /* number of attributes per vertex for the current
      * draw operation */
@@ -121,6 +146,10 @@ struct xa_context {
     unsigned int num_bound_samplers;
     struct pipe_sampler_view *bound_sampler_views[XA_MAX_SAMPLERS];
     const struct xa_composite *comp;
+
+    /* state bound by the last xa_composite_prepare, if it's still bound */
+    struct xa_composite_key composite_key;
+    int composite_key_valid;
 };
 
 static INLINE void
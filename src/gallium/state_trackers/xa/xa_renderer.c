@@ -33,6 +33,7 @@
 #include "util/u_inlines.h"
 #include "util/u_sampler.h"
 #include "util/u_draw_quad.h"
+#include "util/u_upload_mgr.h"
 
 #define floatsEqual(x, y) (fabs(x - y) <= 0.00001f * MIN2(fabs(x), fabs(y)))
 #define floatIsZero(x) (floatsEqual((x) + 1, 1))
@@ -71,6 +72,32 @@ map_point(float *mat, float x, float y, float *out_x, float *out_y)
     }
 }
 
+/*
+ * Stream the vertices in r->buffer to the upload buffer and draw them.
+ * Consecutive batches are appended to the same upload buffer until it's
+ * full.  It stays mapped if the driver supports persistent mappings,
+ * otherwise each batch maps it unsynchronized and unmaps it before the
+ * draw.
+ */
+static void
+renderer_draw_vertices(struct xa_context *r, int num_verts, int num_attribs)
+{
+    struct pipe_vertex_buffer vbuffer;
+
+    memset(&vbuffer, 0, sizeof(vbuffer));
+    vbuffer.stride = num_attribs * NUM_COMPONENTS * sizeof(float);
+
+    if (u_upload_data(r->upload, 0, num_verts * vbuffer.stride, r->buffer,
+		      &vbuffer.buffer_offset, &vbuffer.buffer) != PIPE_OK)
+	return;
+    u_upload_unmap(r->upload);
+
+    cso_set_vertex_buffers(r->cso, 0, 1, &vbuffer);
+    cso_draw_arrays(r->cso, PIPE_PRIM_QUADS, 0, num_verts);
+
+    pipe_resource_reference(&vbuffer.buffer, NULL);
+}
+
 static INLINE void
 renderer_draw(struct xa_context *r)
 {
@@ -89,9 +116,7 @@ renderer_draw(struct xa_context *r)
     r->pipe->set_scissor_states(r->pipe, 0, 1, &r->scissor);
 
     cso_set_vertex_elements(r->cso, r->attrs_per_vertex, r->velems);
-    util_draw_user_vertex_buffer(r->cso, r->buffer, PIPE_PRIM_QUADS,
-                                 num_verts,	/* verts */
-                                 r->attrs_per_vertex);	/* attribs/vert */
+    renderer_draw_vertices(r, num_verts, r->attrs_per_vertex);
     r->buffer_size = 0;
 
     xa_scissor_reset(r);
@@ -423,6 +448,8 @@ renderer_copy_prepare(struct xa_context *r,
     (void)screen;
 
     renderer_bind_destination(r, dst_surface);
+    r->composite_key_valid = FALSE;
+    xa_ctx_sampler_views_destroy(r);
 
     /* set misc state we care about */
     {
@@ -531,9 +558,7 @@ renderer_draw_yuv(struct xa_context *r,
                          dst_x, dst_y, dst_w, dst_h, srf);
 
    cso_set_vertex_elements(r->cso, num_attribs, r->velems);
-   util_draw_user_vertex_buffer(r->cso, r->buffer, PIPE_PRIM_QUADS,
-                                4,	/* verts */
-                                num_attribs);	/* attribs/vert */
+   renderer_draw_vertices(r, 4, num_attribs);
    r->buffer_size = 0;
 }
 
@@ -132,6 +132,8 @@ xa_yuv_planar_blit(struct xa_context *r,
 	return -XA_ERR_NORES;
 
     renderer_bind_destination(r, r->srf);
+    r->composite_key_valid = FALSE;
+    xa_ctx_sampler_views_destroy(r);
     xa_yuv_bind_blend_state(r);
     xa_yuv_bind_shaders(r);
     xa_yuv_bind_samplers(r, yuv);
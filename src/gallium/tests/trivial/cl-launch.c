@@ -0,0 +1,209 @@
+/*
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE COPYRIGHT OWNER(S) AND/OR ITS SUPPLIERS BE
+ * LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+ * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+ * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ */
+
+/*
+ * Launch the same OpenCL kernel over and over through clover: checks
+ * that the kernel arguments kept bound from one launch to the next are
+ * still right, then measures the launch rate.
+ *
+ * Usage: cl-launch [number of launches to time]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <CL/cl.h>
+
+#define N 64
+
+#define CHECK(x) do {                                                   \
+                cl_int __err = (x);                                     \
+                if (__err != CL_SUCCESS) {                              \
+                        fprintf(stderr, "%s:%d: %s failed: %d\n",       \
+                                __FILE__, __LINE__, #x, __err);         \
+                        exit(1);                                        \
+                }                                                       \
+        } while (0)
+
+struct context {
+        cl_device_id dev;
+        cl_context ctx;
+        cl_command_queue q;
+        cl_program prog;
+        cl_kernel kern;
+        cl_mem buf;
+        cl_mem sub;
+};
+
+static const char *src =
+        "__kernel void add(__global uint *buf, uint x)\n"
+        "{\n"
+        "        buf[get_global_id(0)] += x;\n"
+        "}\n";
+
+static void init_ctx(struct context *ctx)
+{
+        cl_platform_id platform;
+        cl_uint align;
+        cl_buffer_region region;
+        cl_uint zero[N] = { 0 };
+        cl_int err;
+
+        CHECK(clGetPlatformIDs(1, &platform, NULL));
+        CHECK(clGetDeviceIDs(platform, CL_DEVICE_TYPE_ALL, 1, &ctx->dev,
+                             NULL));
+
+        ctx->ctx = clCreateContext(NULL, 1, &ctx->dev, NULL, NULL, &err);
+        CHECK(err);
+        ctx->q = clCreateCommandQueue(ctx->ctx, ctx->dev, 0, &err);
+        CHECK(err);
+
+        ctx->prog = clCreateProgramWithSource(ctx->ctx, 1, &src, NULL, &err);
+        CHECK(err);
+        CHECK(clBuildProgram(ctx->prog, 1, &ctx->dev, "", NULL, NULL));
+        ctx->kern = clCreateKernel(ctx->prog, "add", &err);
+        CHECK(err);
+
+        /* Use a sub-buffer, so the global argument has a non-zero offset
+         * into its resource. */
+        CHECK(clGetDeviceInfo(ctx->dev, CL_DEVICE_MEM_BASE_ADDR_ALIGN,
+                              sizeof(align), &align, NULL));
+        region.origin = align / 8;
+        region.size = N * sizeof(cl_uint);
+
+        ctx->buf = clCreateBuffer(ctx->ctx, CL_MEM_READ_WRITE,
+                                  region.origin + region.size, NULL, &err);
+        CHECK(err);
+        ctx->sub = clCreateSubBuffer(ctx->buf, CL_MEM_READ_WRITE,
+                                     CL_BUFFER_CREATE_TYPE_REGION, &region,
+                                     &err);
+        CHECK(err);
+        CHECK(clEnqueueWriteBuffer(ctx->q, ctx->sub, CL_TRUE, 0,
+                                   N * sizeof(cl_uint), zero, 0, NULL,
+                                   NULL));
+}
+
+static void destroy_ctx(struct context *ctx)
+{
+        clReleaseMemObject(ctx->sub);
+        clReleaseMemObject(ctx->buf);
+        clReleaseKernel(ctx->kern);
+        clReleaseProgram(ctx->prog);
+        clReleaseCommandQueue(ctx->q);
+        clReleaseContext(ctx->ctx);
+}
+
+static void launch(struct context *ctx, size_t size)
+{
+        CHECK(clEnqueueNDRangeKernel(ctx->q, ctx->kern, 1, NULL, &size,
+                                     NULL, 0, NULL, NULL));
+}
+
+static int check(struct context *ctx, cl_uint expect)
+{
+        cl_uint data[N];
+        int i;
+
+        CHECK(clEnqueueReadBuffer(ctx->q, ctx->sub, CL_TRUE, 0,
+                                  sizeof(data), data, 0, NULL, NULL));
+
+        for (i = 0; i < N; ++i) {
+                if (data[i] != expect) {
+                        printf("  FAIL: buf[%d] = %u, expected %u\n",
+                               i, data[i], expect);
+                        return 1;
+                }
+        }
+
+        return 0;
+}
+
+static int test_relaunch(struct context *ctx)
+{
+        cl_uint x = 1;
+        int fail = 0;
+
+        printf("- %s\n", __func__);
+
+        CHECK(clSetKernelArg(ctx->kern, 0, sizeof(cl_mem), &ctx->sub));
+        CHECK(clSetKernelArg(ctx->kern, 1, sizeof(x), &x));
+
+        /* The second launch reuses the arguments bound by the first. */
+        launch(ctx, N);
+        launch(ctx, N);
+        fail |= check(ctx, 2);
+
+        /* Only the scalar argument changes. */
+        x = 5;
+        CHECK(clSetKernelArg(ctx->kern, 1, sizeof(x), &x));
+        launch(ctx, N);
+        fail |= check(ctx, 7);
+
+        /* The global argument is set again to the same buffer. */
+        CHECK(clSetKernelArg(ctx->kern, 0, sizeof(cl_mem), &ctx->sub));
+        launch(ctx, N);
+        launch(ctx, N);
+        fail |= check(ctx, 17);
+
+        return fail;
+}
+
+static void bench_launch_rate(struct context *ctx, unsigned count)
+{
+        struct timespec start, end;
+        double secs;
+        unsigned i;
+
+        printf("- %s\n", __func__);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < count; ++i)
+                launch(ctx, 1);
+        CHECK(clFinish(ctx->q));
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        secs = (end.tv_sec - start.tv_sec) +
+                (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("  %u launches in %.3f s, %.0f launches/s\n",
+               count, secs, count / secs);
+}
+
+int main(int argc, char *argv[])
+{
+        struct context ctx;
+        unsigned count = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+        int fail;
+
+        init_ctx(&ctx);
+
+        fail = test_relaunch(&ctx);
+        if (count)
+                bench_launch_rate(&ctx, count);
+
+        destroy_ctx(&ctx);
+
+        return fail;
+}
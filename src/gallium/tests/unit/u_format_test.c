@@ -28,10 +28,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <float.h>
 
+#include "util/u_cpu_detect.h"
 #include "util/u_half.h"
 #include "util/u_format.h"
+#include "util/u_format_direct.h"
 #include "util/u_format_tests.h"
 #include "util/u_format_s3tc.h"
 
@@ -725,6 +728,237 @@ test_all(void)
 }
 
 
+/* Not a multiple of any SIMD width, so that the tails are tested too. */
+#define TRANSLATE_TEST_WIDTH 37
+
+
+/**
+ * Convert the way util_format_translate() does without the direct kernels,
+ * which must match it exactly.
+ */
+static void
+translate_reference(const struct util_format_description *dst_desc,
+                    uint8_t *dst, unsigned dst_stride,
+                    const struct util_format_description *src_desc,
+                    const uint8_t *src, unsigned src_stride,
+                    unsigned width, unsigned height)
+{
+   if (dst_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS) {
+      float z[TRANSLATE_TEST_WIDTH];
+      uint8_t s[TRANSLATE_TEST_WIDTH];
+
+      /* The z_float pack functions keep the X8 bits of the destination,
+       * which the direct kernels write as zero. */
+      memset(dst, 0, dst_stride * height);
+      src_desc->unpack_z_float(z, 0, src, src_stride, width, height);
+      dst_desc->pack_z_float(dst, dst_stride, z, 0, width, height);
+      if (src_desc->unpack_s_8uint && dst_desc->pack_s_8uint) {
+         src_desc->unpack_s_8uint(s, 0, src, src_stride, width, height);
+         dst_desc->pack_s_8uint(dst, dst_stride, s, 0, width, height);
+      }
+   } else if (util_format_fits_8unorm(dst_desc) &&
+              util_format_fits_8unorm(src_desc)) {
+      uint8_t tmp[TRANSLATE_TEST_WIDTH][4];
+
+      src_desc->unpack_rgba_8unorm(&tmp[0][0], 0, src, src_stride, width, height);
+      dst_desc->pack_rgba_8unorm(dst, dst_stride, &tmp[0][0], 0, width, height);
+   } else {
+      float tmp[TRANSLATE_TEST_WIDTH][4];
+
+      src_desc->unpack_rgba_float(&tmp[0][0], 0, src, src_stride, width, height);
+      dst_desc->pack_rgba_float(dst, dst_stride, &tmp[0][0], 0, width, height);
+   }
+}
+
+
+static boolean
+test_format_translate_direct(const struct util_format_description *dst_desc,
+                             const struct util_format_description *src_desc)
+{
+   const unsigned width = TRANSLATE_TEST_WIDTH;
+   const unsigned src_stride = width * src_desc->block.bits / 8;
+   const unsigned dst_stride = width * dst_desc->block.bits / 8;
+   uint8_t src[TRANSLATE_TEST_WIDTH * 16];
+   uint8_t dst[TRANSLATE_TEST_WIDTH * 16];
+   uint8_t ref[TRANSLATE_TEST_WIDTH * 16];
+   struct util_cpu_caps caps = util_cpu_caps;
+   boolean success = TRUE;
+   unsigned level, i;
+
+   printf("Testing util_format_translate_direct %s -> %s ...\n",
+          src_desc->short_name, dst_desc->short_name);
+   fflush(stdout);
+
+   for (i = 0; i < src_stride; ++i) {
+      src[i] = rand();
+   }
+
+   translate_reference(dst_desc, ref, dst_stride,
+                       src_desc, src, src_stride, width, 1);
+
+   /* Run the plain C, SSE2, SSSE3 and AVX2 kernels in turn. */
+   for (level = 0; level < 4; ++level) {
+      util_cpu_caps.has_sse2 = caps.has_sse2 && level >= 1;
+      util_cpu_caps.has_ssse3 = caps.has_ssse3 && level >= 2;
+      util_cpu_caps.has_avx2 = caps.has_avx2 && level >= 3;
+
+      memset(dst, 0xcd, sizeof dst);
+      util_format_translate_direct(dst_desc->format, dst, dst_stride,
+                                   src_desc->format, src, src_stride,
+                                   width, 1);
+
+      if (memcmp(dst, ref, dst_stride) != 0) {
+         printf("FAILED: level %u\n", level);
+         success = FALSE;
+      }
+   }
+
+   util_cpu_caps = caps;
+
+   return success;
+}
+
+
+static boolean
+test_all_translate_direct(void)
+{
+   enum pipe_format dst_format, src_format;
+   boolean success = TRUE;
+
+   util_cpu_detect();
+
+   for (dst_format = 1; dst_format < PIPE_FORMAT_COUNT; ++dst_format) {
+      for (src_format = 1; src_format < PIPE_FORMAT_COUNT; ++src_format) {
+         if (!util_format_has_direct_translate(dst_format, src_format)) {
+            continue;
+         }
+
+         if (!test_format_translate_direct(util_format_description(dst_format),
+                                           util_format_description(src_format))) {
+            success = FALSE;
+         }
+      }
+   }
+
+   return success;
+}
+
+
+/*
+ * Compress a smooth image with the built-in DXTn encoder and check how far
+ * the decoded texels are from the original ones.
+ */
+
+#define DXTN_TEST_SIZE 256
+
+
+static boolean
+test_format_dxtn_roundtrip(const struct util_format_description *format_desc,
+                           unsigned max_rgb_error, unsigned max_alpha_error)
+{
+   const unsigned width = DXTN_TEST_SIZE, height = DXTN_TEST_SIZE;
+   const unsigned src_stride = width * 4;
+   const unsigned dst_stride = (width / 4) * format_desc->block.bits / 8;
+   const boolean has_alpha = format_desc->swizzle[3] != UTIL_FORMAT_SWIZZLE_1;
+   uint8_t *src, *packed, *packed_rows, *unpacked;
+   unsigned x, y, c, max_error[4] = { 0, 0, 0, 0 };
+   boolean success = TRUE;
+
+   printf("Testing util_format_%s round trip ...\n", format_desc->short_name);
+   fflush(stdout);
+
+   src = malloc(height * src_stride);
+   unpacked = malloc(height * src_stride);
+   packed = malloc(height / 4 * dst_stride);
+   packed_rows = malloc(height / 4 * dst_stride);
+
+   for (y = 0; y < height; ++y) {
+      for (x = 0; x < width; ++x) {
+         uint8_t *p = src + y * src_stride + x * 4;
+         p[0] = x * 255 / (width - 1);
+         p[1] = y * 255 / (height - 1);
+         p[2] = (x + y) * 255 / (width + height - 2);
+         /* DXT1 with alpha only has a one bit alpha */
+         p[3] = format_desc->format == PIPE_FORMAT_DXT1_RGBA ?
+                255 : 255 - p[1];
+      }
+   }
+
+   format_desc->pack_rgba_8unorm(packed, dst_stride, src, src_stride,
+                                 width, height);
+
+   /* Compressing one block row at a time, on a single thread, must give
+    * the same blocks as compressing the whole image.
+    */
+   for (y = 0; y < height; y += 4) {
+      format_desc->pack_rgba_8unorm(packed_rows + y / 4 * dst_stride,
+                                    dst_stride, src + y * src_stride,
+                                    src_stride, width, 4);
+   }
+   if (memcmp(packed, packed_rows, height / 4 * dst_stride) != 0) {
+      printf("FAILED: whole image and per row compression differ\n");
+      success = FALSE;
+   }
+
+   format_desc->unpack_rgba_8unorm(unpacked, src_stride, packed, dst_stride,
+                                   width, height);
+
+   for (y = 0; y < height; ++y) {
+      for (x = 0; x < width; ++x) {
+         const uint8_t *p = src + y * src_stride + x * 4;
+         const uint8_t *q = unpacked + y * src_stride + x * 4;
+         for (c = 0; c < 4; ++c) {
+            const unsigned expected = (c == 3 && !has_alpha) ? 255 : p[c];
+            const unsigned error = abs((int) q[c] - (int) expected);
+            max_error[c] = MAX2(max_error[c], error);
+         }
+      }
+   }
+
+   for (c = 0; c < 4; ++c) {
+      if (max_error[c] > (c == 3 ? max_alpha_error : max_rgb_error)) {
+         printf("FAILED: channel %u is off by up to %u\n", c, max_error[c]);
+         success = FALSE;
+      }
+   }
+
+   free(src);
+   free(unpacked);
+   free(packed);
+   free(packed_rows);
+
+   return success;
+}
+
+
+static boolean
+test_all_dxtn_roundtrip(void)
+{
+   boolean success = TRUE;
+
+   if (!util_format_s3tc_enabled)
+      return TRUE;
+
+   /* 565 endpoints and a 2 bit index, 4 bit explicit alpha, and 8 bit
+    * alpha endpoints with a 3 bit index.
+    */
+   if (!test_format_dxtn_roundtrip(util_format_description(PIPE_FORMAT_DXT1_RGB),
+                                   8, 0))
+      success = FALSE;
+   if (!test_format_dxtn_roundtrip(util_format_description(PIPE_FORMAT_DXT1_RGBA),
+                                   8, 0))
+      success = FALSE;
+   if (!test_format_dxtn_roundtrip(util_format_description(PIPE_FORMAT_DXT3_RGBA),
+                                   8, 8))
+      success = FALSE;
+   if (!test_format_dxtn_roundtrip(util_format_description(PIPE_FORMAT_DXT5_RGBA),
+                                   8, 4))
+      success = FALSE;
+
+   return success;
+}
+
+
 int main(int argc, char **argv)
 {
    boolean success;
@@ -733,5 +967,11 @@ int main(int argc, char **argv)
 
    success = test_all();
 
+   if (!test_all_translate_direct())
+      success = FALSE;
+
+   if (!test_all_dxtn_roundtrip())
+      success = FALSE;
+
    return success ? 0 : 1;
 }
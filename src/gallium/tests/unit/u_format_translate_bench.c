@@ -0,0 +1,174 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Throughput of util_format_translate() for the formats with direct
+ * conversion kernels, compared with the generic two pass conversion.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "os/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_format.h"
+#include "util/u_format_direct.h"
+#include "util/u_memory.h"
+
+
+#define WIDTH  1024
+#define HEIGHT 1024
+#define ITERATIONS 8
+
+
+static const struct {
+   enum pipe_format src;
+   enum pipe_format dst;
+} pairs[] = {
+   { PIPE_FORMAT_B8G8R8A8_UNORM, PIPE_FORMAT_R8G8B8A8_UNORM },
+   { PIPE_FORMAT_B8G8R8X8_UNORM, PIPE_FORMAT_R8G8B8A8_UNORM },
+   { PIPE_FORMAT_R8G8B8A8_UNORM, PIPE_FORMAT_B5G6R5_UNORM },
+   { PIPE_FORMAT_B5G6R5_UNORM, PIPE_FORMAT_B8G8R8A8_UNORM },
+   { PIPE_FORMAT_R32_FLOAT, PIPE_FORMAT_R16_FLOAT },
+   { PIPE_FORMAT_R16G16B16A16_FLOAT, PIPE_FORMAT_R32G32B32A32_FLOAT },
+   { PIPE_FORMAT_Z24_UNORM_S8_UINT, PIPE_FORMAT_S8_UINT_Z24_UNORM },
+};
+
+
+/* The conversion as done before the direct kernels existed. */
+static void
+translate_two_pass(const struct util_format_description *dst_desc,
+                   uint8_t *dst, unsigned dst_stride,
+                   const struct util_format_description *src_desc,
+                   const uint8_t *src, unsigned src_stride,
+                   void *tmp)
+{
+   unsigned y;
+
+   for (y = 0; y < HEIGHT; ++y) {
+      if (dst_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS) {
+         src_desc->unpack_z_float(tmp, 0, src, src_stride, WIDTH, 1);
+         dst_desc->pack_z_float(dst, dst_stride, tmp, 0, WIDTH, 1);
+         src_desc->unpack_s_8uint(tmp, 0, src, src_stride, WIDTH, 1);
+         dst_desc->pack_s_8uint(dst, dst_stride, tmp, 0, WIDTH, 1);
+      } else if (util_format_fits_8unorm(src_desc) ||
+                 util_format_fits_8unorm(dst_desc)) {
+         src_desc->unpack_rgba_8unorm(tmp, 0, src, src_stride, WIDTH, 1);
+         dst_desc->pack_rgba_8unorm(dst, dst_stride, tmp, 0, WIDTH, 1);
+      } else {
+         src_desc->unpack_rgba_float(tmp, 0, src, src_stride, WIDTH, 1);
+         dst_desc->pack_rgba_float(dst, dst_stride, tmp, 0, WIDTH, 1);
+      }
+      src += src_stride;
+      dst += dst_stride;
+   }
+}
+
+
+static void
+report(const char *name, int64_t start, int64_t end)
+{
+   double mpixels = (double)WIDTH * HEIGHT * ITERATIONS / 1e6;
+   double secs = (end - start) / 1e9;
+
+   printf("  %-8s %8.1f Mpixels/s\n", name, mpixels / secs);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   static const char *levels[] = { "c", "sse2", "ssse3", "avx2" };
+   struct util_cpu_caps caps;
+   boolean supported[4];
+   uint8_t *src, *dst;
+   float *tmp;
+   unsigned i, j, level;
+
+   util_cpu_detect();
+   caps = util_cpu_caps;
+   supported[0] = TRUE;
+   supported[1] = caps.has_sse2;
+   supported[2] = caps.has_ssse3;
+   supported[3] = caps.has_avx2;
+
+   src = MALLOC(WIDTH * HEIGHT * 16);
+   dst = MALLOC(WIDTH * HEIGHT * 16);
+   tmp = MALLOC(WIDTH * 4 * sizeof *tmp);
+   if (!src || !dst || !tmp)
+      return 1;
+
+   for (i = 0; i < WIDTH * HEIGHT * 16; ++i) {
+      src[i] = rand();
+   }
+
+   for (i = 0; i < Elements(pairs); ++i) {
+      const struct util_format_description *src_desc =
+         util_format_description(pairs[i].src);
+      const struct util_format_description *dst_desc =
+         util_format_description(pairs[i].dst);
+      unsigned src_stride = WIDTH * src_desc->block.bits / 8;
+      unsigned dst_stride = WIDTH * dst_desc->block.bits / 8;
+      int64_t start;
+
+      printf("%s -> %s\n", src_desc->short_name, dst_desc->short_name);
+
+      start = os_time_get_nano();
+      for (j = 0; j < ITERATIONS; ++j) {
+         translate_two_pass(dst_desc, dst, dst_stride,
+                            src_desc, src, src_stride, tmp);
+      }
+      report("2-pass", start, os_time_get_nano());
+
+      for (level = 0; level < Elements(levels); ++level) {
+         if (!supported[level])
+            continue;
+
+         util_cpu_caps.has_sse2 = caps.has_sse2 && level >= 1;
+         util_cpu_caps.has_ssse3 = caps.has_ssse3 && level >= 2;
+         util_cpu_caps.has_avx2 = caps.has_avx2 && level >= 3;
+
+         start = os_time_get_nano();
+         for (j = 0; j < ITERATIONS; ++j) {
+            util_format_translate(pairs[i].dst, dst, dst_stride, 0, 0,
+                                  pairs[i].src, src, src_stride, 0, 0,
+                                  WIDTH, HEIGHT);
+         }
+         report(levels[level], start, os_time_get_nano());
+      }
+
+      util_cpu_caps = caps;
+   }
+
+   FREE(tmp);
+   FREE(dst);
+   FREE(src);
+
+   return 0;
+}
@@ -0,0 +1,275 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+
+/*
+ * Throughput of the MPEG-2 slice parser with different numbers of slice
+ * parsing threads (VL_MPEG12_THREADS), on a synthetic intra coded
+ * elementary stream.
+ *
+ * The macroblocks go to a dummy decoder instead of a pipe driver, so only
+ * the parsing is measured. Their checksum must not depend on the number
+ * of threads.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pipe/p_video_codec.h"
+#include "os/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "vl/vl_mpeg12_bitstream.h"
+
+
+#define WIDTH  1920
+#define HEIGHT 1088
+#define PICTURES 16
+
+
+struct bitwriter
+{
+   uint8_t *data;
+   unsigned size;
+   unsigned bits;
+};
+
+
+static void
+put_bits(struct bitwriter *bw, unsigned value, unsigned num_bits)
+{
+   while (num_bits--) {
+      unsigned byte = bw->bits / 8;
+
+      if (byte == bw->size) {
+         bw->size *= 2;
+         bw->data = REALLOC(bw->data, bw->size / 2, bw->size);
+         memset(bw->data + bw->size / 2, 0, bw->size / 2);
+      }
+
+      if ((value >> num_bits) & 1)
+         bw->data[byte] |= 0x80 >> (bw->bits % 8);
+      bw->bits++;
+   }
+}
+
+
+static void
+put_start_code(struct bitwriter *bw, unsigned code)
+{
+   /* zero stuffing up to the next byte */
+   bw->bits = align(bw->bits, 8);
+   put_bits(bw, 0x000001, 24);
+   put_bits(bw, code, 8);
+}
+
+
+/* some of the table B-14 codes, without the sign bit */
+static const struct {
+   unsigned code, length, run;
+} coeffs[] = {
+   { 0x3, 2, 0 },    /* run 0, level 1 */
+   { 0x3, 3, 1 },    /* run 1, level 1 */
+   { 0x4, 4, 0 },    /* run 0, level 2 */
+   { 0x5, 4, 2 },    /* run 2, level 1 */
+   { 0x5, 5, 0 },    /* run 0, level 3 */
+   { 0x7, 5, 3 },    /* run 3, level 1 */
+};
+
+
+/**
+ * An I picture with one slice per macroblock row, every macroblock intra
+ * coded with a few AC coefficients in each block.
+ */
+static void
+make_picture(struct bitwriter *bw)
+{
+   unsigned x, y, b, i;
+
+   for (y = 0; y < HEIGHT / 16; ++y) {
+      put_start_code(bw, y + 1);
+      put_bits(bw, 8, 5);        /* quantiser_scale_code */
+      put_bits(bw, 0, 1);        /* extra_bit_slice */
+
+      for (x = 0; x < WIDTH / 16; ++x) {
+         put_bits(bw, 1, 1);     /* macroblock_address_increment 1 */
+         put_bits(bw, 1, 1);     /* macroblock_type intra */
+
+         for (b = 0; b < 6; ++b) {
+            unsigned num_coeffs = rand() % 16, pos = 0;
+
+            /* dct_dc_size 0 */
+            if (b < 4)
+               put_bits(bw, 0x4, 3);
+            else
+               put_bits(bw, 0x0, 2);
+
+            for (i = 0; i < num_coeffs; ++i) {
+               unsigned c = rand() % Elements(coeffs);
+
+               pos += coeffs[c].run + 1;
+               if (pos > 63)
+                  break;
+
+               put_bits(bw, coeffs[c].code, coeffs[c].length);
+               put_bits(bw, rand() & 1, 1);
+            }
+
+            put_bits(bw, 0x2, 2); /* end of block */
+         }
+      }
+   }
+
+   put_start_code(bw, 0xB7);     /* sequence_end_code */
+}
+
+
+struct dummy_decoder
+{
+   struct pipe_video_codec base;
+   unsigned num_mbs;
+   uint32_t checksum;
+};
+
+
+static void
+dummy_decode_macroblock(struct pipe_video_codec *codec,
+                        struct pipe_video_buffer *target,
+                        struct pipe_picture_desc *picture,
+                        const struct pipe_macroblock *macroblocks,
+                        unsigned num_macroblocks)
+{
+   struct dummy_decoder *dec = (struct dummy_decoder *)codec;
+   const struct pipe_mpeg12_macroblock *mb =
+      (const struct pipe_mpeg12_macroblock *)macroblocks;
+   unsigned i, j;
+
+   for (i = 0; i < num_macroblocks; ++i, ++mb) {
+      uint32_t sum = mb->x | mb->y << 8 | mb->macroblock_type << 16;
+
+      for (j = 0; j < 64 * util_bitcount(mb->coded_block_pattern); ++j)
+         sum = sum * 31 + mb->blocks[j];
+
+      dec->checksum = dec->checksum * 17 + sum;
+      dec->num_mbs += 1 + mb->num_skipped_macroblocks;
+   }
+}
+
+
+static void
+set_threads(unsigned num_threads)
+{
+   char value[16];
+
+   util_snprintf(value, sizeof(value), "%u", num_threads);
+#ifdef PIPE_OS_WINDOWS
+   _putenv_s("VL_MPEG12_THREADS", value);
+#else
+   setenv("VL_MPEG12_THREADS", value, 1);
+#endif
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_mpeg12_picture_desc desc;
+   struct dummy_decoder dec;
+   struct bitwriter bw;
+   const void *buffers[1];
+   unsigned sizes[1];
+   uint32_t checksum = 0;
+   unsigned num_threads, i;
+   boolean success = TRUE;
+
+   util_cpu_detect();
+
+   bw.size = 1 << 20;
+   bw.data = CALLOC(bw.size, 1);
+   bw.bits = 0;
+   make_picture(&bw);
+   buffers[0] = bw.data;
+   sizes[0] = bw.bits / 8;
+
+   memset(&desc, 0, sizeof(desc));
+   desc.base.profile = PIPE_VIDEO_PROFILE_MPEG2_MAIN;
+   desc.picture_coding_type = PIPE_MPEG12_PICTURE_CODING_TYPE_I;
+   desc.picture_structure = PIPE_MPEG12_PICTURE_STRUCTURE_FRAME;
+   desc.frame_pred_frame_dct = 1;
+
+   memset(&dec, 0, sizeof(dec));
+   dec.base.profile = PIPE_VIDEO_PROFILE_MPEG2_MAIN;
+   dec.base.entrypoint = PIPE_VIDEO_ENTRYPOINT_BITSTREAM;
+   dec.base.width = WIDTH;
+   dec.base.height = HEIGHT;
+   dec.base.decode_macroblock = dummy_decode_macroblock;
+
+   printf("%u kbytes per picture\n", sizes[0] / 1024);
+
+   for (num_threads = 1; num_threads <= util_cpu_caps.nr_cpus; num_threads *= 2) {
+      struct vl_mpg12_bs_pool *pool;
+      struct vl_mpg12_bs bs;
+      int64_t start, end;
+
+      set_threads(num_threads);
+      pool = vl_mpg12_bs_create_pool(&dec.base);
+      vl_mpg12_bs_init(&bs, &dec.base, pool);
+
+      dec.num_mbs = 0;
+      dec.checksum = 0;
+
+      start = os_time_get_nano();
+      for (i = 0; i < PICTURES; ++i)
+         vl_mpg12_bs_decode(&bs, NULL, &desc, 1, buffers, sizes);
+      end = os_time_get_nano();
+
+      vl_mpg12_bs_destroy_pool(pool);
+
+      printf("  %u threads %8.1f pictures/s\n", num_threads,
+             PICTURES / ((end - start) / 1e9));
+
+      if (dec.num_mbs != PICTURES * (WIDTH / 16) * (HEIGHT / 16)) {
+         printf("    decoded %u macroblocks instead of %u\n", dec.num_mbs,
+                PICTURES * (WIDTH / 16) * (HEIGHT / 16));
+         success = FALSE;
+      }
+
+      if (num_threads == 1)
+         checksum = dec.checksum;
+      else if (dec.checksum != checksum) {
+         printf("    macroblocks differ from the single threaded ones\n");
+         success = FALSE;
+      }
+   }
+
+   FREE(bw.data);
+
+   return success ? 0 : 1;
+}
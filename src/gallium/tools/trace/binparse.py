@@ -0,0 +1,314 @@
+#!/usr/bin/env python
+##########################################################################
+#
+# Copyright 2014 The Mesa Project
+# All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sub license, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice (including the
+# next paragraph) shall be included in all copies or substantial portions
+# of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+# IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+# ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+# TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+# SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+##########################################################################
+
+
+'''Reader and writer of the binary traces of GALLIUM_TRACE_BINARY.
+
+See src/gallium/drivers/trace/tr_dump_binary.h for the format.'''
+
+
+import struct
+
+from model import *
+
+
+MAGIC = b'GTRB'
+VERSION = 1
+
+(STRING_DEF, CALL, CALL_END, ARG, RET, NULL, BOOL, INT, UINT, FLOAT, STRING,
+ ENUM, ARRAY, STRUCT, MEMBER, END, PTR, BYTES, BLOB_DEF, BLOB_REF, STATE_DEF,
+ STATE_REF) = range(1, 23)
+
+
+class TruncatedTrace(Exception):
+    pass
+
+
+class BinaryTraceReader:
+
+    def __init__(self, fp):
+        self.fp = fp
+        self.buf = bytearray()
+        self.pos = 0
+        self.strings = []
+        self.blobs = {}
+        self.states = []
+
+    def fill(self, size):
+        while len(self.buf) - self.pos < size:
+            data = self.fp.read(64*1024)
+            if not data:
+                raise TruncatedTrace
+            self.buf = self.buf[self.pos:] + bytearray(data)
+            self.pos = 0
+
+    def read_bytes(self, size):
+        self.fill(size)
+        data = bytes(self.buf[self.pos:self.pos + size])
+        self.pos += size
+        return data
+
+    def read_byte(self):
+        self.fill(1)
+        value = self.buf[self.pos]
+        self.pos += 1
+        return value
+
+    def read_varint(self):
+        value = 0
+        shift = 0
+        while True:
+            byte = self.read_byte()
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    def read_sint(self):
+        value = self.read_varint()
+        return (value >> 1) ^ -(value & 1)
+
+    def read_u64(self):
+        return struct.unpack('<Q', self.read_bytes(8))[0]
+
+    def read_str(self):
+        return self.strings[self.read_varint()]
+
+    def read_token(self):
+        while True:
+            token = self.read_byte()
+            if token != STRING_DEF:
+                return token
+            size = self.read_varint()
+            self.strings.append(self.read_bytes(size).decode('utf-8'))
+
+    def parse_header(self):
+        if self.read_bytes(4) != MAGIC:
+            raise ValueError('not a binary gallium trace')
+        version = struct.unpack('<I', self.read_bytes(4))[0]
+        if version != VERSION:
+            raise ValueError('unsupported binary trace version %u' % version)
+
+    def parse_calls(self):
+        '''Generate the calls in the trace.
+
+        A trace cut short by a crash ends at the last complete call.'''
+
+        self.parse_header()
+        while True:
+            try:
+                token = self.read_token()
+            except TruncatedTrace:
+                return
+            if token != CALL:
+                raise ValueError('call expected, token %u found' % token)
+            try:
+                call = self.parse_call()
+            except TruncatedTrace:
+                return
+            yield call
+
+    def parse_call(self):
+        no = self.read_varint()
+        klass = self.read_str()
+        method = self.read_str()
+        args = []
+        ret = None
+        while True:
+            token = self.read_token()
+            if token == ARG:
+                name = self.read_str()
+                args.append((name, self.parse_value()))
+            elif token == RET:
+                ret = self.parse_value()
+            elif token == CALL_END:
+                time = Literal(self.read_sint())
+                return Call(no, klass, method, args, ret, time)
+            else:
+                raise ValueError('argument expected, token %u found' % token)
+
+    def parse_value(self, token = None):
+        if token is None:
+            token = self.read_token()
+        if token == NULL:
+            return Literal(None)
+        if token == BOOL:
+            return Literal(self.read_byte())
+        if token == INT:
+            return Literal(self.read_sint())
+        if token == UINT:
+            return Literal(self.read_varint())
+        if token == FLOAT:
+            return Literal(struct.unpack('<d', self.read_bytes(8))[0])
+        if token == STRING:
+            size = self.read_varint()
+            return Literal(self.read_bytes(size).decode('utf-8'))
+        if token == ENUM:
+            return NamedConstant(self.read_str())
+        if token == ARRAY:
+            elems = []
+            token = self.read_token()
+            while token != END:
+                elems.append(self.parse_value(token))
+                token = self.read_token()
+            return Array(elems)
+        if token == STRUCT:
+            name = self.read_str()
+            members = []
+            token = self.read_token()
+            while token == MEMBER:
+                member_name = self.read_str()
+                members.append((member_name, self.parse_value()))
+                token = self.read_token()
+            if token != END:
+                raise ValueError('member expected, token %u found' % token)
+            return Struct(name, members)
+        if token == PTR:
+            return Pointer('0x%08x' % self.read_varint())
+        if token == BYTES:
+            size = self.read_varint()
+            return Blob(None, self.read_bytes(size))
+        if token == BLOB_DEF:
+            hash = self.read_u64()
+            size = self.read_varint()
+            data = self.read_bytes(size)
+            self.blobs[hash] = data
+            return Blob(None, data)
+        if token == BLOB_REF:
+            return Blob(None, self.blobs[self.read_u64()])
+        if token == STATE_DEF:
+            value = self.parse_value()
+            self.states.append(value)
+            return value
+        if token == STATE_REF:
+            return self.states[self.read_varint()]
+        raise ValueError('value expected, token %u found' % token)
+
+
+class BinaryTraceWriter:
+    '''Write calls in the binary format, e.g. to convert XML traces.
+
+    States and blobs are written as plain structs and bytes, the reader
+    doesn't need them to be shared.'''
+
+    def __init__(self, fp):
+        self.fp = fp
+        self.strings = {}
+        self.fp.write(MAGIC + struct.pack('<I', VERSION))
+
+    def write_byte(self, value):
+        self.fp.write(struct.pack('B', value))
+
+    def write_varint(self, value):
+        data = bytearray()
+        while value >= 0x80:
+            data.append((value & 0x7f) | 0x80)
+            value >>= 7
+        data.append(value)
+        self.fp.write(bytes(data))
+
+    def write_sint(self, value):
+        self.write_varint((value << 1) ^ -(value < 0))
+
+    def write_data(self, data):
+        self.write_varint(len(data))
+        self.fp.write(data)
+
+    def string_id(self, name):
+        try:
+            return self.strings[name]
+        except KeyError:
+            id = len(self.strings)
+            self.strings[name] = id
+            self.write_byte(STRING_DEF)
+            self.write_data(name.encode('utf-8'))
+            return id
+
+    def write_named(self, token, name):
+        id = self.string_id(name)
+        self.write_byte(token)
+        self.write_varint(id)
+
+    def write_call(self, call):
+        klass = self.string_id(call.klass)
+        method = self.string_id(call.method)
+        self.write_byte(CALL)
+        self.write_varint(call.no)
+        self.write_varint(klass)
+        self.write_varint(method)
+        for name, value in call.args:
+            self.write_named(ARG, name)
+            self.write_value(value)
+        if call.ret is not None:
+            self.write_byte(RET)
+            self.write_value(call.ret)
+        time = 0
+        if call.time is not None:
+            time = int(call.time.value)
+        self.write_byte(CALL_END)
+        self.write_sint(time)
+
+    def write_value(self, node):
+        if isinstance(node, Literal):
+            value = node.value
+            if value is None:
+                self.write_byte(NULL)
+            elif isinstance(value, float):
+                self.write_byte(FLOAT)
+                self.fp.write(struct.pack('<d', value))
+            elif isinstance(value, (int, long)):
+                if value < 0:
+                    self.write_byte(INT)
+                    self.write_sint(value)
+                else:
+                    self.write_byte(UINT)
+                    self.write_varint(value)
+            else:
+                self.write_byte(STRING)
+                self.write_data(value.encode('utf-8'))
+        elif isinstance(node, NamedConstant):
+            self.write_named(ENUM, node.name)
+        elif isinstance(node, Array):
+            self.write_byte(ARRAY)
+            for elem in node.elements:
+                self.write_value(elem)
+            self.write_byte(END)
+        elif isinstance(node, Struct):
+            self.write_named(STRUCT, node.name)
+            for name, value in node.members:
+                self.write_named(MEMBER, name)
+                self.write_value(value)
+            self.write_byte(END)
+        elif isinstance(node, Pointer):
+            self.write_byte(PTR)
+            self.write_varint(int(node.address, 16))
+        elif isinstance(node, Blob):
+            self.write_byte(BYTES)
+            self.write_data(node.getValue())
+        else:
+            raise ValueError('unexpected node %r' % node)
@@ -32,6 +32,7 @@ import xml.parsers.expat
 import optparse
 
 from model import *
+import binparse
 
 
 ELEMENT_START, ELEMENT_END, CHARACTER_DATA, EOF = range(4)
@@ -187,13 +188,43 @@ class XmlParser:
         return data
 
 
+class PrefixedStream:
+    '''Stream with some data already read from it pushed back.'''
+
+    def __init__(self, prefix, fp):
+        self.prefix = prefix
+        self.fp = fp
+
+    def read(self, size):
+        if not self.prefix:
+            return self.fp.read(size)
+        data = self.prefix[:size]
+        self.prefix = self.prefix[size:]
+        if len(data) < size:
+            data += self.fp.read(size - len(data))
+        return data
+
+
 class TraceParser(XmlParser):
 
     def __init__(self, fp):
-        XmlParser.__init__(self, fp)
+        # Binary traces (GALLIUM_TRACE_BINARY) are recognized by their magic
+        # number, and produce the same calls as XML ones.
+        magic = fp.read(len(binparse.MAGIC))
+        fp = PrefixedStream(magic, fp)
+        if magic == binparse.MAGIC:
+            self.reader = binparse.BinaryTraceReader(fp)
+        else:
+            self.reader = None
+            XmlParser.__init__(self, fp)
         self.last_call_no = 0
     
     def parse(self):
+        if self.reader is not None:
+            for call in self.reader.parse_calls():
+                self.handle_call(call)
+            return
+
         self.element_start('trace')
         while self.token.type not in (ELEMENT_END, EOF):
             call = self.parse_call()
@@ -378,12 +409,12 @@ class Main:
         for arg in args:
             if arg.endswith('.gz'):
                 from gzip import GzipFile
-                stream = GzipFile(arg, 'rt')
+                stream = GzipFile(arg, 'rb')
             elif arg.endswith('.bz2'):
                 from bz2 import BZ2File
-                stream = BZ2File(arg, 'rU')
+                stream = BZ2File(arg, 'rb')
             else:
-                stream = open(arg, 'rt')
+                stream = open(arg, 'rb')
             self.process_arg(stream, options)
 
     def get_optparser(self):
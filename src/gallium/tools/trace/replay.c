@@ -0,0 +1,345 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Replay a binary gallium trace against a driver and time it, to compare
+ * the performance of the driver from one version to the next.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_screen.h"
+#include "pipe-loader/pipe_loader.h"
+#include "os/os_time.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+#include "noop/noop_public.h"
+
+#include "replay.h"
+
+
+#define MAX_DEVICES 16
+
+
+struct replay_stats {
+   unsigned count;
+   int64_t total;
+   int64_t max;
+};
+
+
+static void
+usage(const char *name)
+{
+   fprintf(stderr,
+           "usage: %s [options] TRACE\n"
+           "\n"
+           "Replay a trace written with GALLIUM_TRACE_BINARY=true.\n"
+           "\n"
+           "    -d N  replay on the Nth device found by the pipe loader\n"
+           "    -L    list the devices and exit\n"
+           "    -l N  replay the trace N times (default 1)\n"
+           "    -w    keep the contexts, shaders and states from one loop\n"
+           "          to the next, and don't time the first loop\n"
+           "    -f    wait for the rendering at the end of each frame\n"
+           "    -c    print the time spent in each call\n"
+           "    -p    print the time of each frame\n"
+           "    -v    print the calls which couldn't be replayed\n"
+           "\n"
+           "Set GALLIUM_NOOP=true to measure the CPU overhead without the\n"
+           "hardware.\n",
+           name);
+}
+
+
+static int
+compare_times(const void *a, const void *b)
+{
+   int64_t ta = *(const int64_t *)a;
+   int64_t tb = *(const int64_t *)b;
+
+   return ta < tb ? -1 : ta > tb;
+}
+
+
+static const struct replay_stats *sort_stats;
+
+static int
+compare_stats(const void *a, const void *b)
+{
+   int64_t ta = sort_stats[*(const unsigned *)a].total;
+   int64_t tb = sort_stats[*(const unsigned *)b].total;
+
+   return ta > tb ? -1 : ta < tb;
+}
+
+
+static void
+print_call_stats(const struct replay_stats *stats)
+{
+   unsigned *order = MALLOC(replay_num_handlers * sizeof(*order));
+   unsigned i;
+
+   if (!order)
+      return;
+
+   for (i = 0; i < replay_num_handlers; i++)
+      order[i] = i;
+   sort_stats = stats;
+   qsort(order, replay_num_handlers, sizeof(*order), compare_stats);
+
+   printf("\n%-48s %8s %10s %10s %10s\n",
+          "call", "count", "total ms", "avg us", "max us");
+   for (i = 0; i < replay_num_handlers; i++) {
+      const struct replay_handler *h = &replay_handlers[order[i]];
+      const struct replay_stats *s = &stats[order[i]];
+      char name[64];
+
+      if (!s->count)
+         continue;
+
+      util_snprintf(name, sizeof(name), "%s::%s", h->klass, h->method);
+      printf("%-48s %8u %10.3f %10.3f %10.3f\n", name, s->count,
+             s->total / 1e6, s->total / 1e3 / s->count, s->max / 1e3);
+   }
+
+   FREE(order);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct pipe_loader_device *devs[MAX_DEVICES];
+   struct pipe_screen *screen;
+   struct replay_trace trace;
+   struct replay_stats *stats;
+   struct replay r;
+   const char *filename = NULL;
+   unsigned device = 0, loops = 1, loop, num_loops;
+   boolean list = FALSE, warm = FALSE, finish = FALSE;
+   boolean call_times = FALSE, frame_times = FALSE, verbose = FALSE;
+   unsigned unsupported = 0, skipped = 0;
+   int64_t *frames = NULL, total = 0;
+   unsigned num_frames = 0, max_frames = 0;
+   int ndev, i;
+   unsigned c;
+
+   for (i = 1; i < argc; i++) {
+      if (!strcmp(argv[i], "-d") && i + 1 < argc) {
+         device = atoi(argv[++i]);
+      } else if (!strcmp(argv[i], "-L")) {
+         list = TRUE;
+      } else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+         loops = atoi(argv[++i]);
+      } else if (!strcmp(argv[i], "-w")) {
+         warm = TRUE;
+      } else if (!strcmp(argv[i], "-f")) {
+         finish = TRUE;
+      } else if (!strcmp(argv[i], "-c")) {
+         call_times = TRUE;
+      } else if (!strcmp(argv[i], "-p")) {
+         frame_times = TRUE;
+      } else if (!strcmp(argv[i], "-v")) {
+         verbose = TRUE;
+      } else if (argv[i][0] != '-' && !filename) {
+         filename = argv[i];
+      } else {
+         usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if ((!filename && !list) || !loops) {
+      usage(argv[0]);
+      return 1;
+   }
+
+   ndev = pipe_loader_probe(devs, MAX_DEVICES);
+   ndev = MIN2(ndev, MAX_DEVICES);
+
+   if (list) {
+      for (i = 0; i < ndev; i++)
+         printf("%d: %s\n", i, devs[i]->driver_name);
+      pipe_loader_release(devs, ndev);
+      return 0;
+   }
+
+   if (device >= (unsigned)ndev) {
+      fprintf(stderr, "no device %u, %d found\n", device, ndev);
+      pipe_loader_release(devs, ndev);
+      return 1;
+   }
+
+   if (!replay_load(&trace, filename)) {
+      pipe_loader_release(devs, ndev);
+      return 1;
+   }
+
+   for (c = 0; c < trace.num_calls; c++) {
+      struct replay_call *call = &trace.calls[c];
+
+      call->handler = replay_find_handler(call->klass, call->method);
+      if (!call->handler) {
+         unsupported++;
+         if (verbose)
+            fprintf(stderr, "call %u: %s::%s is not supported\n",
+                    call->no, call->klass, call->method);
+      }
+   }
+
+   screen = pipe_loader_create_screen(devs[device], PIPE_SEARCH_DIR);
+   if (screen)
+      screen = noop_screen_create(screen);
+   if (!screen) {
+      fprintf(stderr, "failed to create the screen of %s\n",
+              devs[device]->driver_name);
+      replay_unload(&trace);
+      pipe_loader_release(devs, ndev);
+      return 1;
+   }
+
+   memset(&r, 0, sizeof(r));
+   stats = CALLOC(replay_num_handlers, sizeof(*stats));
+   if (!stats || !replay_init(&r, screen)) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+   }
+   r.warm = warm;
+   r.finish_frames = finish;
+
+   printf("replaying %u calls of %s on %s\n", trace.num_calls, filename,
+          devs[device]->driver_name);
+
+   /* the first loop only warms up the caches */
+   num_loops = warm ? loops + 1 : loops;
+
+   for (loop = 0; loop < num_loops; loop++) {
+      boolean timed = !warm || loop > 0;
+      int64_t frame_start = os_time_get_nano();
+      int64_t loop_start = frame_start;
+
+      for (c = 0; c < trace.num_calls; c++) {
+         struct replay_call *call = &trace.calls[c];
+         int64_t start, end;
+
+         if (!call->handler || !call->handler->exec)
+            continue;
+
+         r.skip = FALSE;
+         r.end_of_frame = FALSE;
+
+         start = os_time_get_nano();
+         call->handler->exec(&r, call);
+         if (r.end_of_frame && r.finish_frames)
+            replay_finish(&r);
+         end = os_time_get_nano();
+
+         if (r.skip) {
+            if (timed)
+               skipped++;
+            if (verbose && loop == num_loops - 1)
+               fprintf(stderr, "call %u: %s::%s skipped\n",
+                       call->no, call->klass, call->method);
+            continue;
+         }
+
+         if (timed) {
+            struct replay_stats *s = &stats[call->handler - replay_handlers];
+
+            s->count++;
+            s->total += end - start;
+            s->max = MAX2(s->max, end - start);
+         }
+
+         if (r.end_of_frame) {
+            if (timed) {
+               if (num_frames == max_frames) {
+                  unsigned n = max_frames ? max_frames * 2 : 256;
+
+                  frames = REALLOC(frames, max_frames * sizeof(*frames),
+                                   n * sizeof(*frames));
+                  max_frames = frames ? n : 0;
+               }
+               if (frames)
+                  frames[num_frames++] = end - frame_start;
+            }
+            frame_start = end;
+         }
+      }
+
+      if (timed)
+         total += os_time_get_nano() - loop_start;
+
+      replay_end_loop(&r);
+   }
+
+   if (frame_times) {
+      for (c = 0; c < num_frames; c++)
+         printf("frame %u: %.3f ms\n", c, frames[c] / 1e6);
+   }
+
+   printf("%u loops, %.3f ms", loops, total / 1e6);
+   if (num_frames) {
+      int64_t sum = 0;
+
+      for (c = 0; c < num_frames; c++)
+         sum += frames[c];
+      qsort(frames, num_frames, sizeof(*frames), compare_times);
+
+      printf(", %u frames, %.2f fps\n", num_frames, num_frames * 1e9 / sum);
+      printf("frame ms: min %.3f, avg %.3f, median %.3f, max %.3f\n",
+             frames[0] / 1e6, sum / 1e6 / num_frames,
+             frames[num_frames / 2] / 1e6, frames[num_frames - 1] / 1e6);
+   }
+   else {
+      printf(", no frame ends in the trace\n");
+   }
+
+   if (unsupported || skipped)
+      printf("%u unsupported calls, %u skipped calls%s\n", unsupported,
+             skipped, verbose ? "" : " (-v to list them)");
+
+   if (call_times)
+      print_call_stats(stats);
+
+   replay_fini(&r);
+   screen->destroy(screen);
+
+   for (c = 0; c < trace.num_calls; c++)
+      replay_release_call(&trace.calls[c]);
+   replay_unload(&trace);
+
+   FREE(frames);
+   FREE(stats);
+   pipe_loader_release(devs, ndev);
+   return 0;
+}
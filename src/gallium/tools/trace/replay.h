@@ -0,0 +1,242 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Replay of the binary traces written by the trace driver.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+
+#include "pipe/p_compiler.h"
+#include "util/u_double_list.h"
+
+
+struct pipe_context;
+struct pipe_screen;
+struct util_hash_table;
+struct replay;
+struct replay_object;
+struct replay_pool;
+
+
+/*
+ * Trace contents, as loaded by replay_load.c.
+ */
+
+enum replay_value_type {
+   REPLAY_NULL,
+   REPLAY_BOOL,
+   REPLAY_INT,
+   REPLAY_UINT,
+   REPLAY_FLOAT,
+   REPLAY_STRING,
+   REPLAY_ENUM,
+   REPLAY_ARRAY,
+   REPLAY_STRUCT,
+   REPLAY_PTR,
+   REPLAY_BYTES
+};
+
+/**
+ * A value of the trace. Values are never modified once loaded, and
+ * identical states may be shared by several calls.
+ */
+struct replay_value {
+   enum replay_value_type type;
+
+   /** number of array elements or struct members, or size of the bytes */
+   unsigned num;
+
+   union {
+      int64_t i;                 /* BOOL, INT */
+      uint64_t u;                /* UINT, PTR */
+      double f;                  /* FLOAT */
+      const char *str;           /* STRING, ENUM */
+      const void *data;          /* BYTES */
+      struct {
+         const char *name;                /* STRUCT only */
+         const char **names;              /* STRUCT only */
+         const struct replay_value **values;
+      } c;                       /* ARRAY, STRUCT */
+   } u;
+};
+
+struct replay_handler;
+
+struct replay_call {
+   unsigned no;
+   const char *klass;
+   const char *method;
+
+   unsigned num_args;
+   const char **arg_names;
+   const struct replay_value **args;
+   const struct replay_value *ret;
+
+   /** NULL for the calls which can't be replayed */
+   const struct replay_handler *handler;
+
+   /** object created by this call, kept from one loop to the next */
+   struct replay_object *cached;
+
+   /** data decoded once by the handler, e.g. shader tokens */
+   void *data;
+};
+
+struct replay_trace {
+   struct replay_call *calls;
+   unsigned num_calls;
+
+   /* memory of the values, names and contents */
+   struct replay_pool *pool;
+};
+
+boolean
+replay_load(struct replay_trace *trace, const char *filename);
+
+void
+replay_unload(struct replay_trace *trace);
+
+const struct replay_value *
+replay_arg(const struct replay_call *call, const char *name);
+
+const struct replay_value *
+replay_member(const struct replay_value *value, const char *name);
+
+const struct replay_value *
+replay_elem(const struct replay_value *value, unsigned index);
+
+int64_t
+replay_int(const struct replay_value *value);
+
+uint64_t
+replay_uint(const struct replay_value *value);
+
+double
+replay_float(const struct replay_value *value);
+
+static INLINE int64_t
+replay_member_int(const struct replay_value *value, const char *name)
+{
+   return replay_int(replay_member(value, name));
+}
+
+static INLINE uint64_t
+replay_member_uint(const struct replay_value *value, const char *name)
+{
+   return replay_uint(replay_member(value, name));
+}
+
+static INLINE double
+replay_member_float(const struct replay_value *value, const char *name)
+{
+   return replay_float(replay_member(value, name));
+}
+
+
+/*
+ * Execution of the calls, in replay_calls.c.
+ */
+
+/**
+ * How to replay a call. Calls without an exec function, like the queries
+ * of the screen capabilities, have nothing to replay.
+ */
+struct replay_handler {
+   const char *klass;
+   const char *method;
+   void (*exec)(struct replay *r, struct replay_call *call);
+};
+
+extern const struct replay_handler replay_handlers[];
+extern const unsigned replay_num_handlers;
+
+const struct replay_handler *
+replay_find_handler(const char *klass, const char *method);
+
+/** Free what the handlers keep in replay_call::data. */
+void
+replay_release_call(struct replay_call *call);
+
+
+/*
+ * Replay state.
+ */
+
+struct replay {
+   struct pipe_screen *screen;
+
+   /** keep contexts, shaders and state objects from one loop to the next */
+   boolean warm;
+
+   /** wait for the fence of the end of each frame */
+   boolean finish_frames;
+
+   /** traced pointer -> struct replay_object */
+   struct util_hash_table *objects;
+
+   /** objects created by the current loop */
+   struct list_head live;
+
+   /** objects kept from one loop to the next */
+   struct list_head cached;
+
+   /** set by the calls which end a frame */
+   boolean end_of_frame;
+
+   /**
+    * The trace marks the frame ends with PIPE_FLUSH_END_OF_FRAME, so
+    * flush_frontbuffer doesn't end another frame.
+    */
+   boolean flush_frame_ends;
+
+   /**
+    * Set by the handlers when the call can't be replayed, e.g. because it
+    * uses an object which wasn't replayed.
+    */
+   boolean skip;
+};
+
+boolean
+replay_init(struct replay *r, struct pipe_screen *screen);
+
+/** Destroy the objects created by the current loop. */
+void
+replay_end_loop(struct replay *r);
+
+/** Wait for the rendering of all the contexts. */
+void
+replay_finish(struct replay *r);
+
+void
+replay_fini(struct replay *r);
+
+
+#endif /* REPLAY_H */
@@ -0,0 +1,2069 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Execution of the traced calls.
+ *
+ * The trace refers to objects by the pointers the driver returned when it
+ * was recorded. These are mapped to the objects created by the replay,
+ * and the states are decoded back from the way tr_dump_state.c wrote them.
+ */
+
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_state.h"
+#include "tgsi/tgsi_parse.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_dump.h"
+#include "util/u_format.h"
+#include "util/u_hash_table.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "replay.h"
+
+
+#define REPLAY_MAX_SHADER_TOKENS (64 * 1024)
+
+/* replay_object::user_buffers bit of the index buffer */
+#define REPLAY_USER_INDEX_BUFFER (1u << 31)
+
+
+enum replay_object_type {
+   REPLAY_OBJECT_CONTEXT,
+   REPLAY_OBJECT_RESOURCE,
+   REPLAY_OBJECT_SURFACE,
+   REPLAY_OBJECT_SAMPLER_VIEW,
+   REPLAY_OBJECT_SO_TARGET,
+   REPLAY_OBJECT_QUERY,
+   REPLAY_OBJECT_FENCE,
+   REPLAY_OBJECT_BLEND,
+   REPLAY_OBJECT_SAMPLER,
+   REPLAY_OBJECT_RASTERIZER,
+   REPLAY_OBJECT_DSA,
+   REPLAY_OBJECT_FS,
+   REPLAY_OBJECT_VS,
+   REPLAY_OBJECT_GS,
+   REPLAY_OBJECT_VELEMS
+};
+
+struct replay_object {
+   /** traced pointer, the key of replay::objects */
+   uint64_t addr;
+
+   enum replay_object_type type;
+   void *obj;
+
+   /** context of the object, the object itself for contexts */
+   struct pipe_context *pipe;
+
+   /**
+    * For contexts, the vertex buffer slots bound to user memory and
+    * REPLAY_USER_INDEX_BUFFER. The contents of user buffers aren't in the
+    * trace, so draws using them can't be replayed.
+    */
+   unsigned user_buffers;
+
+   /** in replay::objects */
+   boolean mapped;
+
+   /** kept from one loop to the next, in replay::cached */
+   boolean cached;
+
+   /** in replay::live or replay::cached */
+   struct list_head link;
+};
+
+
+/* zeros, for the data which isn't in the trace */
+static void *replay_zeros;
+static size_t replay_zeros_size;
+
+/* enum name -> format + 1 */
+static struct util_hash_table *replay_formats;
+
+
+static boolean
+replay_is_cacheable(enum replay_object_type type)
+{
+   return type == REPLAY_OBJECT_CONTEXT || type >= REPLAY_OBJECT_BLEND;
+}
+
+
+/*
+ * Objects.
+ */
+
+static void
+replay_destroy_object(struct replay *r, struct replay_object *obj)
+{
+   struct pipe_context *pipe = obj->pipe;
+
+   switch (obj->type) {
+   case REPLAY_OBJECT_CONTEXT:
+      pipe->destroy(pipe);
+      break;
+   case REPLAY_OBJECT_RESOURCE: {
+      struct pipe_resource *resource = obj->obj;
+      pipe_resource_reference(&resource, NULL);
+      break;
+   }
+   case REPLAY_OBJECT_SURFACE: {
+      struct pipe_surface *surface = obj->obj;
+      pipe_surface_reference(&surface, NULL);
+      break;
+   }
+   case REPLAY_OBJECT_SAMPLER_VIEW: {
+      struct pipe_sampler_view *view = obj->obj;
+      pipe_sampler_view_reference(&view, NULL);
+      break;
+   }
+   case REPLAY_OBJECT_SO_TARGET:
+      pipe->stream_output_target_destroy(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_QUERY:
+      pipe->destroy_query(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_FENCE: {
+      struct pipe_fence_handle *fence = obj->obj;
+      r->screen->fence_reference(r->screen, &fence, NULL);
+      break;
+   }
+   case REPLAY_OBJECT_BLEND:
+      pipe->delete_blend_state(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_SAMPLER:
+      pipe->delete_sampler_state(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_RASTERIZER:
+      pipe->delete_rasterizer_state(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_DSA:
+      pipe->delete_depth_stencil_alpha_state(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_FS:
+      pipe->delete_fs_state(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_VS:
+      pipe->delete_vs_state(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_GS:
+      pipe->delete_gs_state(pipe, obj->obj);
+      break;
+   case REPLAY_OBJECT_VELEMS:
+      pipe->delete_vertex_elements_state(pipe, obj->obj);
+      break;
+   }
+}
+
+
+static void
+replay_unmap_object(struct replay *r, struct replay_object *obj)
+{
+   if (obj->mapped) {
+      util_hash_table_remove(r->objects, &obj->addr);
+      obj->mapped = FALSE;
+   }
+}
+
+
+static void
+replay_unbind_all(struct pipe_context *pipe);
+
+
+/**
+ * Handle the destruction of an object by the trace. Cached objects are
+ * only forgotten until the next loop creates them again.
+ */
+static void
+replay_release_object(struct replay *r, struct replay_object *obj)
+{
+   replay_unmap_object(r, obj);
+
+   if (obj->cached)
+      return;
+
+   if (obj->type == REPLAY_OBJECT_CONTEXT) {
+      struct replay_object *child, *next;
+
+      /* the objects the trace didn't destroy before the context */
+      replay_unbind_all(obj->pipe);
+      LIST_FOR_EACH_ENTRY_SAFE(child, next, &r->live, link) {
+         if (child != obj && child->pipe == obj->pipe) {
+            replay_unmap_object(r, child);
+            replay_destroy_object(r, child);
+            LIST_DEL(&child->link);
+            FREE(child);
+         }
+      }
+   }
+
+   replay_destroy_object(r, obj);
+   LIST_DEL(&obj->link);
+   FREE(obj);
+}
+
+
+static void
+replay_map_object(struct replay *r, struct replay_object *obj)
+{
+   struct replay_object *old = util_hash_table_get(r->objects, &obj->addr);
+
+   if (old == obj)
+      return;
+
+   /* The address was reused, so the traced object is gone even if its
+    * destruction wasn't traced, like for fences. */
+   if (old)
+      replay_release_object(r, old);
+
+   util_hash_table_set(r->objects, &obj->addr, obj);
+   obj->mapped = TRUE;
+}
+
+
+/**
+ * Register the object created by \p call, under the pointer the call
+ * returned in the trace.
+ */
+static struct replay_object *
+replay_add_object(struct replay *r, struct replay_call *call,
+                  enum replay_object_type type, void *ptr,
+                  struct pipe_context *pipe)
+{
+   struct replay_object *obj;
+
+   if (!ptr)
+      return NULL;
+
+   obj = CALLOC_STRUCT(replay_object);
+   if (!obj)
+      return NULL;
+
+   obj->type = type;
+   obj->obj = ptr;
+   obj->pipe = pipe;
+
+   /* the creation failed when recording, nothing will use the object */
+   if (!call->ret || call->ret->type != REPLAY_PTR) {
+      replay_destroy_object(r, obj);
+      FREE(obj);
+      return NULL;
+   }
+
+   obj->addr = call->ret->u.u;
+   replay_map_object(r, obj);
+
+   if (r->warm && replay_is_cacheable(type)) {
+      obj->cached = TRUE;
+      call->cached = obj;
+      LIST_ADDTAIL(&obj->link, &r->cached);
+   }
+   else {
+      LIST_ADDTAIL(&obj->link, &r->live);
+   }
+
+   return obj;
+}
+
+
+/**
+ * Reuse the object this call created in a previous loop, if any.
+ */
+static boolean
+replay_reuse(struct replay *r, struct replay_call *call)
+{
+   if (!call->cached)
+      return FALSE;
+
+   replay_map_object(r, call->cached);
+   return TRUE;
+}
+
+
+static struct replay_object *
+replay_lookup(struct replay *r, const struct replay_value *value,
+              enum replay_object_type type)
+{
+   struct replay_object *obj;
+
+   if (!value || value->type != REPLAY_PTR)
+      return NULL;
+
+   obj = util_hash_table_get(r->objects, (void *)&value->u.u);
+   if (!obj || obj->type != type) {
+      r->skip = TRUE;
+      return NULL;
+   }
+   return obj;
+}
+
+
+/**
+ * Return the object a traced pointer refers to. Sets replay::skip if the
+ * pointer isn't NULL but the object is unknown.
+ */
+static void *
+replay_get(struct replay *r, const struct replay_value *value,
+           enum replay_object_type type)
+{
+   struct replay_object *obj = replay_lookup(r, value, type);
+
+   return obj ? obj->obj : NULL;
+}
+
+
+static struct replay_object *
+replay_context(struct replay *r, const struct replay_call *call)
+{
+   const struct replay_value *value = replay_arg(call, "pipe");
+   struct replay_object *ctx;
+
+   if (!value)
+      value = replay_arg(call, "context");
+
+   ctx = replay_lookup(r, value, REPLAY_OBJECT_CONTEXT);
+   if (!ctx)
+      r->skip = TRUE;
+   return ctx;
+}
+
+
+static struct pipe_context *
+replay_pipe(struct replay *r, const struct replay_call *call)
+{
+   struct replay_object *ctx = replay_context(r, call);
+
+   return ctx ? ctx->pipe : NULL;
+}
+
+
+static void
+replay_delete(struct replay *r, struct replay_call *call, const char *name,
+              enum replay_object_type type)
+{
+   struct replay_object *obj = replay_lookup(r, replay_arg(call, name), type);
+
+   if (obj)
+      replay_release_object(r, obj);
+}
+
+
+/*
+ * Decoding of the states.
+ */
+
+static unsigned
+replay_hash_pointer(void *key)
+{
+   return (unsigned)(uintptr_t)key;
+}
+
+
+static int
+replay_compare_pointer(void *key1, void *key2)
+{
+   return key1 != key2;
+}
+
+
+static enum pipe_format
+replay_format(const struct replay_value *value)
+{
+   void *cached;
+   unsigned i;
+
+   if (!value || value->type != REPLAY_ENUM)
+      return PIPE_FORMAT_NONE;
+
+   /* the enum names are interned by the trace */
+   if (!replay_formats)
+      replay_formats = util_hash_table_create(replay_hash_pointer,
+                                              replay_compare_pointer);
+
+   cached = util_hash_table_get(replay_formats, (void *)value->u.str);
+   if (cached)
+      return (enum pipe_format)((uintptr_t)cached - 1);
+
+   for (i = 0; i < PIPE_FORMAT_COUNT; i++) {
+      if (strcmp(util_format_name(i), value->u.str) == 0) {
+         util_hash_table_set(replay_formats, (void *)value->u.str,
+                             (void *)(uintptr_t)(i + 1));
+         return i;
+      }
+   }
+   return PIPE_FORMAT_NONE;
+}
+
+
+static void
+replay_floats(const struct replay_value *value, float *dst, unsigned n)
+{
+   unsigned i;
+
+   for (i = 0; i < n; i++)
+      dst[i] = replay_float(replay_elem(value, i));
+}
+
+
+static void
+replay_uints(const struct replay_value *value, unsigned *dst, unsigned n)
+{
+   unsigned i;
+
+   for (i = 0; i < n; i++)
+      dst[i] = replay_uint(replay_elem(value, i));
+}
+
+
+static void
+replay_decode_box(const struct replay_value *v, struct pipe_box *box)
+{
+   box->x = replay_member_int(v, "x");
+   box->y = replay_member_int(v, "y");
+   box->z = replay_member_int(v, "z");
+   box->width = replay_member_int(v, "width");
+   box->height = replay_member_int(v, "height");
+   box->depth = replay_member_int(v, "depth");
+}
+
+
+static void
+replay_decode_scissor(const struct replay_value *v,
+                      struct pipe_scissor_state *state)
+{
+   state->minx = replay_member_uint(v, "minx");
+   state->miny = replay_member_uint(v, "miny");
+   state->maxx = replay_member_uint(v, "maxx");
+   state->maxy = replay_member_uint(v, "maxy");
+}
+
+
+static void
+replay_decode_resource_template(const struct replay_value *v,
+                                struct pipe_resource *templ)
+{
+   memset(templ, 0, sizeof(*templ));
+   templ->target = replay_member_uint(v, "target");
+   templ->format = replay_format(replay_member(v, "format"));
+   templ->width0 = replay_member_uint(v, "width");
+   templ->height0 = replay_member_uint(v, "height");
+   templ->depth0 = replay_member_uint(v, "depth");
+   templ->array_size = replay_member_uint(v, "array_size");
+   templ->last_level = replay_member_uint(v, "last_level");
+   templ->nr_samples = replay_member_uint(v, "nr_samples");
+   templ->usage = replay_member_uint(v, "usage");
+   templ->bind = replay_member_uint(v, "bind");
+   templ->flags = replay_member_uint(v, "flags");
+}
+
+
+/*
+ * pipe_screen
+ */
+
+static void
+replay_context_create(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe;
+
+   if (replay_reuse(r, call))
+      return;
+
+   pipe = r->screen->context_create(r->screen, NULL);
+   replay_add_object(r, call, REPLAY_OBJECT_CONTEXT, pipe, pipe);
+}
+
+
+static void
+replay_resource_create(struct replay *r, struct replay_call *call)
+{
+   struct pipe_resource templ;
+
+   replay_decode_resource_template(replay_arg(call, "templat"), &templ);
+   replay_add_object(r, call, REPLAY_OBJECT_RESOURCE,
+                     r->screen->resource_create(r->screen, &templ), NULL);
+}
+
+
+static void
+replay_resource_destroy(struct replay *r, struct replay_call *call)
+{
+   replay_delete(r, call, "resource", REPLAY_OBJECT_RESOURCE);
+}
+
+
+static void
+replay_flush_frontbuffer(struct replay *r, struct replay_call *call)
+{
+   /* there is no window to present to */
+   if (!r->flush_frame_ends)
+      r->end_of_frame = TRUE;
+}
+
+
+static void
+replay_fence_finish(struct replay *r, struct replay_call *call)
+{
+   struct pipe_fence_handle *fence;
+
+   fence = replay_get(r, replay_arg(call, "fence"), REPLAY_OBJECT_FENCE);
+   if (fence)
+      r->screen->fence_finish(r->screen, fence,
+                              replay_uint(replay_arg(call, "timeout")));
+}
+
+
+static void
+replay_fence_signalled(struct replay *r, struct replay_call *call)
+{
+   struct pipe_fence_handle *fence;
+
+   fence = replay_get(r, replay_arg(call, "fence"), REPLAY_OBJECT_FENCE);
+   if (fence)
+      r->screen->fence_signalled(r->screen, fence);
+}
+
+
+/*
+ * pipe_context
+ */
+
+static void
+replay_draw_vbo(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "info");
+   struct replay_object *ctx = replay_context(r, call);
+   struct pipe_draw_info info;
+
+   memset(&info, 0, sizeof(info));
+   info.indexed = replay_member_uint(v, "indexed");
+   info.mode = replay_member_uint(v, "mode");
+   info.start = replay_member_uint(v, "start");
+   info.count = replay_member_uint(v, "count");
+   info.start_instance = replay_member_uint(v, "start_instance");
+   info.instance_count = replay_member_uint(v, "instance_count");
+   info.index_bias = replay_member_int(v, "index_bias");
+   info.min_index = replay_member_uint(v, "min_index");
+   info.max_index = replay_member_uint(v, "max_index");
+   info.primitive_restart = replay_member_uint(v, "primitive_restart");
+   info.restart_index = replay_member_uint(v, "restart_index");
+   info.count_from_stream_output =
+      replay_get(r, replay_member(v, "count_from_stream_output"),
+                 REPLAY_OBJECT_SO_TARGET);
+   info.indirect = replay_get(r, replay_member(v, "indirect"),
+                              REPLAY_OBJECT_RESOURCE);
+   info.indirect_offset = replay_member_uint(v, "indirect_offset");
+
+   if (r->skip)
+      return;
+
+   if (ctx->user_buffers) {
+      r->skip = TRUE;
+      return;
+   }
+
+   ctx->pipe->draw_vbo(ctx->pipe, &info);
+}
+
+
+static void
+replay_create_query(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "query_type");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   unsigned type;
+
+   if (r->skip)
+      return;
+
+   /* driver specific queries can't be identified */
+   for (type = 0; type < PIPE_QUERY_TYPES; type++) {
+      if (v && v->type == REPLAY_ENUM &&
+          strcmp(util_dump_query_type(type, FALSE), v->u.str) == 0)
+         break;
+   }
+   if (type == PIPE_QUERY_TYPES) {
+      r->skip = TRUE;
+      return;
+   }
+
+   replay_add_object(r, call, REPLAY_OBJECT_QUERY,
+                     pipe->create_query(pipe, type,
+                                        replay_uint(replay_arg(call, "index"))),
+                     pipe);
+}
+
+
+static void
+replay_destroy_query(struct replay *r, struct replay_call *call)
+{
+   replay_delete(r, call, "query", REPLAY_OBJECT_QUERY);
+}
+
+
+static void
+replay_begin_query(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_query *query;
+
+   query = replay_get(r, replay_arg(call, "query"), REPLAY_OBJECT_QUERY);
+   if (!r->skip && query)
+      pipe->begin_query(pipe, query);
+}
+
+
+static void
+replay_end_query(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_query *query;
+
+   query = replay_get(r, replay_arg(call, "query"), REPLAY_OBJECT_QUERY);
+   if (!r->skip && query)
+      pipe->end_query(pipe, query);
+}
+
+
+static void
+replay_get_query_result(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   union pipe_query_result result;
+   struct pipe_query *query;
+
+   query = replay_get(r, replay_arg(call, "query"), REPLAY_OBJECT_QUERY);
+   if (r->skip || !query)
+      return;
+
+   /* wait if the application got the result */
+   pipe->get_query_result(pipe, query, replay_uint(call->ret) != 0, &result);
+}
+
+
+static void
+replay_render_condition(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_query *query;
+
+   query = replay_get(r, replay_arg(call, "query"), REPLAY_OBJECT_QUERY);
+   if (r->skip)
+      return;
+
+   pipe->render_condition(pipe, query,
+                          replay_uint(replay_arg(call, "condition")),
+                          replay_uint(replay_arg(call, "mode")));
+}
+
+
+static void
+replay_create_blend_state(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "state");
+   struct pipe_blend_state state;
+   struct pipe_context *pipe;
+   unsigned i;
+
+   if (replay_reuse(r, call))
+      return;
+
+   pipe = replay_pipe(r, call);
+   if (r->skip)
+      return;
+
+   memset(&state, 0, sizeof(state));
+   state.dither = replay_member_uint(v, "dither");
+   state.logicop_enable = replay_member_uint(v, "logicop_enable");
+   state.logicop_func = replay_member_uint(v, "logicop_func");
+   state.independent_blend_enable =
+      replay_member_uint(v, "independent_blend_enable");
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      const struct replay_value *rt = replay_elem(replay_member(v, "rt"), i);
+
+      if (!rt)
+         break;
+
+      state.rt[i].blend_enable = replay_member_uint(rt, "blend_enable");
+      state.rt[i].rgb_func = replay_member_uint(rt, "rgb_func");
+      state.rt[i].rgb_src_factor = replay_member_uint(rt, "rgb_src_factor");
+      state.rt[i].rgb_dst_factor = replay_member_uint(rt, "rgb_dst_factor");
+      state.rt[i].alpha_func = replay_member_uint(rt, "alpha_func");
+      state.rt[i].alpha_src_factor =
+         replay_member_uint(rt, "alpha_src_factor");
+      state.rt[i].alpha_dst_factor =
+         replay_member_uint(rt, "alpha_dst_factor");
+      state.rt[i].colormask = replay_member_uint(rt, "colormask");
+   }
+
+   replay_add_object(r, call, REPLAY_OBJECT_BLEND,
+                     pipe->create_blend_state(pipe, &state), pipe);
+}
+
+
+static void
+replay_create_sampler_state(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "state");
+   struct pipe_sampler_state state;
+   struct pipe_context *pipe;
+
+   if (replay_reuse(r, call))
+      return;
+
+   pipe = replay_pipe(r, call);
+   if (r->skip)
+      return;
+
+   memset(&state, 0, sizeof(state));
+   state.wrap_s = replay_member_uint(v, "wrap_s");
+   state.wrap_t = replay_member_uint(v, "wrap_t");
+   state.wrap_r = replay_member_uint(v, "wrap_r");
+   state.min_img_filter = replay_member_uint(v, "min_img_filter");
+   state.min_mip_filter = replay_member_uint(v, "min_mip_filter");
+   state.mag_img_filter = replay_member_uint(v, "mag_img_filter");
+   state.compare_mode = replay_member_uint(v, "compare_mode");
+   state.compare_func = replay_member_uint(v, "compare_func");
+   state.normalized_coords = replay_member_uint(v, "normalized_coords");
+   state.max_anisotropy = replay_member_uint(v, "max_anisotropy");
+   state.seamless_cube_map = replay_member_uint(v, "seamless_cube_map");
+   state.lod_bias = replay_member_float(v, "lod_bias");
+   state.min_lod = replay_member_float(v, "min_lod");
+   state.max_lod = replay_member_float(v, "max_lod");
+   replay_floats(replay_member(v, "border_color.f"), state.border_color.f, 4);
+
+   replay_add_object(r, call, REPLAY_OBJECT_SAMPLER,
+                     pipe->create_sampler_state(pipe, &state), pipe);
+}
+
+
+static void
+replay_create_rasterizer_state(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "state");
+   struct pipe_rasterizer_state state;
+   struct pipe_context *pipe;
+
+   if (replay_reuse(r, call))
+      return;
+
+   pipe = replay_pipe(r, call);
+   if (r->skip)
+      return;
+
+   memset(&state, 0, sizeof(state));
+   state.flatshade = replay_member_uint(v, "flatshade");
+   state.light_twoside = replay_member_uint(v, "light_twoside");
+   state.clamp_vertex_color = replay_member_uint(v, "clamp_vertex_color");
+   state.clamp_fragment_color = replay_member_uint(v, "clamp_fragment_color");
+   state.front_ccw = replay_member_uint(v, "front_ccw");
+   state.cull_face = replay_member_uint(v, "cull_face");
+   state.fill_front = replay_member_uint(v, "fill_front");
+   state.fill_back = replay_member_uint(v, "fill_back");
+   state.offset_point = replay_member_uint(v, "offset_point");
+   state.offset_line = replay_member_uint(v, "offset_line");
+   state.offset_tri = replay_member_uint(v, "offset_tri");
+   state.scissor = replay_member_uint(v, "scissor");
+   state.poly_smooth = replay_member_uint(v, "poly_smooth");
+   state.poly_stipple_enable = replay_member_uint(v, "poly_stipple_enable");
+   state.point_smooth = replay_member_uint(v, "point_smooth");
+   state.sprite_coord_mode = replay_member_uint(v, "sprite_coord_mode");
+   state.point_quad_rasterization =
+      replay_member_uint(v, "point_quad_rasterization");
+   state.point_size_per_vertex =
+      replay_member_uint(v, "point_size_per_vertex");
+   state.multisample = replay_member_uint(v, "multisample");
+   state.line_smooth = replay_member_uint(v, "line_smooth");
+   state.line_stipple_enable = replay_member_uint(v, "line_stipple_enable");
+   state.line_last_pixel = replay_member_uint(v, "line_last_pixel");
+   state.flatshade_first = replay_member_uint(v, "flatshade_first");
+   state.half_pixel_center = replay_member_uint(v, "half_pixel_center");
+   state.bottom_edge_rule = replay_member_uint(v, "bottom_edge_rule");
+   state.rasterizer_discard = replay_member_uint(v, "rasterizer_discard");
+   state.depth_clip = replay_member_uint(v, "depth_clip");
+   state.clip_halfz = replay_member_uint(v, "clip_halfz");
+   state.clip_plane_enable = replay_member_uint(v, "clip_plane_enable");
+   state.line_stipple_factor = replay_member_uint(v, "line_stipple_factor");
+   state.line_stipple_pattern = replay_member_uint(v, "line_stipple_pattern");
+   state.sprite_coord_enable = replay_member_uint(v, "sprite_coord_enable");
+   state.line_width = replay_member_float(v, "line_width");
+   state.point_size = replay_member_float(v, "point_size");
+   state.offset_units = replay_member_float(v, "offset_units");
+   state.offset_scale = replay_member_float(v, "offset_scale");
+   state.offset_clamp = replay_member_float(v, "offset_clamp");
+
+   replay_add_object(r, call, REPLAY_OBJECT_RASTERIZER,
+                     pipe->create_rasterizer_state(pipe, &state), pipe);
+}
+
+
+static void
+replay_create_depth_stencil_alpha_state(struct replay *r,
+                                        struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "state");
+   const struct replay_value *depth, *alpha;
+   struct pipe_depth_stencil_alpha_state state;
+   struct pipe_context *pipe;
+   unsigned i;
+
+   if (replay_reuse(r, call))
+      return;
+
+   pipe = replay_pipe(r, call);
+   if (r->skip)
+      return;
+
+   memset(&state, 0, sizeof(state));
+
+   depth = replay_member(v, "depth");
+   state.depth.enabled = replay_member_uint(depth, "enabled");
+   state.depth.writemask = replay_member_uint(depth, "writemask");
+   state.depth.func = replay_member_uint(depth, "func");
+
+   for (i = 0; i < 2; i++) {
+      const struct replay_value *s = replay_elem(replay_member(v, "stencil"),
+                                                 i);
+
+      state.stencil[i].enabled = replay_member_uint(s, "enabled");
+      state.stencil[i].func = replay_member_uint(s, "func");
+      state.stencil[i].fail_op = replay_member_uint(s, "fail_op");
+      state.stencil[i].zpass_op = replay_member_uint(s, "zpass_op");
+      state.stencil[i].zfail_op = replay_member_uint(s, "zfail_op");
+      state.stencil[i].valuemask = replay_member_uint(s, "valuemask");
+      state.stencil[i].writemask = replay_member_uint(s, "writemask");
+   }
+
+   alpha = replay_member(v, "alpha");
+   state.alpha.enabled = replay_member_uint(alpha, "enabled");
+   state.alpha.func = replay_member_uint(alpha, "func");
+   state.alpha.ref_value = replay_member_float(alpha, "ref_value");
+
+   replay_add_object(r, call, REPLAY_OBJECT_DSA,
+                     pipe->create_depth_stencil_alpha_state(pipe, &state),
+                     pipe);
+}
+
+
+/**
+ * Translate the TGSI text of a shader, once for all the loops.
+ */
+static const struct tgsi_token *
+replay_shader_tokens(struct replay_call *call, const struct replay_value *text)
+{
+   struct tgsi_token *tokens;
+   unsigned n;
+
+   if (call->data)
+      return call->data;
+
+   if (!text || text->type != REPLAY_STRING)
+      return NULL;
+
+   tokens = MALLOC(REPLAY_MAX_SHADER_TOKENS * sizeof(tokens[0]));
+   if (!tokens)
+      return NULL;
+
+   if (!tgsi_text_translate(text->u.str, tokens, REPLAY_MAX_SHADER_TOKENS)) {
+      FREE(tokens);
+      return NULL;
+   }
+
+   n = tgsi_num_tokens(tokens);
+   call->data = REALLOC(tokens, REPLAY_MAX_SHADER_TOKENS * sizeof(tokens[0]),
+                        n * sizeof(tokens[0]));
+   if (!call->data)
+      call->data = tokens;
+   return call->data;
+}
+
+
+static void
+replay_create_shader(struct replay *r, struct replay_call *call,
+                     enum replay_object_type type)
+{
+   const struct replay_value *v = replay_arg(call, "state");
+   const struct replay_value *so = replay_member(v, "stream_output");
+   struct pipe_shader_state state;
+   struct pipe_context *pipe;
+   void *shader = NULL;
+   unsigned i;
+
+   if (replay_reuse(r, call))
+      return;
+
+   pipe = replay_pipe(r, call);
+   if (r->skip)
+      return;
+
+   memset(&state, 0, sizeof(state));
+   state.tokens = replay_shader_tokens(call, replay_member(v, "tokens"));
+   if (!state.tokens) {
+      r->skip = TRUE;
+      return;
+   }
+
+   state.stream_output.num_outputs =
+      MIN2(replay_member_uint(so, "num_outputs"), PIPE_MAX_SO_OUTPUTS);
+   replay_uints(replay_member(so, "stride"), state.stream_output.stride,
+                PIPE_MAX_SO_BUFFERS);
+   for (i = 0; i < state.stream_output.num_outputs; i++) {
+      const struct replay_value *out = replay_elem(replay_member(so, "output"),
+                                                   i);
+
+      state.stream_output.output[i].register_index =
+         replay_member_uint(out, "register_index");
+      state.stream_output.output[i].start_component =
+         replay_member_uint(out, "start_component");
+      state.stream_output.output[i].num_components =
+         replay_member_uint(out, "num_components");
+      state.stream_output.output[i].output_buffer =
+         replay_member_uint(out, "output_buffer");
+      state.stream_output.output[i].dst_offset =
+         replay_member_uint(out, "dst_offset");
+      state.stream_output.output[i].stream =
+         replay_member_uint(out, "stream");
+   }
+
+   switch (type) {
+   case REPLAY_OBJECT_FS:
+      shader = pipe->create_fs_state(pipe, &state);
+      break;
+   case REPLAY_OBJECT_VS:
+      shader = pipe->create_vs_state(pipe, &state);
+      break;
+   case REPLAY_OBJECT_GS:
+      if (pipe->create_gs_state)
+         shader = pipe->create_gs_state(pipe, &state);
+      break;
+   default:
+      assert(0);
+   }
+
+   if (!shader)
+      r->skip = TRUE;
+
+   replay_add_object(r, call, type, shader, pipe);
+}
+
+
+static void
+replay_create_vertex_elements_state(struct replay *r,
+                                    struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "elements");
+   struct pipe_vertex_element elements[PIPE_MAX_ATTRIBS];
+   struct pipe_context *pipe;
+   unsigned i, n;
+
+   if (replay_reuse(r, call))
+      return;
+
+   pipe = replay_pipe(r, call);
+   if (r->skip)
+      return;
+
+   n = MIN2(replay_uint(replay_arg(call, "num_elements")), PIPE_MAX_ATTRIBS);
+   for (i = 0; i < n; i++) {
+      const struct replay_value *e = replay_elem(v, i);
+
+      elements[i].src_offset = replay_member_uint(e, "src_offset");
+      elements[i].instance_divisor = replay_member_uint(e, "instance_divisor");
+      elements[i].vertex_buffer_index =
+         replay_member_uint(e, "vertex_buffer_index");
+      elements[i].src_format = replay_format(replay_member(e, "src_format"));
+   }
+
+   replay_add_object(r, call, REPLAY_OBJECT_VELEMS,
+                     pipe->create_vertex_elements_state(pipe, n, elements),
+                     pipe);
+}
+
+
+static void
+replay_bind(struct replay *r, struct replay_call *call,
+            enum replay_object_type type)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   void *state = replay_get(r, replay_arg(call, "state"), type);
+
+   if (r->skip)
+      return;
+
+   switch (type) {
+   case REPLAY_OBJECT_BLEND:
+      pipe->bind_blend_state(pipe, state);
+      break;
+   case REPLAY_OBJECT_RASTERIZER:
+      pipe->bind_rasterizer_state(pipe, state);
+      break;
+   case REPLAY_OBJECT_DSA:
+      pipe->bind_depth_stencil_alpha_state(pipe, state);
+      break;
+   case REPLAY_OBJECT_FS:
+      pipe->bind_fs_state(pipe, state);
+      break;
+   case REPLAY_OBJECT_VS:
+      pipe->bind_vs_state(pipe, state);
+      break;
+   case REPLAY_OBJECT_GS:
+      if (pipe->bind_gs_state)
+         pipe->bind_gs_state(pipe, state);
+      break;
+   case REPLAY_OBJECT_VELEMS:
+      pipe->bind_vertex_elements_state(pipe, state);
+      break;
+   default:
+      assert(0);
+   }
+}
+
+
+#define REPLAY_STATE(name, TYPE) \
+   static void \
+   replay_bind_##name(struct replay *r, struct replay_call *call) \
+   { \
+      replay_bind(r, call, REPLAY_OBJECT_##TYPE); \
+   } \
+   \
+   static void \
+   replay_delete_##name(struct replay *r, struct replay_call *call) \
+   { \
+      replay_delete(r, call, "state", REPLAY_OBJECT_##TYPE); \
+   }
+
+REPLAY_STATE(blend_state, BLEND)
+REPLAY_STATE(rasterizer_state, RASTERIZER)
+REPLAY_STATE(depth_stencil_alpha_state, DSA)
+REPLAY_STATE(fs_state, FS)
+REPLAY_STATE(vs_state, VS)
+REPLAY_STATE(gs_state, GS)
+REPLAY_STATE(vertex_elements_state, VELEMS)
+
+#undef REPLAY_STATE
+
+
+#define REPLAY_SHADER(shader_type, TYPE) \
+   static void \
+   replay_create_##shader_type##_state(struct replay *r, \
+                                       struct replay_call *call) \
+   { \
+      replay_create_shader(r, call, REPLAY_OBJECT_##TYPE); \
+   }
+
+REPLAY_SHADER(fs, FS)
+REPLAY_SHADER(vs, VS)
+REPLAY_SHADER(gs, GS)
+
+#undef REPLAY_SHADER
+
+
+static void
+replay_delete_sampler_state(struct replay *r, struct replay_call *call)
+{
+   replay_delete(r, call, "state", REPLAY_OBJECT_SAMPLER);
+}
+
+
+static void
+replay_bind_sampler_states(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "states");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   void *states[PIPE_MAX_SAMPLERS];
+   unsigned i, n;
+
+   n = MIN2(replay_uint(replay_arg(call, "num_states")), PIPE_MAX_SAMPLERS);
+   for (i = 0; i < n; i++)
+      states[i] = replay_get(r, replay_elem(v, i), REPLAY_OBJECT_SAMPLER);
+
+   if (r->skip)
+      return;
+
+   pipe->bind_sampler_states(pipe, replay_uint(replay_arg(call, "shader")),
+                             replay_uint(replay_arg(call, "start")), n,
+                             states);
+}
+
+
+static void
+replay_set_blend_color(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_blend_color state;
+
+   if (r->skip)
+      return;
+
+   replay_floats(replay_member(replay_arg(call, "state"), "color"),
+                 state.color, 4);
+   pipe->set_blend_color(pipe, &state);
+}
+
+
+static void
+replay_set_stencil_ref(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_stencil_ref state;
+   unsigned ref_value[2];
+
+   if (r->skip)
+      return;
+
+   replay_uints(replay_member(replay_arg(call, "state"), "ref_value"),
+                ref_value, 2);
+   state.ref_value[0] = ref_value[0];
+   state.ref_value[1] = ref_value[1];
+   pipe->set_stencil_ref(pipe, &state);
+}
+
+
+static void
+replay_set_clip_state(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *ucp;
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_clip_state state;
+   unsigned i;
+
+   if (r->skip)
+      return;
+
+   ucp = replay_member(replay_arg(call, "state"), "ucp");
+   for (i = 0; i < PIPE_MAX_CLIP_PLANES; i++)
+      replay_floats(replay_elem(ucp, i), state.ucp[i], 4);
+
+   pipe->set_clip_state(pipe, &state);
+}
+
+
+static void
+replay_set_sample_mask(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+
+   if (r->skip)
+      return;
+
+   pipe->set_sample_mask(pipe, replay_uint(replay_arg(call, "sample_mask")));
+}
+
+
+static void
+replay_set_constant_buffer(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "constant_buffer");
+   const struct replay_value *user;
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_constant_buffer cb;
+
+   memset(&cb, 0, sizeof(cb));
+   cb.buffer = replay_get(r, replay_member(v, "buffer"),
+                          REPLAY_OBJECT_RESOURCE);
+   cb.buffer_offset = replay_member_uint(v, "buffer_offset");
+   cb.buffer_size = replay_member_uint(v, "buffer_size");
+
+   user = replay_member(v, "user_buffer");
+   if (user && user->type == REPLAY_BYTES) {
+      cb.user_buffer = user->u.data;
+      cb.buffer_size = MIN2(cb.buffer_size, user->num);
+   }
+
+   if (r->skip)
+      return;
+
+   /* traces from before the user constants were recorded */
+   if (v && v->type == REPLAY_STRUCT && !cb.buffer && !cb.user_buffer) {
+      r->skip = TRUE;
+      return;
+   }
+
+   pipe->set_constant_buffer(pipe, replay_uint(replay_arg(call, "shader")),
+                             replay_uint(replay_arg(call, "index")),
+                             v && v->type == REPLAY_STRUCT ? &cb : NULL);
+}
+
+
+static void
+replay_set_framebuffer_state(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "state");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_framebuffer_state state;
+   unsigned i;
+
+   memset(&state, 0, sizeof(state));
+   state.width = replay_member_uint(v, "width");
+   state.height = replay_member_uint(v, "height");
+   state.nr_cbufs = MIN2(replay_member_uint(v, "nr_cbufs"),
+                         PIPE_MAX_COLOR_BUFS);
+   for (i = 0; i < state.nr_cbufs; i++)
+      state.cbufs[i] = replay_get(r, replay_elem(replay_member(v, "cbufs"), i),
+                                  REPLAY_OBJECT_SURFACE);
+   state.zsbuf = replay_get(r, replay_member(v, "zsbuf"),
+                            REPLAY_OBJECT_SURFACE);
+
+   if (r->skip)
+      return;
+
+   pipe->set_framebuffer_state(pipe, &state);
+}
+
+
+static void
+replay_set_polygon_stipple(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_poly_stipple state;
+
+   if (r->skip)
+      return;
+
+   replay_uints(replay_member(replay_arg(call, "state"), "stipple"),
+                state.stipple, 32);
+   pipe->set_polygon_stipple(pipe, &state);
+}
+
+
+/* The trace only has the first of the scissors and viewports. */
+
+static void
+replay_set_scissor_states(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_scissor_state states[PIPE_MAX_VIEWPORTS];
+   unsigned i, n;
+
+   if (r->skip)
+      return;
+
+   n = MIN2(replay_uint(replay_arg(call, "num_scissors")), PIPE_MAX_VIEWPORTS);
+   for (i = 0; i < n; i++)
+      replay_decode_scissor(replay_arg(call, "states"), &states[i]);
+
+   pipe->set_scissor_states(pipe, replay_uint(replay_arg(call, "start_slot")),
+                            n, states);
+}
+
+
+static void
+replay_set_viewport_states(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "states");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_viewport_state states[PIPE_MAX_VIEWPORTS];
+   unsigned i, n;
+
+   if (r->skip)
+      return;
+
+   n = MIN2(replay_uint(replay_arg(call, "num_viewports")),
+            PIPE_MAX_VIEWPORTS);
+   for (i = 0; i < n; i++) {
+      replay_floats(replay_member(v, "scale"), states[i].scale, 4);
+      replay_floats(replay_member(v, "translate"), states[i].translate, 4);
+   }
+
+   pipe->set_viewport_states(pipe,
+                             replay_uint(replay_arg(call, "start_slot")),
+                             n, states);
+}
+
+
+static void
+replay_create_sampler_view(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "templ");
+   const struct replay_value *u = replay_member(v, "u");
+   const struct replay_value *buf = replay_member(u, "buf");
+   const struct replay_value *tex = replay_member(u, "tex");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_resource *resource;
+   struct pipe_sampler_view templ;
+
+   resource = replay_get(r, replay_arg(call, "resource"),
+                         REPLAY_OBJECT_RESOURCE);
+   if (r->skip || !resource)
+      return;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.format = replay_format(replay_member(v, "format"));
+   if (buf) {
+      templ.u.buf.first_element = replay_member_uint(buf, "first_element");
+      templ.u.buf.last_element = replay_member_uint(buf, "last_element");
+   }
+   else {
+      templ.u.tex.first_layer = replay_member_uint(tex, "first_layer");
+      templ.u.tex.last_layer = replay_member_uint(tex, "last_layer");
+      templ.u.tex.first_level = replay_member_uint(tex, "first_level");
+      templ.u.tex.last_level = replay_member_uint(tex, "last_level");
+   }
+   templ.swizzle_r = replay_member_uint(v, "swizzle_r");
+   templ.swizzle_g = replay_member_uint(v, "swizzle_g");
+   templ.swizzle_b = replay_member_uint(v, "swizzle_b");
+   templ.swizzle_a = replay_member_uint(v, "swizzle_a");
+
+   replay_add_object(r, call, REPLAY_OBJECT_SAMPLER_VIEW,
+                     pipe->create_sampler_view(pipe, resource, &templ), pipe);
+}
+
+
+static void
+replay_sampler_view_destroy(struct replay *r, struct replay_call *call)
+{
+   replay_delete(r, call, "view", REPLAY_OBJECT_SAMPLER_VIEW);
+}
+
+
+static void
+replay_create_surface(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "surf_tmpl");
+   const struct replay_value *u = replay_member(v, "u");
+   const struct replay_value *buf = replay_member(u, "buf");
+   const struct replay_value *tex = replay_member(u, "tex");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_resource *resource;
+   struct pipe_surface templ;
+
+   resource = replay_get(r, replay_arg(call, "resource"),
+                         REPLAY_OBJECT_RESOURCE);
+   if (r->skip || !resource)
+      return;
+
+   memset(&templ, 0, sizeof(templ));
+   templ.format = replay_format(replay_member(v, "format"));
+   templ.width = replay_member_uint(v, "width");
+   templ.height = replay_member_uint(v, "height");
+   if (buf) {
+      templ.u.buf.first_element = replay_member_uint(buf, "first_element");
+      templ.u.buf.last_element = replay_member_uint(buf, "last_element");
+   }
+   else {
+      templ.u.tex.level = replay_member_uint(tex, "level");
+      templ.u.tex.first_layer = replay_member_uint(tex, "first_layer");
+      templ.u.tex.last_layer = replay_member_uint(tex, "last_layer");
+   }
+
+   replay_add_object(r, call, REPLAY_OBJECT_SURFACE,
+                     pipe->create_surface(pipe, resource, &templ), pipe);
+}
+
+
+static void
+replay_surface_destroy(struct replay *r, struct replay_call *call)
+{
+   replay_delete(r, call, "surface", REPLAY_OBJECT_SURFACE);
+}
+
+
+static void
+replay_set_sampler_views(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "views");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_sampler_view *views[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   unsigned i, n;
+
+   n = MIN2(replay_uint(replay_arg(call, "num")),
+            PIPE_MAX_SHADER_SAMPLER_VIEWS);
+   for (i = 0; i < n; i++)
+      views[i] = replay_get(r, replay_elem(v, i), REPLAY_OBJECT_SAMPLER_VIEW);
+
+   if (r->skip)
+      return;
+
+   pipe->set_sampler_views(pipe, replay_uint(replay_arg(call, "shader")),
+                           replay_uint(replay_arg(call, "start")), n, views);
+}
+
+
+static void
+replay_set_vertex_buffers(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "buffers");
+   struct replay_object *ctx = replay_context(r, call);
+   struct pipe_vertex_buffer buffers[PIPE_MAX_ATTRIBS];
+   unsigned start_slot = replay_uint(replay_arg(call, "start_slot"));
+   unsigned i, n;
+
+   n = replay_uint(replay_arg(call, "num_buffers"));
+   if (start_slot >= PIPE_MAX_ATTRIBS || n > PIPE_MAX_ATTRIBS - start_slot) {
+      r->skip = TRUE;
+      return;
+   }
+
+   memset(buffers, 0, sizeof(buffers));
+   for (i = 0; i < n; i++) {
+      const struct replay_value *vb = replay_elem(v, i);
+
+      buffers[i].stride = replay_member_uint(vb, "stride");
+      buffers[i].buffer_offset = replay_member_uint(vb, "buffer_offset");
+      buffers[i].buffer = replay_get(r, replay_member(vb, "buffer"),
+                                     REPLAY_OBJECT_RESOURCE);
+   }
+
+   if (r->skip)
+      return;
+
+   for (i = 0; i < n; i++) {
+      const struct replay_value *user =
+         replay_member(replay_elem(v, i), "user_buffer");
+
+      if (user && user->type == REPLAY_PTR)
+         ctx->user_buffers |= 1u << (start_slot + i);
+      else
+         ctx->user_buffers &= ~(1u << (start_slot + i));
+   }
+
+   ctx->pipe->set_vertex_buffers(ctx->pipe, start_slot, n,
+                                 v && v->type == REPLAY_ARRAY ? buffers
+                                                              : NULL);
+}
+
+
+static void
+replay_set_index_buffer(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "ib");
+   struct replay_object *ctx = replay_context(r, call);
+   const struct replay_value *user = replay_member(v, "user_buffer");
+   struct pipe_index_buffer ib;
+
+   memset(&ib, 0, sizeof(ib));
+   ib.index_size = replay_member_uint(v, "index_size");
+   ib.offset = replay_member_uint(v, "offset");
+   ib.buffer = replay_get(r, replay_member(v, "buffer"),
+                          REPLAY_OBJECT_RESOURCE);
+
+   if (r->skip)
+      return;
+
+   if (user && user->type == REPLAY_PTR)
+      ctx->user_buffers |= REPLAY_USER_INDEX_BUFFER;
+   else
+      ctx->user_buffers &= ~REPLAY_USER_INDEX_BUFFER;
+
+   ctx->pipe->set_index_buffer(ctx->pipe,
+                               v && v->type == REPLAY_STRUCT ? &ib : NULL);
+}
+
+
+static void
+replay_create_stream_output_target(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_resource *res;
+
+   res = replay_get(r, replay_arg(call, "res"), REPLAY_OBJECT_RESOURCE);
+   if (r->skip || !res)
+      return;
+
+   replay_add_object(r, call, REPLAY_OBJECT_SO_TARGET,
+                     pipe->create_stream_output_target(
+                        pipe, res,
+                        replay_uint(replay_arg(call, "buffer_offset")),
+                        replay_uint(replay_arg(call, "buffer_size"))),
+                     pipe);
+}
+
+
+static void
+replay_stream_output_target_destroy(struct replay *r,
+                                    struct replay_call *call)
+{
+   replay_delete(r, call, "target", REPLAY_OBJECT_SO_TARGET);
+}
+
+
+static void
+replay_set_stream_output_targets(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_stream_output_target *targets[PIPE_MAX_SO_BUFFERS];
+   unsigned offsets[PIPE_MAX_SO_BUFFERS];
+   unsigned i, n;
+
+   n = MIN2(replay_uint(replay_arg(call, "num_targets")),
+            PIPE_MAX_SO_BUFFERS);
+   for (i = 0; i < n; i++)
+      targets[i] = replay_get(r, replay_elem(replay_arg(call, "tgs"), i),
+                              REPLAY_OBJECT_SO_TARGET);
+   replay_uints(replay_arg(call, "offsets"), offsets, n);
+
+   if (r->skip)
+      return;
+
+   pipe->set_stream_output_targets(pipe, n, targets, offsets);
+}
+
+
+static void
+replay_resource_copy_region(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_resource *dst, *src;
+   struct pipe_box box;
+
+   dst = replay_get(r, replay_arg(call, "dst"), REPLAY_OBJECT_RESOURCE);
+   src = replay_get(r, replay_arg(call, "src"), REPLAY_OBJECT_RESOURCE);
+   if (r->skip || !dst || !src)
+      return;
+
+   replay_decode_box(replay_arg(call, "src_box"), &box);
+   pipe->resource_copy_region(pipe, dst,
+                              replay_uint(replay_arg(call, "dst_level")),
+                              replay_uint(replay_arg(call, "dstx")),
+                              replay_uint(replay_arg(call, "dsty")),
+                              replay_uint(replay_arg(call, "dstz")),
+                              src,
+                              replay_uint(replay_arg(call, "src_level")),
+                              &box);
+}
+
+
+static void
+replay_blit(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "_info");
+   const struct replay_value *dst = replay_member(v, "dst");
+   const struct replay_value *src = replay_member(v, "src");
+   const struct replay_value *mask = replay_member(v, "mask");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_blit_info info;
+
+   memset(&info, 0, sizeof(info));
+   info.dst.resource = replay_get(r, replay_member(dst, "resource"),
+                                  REPLAY_OBJECT_RESOURCE);
+   info.dst.level = replay_member_uint(dst, "level");
+   info.dst.format = replay_format(replay_member(dst, "format"));
+   replay_decode_box(replay_member(dst, "box"), &info.dst.box);
+
+   info.src.resource = replay_get(r, replay_member(src, "resource"),
+                                  REPLAY_OBJECT_RESOURCE);
+   info.src.level = replay_member_uint(src, "level");
+   info.src.format = replay_format(replay_member(src, "format"));
+   replay_decode_box(replay_member(src, "box"), &info.src.box);
+
+   if (mask && mask->type == REPLAY_STRING) {
+      static const unsigned bits[6] = {
+         PIPE_MASK_R, PIPE_MASK_G, PIPE_MASK_B, PIPE_MASK_A,
+         PIPE_MASK_Z, PIPE_MASK_S
+      };
+      unsigned i;
+
+      for (i = 0; i < 6 && mask->u.str[i]; i++) {
+         if (mask->u.str[i] != '-')
+            info.mask |= bits[i];
+      }
+   }
+
+   info.filter = replay_member_uint(v, "filter");
+   info.scissor_enable = replay_member_uint(v, "scissor_enable");
+   replay_decode_scissor(replay_member(v, "scissor"), &info.scissor);
+
+   if (r->skip || !info.dst.resource || !info.src.resource)
+      return;
+
+   pipe->blit(pipe, &info);
+}
+
+
+static void
+replay_flush_resource(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_resource *resource;
+
+   resource = replay_get(r, replay_arg(call, "resource"),
+                         REPLAY_OBJECT_RESOURCE);
+   if (r->skip || !resource)
+      return;
+
+   pipe->flush_resource(pipe, resource);
+}
+
+
+static void
+replay_clear(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *v = replay_arg(call, "color");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   union pipe_color_union color;
+
+   if (r->skip)
+      return;
+
+   replay_floats(v, color.f, 4);
+   pipe->clear(pipe, replay_uint(replay_arg(call, "buffers")),
+               v && v->type == REPLAY_ARRAY ? &color : NULL,
+               replay_float(replay_arg(call, "depth")),
+               replay_uint(replay_arg(call, "stencil")));
+}
+
+
+static void
+replay_clear_render_target(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_surface *dst;
+   union pipe_color_union color;
+
+   dst = replay_get(r, replay_arg(call, "dst"), REPLAY_OBJECT_SURFACE);
+   if (r->skip || !dst)
+      return;
+
+   replay_floats(replay_arg(call, "color->f"), color.f, 4);
+   pipe->clear_render_target(pipe, dst, &color,
+                             replay_uint(replay_arg(call, "dstx")),
+                             replay_uint(replay_arg(call, "dsty")),
+                             replay_uint(replay_arg(call, "width")),
+                             replay_uint(replay_arg(call, "height")));
+}
+
+
+static void
+replay_clear_depth_stencil(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_surface *dst;
+
+   dst = replay_get(r, replay_arg(call, "dst"), REPLAY_OBJECT_SURFACE);
+   if (r->skip || !dst)
+      return;
+
+   pipe->clear_depth_stencil(pipe, dst,
+                             replay_uint(replay_arg(call, "clear_flags")),
+                             replay_float(replay_arg(call, "depth")),
+                             replay_uint(replay_arg(call, "stencil")),
+                             replay_uint(replay_arg(call, "dstx")),
+                             replay_uint(replay_arg(call, "dsty")),
+                             replay_uint(replay_arg(call, "width")),
+                             replay_uint(replay_arg(call, "height")));
+}
+
+
+static void
+replay_flush(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_fence_handle *fence = NULL;
+   unsigned flags = replay_uint(replay_arg(call, "flags"));
+   boolean want_fence = call->ret && call->ret->type == REPLAY_PTR;
+
+   if (r->skip)
+      return;
+
+   pipe->flush(pipe, want_fence ? &fence : NULL, flags);
+   replay_add_object(r, call, REPLAY_OBJECT_FENCE, fence, pipe);
+
+   if (flags & PIPE_FLUSH_END_OF_FRAME) {
+      r->end_of_frame = TRUE;
+      r->flush_frame_ends = TRUE;
+   }
+}
+
+
+static void
+replay_destroy(struct replay *r, struct replay_call *call)
+{
+   replay_delete(r, call, "pipe", REPLAY_OBJECT_CONTEXT);
+}
+
+
+static void
+replay_texture_barrier(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+
+   if (!r->skip && pipe->texture_barrier)
+      pipe->texture_barrier(pipe);
+}
+
+
+static void
+replay_memory_barrier(struct replay *r, struct replay_call *call)
+{
+   struct pipe_context *pipe = replay_pipe(r, call);
+
+   if (!r->skip && pipe->memory_barrier)
+      pipe->memory_barrier(pipe, replay_uint(replay_arg(call, "flags")));
+}
+
+
+static void
+replay_transfer_inline_write(struct replay *r, struct replay_call *call)
+{
+   const struct replay_value *data = replay_arg(call, "data");
+   struct pipe_context *pipe = replay_pipe(r, call);
+   struct pipe_resource *resource;
+   unsigned stride = replay_uint(replay_arg(call, "stride"));
+   unsigned layer_stride = replay_uint(replay_arg(call, "layer_stride"));
+   unsigned usage = replay_uint(replay_arg(call, "usage"));
+   const void *ptr = NULL;
+   struct pipe_box box;
+   size_t size;
+
+   resource = replay_get(r, replay_arg(call, "resource"),
+                         REPLAY_OBJECT_RESOURCE);
+   if (r->skip || !resource)
+      return;
+
+   replay_decode_box(replay_arg(call, "box"), &box);
+
+   /* the size tr_dump.c would have written */
+   if (resource->target == PIPE_BUFFER)
+      size = box.width;
+   else
+      size = (box.depth - 1) * layer_stride +
+             (util_format_get_nblocksy(resource->format, box.height) - 1) *
+             stride +
+             util_format_get_nblocksx(resource->format, box.width) *
+             util_format_get_blocksize(resource->format);
+
+   if (data && data->type == REPLAY_BYTES && data->num >= size) {
+      ptr = data->u.data;
+   }
+   else {
+      /* texture contents are only traced with GALLIUM_TRACE_CONTENTS */
+      if (size > replay_zeros_size) {
+         FREE(replay_zeros);
+         replay_zeros = CALLOC(1, size);
+         replay_zeros_size = replay_zeros ? size : 0;
+         if (!replay_zeros) {
+            r->skip = TRUE;
+            return;
+         }
+      }
+      ptr = replay_zeros;
+   }
+
+   /* These only make sense for the mapping the call was made from. */
+   usage &= ~(PIPE_TRANSFER_MAP_DIRECTLY |
+              PIPE_TRANSFER_DONTBLOCK |
+              PIPE_TRANSFER_FLUSH_EXPLICIT |
+              PIPE_TRANSFER_PERSISTENT |
+              PIPE_TRANSFER_COHERENT);
+
+   pipe->transfer_inline_write(pipe, resource,
+                               replay_uint(replay_arg(call, "level")),
+                               usage | PIPE_TRANSFER_WRITE, &box, ptr,
+                               stride, layer_stride);
+}
+
+
+const struct replay_handler replay_handlers[] = {
+   /* nothing to replay */
+   { "", "pipe_screen_create", NULL },
+   { "pipe_screen", "destroy", NULL },
+   { "pipe_screen", "get_name", NULL },
+   { "pipe_screen", "get_vendor", NULL },
+   { "pipe_screen", "get_param", NULL },
+   { "pipe_screen", "get_shader_param", NULL },
+   { "pipe_screen", "get_paramf", NULL },
+   { "pipe_screen", "is_format_supported", NULL },
+   { "pipe_screen", "get_timestamp", NULL },
+   { "pipe_screen", "fence_reference", NULL },
+
+   { "pipe_screen", "context_create", replay_context_create },
+   { "pipe_screen", "resource_create", replay_resource_create },
+   { "pipe_screen", "resource_destroy", replay_resource_destroy },
+   { "pipe_screen", "flush_frontbuffer", replay_flush_frontbuffer },
+   { "pipe_screen", "fence_finish", replay_fence_finish },
+   { "pipe_screen", "fence_signalled", replay_fence_signalled },
+
+#define REPLAY_CONTEXT_CALL(method) \
+   { "pipe_context", #method, replay_##method }
+
+   REPLAY_CONTEXT_CALL(draw_vbo),
+   REPLAY_CONTEXT_CALL(render_condition),
+   REPLAY_CONTEXT_CALL(create_query),
+   REPLAY_CONTEXT_CALL(destroy_query),
+   REPLAY_CONTEXT_CALL(begin_query),
+   REPLAY_CONTEXT_CALL(end_query),
+   REPLAY_CONTEXT_CALL(get_query_result),
+   REPLAY_CONTEXT_CALL(create_blend_state),
+   REPLAY_CONTEXT_CALL(bind_blend_state),
+   REPLAY_CONTEXT_CALL(delete_blend_state),
+   REPLAY_CONTEXT_CALL(create_sampler_state),
+   REPLAY_CONTEXT_CALL(bind_sampler_states),
+   REPLAY_CONTEXT_CALL(delete_sampler_state),
+   REPLAY_CONTEXT_CALL(create_rasterizer_state),
+   REPLAY_CONTEXT_CALL(bind_rasterizer_state),
+   REPLAY_CONTEXT_CALL(delete_rasterizer_state),
+   REPLAY_CONTEXT_CALL(create_depth_stencil_alpha_state),
+   REPLAY_CONTEXT_CALL(bind_depth_stencil_alpha_state),
+   REPLAY_CONTEXT_CALL(delete_depth_stencil_alpha_state),
+   REPLAY_CONTEXT_CALL(create_fs_state),
+   REPLAY_CONTEXT_CALL(bind_fs_state),
+   REPLAY_CONTEXT_CALL(delete_fs_state),
+   REPLAY_CONTEXT_CALL(create_vs_state),
+   REPLAY_CONTEXT_CALL(bind_vs_state),
+   REPLAY_CONTEXT_CALL(delete_vs_state),
+   REPLAY_CONTEXT_CALL(create_gs_state),
+   REPLAY_CONTEXT_CALL(bind_gs_state),
+   REPLAY_CONTEXT_CALL(delete_gs_state),
+   REPLAY_CONTEXT_CALL(create_vertex_elements_state),
+   REPLAY_CONTEXT_CALL(bind_vertex_elements_state),
+   REPLAY_CONTEXT_CALL(delete_vertex_elements_state),
+   REPLAY_CONTEXT_CALL(set_blend_color),
+   REPLAY_CONTEXT_CALL(set_stencil_ref),
+   REPLAY_CONTEXT_CALL(set_clip_state),
+   REPLAY_CONTEXT_CALL(set_sample_mask),
+   REPLAY_CONTEXT_CALL(set_constant_buffer),
+   REPLAY_CONTEXT_CALL(set_framebuffer_state),
+   REPLAY_CONTEXT_CALL(set_polygon_stipple),
+   REPLAY_CONTEXT_CALL(set_scissor_states),
+   REPLAY_CONTEXT_CALL(set_viewport_states),
+   REPLAY_CONTEXT_CALL(set_sampler_views),
+   REPLAY_CONTEXT_CALL(create_sampler_view),
+   REPLAY_CONTEXT_CALL(sampler_view_destroy),
+   REPLAY_CONTEXT_CALL(create_surface),
+   REPLAY_CONTEXT_CALL(surface_destroy),
+   REPLAY_CONTEXT_CALL(set_vertex_buffers),
+   REPLAY_CONTEXT_CALL(set_index_buffer),
+   REPLAY_CONTEXT_CALL(create_stream_output_target),
+   REPLAY_CONTEXT_CALL(stream_output_target_destroy),
+   REPLAY_CONTEXT_CALL(set_stream_output_targets),
+   REPLAY_CONTEXT_CALL(resource_copy_region),
+   REPLAY_CONTEXT_CALL(blit),
+   REPLAY_CONTEXT_CALL(flush_resource),
+   REPLAY_CONTEXT_CALL(clear),
+   REPLAY_CONTEXT_CALL(clear_render_target),
+   REPLAY_CONTEXT_CALL(clear_depth_stencil),
+   REPLAY_CONTEXT_CALL(flush),
+   REPLAY_CONTEXT_CALL(destroy),
+   REPLAY_CONTEXT_CALL(texture_barrier),
+   REPLAY_CONTEXT_CALL(memory_barrier),
+   REPLAY_CONTEXT_CALL(transfer_inline_write),
+
+#undef REPLAY_CONTEXT_CALL
+};
+
+const unsigned replay_num_handlers = Elements(replay_handlers);
+
+
+const struct replay_handler *
+replay_find_handler(const char *klass, const char *method)
+{
+   unsigned i;
+
+   for (i = 0; i < Elements(replay_handlers); i++) {
+      if (strcmp(replay_handlers[i].klass, klass) == 0 &&
+          strcmp(replay_handlers[i].method, method) == 0)
+         return &replay_handlers[i];
+   }
+   return NULL;
+}
+
+
+void
+replay_release_call(struct replay_call *call)
+{
+   FREE(call->data);
+   call->data = NULL;
+   call->cached = NULL;
+}
+
+
+/*
+ * Setup and teardown.
+ */
+
+static unsigned
+replay_hash_addr(void *key)
+{
+   uint64_t addr = *(uint64_t *)key;
+
+   /* allocations are aligned */
+   return (unsigned)((addr >> 4) ^ (addr >> 32));
+}
+
+
+static int
+replay_compare_addr(void *key1, void *key2)
+{
+   return *(uint64_t *)key1 != *(uint64_t *)key2;
+}
+
+
+boolean
+replay_init(struct replay *r, struct pipe_screen *screen)
+{
+   r->screen = screen;
+   r->objects = util_hash_table_create(replay_hash_addr, replay_compare_addr);
+   if (!r->objects)
+      return FALSE;
+
+   LIST_INITHEAD(&r->live);
+   LIST_INITHEAD(&r->cached);
+   return TRUE;
+}
+
+
+/**
+ * Unbind all the states of a context, so that they can be deleted.
+ */
+static void
+replay_unbind_all(struct pipe_context *pipe)
+{
+   static struct pipe_sampler_view *views[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+   static void *samplers[PIPE_MAX_SAMPLERS];
+   struct pipe_screen *screen = pipe->screen;
+   unsigned sh;
+
+   pipe->bind_blend_state(pipe, NULL);
+   pipe->bind_rasterizer_state(pipe, NULL);
+   pipe->bind_depth_stencil_alpha_state(pipe, NULL);
+   pipe->bind_fs_state(pipe, NULL);
+   pipe->bind_vs_state(pipe, NULL);
+   if (pipe->bind_gs_state)
+      pipe->bind_gs_state(pipe, NULL);
+   pipe->bind_vertex_elements_state(pipe, NULL);
+
+   for (sh = 0; sh < PIPE_SHADER_TYPES; sh++) {
+      int max_samplers =
+         screen->get_shader_param(screen, sh,
+                                  PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS);
+      int max_views =
+         screen->get_shader_param(screen, sh,
+                                  PIPE_SHADER_CAP_MAX_SAMPLER_VIEWS);
+
+      if (max_samplers > 0)
+         pipe->bind_sampler_states(pipe, sh, 0,
+                                   MIN2(max_samplers, PIPE_MAX_SAMPLERS),
+                                   samplers);
+      if (max_views > 0)
+         pipe->set_sampler_views(pipe, sh, 0,
+                                 MIN2(max_views,
+                                      PIPE_MAX_SHADER_SAMPLER_VIEWS),
+                                 views);
+   }
+
+   if (pipe->set_stream_output_targets)
+      pipe->set_stream_output_targets(pipe, 0, NULL, NULL);
+}
+
+
+/**
+ * Destroy all the objects of a list: first the ones which belong to a
+ * context, then the contexts, then the resources.
+ */
+static void
+replay_destroy_list(struct replay *r, struct list_head *list)
+{
+   struct replay_object *obj, *next;
+   unsigned pass;
+
+   LIST_FOR_EACH_ENTRY(obj, list, link) {
+      if (obj->type == REPLAY_OBJECT_CONTEXT)
+         replay_unbind_all(obj->pipe);
+   }
+
+   for (pass = 0; pass < 3; pass++) {
+      LIST_FOR_EACH_ENTRY_SAFE(obj, next, list, link) {
+         unsigned obj_pass = obj->type == REPLAY_OBJECT_CONTEXT ? 1 :
+                             obj->type == REPLAY_OBJECT_RESOURCE ? 2 : 0;
+
+         if (obj_pass != pass)
+            continue;
+
+         replay_unmap_object(r, obj);
+         replay_destroy_object(r, obj);
+         LIST_DEL(&obj->link);
+         FREE(obj);
+      }
+   }
+}
+
+
+void
+replay_end_loop(struct replay *r)
+{
+   struct replay_object *obj;
+
+   replay_destroy_list(r, &r->live);
+
+   /* the cached objects are mapped again when the next loop creates them */
+   LIST_FOR_EACH_ENTRY(obj, &r->cached, link) {
+      replay_unmap_object(r, obj);
+      if (obj->type == REPLAY_OBJECT_CONTEXT)
+         obj->user_buffers = 0;
+   }
+}
+
+
+void
+replay_finish(struct replay *r)
+{
+   struct list_head *lists[2] = { &r->live, &r->cached };
+   struct replay_object *obj;
+   unsigned i;
+
+   for (i = 0; i < 2; i++) {
+      LIST_FOR_EACH_ENTRY(obj, lists[i], link) {
+         struct pipe_fence_handle *fence = NULL;
+
+         if (obj->type != REPLAY_OBJECT_CONTEXT)
+            continue;
+
+         obj->pipe->flush(obj->pipe, &fence, 0);
+         if (fence) {
+            r->screen->fence_finish(r->screen, fence, PIPE_TIMEOUT_INFINITE);
+            r->screen->fence_reference(r->screen, &fence, NULL);
+         }
+      }
+   }
+}
+
+
+void
+replay_fini(struct replay *r)
+{
+   replay_end_loop(r);
+   replay_destroy_list(r, &r->cached);
+
+   util_hash_table_destroy(r->objects);
+   r->objects = NULL;
+
+   if (replay_formats) {
+      util_hash_table_destroy(replay_formats);
+      replay_formats = NULL;
+   }
+
+   FREE(replay_zeros);
+   replay_zeros = NULL;
+   replay_zeros_size = 0;
+}
@@ -0,0 +1,878 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Project
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Loading of binary traces (see drivers/trace/tr_dump_binary.h) in memory.
+ *
+ * The whole trace is loaded before replaying it, so that it can be looped
+ * and so that reading the file doesn't show up in the timings. The contents
+ * of buffers and textures point into the file data, which is kept around.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "util/u_hash_table.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+
+#include "../../drivers/trace/tr_dump_binary.h"
+
+#include "replay.h"
+
+
+#define REPLAY_POOL_CHUNK_SIZE (1024 * 1024)
+
+
+struct replay_pool_chunk {
+   struct replay_pool_chunk *next;
+   size_t used;
+   size_t size;
+   /* followed by the data */
+};
+
+struct replay_pool {
+   struct replay_pool_chunk *chunks;
+   uint8_t *file_data;
+};
+
+
+static void *
+replay_pool_alloc(struct replay_pool *pool, size_t size)
+{
+   struct replay_pool_chunk *chunk = pool->chunks;
+   void *ptr;
+
+   size = align(size, 8);
+
+   if (!chunk || chunk->used + size > chunk->size) {
+      size_t chunk_size = MAX2(size, REPLAY_POOL_CHUNK_SIZE);
+
+      chunk = MALLOC(sizeof(*chunk) + chunk_size);
+      if (!chunk)
+         return NULL;
+      chunk->used = 0;
+      chunk->size = chunk_size;
+
+      /* keep filling the current chunk after an oversized allocation */
+      if (pool->chunks && size > REPLAY_POOL_CHUNK_SIZE) {
+         chunk->next = pool->chunks->next;
+         pool->chunks->next = chunk;
+      }
+      else {
+         chunk->next = pool->chunks;
+         pool->chunks = chunk;
+      }
+   }
+
+   ptr = (uint8_t *)(chunk + 1) + chunk->used;
+   chunk->used += size;
+   return ptr;
+}
+
+
+static void
+replay_pool_destroy(struct replay_pool *pool)
+{
+   struct replay_pool_chunk *chunk, *next;
+
+   for (chunk = pool->chunks; chunk; chunk = next) {
+      next = chunk->next;
+      FREE(chunk);
+   }
+   FREE(pool->file_data);
+   FREE(pool);
+}
+
+
+/*
+ * Decoding.
+ */
+
+struct replay_reader {
+   const uint8_t *pos;
+   const uint8_t *end;
+   struct replay_pool *pool;
+
+   /** the data ended in the middle of a call */
+   boolean truncated;
+   /** the data isn't a valid trace */
+   boolean invalid;
+
+   const char **strings;
+   unsigned num_strings;
+   unsigned max_strings;
+
+   /** content hash -> BYTES value */
+   struct util_hash_table *blobs;
+
+   const struct replay_value **states;
+   unsigned num_states;
+   unsigned max_states;
+
+   /** elements and members of the arrays and structs being decoded */
+   const struct replay_value **stack;
+   const char **stack_names;
+   unsigned stack_size;
+   unsigned max_stack_size;
+};
+
+
+static boolean
+replay_grow(void *array, unsigned *max, unsigned needed, size_t elem_size)
+{
+   void **ptr = array;
+   unsigned new_max;
+   void *data;
+
+   if (needed <= *max)
+      return TRUE;
+
+   new_max = MAX2(needed, MAX2(*max * 2, 64));
+   data = REALLOC(*ptr, *max * elem_size, new_max * elem_size);
+   if (!data)
+      return FALSE;
+
+   *ptr = data;
+   *max = new_max;
+   return TRUE;
+}
+
+
+/** Push an array element, struct member or call argument. */
+static boolean
+replay_push(struct replay_reader *rd, const struct replay_value *value,
+            const char *name)
+{
+   if (rd->stack_size == rd->max_stack_size) {
+      unsigned max = MAX2(rd->max_stack_size * 2, 64);
+      const struct replay_value **stack;
+      const char **names;
+
+      stack = REALLOC(rd->stack, rd->max_stack_size * sizeof(stack[0]),
+                      max * sizeof(stack[0]));
+      if (!stack) {
+         rd->invalid = TRUE;
+         return FALSE;
+      }
+      rd->stack = stack;
+
+      names = REALLOC(rd->stack_names, rd->max_stack_size * sizeof(names[0]),
+                      max * sizeof(names[0]));
+      if (!names) {
+         rd->invalid = TRUE;
+         return FALSE;
+      }
+      rd->stack_names = names;
+      rd->max_stack_size = max;
+   }
+
+   rd->stack[rd->stack_size] = value;
+   rd->stack_names[rd->stack_size] = name;
+   rd->stack_size++;
+   return TRUE;
+}
+
+
+static const struct replay_value *
+replay_read_value(struct replay_reader *rd, unsigned token);
+
+
+static INLINE unsigned
+replay_read_byte(struct replay_reader *rd)
+{
+   if (rd->pos >= rd->end) {
+      rd->truncated = TRUE;
+      return 0;
+   }
+   return *rd->pos++;
+}
+
+
+static uint64_t
+replay_read_varint(struct replay_reader *rd)
+{
+   uint64_t value = 0;
+   unsigned shift = 0;
+   unsigned byte;
+
+   do {
+      byte = replay_read_byte(rd);
+      if (shift < 64)
+         value |= (uint64_t)(byte & 0x7f) << shift;
+      shift += 7;
+   } while ((byte & 0x80) && !rd->truncated);
+
+   return value;
+}
+
+
+static INLINE int64_t
+replay_read_sint(struct replay_reader *rd)
+{
+   uint64_t value = replay_read_varint(rd);
+
+   return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+
+static uint64_t
+replay_read_u64(struct replay_reader *rd)
+{
+   uint64_t value = 0;
+   unsigned i;
+
+   for (i = 0; i < 8; i++)
+      value |= (uint64_t)replay_read_byte(rd) << (i * 8);
+
+   return value;
+}
+
+
+/** Return a pointer to the next \p size bytes of the data. */
+static const uint8_t *
+replay_read_bytes(struct replay_reader *rd, uint64_t size)
+{
+   const uint8_t *data = rd->pos;
+
+   if (size > (uint64_t)(rd->end - rd->pos)) {
+      rd->truncated = TRUE;
+      return NULL;
+   }
+
+   rd->pos += size;
+   return data;
+}
+
+
+static const char *
+replay_read_str(struct replay_reader *rd)
+{
+   uint64_t id = replay_read_varint(rd);
+
+   if (id >= rd->num_strings) {
+      if (!rd->truncated)
+         rd->invalid = TRUE;
+      return "";
+   }
+   return rd->strings[id];
+}
+
+
+/** Read a token, handling the string definitions which precede it. */
+static unsigned
+replay_read_token(struct replay_reader *rd)
+{
+   while (!rd->truncated && !rd->invalid) {
+      unsigned token = replay_read_byte(rd);
+      uint64_t size;
+      const uint8_t *data;
+      char *str;
+
+      if (token != TRACE_BIN_STRING_DEF) {
+         if (!token && !rd->truncated)
+            rd->invalid = TRUE;
+         return token;
+      }
+
+      size = replay_read_varint(rd);
+      data = replay_read_bytes(rd, size);
+      if (!data)
+         break;
+
+      str = replay_pool_alloc(rd->pool, size + 1);
+      if (!str ||
+          !replay_grow(&rd->strings, &rd->max_strings, rd->num_strings + 1,
+                       sizeof(rd->strings[0]))) {
+         rd->invalid = TRUE;
+         break;
+      }
+      memcpy(str, data, size);
+      str[size] = '\0';
+      rd->strings[rd->num_strings++] = str;
+   }
+
+   return 0;
+}
+
+
+static struct replay_value *
+replay_new_value(struct replay_reader *rd, enum replay_value_type type)
+{
+   struct replay_value *value = replay_pool_alloc(rd->pool, sizeof(*value));
+
+   if (!value) {
+      rd->invalid = TRUE;
+      return NULL;
+   }
+   memset(value, 0, sizeof(*value));
+   value->type = type;
+   return value;
+}
+
+
+static const struct replay_value *
+replay_new_bytes(struct replay_reader *rd)
+{
+   uint64_t size = replay_read_varint(rd);
+   const uint8_t *data = replay_read_bytes(rd, size);
+   struct replay_value *value;
+
+   if (!data)
+      return NULL;
+
+   value = replay_new_value(rd, REPLAY_BYTES);
+   if (value) {
+      value->num = size;
+      value->u.data = data;
+   }
+   return value;
+}
+
+
+/**
+ * Read the elements of an array or the members of a struct, up to END,
+ * and copy them into \p value.
+ */
+static void
+replay_read_children(struct replay_reader *rd, struct replay_value *value)
+{
+   unsigned base = rd->stack_size;
+   unsigned token, n;
+
+   for (;;) {
+      const struct replay_value *child;
+      const char *name = NULL;
+
+      token = replay_read_token(rd);
+      if (token == TRACE_BIN_END || !token)
+         break;
+
+      if (value->type == REPLAY_STRUCT) {
+         if (token != TRACE_BIN_MEMBER) {
+            rd->invalid = TRUE;
+            break;
+         }
+         name = replay_read_str(rd);
+         token = replay_read_token(rd);
+      }
+
+      child = replay_read_value(rd, token);
+      if (!child)
+         break;
+
+      if (!replay_push(rd, child, name))
+         break;
+   }
+
+   n = rd->stack_size - base;
+   rd->stack_size = base;
+
+   if (token != TRACE_BIN_END)
+      return;
+
+   value->num = n;
+   if (!n)
+      return;
+
+   value->u.c.values = replay_pool_alloc(rd->pool,
+                                         n * sizeof(value->u.c.values[0]));
+   if (!value->u.c.values) {
+      rd->invalid = TRUE;
+      return;
+   }
+   memcpy(value->u.c.values, &rd->stack[base], n * sizeof(rd->stack[0]));
+
+   if (value->type == REPLAY_STRUCT) {
+      value->u.c.names = replay_pool_alloc(rd->pool,
+                                           n * sizeof(value->u.c.names[0]));
+      if (!value->u.c.names) {
+         rd->invalid = TRUE;
+         return;
+      }
+      memcpy(value->u.c.names, &rd->stack_names[base],
+             n * sizeof(rd->stack_names[0]));
+   }
+}
+
+
+static const struct replay_value *
+replay_read_value(struct replay_reader *rd, unsigned token)
+{
+   struct replay_value *value = NULL;
+   uint64_t hash;
+
+   switch (token) {
+   case TRACE_BIN_NULL:
+      value = replay_new_value(rd, REPLAY_NULL);
+      break;
+   case TRACE_BIN_BOOL:
+      value = replay_new_value(rd, REPLAY_BOOL);
+      if (value)
+         value->u.i = replay_read_byte(rd);
+      break;
+   case TRACE_BIN_INT:
+      value = replay_new_value(rd, REPLAY_INT);
+      if (value)
+         value->u.i = replay_read_sint(rd);
+      break;
+   case TRACE_BIN_UINT:
+   case TRACE_BIN_PTR:
+      value = replay_new_value(rd, token == TRACE_BIN_PTR ? REPLAY_PTR
+                                                          : REPLAY_UINT);
+      if (value)
+         value->u.u = replay_read_varint(rd);
+      break;
+   case TRACE_BIN_FLOAT:
+      value = replay_new_value(rd, REPLAY_FLOAT);
+      if (value) {
+         union {
+            uint64_t u;
+            double f;
+         } v;
+         v.u = replay_read_u64(rd);
+         value->u.f = v.f;
+      }
+      break;
+   case TRACE_BIN_STRING: {
+      uint64_t size = replay_read_varint(rd);
+      const uint8_t *data = replay_read_bytes(rd, size);
+      char *str;
+
+      if (!data)
+         return NULL;
+      value = replay_new_value(rd, REPLAY_STRING);
+      str = replay_pool_alloc(rd->pool, size + 1);
+      if (!value || !str) {
+         rd->invalid = TRUE;
+         return NULL;
+      }
+      memcpy(str, data, size);
+      str[size] = '\0';
+      value->u.str = str;
+      break;
+   }
+   case TRACE_BIN_ENUM:
+      value = replay_new_value(rd, REPLAY_ENUM);
+      if (value)
+         value->u.str = replay_read_str(rd);
+      break;
+   case TRACE_BIN_ARRAY:
+      value = replay_new_value(rd, REPLAY_ARRAY);
+      if (value)
+         replay_read_children(rd, value);
+      break;
+   case TRACE_BIN_STRUCT:
+      value = replay_new_value(rd, REPLAY_STRUCT);
+      if (value) {
+         value->u.c.name = replay_read_str(rd);
+         replay_read_children(rd, value);
+      }
+      break;
+   case TRACE_BIN_BYTES:
+      return replay_new_bytes(rd);
+   case TRACE_BIN_BLOB_DEF: {
+      const struct replay_value *bytes;
+      uint64_t *key;
+
+      hash = replay_read_u64(rd);
+      bytes = replay_new_bytes(rd);
+      if (!bytes)
+         return NULL;
+
+      key = replay_pool_alloc(rd->pool, sizeof(*key));
+      if (!key) {
+         rd->invalid = TRUE;
+         return NULL;
+      }
+      *key = hash;
+      util_hash_table_set(rd->blobs, key, (void *)bytes);
+      return bytes;
+   }
+   case TRACE_BIN_BLOB_REF:
+      hash = replay_read_u64(rd);
+      if (rd->truncated)
+         return NULL;
+      value = util_hash_table_get(rd->blobs, &hash);
+      if (!value)
+         rd->invalid = TRUE;
+      return value;
+   case TRACE_BIN_STATE_DEF: {
+      const struct replay_value *state;
+
+      state = replay_read_value(rd, replay_read_token(rd));
+      if (!state)
+         return NULL;
+      if (!replay_grow(&rd->states, &rd->max_states, rd->num_states + 1,
+                       sizeof(rd->states[0]))) {
+         rd->invalid = TRUE;
+         return NULL;
+      }
+      rd->states[rd->num_states++] = state;
+      return state;
+   }
+   case TRACE_BIN_STATE_REF: {
+      uint64_t id = replay_read_varint(rd);
+
+      if (rd->truncated)
+         return NULL;
+      if (id >= rd->num_states) {
+         rd->invalid = TRUE;
+         return NULL;
+      }
+      return rd->states[id];
+   }
+   default:
+      if (!rd->truncated)
+         rd->invalid = TRUE;
+      return NULL;
+   }
+
+   if (rd->truncated || rd->invalid)
+      return NULL;
+
+   return value;
+}
+
+
+/**
+ * Read the call after the CALL token. Returns FALSE when the call is
+ * incomplete.
+ */
+static boolean
+replay_read_call(struct replay_reader *rd, struct replay_call *call)
+{
+   unsigned base = rd->stack_size;
+   unsigned n, token;
+
+   memset(call, 0, sizeof(*call));
+   call->no = replay_read_varint(rd);
+   call->klass = replay_read_str(rd);
+   call->method = replay_read_str(rd);
+
+   for (;;) {
+      const struct replay_value *value;
+      const char *name = NULL;
+
+      token = replay_read_token(rd);
+      if (token == TRACE_BIN_CALL_END) {
+         replay_read_sint(rd);
+         break;
+      }
+
+      if (token == TRACE_BIN_ARG) {
+         name = replay_read_str(rd);
+      }
+      else if (token != TRACE_BIN_RET) {
+         if (token)
+            rd->invalid = TRUE;
+         break;
+      }
+
+      value = replay_read_value(rd, replay_read_token(rd));
+      if (!value)
+         break;
+
+      if (token == TRACE_BIN_RET) {
+         call->ret = value;
+         continue;
+      }
+
+      if (!replay_push(rd, value, name))
+         break;
+   }
+
+   n = rd->stack_size - base;
+   rd->stack_size = base;
+
+   if (rd->truncated || rd->invalid)
+      return FALSE;
+
+   call->num_args = n;
+   if (!n)
+      return TRUE;
+
+   call->args = replay_pool_alloc(rd->pool, n * sizeof(call->args[0]));
+   call->arg_names = replay_pool_alloc(rd->pool,
+                                       n * sizeof(call->arg_names[0]));
+   if (!call->args || !call->arg_names) {
+      rd->invalid = TRUE;
+      return FALSE;
+   }
+   memcpy(call->args, &rd->stack[base], n * sizeof(rd->stack[0]));
+   memcpy(call->arg_names, &rd->stack_names[base],
+          n * sizeof(rd->stack_names[0]));
+   return TRUE;
+}
+
+
+static unsigned
+replay_hash_u64(void *key)
+{
+   uint64_t value = *(uint64_t *)key;
+
+   return (unsigned)(value ^ (value >> 32));
+}
+
+
+static int
+replay_compare_u64(void *key1, void *key2)
+{
+   return *(uint64_t *)key1 != *(uint64_t *)key2;
+}
+
+
+static uint8_t *
+replay_read_file(const char *filename, size_t *size)
+{
+   FILE *file;
+   uint8_t *data = NULL;
+   size_t used = 0, max = 0;
+
+   file = fopen(filename, "rb");
+   if (!file) {
+      fprintf(stderr, "%s: can't open the file\n", filename);
+      return NULL;
+   }
+
+   for (;;) {
+      size_t n;
+
+      if (used == max) {
+         size_t new_max = max ? max * 2 : 16 * 1024 * 1024;
+         uint8_t *new_data = REALLOC(data, max, new_max);
+
+         if (!new_data) {
+            fprintf(stderr, "%s: out of memory\n", filename);
+            FREE(data);
+            fclose(file);
+            return NULL;
+         }
+         data = new_data;
+         max = new_max;
+      }
+
+      n = fread(data + used, 1, max - used, file);
+      used += n;
+      if (n == 0)
+         break;
+   }
+
+   if (ferror(file)) {
+      fprintf(stderr, "%s: read error\n", filename);
+      FREE(data);
+      data = NULL;
+   }
+
+   fclose(file);
+   *size = used;
+   return data;
+}
+
+
+/**
+ * Load a trace in memory. A trace which was cut short, e.g. because the
+ * application crashed, ends at its last complete call.
+ */
+boolean
+replay_load(struct replay_trace *trace, const char *filename)
+{
+   struct replay_reader rd;
+   unsigned max_calls = 0;
+   size_t size;
+   uint8_t *data;
+
+   memset(trace, 0, sizeof(*trace));
+
+   data = replay_read_file(filename, &size);
+   if (!data)
+      return FALSE;
+
+   if (size < 8 || memcmp(data, "GTRB", 4) != 0) {
+      fprintf(stderr, "%s: not a binary trace; write it with "
+              "GALLIUM_TRACE_BINARY=true, or convert it with tobinary.py\n",
+              filename);
+      FREE(data);
+      return FALSE;
+   }
+
+   if ((data[4] | data[5] << 8 | data[6] << 16 |
+        (uint32_t)data[7] << 24) != TRACE_BIN_VERSION) {
+      fprintf(stderr, "%s: unsupported trace version\n", filename);
+      FREE(data);
+      return FALSE;
+   }
+
+   memset(&rd, 0, sizeof(rd));
+   rd.pos = data + 8;
+   rd.end = data + size;
+   rd.pool = CALLOC_STRUCT(replay_pool);
+   rd.blobs = util_hash_table_create(replay_hash_u64, replay_compare_u64);
+   if (!rd.pool || !rd.blobs) {
+      fprintf(stderr, "%s: out of memory\n", filename);
+      FREE(rd.pool);
+      if (rd.blobs)
+         util_hash_table_destroy(rd.blobs);
+      FREE(data);
+      return FALSE;
+   }
+   rd.pool->file_data = data;
+   trace->pool = rd.pool;
+
+   while (rd.pos < rd.end) {
+      unsigned token = replay_read_token(&rd);
+
+      if (!token)
+         break;
+      if (token != TRACE_BIN_CALL) {
+         rd.invalid = TRUE;
+         break;
+      }
+
+      if (!replay_grow(&trace->calls, &max_calls, trace->num_calls + 1,
+                       sizeof(trace->calls[0]))) {
+         rd.invalid = TRUE;
+         break;
+      }
+
+      if (!replay_read_call(&rd, &trace->calls[trace->num_calls]))
+         break;
+      trace->num_calls++;
+   }
+
+   if (rd.invalid)
+      fprintf(stderr, "%s: invalid data after call %u\n", filename,
+              trace->num_calls ? trace->calls[trace->num_calls - 1].no : 0);
+   else if (rd.truncated)
+      fprintf(stderr, "%s: the trace is truncated after call %u\n", filename,
+              trace->num_calls ? trace->calls[trace->num_calls - 1].no : 0);
+
+   util_hash_table_destroy(rd.blobs);
+   FREE(rd.strings);
+   FREE(rd.states);
+   FREE(rd.stack);
+   FREE(rd.stack_names);
+
+   if (rd.invalid) {
+      replay_unload(trace);
+      return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+void
+replay_unload(struct replay_trace *trace)
+{
+   FREE(trace->calls);
+   if (trace->pool)
+      replay_pool_destroy(trace->pool);
+   memset(trace, 0, sizeof(*trace));
+}
+
+
+/*
+ * Access to the values.
+ */
+
+const struct replay_value *
+replay_arg(const struct replay_call *call, const char *name)
+{
+   unsigned i;
+
+   for (i = 0; i < call->num_args; i++) {
+      if (strcmp(call->arg_names[i], name) == 0)
+         return call->args[i];
+   }
+   return NULL;
+}
+
+
+const struct replay_value *
+replay_member(const struct replay_value *value, const char *name)
+{
+   unsigned i;
+
+   if (!value || value->type != REPLAY_STRUCT)
+      return NULL;
+
+   for (i = 0; i < value->num; i++) {
+      if (strcmp(value->u.c.names[i], name) == 0)
+         return value->u.c.values[i];
+   }
+   return NULL;
+}
+
+
+const struct replay_value *
+replay_elem(const struct replay_value *value, unsigned index)
+{
+   if (!value || value->type != REPLAY_ARRAY || index >= value->num)
+      return NULL;
+
+   return value->u.c.values[index];
+}
+
+
+int64_t
+replay_int(const struct replay_value *value)
+{
+   if (!value)
+      return 0;
+
+   switch (value->type) {
+   case REPLAY_BOOL:
+   case REPLAY_INT:
+      return value->u.i;
+   case REPLAY_UINT:
+   case REPLAY_PTR:
+      return (int64_t)value->u.u;
+   case REPLAY_FLOAT:
+      return (int64_t)value->u.f;
+   default:
+      return 0;
+   }
+}
+
+
+uint64_t
+replay_uint(const struct replay_value *value)
+{
+   return (uint64_t)replay_int(value);
+}
+
+
+double
+replay_float(const struct replay_value *value)
+{
+   if (value && value->type == REPLAY_FLOAT)
+      return value->u.f;
+
+   return (double)replay_int(value);
+}
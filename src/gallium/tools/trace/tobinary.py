@@ -0,0 +1,74 @@
+#!/usr/bin/env python
+##########################################################################
+#
+# Copyright 2014 The Mesa Project
+# All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sub license, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice (including the
+# next paragraph) shall be included in all copies or substantial portions
+# of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+# IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+# ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+# TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+# SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+##########################################################################
+
+
+'''Convert a trace to the binary format, e.g. for gallium_replay.'''
+
+
+import sys
+
+from parse import *
+from binparse import BinaryTraceWriter
+
+
+class TraceConverter(TraceParser):
+
+    def __init__(self, fp, writer):
+        TraceParser.__init__(self, fp)
+        self.writer = writer
+
+    def handle_call(self, call):
+        self.writer.write_call(call)
+
+
+class Converter(Main):
+
+    def get_optparser(self):
+        optparser = Main.get_optparser(self)
+        optparser.add_option(
+            '-o', '--output', metavar='FILE',
+            type='string', dest='output',
+            help='binary trace to write [default: TRACE.gtrace]')
+        return optparser
+
+    def process_arg(self, stream, options):
+        output = options.output
+        if output is None:
+            name = stream.name
+            for ext in ('.gz', '.bz2', '.xml', '.trace'):
+                if name.endswith(ext):
+                    name = name[:-len(ext)]
+            output = name + '.gtrace'
+        fp = open(output, 'wb')
+        parser = TraceConverter(stream, BinaryTraceWriter(fp))
+        parser.parse()
+        fp.close()
+
+
+if __name__ == '__main__':
+    Converter().main()
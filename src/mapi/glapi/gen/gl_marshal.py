@@ -0,0 +1,427 @@
+#!/usr/bin/env python
+
+# Copyright (C) 2014 VMware, Inc.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# This script generates the file marshal_generated.c, which contains the
+# dispatch table used by the GL thread (see main/glthread.c) on the
+# application's side, and the functions which execute the marshalled
+# commands on the GL thread.
+#
+# A function is marshalled, ie. queued and executed later by the GL
+# thread, when it doesn't return anything and all its pointer parameters
+# point to data whose size is known when the function is called.  That
+# data is copied into the command.  All other functions wait for the GL
+# thread to go idle and are then executed synchronously.
+
+import license
+import gl_XML
+import sys, getopt
+
+
+header = """
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/glthread.h"
+#include "main/marshal.h"
+"""
+
+
+# Functions which must not be queued even though they could be.
+sync_functions = set([
+    # the caller expects the rendering to be complete on return
+    'Finish',
+    # these change the client state the GL thread tracks
+    'PushClientAttrib',
+    'PopClientAttrib',
+    'PushClientAttribDefaultEXT',
+    ])
+
+# Functions which read the current vertex arrays, which may be in client
+# memory.  They are only queued when no client arrays have been set up.
+draw_functions = set([
+    'ArrayElement',
+    'DrawArrays',
+    'DrawArraysInstancedARB',
+    'DrawArraysInstancedBaseInstance',
+    'DrawElements',
+    'DrawRangeElements',
+    'DrawElementsBaseVertex',
+    'DrawRangeElementsBaseVertex',
+    'DrawElementsInstancedARB',
+    'DrawElementsInstancedBaseVertex',
+    'DrawElementsInstancedBaseInstance',
+    'DrawElementsInstancedBaseVertexBaseInstance',
+    'DrawTransformFeedback',
+    'DrawTransformFeedbackInstanced',
+    'DrawTransformFeedbackStream',
+    'DrawTransformFeedbackStreamInstanced',
+    'MultiDrawArrays',
+    'MultiDrawElementsEXT',
+    'MultiDrawElementsBaseVertex',
+    ])
+
+# Functions whose data parameter is read from the bound
+# GL_PIXEL_UNPACK_BUFFER rather than client memory when there is one.  They
+# are only queued, with the data copied into the command, when there isn't.
+unpack_functions = set([
+    'CompressedTexImage1D',
+    'CompressedTexImage2D',
+    'CompressedTexImage3D',
+    'CompressedTexSubImage1D',
+    'CompressedTexSubImage2D',
+    'CompressedTexSubImage3D',
+    'PixelMapfv',
+    'PixelMapuiv',
+    'PixelMapusv',
+    ])
+
+# Calls made after a function has been queued or executed, which update
+# the state the GL thread tracks on the application's side.
+tracking_hooks = {
+    'BindBuffer': '_mesa_glthread_BindBuffer(ctx, target, buffer);',
+    'DeleteBuffers': '_mesa_glthread_DeleteBuffers(ctx, n, buffer);',
+    'BindVertexArray': '_mesa_glthread_BindVertexArray(ctx, array);',
+    'BindVertexArrayAPPLE': '_mesa_glthread_BindVertexArray(ctx, array);',
+    'DeleteVertexArrays': '_mesa_glthread_DeleteVertexArrays(ctx, n, arrays);',
+    'PopClientAttrib': '_mesa_glthread_update_tracking(ctx);',
+    'Flush': '_mesa_glthread_flush_batch(ctx);',
+    }
+
+
+def is_array_pointer_function(f):
+    """Is this one of the gl*Pointer* functions which take either client
+    memory addresses or offsets into the bound GL_ARRAY_BUFFER?  That
+    includes the ones typed otherwise than const GLvoid *, like
+    EdgeFlagPointerEXT and the IBM/INTEL pointer lists, and
+    InterleavedArrays."""
+    if f.name.startswith('Get') or \
+       ('Pointer' not in f.name and f.name != 'InterleavedArrays'):
+        return False
+    for p in f.parameters:
+        if p.name == 'pointer' and not p.is_output:
+            return True
+    return False
+
+
+def is_fixed_array(p):
+    return p.is_pointer() and p.count and not p.is_variable_length()
+
+
+def is_variable_array(p):
+    return p.is_pointer() and p.counter and not p.count_parameter_list \
+        and not p.is_image()
+
+
+def passed_as_value(f, p):
+    """Pointers which are offsets into a buffer object are passed as is."""
+    if p.name == 'pointer' and is_array_pointer_function(f) and \
+       p.type_string().count('*') == 1:
+        return True
+    if p.name == 'indices' and f.name in draw_functions and \
+       not is_variable_array(p):
+        return True
+    return False
+
+
+def marshal_mode(f):
+    """Return 'async' if the function can be queued, else 'sync'."""
+    if f.name in sync_functions:
+        return 'sync'
+    if f.return_type != 'void':
+        return 'sync'
+    for p in f.parameters:
+        if p.is_output or p.is_image():
+            return 'sync'
+        if p.is_pointer() and not passed_as_value(f, p) and \
+           not is_fixed_array(p) and not is_variable_array(p):
+            return 'sync'
+    return 'async'
+
+
+def base_type(p):
+    return p.get_base_type_string().replace('const ', '')
+
+
+def call_args(f, prefix = ''):
+    return ', '.join([prefix + p.name for p in f.parameters
+                      if not p.is_padding])
+
+
+class PrintCode(gl_XML.gl_print_base):
+
+    def __init__(self):
+        gl_XML.gl_print_base.__init__(self)
+
+        self.name = 'gl_marshal.py'
+        self.license = license.bsd_license_template % (
+            'Copyright (C) 2014 VMware, Inc.', 'VMware, Inc.')
+
+    def printRealHeader(self):
+        print header
+
+    def printRealFooter(self):
+        pass
+
+    def print_sync_call(self, f, indent = '   '):
+        call = 'CALL_{0}(ctx->CurrentDispatch, ({1}))'.format(
+            f.name, call_args(f))
+        print indent + '_mesa_glthread_finish(ctx);'
+        if f.return_type != 'void':
+            print indent + 'result = {0};'.format(call)
+            print indent + '_mesa_glthread_restore_dispatch(ctx);'
+            print indent + 'return result;'
+        else:
+            print indent + '{0};'.format(call)
+            print indent + '_mesa_glthread_restore_dispatch(ctx);'
+            if f.name in tracking_hooks:
+                print indent + tracking_hooks[f.name]
+
+    def print_sync_function(self, f):
+        print 'static {0} GLAPIENTRY'.format(f.return_type)
+        print '_mesa_marshal_{0}({1})'.format(
+            f.name, f.get_parameter_string())
+        print '{'
+        print '   GET_CURRENT_CONTEXT(ctx);'
+        if f.return_type != 'void':
+            print '   {0} result;'.format(f.return_type)
+            print ''
+        if is_array_pointer_function(f):
+            # the pointers may be in client memory, which draws must see
+            print '   (void) _mesa_glthread_array_pointer_is_offset(ctx);'
+        self.print_sync_call(f)
+        print '}'
+        print ''
+        print ''
+
+    def print_async_functions(self, f):
+        fixed_params = [p for p in f.parameters
+                        if not p.is_padding and not is_variable_array(p)]
+        variable_params = [p for p in f.parameters
+                           if not p.is_padding and is_variable_array(p)]
+
+        # command structure
+        print 'struct marshal_cmd_{0}'.format(f.name)
+        print '{'
+        print '   struct marshal_cmd_base cmd_base;'
+        for p in fixed_params:
+            if is_fixed_array(p):
+                print '   {0} {1}[{2}];'.format(
+                    base_type(p), p.name,
+                    p.count * p.count_scale)
+            elif p.is_pointer():
+                print '   {0} {1};'.format(p.type_string(), p.name)
+            else:
+                print '   {0} {1};'.format(p.type_string(), p.name)
+        for p in variable_params:
+            print '   GLboolean {0}_null;'.format(p.name)
+        for p in variable_params:
+            print '   /* Next ALIGN({0} * {1}, 8) bytes are {2} {3}[],'.format(
+                p.counter, p.size(), base_type(p), p.name)
+            print '    * unless {0}_null is set */'.format(p.name)
+        print '};'
+        print ''
+        print ''
+
+        # execution on the GL thread
+        print 'static void'
+        print '_mesa_unmarshal_{0}(struct gl_context *ctx, ' \
+              'const struct marshal_cmd_{0} *cmd)'.format(f.name)
+        print '{'
+        for p in fixed_params:
+            if is_fixed_array(p):
+                print '   const {0} *{1} = cmd->{1};'.format(
+                    base_type(p), p.name)
+            elif p.is_pointer():
+                print '   {0} {1} = cmd->{1};'.format(
+                    p.type_string(), p.name)
+            else:
+                print '   const {0} {1} = cmd->{1};'.format(
+                    p.type_string(), p.name)
+        for p in variable_params:
+            print '   const {0} *{1};'.format(base_type(p), p.name)
+        if variable_params:
+            print '   const char *variable_data = (const char *) (cmd + 1);'
+            for p in variable_params:
+                print '   {0} = cmd->{0}_null ? NULL : ' \
+                      '(const {1} *) variable_data;'.format(p.name, base_type(p))
+                if p != variable_params[-1]:
+                    print '   if (!cmd->{0}_null)'.format(p.name)
+                    print '      variable_data += ALIGN({0} * {1}, 8);'.format(
+                        p.counter, p.size())
+        print '   CALL_{0}(ctx->CurrentDispatch, ({1}));'.format(
+            f.name, call_args(f))
+        print '}'
+        print ''
+        print ''
+
+        # queuing on the application's thread
+        print 'static void GLAPIENTRY'
+        print '_mesa_marshal_{0}({1})'.format(
+            f.name, f.get_parameter_string())
+        print '{'
+        print '   GET_CURRENT_CONTEXT(ctx);'
+        for p in variable_params:
+            print '   size_t {0}_size = {0} ? ALIGN({1} * {2}, 8) : 0;'.format(
+                p.name, p.counter, p.size())
+        size = 'sizeof(struct marshal_cmd_{0})'.format(f.name)
+        for p in variable_params:
+            size += ' + {0}_size'.format(p.name)
+        print '   size_t cmd_size = {0};'.format(size)
+        if fixed_params or variable_params:
+            print '   struct marshal_cmd_{0} *cmd;'.format(f.name)
+        if variable_params:
+            print '   char *variable_data;'
+        print ''
+
+        # conditions under which we have to fall back to a sync call
+        conditions = []
+        for p in variable_params:
+            conditions.append('{0} < 0'.format(p.counter))
+        if variable_params:
+            conditions.append('cmd_size > MARSHAL_MAX_CMD_SIZE')
+        if is_array_pointer_function(f):
+            conditions.append('!_mesa_glthread_array_pointer_is_offset(ctx)')
+        if f.name in unpack_functions:
+            conditions.append('!_mesa_glthread_unpack_pointer_is_client(ctx)')
+        if f.name in draw_functions:
+            conditions.append('!_mesa_glthread_can_queue_draw(ctx, {0})'.format(
+                'GL_TRUE' if [p for p in f.parameters if p.name == 'indices']
+                else 'GL_FALSE'))
+        if conditions:
+            print '   if ({0}) {{'.format(' ||\n       '.join(conditions))
+            self.print_sync_call(f, '      ')
+            print '      return;'
+            print '   }'
+            print ''
+
+        print '   {0}_mesa_glthread_allocate_command(ctx, ' \
+              'DISPATCH_CMD_{1}, cmd_size);'.format(
+                  'cmd = ' if fixed_params or variable_params else '(void) ',
+                  f.name)
+        for p in fixed_params:
+            if is_fixed_array(p):
+                print '   memcpy(cmd->{0}, {0}, {1});'.format(
+                    p.name, p.size())
+            else:
+                print '   cmd->{0} = {0};'.format(p.name)
+        if variable_params:
+            print '   variable_data = (char *) (cmd + 1);'
+            for p in variable_params:
+                print '   cmd->{0}_null = !{0};'.format(p.name)
+                print '   if ({0})'.format(p.name)
+                print '      memcpy(variable_data, {0}, {1} * {2});'.format(
+                    p.name, p.counter, p.size())
+                if p != variable_params[-1]:
+                    print '   variable_data += {0}_size;'.format(p.name)
+        if f.name in tracking_hooks:
+            print '   {0}'.format(tracking_hooks[f.name])
+        print '}'
+        print ''
+        print ''
+
+    def printBody(self, api):
+        functions = sorted(api.functionIterateByOffset(), key = lambda f: f.name)
+        async = [f for f in functions if marshal_mode(f) == 'async']
+
+        print 'enum marshal_dispatch_cmd_id'
+        print '{'
+        for f in async:
+            print '   DISPATCH_CMD_{0},'.format(f.name)
+        print '   NUM_DISPATCH_CMD'
+        print '};'
+        print ''
+        print ''
+
+        for f in functions:
+            if marshal_mode(f) == 'async':
+                self.print_async_functions(f)
+            else:
+                self.print_sync_function(f)
+
+        print '/**'
+        print ' * Execute the command at the given address on the GL thread.'
+        print ' * \\return  size of the command in bytes'
+        print ' */'
+        print 'size_t'
+        print '_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, ' \
+              'const void *cmd)'
+        print '{'
+        print '   const struct marshal_cmd_base *cmd_base = cmd;'
+        print ''
+        print '   switch (cmd_base->cmd_id) {'
+        for f in async:
+            print '   case DISPATCH_CMD_{0}:'.format(f.name)
+            print '      _mesa_unmarshal_{0}(ctx, ' \
+                  '(const struct marshal_cmd_{0} *) cmd);'.format(f.name)
+            print '      break;'
+        print '   default:'
+        print '      assert(!"invalid marshalled command");'
+        print '      break;'
+        print '   }'
+        print ''
+        print '   return cmd_base->cmd_size;'
+        print '}'
+        print ''
+        print ''
+
+        print '/**'
+        print ' * Create the dispatch table the application uses while the GL'
+        print ' * thread is enabled.'
+        print ' */'
+        print 'struct _glapi_table *'
+        print '_mesa_create_marshal_table(const struct gl_context *ctx)'
+        print '{'
+        print '   struct _glapi_table *table;'
+        print ''
+        print '   table = _mesa_alloc_dispatch_table();'
+        print '   if (table == NULL)'
+        print '      return NULL;'
+        print ''
+        for f in functions:
+            print '   SET_{0}(table, _mesa_marshal_{0});'.format(f.name)
+        print ''
+        print '   return table;'
+        print '}'
+
+
+def show_usage():
+    print "Usage: %s [-f input_file_name]" % sys.argv[0]
+    sys.exit(1)
+
+
+if __name__ == '__main__':
+    file_name = "gl_and_es_API.xml"
+
+    try:
+        (args, trail) = getopt.getopt(sys.argv[1:], "m:f:")
+    except Exception,e:
+        show_usage()
+
+    for (arg,val) in args:
+        if arg == "-f":
+            file_name = val
+
+    printer = PrintCode()
+
+    api = gl_XML.parse_GL_API(file_name)
+    printer.Print(api)
@@ -1130,6 +1130,8 @@ static struct name_function functions[] = {
    { "OSMesaGetProcAddress", (OSMESAproc) OSMesaGetProcAddress },
    { "OSMesaColorClamp", (OSMESAproc) OSMesaColorClamp },
    { "OSMesaPostprocess", (OSMESAproc) OSMesaPostprocess },
+   { "OSMesaFlushAsync", (OSMESAproc) OSMesaFlushAsync },
+   { "OSMesaWaitFlush", (OSMESAproc) OSMesaWaitFlush },
    { NULL, NULL }
 };
 
@@ -1169,6 +1171,21 @@ OSMesaPostprocess(OSMesaContext osmesa, const char *filter,
 }
 
 
+GLAPI void GLAPIENTRY
+OSMesaFlushAsync(void)
+{
+   /* swrast renders directly into the user's buffer */
+   _mesa_Flush();
+}
+
+
+GLAPI void GLAPIENTRY
+OSMesaWaitFlush(void)
+{
+   /* nothing to wait for, see OSMesaFlushAsync() */
+}
+
+
 
 /**
  * When GLX_INDIRECT_RENDERING is defined, some symbols are missing in
@@ -82,6 +82,7 @@ struct gl_list_instruction
    void (*Execute)( struct gl_context *ctx, void *data );
    void (*Destroy)( struct gl_context *ctx, void *data );
    void (*Print)( struct gl_context *ctx, void *data );
+   gl_list_merge_func Merge;   /**< optional, see _mesa_dlist_set_merge_func */
 };
 
 
@@ -481,8 +482,9 @@ typedef enum
    /* ARB_uniform_buffer_object */
    OPCODE_UNIFORM_BLOCK_BINDING,
 
-   /* The following three are meta instructions */
+   /* The following four are meta instructions */
    OPCODE_ERROR,                /* raise compiled-in error */
+   OPCODE_NOP,                  /* removed instruction, n[1].ui = size */
    OPCODE_CONTINUE,
    OPCODE_END_OF_LIST,
    OPCODE_EXT_0
@@ -827,6 +829,9 @@ _mesa_delete_list(struct gl_context *ctx, struct gl_display_list *dlist)
             n += InstSize[n[0].opcode];
             break;
 
+         case OPCODE_NOP:
+            n += n[1].ui;
+            break;
          case OPCODE_CONTINUE:
             n = (Node *) get_pointer(&n[1]);
             free(block);
@@ -1104,12 +1109,30 @@ _mesa_dlist_alloc_opcode(struct gl_context *ctx,
       ctx->ListExt->Opcode[i].Execute = execute;
       ctx->ListExt->Opcode[i].Destroy = destroy;
       ctx->ListExt->Opcode[i].Print = print;
+      ctx->ListExt->Opcode[i].Merge = NULL;
       return i + OPCODE_EXT_0;
    }
    return -1;
 }
 
 
+/**
+ * Let glEndList merge runs of the given extension instruction, separated
+ * only by current attribute changes, into fewer instructions.
+ * \param opcode  an opcode returned by _mesa_dlist_alloc_opcode()
+ * \param merge  the merge function, see gl_list_merge_func
+ */
+void
+_mesa_dlist_set_merge_func(struct gl_context *ctx, GLuint opcode,
+                           gl_list_merge_func merge)
+{
+   const GLuint i = opcode - OPCODE_EXT_0;
+
+   ASSERT(opcode >= OPCODE_EXT_0 && i < ctx->ListExt->NumOpcodes);
+   ctx->ListExt->Opcode[i].Merge = merge;
+}
+
+
 /**
  * Allocate space for a display list instruction.  The space is basically
  * an array of Nodes where node[0] holds the opcode, node[1] is the first
@@ -1157,6 +1180,290 @@ trim_list(struct gl_context *ctx)
 }
 
 
+/**
+ * State of the glEndList pass which merges extension instructions, see
+ * merge_list_instructions().
+ */
+struct merge_state
+{
+   GLint opcode;                /**< opcode of the collected items, or -1 */
+
+   struct gl_list_merge_item *items;
+   Node **item_nodes;
+   GLuint num_items, max_items;
+
+   /** Attribute instructions of the items, followed by the pending ones */
+   struct gl_list_attrib_value *attribs;
+   Node **attrib_nodes;
+   GLuint num_attribs, max_attribs;
+
+   /** Attribute instructions found since the last item */
+   GLuint num_pending;
+};
+
+
+/**
+ * Replace an instruction by an OPCODE_NOP of the same size.
+ */
+static void
+remove_instruction(Node *n, GLuint size)
+{
+   ASSERT(size >= 2);
+   n[0].opcode = OPCODE_NOP;
+   n[1].ui = size;
+}
+
+
+/**
+ * If the instruction sets a float current attribute, which a vertex list
+ * could just as well supply per vertex, return its value.
+ */
+static GLboolean
+get_attrib_value(const Node *n, struct gl_list_attrib_value *value)
+{
+   GLuint i;
+
+   switch (n[0].opcode) {
+   case OPCODE_ATTR_1F_NV:
+   case OPCODE_ATTR_2F_NV:
+   case OPCODE_ATTR_3F_NV:
+   case OPCODE_ATTR_4F_NV:
+      value->attr = n[1].e;
+      value->size = n[0].opcode - OPCODE_ATTR_1F_NV + 1;
+      break;
+   case OPCODE_ATTR_1F_ARB:
+   case OPCODE_ATTR_2F_ARB:
+   case OPCODE_ATTR_3F_ARB:
+   case OPCODE_ATTR_4F_ARB:
+      value->attr = VERT_ATTRIB_GENERIC(n[1].e);
+      value->size = n[0].opcode - OPCODE_ATTR_1F_ARB + 1;
+      break;
+   default:
+      return GL_FALSE;
+   }
+
+   /* Setting the position (or generic 0, which may alias it) emits a
+    * vertex rather than changing the current state.
+    */
+   if (value->attr == VERT_ATTRIB_POS || value->attr == VERT_ATTRIB_GENERIC0)
+      return GL_FALSE;
+
+   ASSIGN_4V(value->value, 0.0F, 0.0F, 0.0F, 1.0F);
+   for (i = 0; i < value->size; i++)
+      value->value[i] = n[2 + i].f;
+
+   return GL_TRUE;
+}
+
+
+static GLboolean
+add_merge_attrib(struct merge_state *st, Node *n,
+                 const struct gl_list_attrib_value *value)
+{
+   if (st->num_attribs == st->max_attribs) {
+      const GLuint max = MAX2(2 * st->max_attribs, 64);
+      struct gl_list_attrib_value *attribs =
+         realloc(st->attribs, max * sizeof(*attribs));
+      Node **nodes;
+
+      if (!attribs)
+         return GL_FALSE;
+      st->attribs = attribs;
+
+      nodes = realloc(st->attrib_nodes, max * sizeof(*nodes));
+      if (!nodes)
+         return GL_FALSE;
+      st->attrib_nodes = nodes;
+      st->max_attribs = max;
+   }
+
+   st->attribs[st->num_attribs] = *value;
+   st->attrib_nodes[st->num_attribs] = n;
+   st->num_attribs++;
+   st->num_pending++;
+   return GL_TRUE;
+}
+
+
+static GLboolean
+add_merge_item(struct merge_state *st, Node *n)
+{
+   if (st->num_items == st->max_items) {
+      const GLuint max = MAX2(2 * st->max_items, 64);
+      struct gl_list_merge_item *items =
+         realloc(st->items, max * sizeof(*items));
+      Node **nodes;
+
+      if (!items)
+         return GL_FALSE;
+      st->items = items;
+
+      nodes = realloc(st->item_nodes, max * sizeof(*nodes));
+      if (!nodes)
+         return GL_FALSE;
+      st->item_nodes = nodes;
+      st->max_items = max;
+   }
+
+   st->items[st->num_items].data = &n[1];
+   st->items[st->num_items].attribs = NULL;
+   st->items[st->num_items].num_attribs = st->num_pending;
+   st->item_nodes[st->num_items] = n;
+   st->num_items++;
+   st->num_pending = 0;
+   return GL_TRUE;
+}
+
+
+/**
+ * Hand the collected items to the merge function of their opcode, and
+ * remove the instructions it merged.  The attribute instructions found
+ * after the last item are kept for the next run.
+ */
+static void
+flush_merge_items(struct gl_context *ctx, struct merge_state *st)
+{
+   const GLuint first_pending = st->num_attribs - st->num_pending;
+
+   if (st->num_items) {
+      const struct gl_list_instruction *inst =
+         &ctx->ListExt->Opcode[st->opcode - OPCODE_EXT_0];
+      GLuint i, a;
+
+      for (i = 0, a = 0; i < st->num_items; i++) {
+         st->items[i].attribs = st->attribs + a;
+         a += st->items[i].num_attribs;
+      }
+
+      i = 0;
+      a = 0;
+      while (i < st->num_items) {
+         const GLuint n = inst->Merge(ctx, st->items + i, st->num_items - i);
+         GLuint j, k;
+
+         if (n == 0) {
+            a += st->items[i].num_attribs;
+            i++;
+            continue;
+         }
+
+         ASSERT(n <= st->num_items - i);
+         for (j = i; j < i + n; j++) {
+            for (k = 0; k < st->items[j].num_attribs; k++, a++) {
+               Node *attrib = st->attrib_nodes[a];
+               remove_instruction(attrib, InstSize[attrib[0].opcode]);
+            }
+            if (j > i) {
+               inst->Destroy(ctx, st->items[j].data);
+               remove_instruction(st->item_nodes[j], inst->Size);
+            }
+         }
+         i += n;
+      }
+   }
+
+   memmove(st->attribs, st->attribs + first_pending,
+           st->num_pending * sizeof(*st->attribs));
+   memmove(st->attrib_nodes, st->attrib_nodes + first_pending,
+           st->num_pending * sizeof(*st->attrib_nodes));
+   st->num_attribs = st->num_pending;
+   st->num_items = 0;
+}
+
+
+/**
+ * Called for any instruction which isn't an attribute change or a
+ * mergeable item: the current run ends there.
+ */
+static void
+end_merge_run(struct gl_context *ctx, struct merge_state *st)
+{
+   flush_merge_items(ctx, st);
+   st->num_attribs = 0;
+   st->num_pending = 0;
+   st->opcode = -1;
+}
+
+
+/**
+ * Give the extension instructions which have a merge function (ie. the
+ * vbo module's vertex lists) the chance to merge with the instructions of
+ * the same kind which follow them, when only current attribute changes
+ * stand in between.  Apps replaying lists made of many small glBegin/glEnd
+ * blocks are otherwise dominated by the per-instruction overhead.
+ * Merged instructions are replaced by OPCODE_NOP.
+ */
+static void
+merge_list_instructions(struct gl_context *ctx, struct gl_display_list *dlist)
+{
+   struct merge_state st;
+   Node *n = dlist->Head;
+   GLboolean done = GL_FALSE;
+
+   /* Vertex lists referring to the current attributes are replayed as
+    * immediate mode commands and have to stay as they are.
+    */
+   if (dlist->Flags & DLIST_DANGLING_REFS)
+      return;
+
+   memset(&st, 0, sizeof(st));
+   st.opcode = -1;
+
+   while (!done) {
+      const OpCode opcode = n[0].opcode;
+      struct gl_list_attrib_value value;
+
+      if (is_ext_opcode(opcode)) {
+         const struct gl_list_instruction *inst =
+            &ctx->ListExt->Opcode[opcode - OPCODE_EXT_0];
+
+         if (inst->Merge) {
+            if ((GLint) opcode != st.opcode) {
+               flush_merge_items(ctx, &st);
+               st.opcode = opcode;
+            }
+            if (!add_merge_item(&st, n))
+               break;
+         }
+         else {
+            end_merge_run(ctx, &st);
+         }
+         n += inst->Size;
+      }
+      else if (get_attrib_value(n, &value)) {
+         if (!add_merge_attrib(&st, n, &value))
+            break;
+         n += InstSize[opcode];
+      }
+      else {
+         switch (opcode) {
+         case OPCODE_NOP:
+            n += n[1].ui;
+            break;
+         case OPCODE_CONTINUE:
+            n = (Node *) get_pointer(&n[1]);
+            break;
+         case OPCODE_END_OF_LIST:
+            done = GL_TRUE;
+            break;
+         default:
+            end_merge_run(ctx, &st);
+            n += InstSize[opcode];
+            break;
+         }
+      }
+   }
+
+   /* Whatever was collected is still valid if we ran out of memory */
+   end_merge_run(ctx, &st);
+
+   free(st.items);
+   free(st.item_nodes);
+   free(st.attribs);
+   free(st.attrib_nodes);
+}
+
+
 
 /*
  * Display List compilation functions
@@ -8877,6 +9184,10 @@ execute_list(struct gl_context *ctx, GLuint list)
             CALL_UniformBlockBinding(ctx->Exec, (n[1].ui, n[2].ui, n[3].ui));
             break;
 
+         case OPCODE_NOP:
+            /* InstSize[OPCODE_NOP] is zero, the size is in the node */
+            n += n[1].ui;
+            break;
          case OPCODE_CONTINUE:
             n = (Node *) get_pointer(&n[1]);
             break;
@@ -9067,6 +9378,8 @@ _mesa_EndList(void)
 
    (void) alloc_instruction(ctx, OPCODE_END_OF_LIST, 0);
 
+   merge_list_instructions(ctx, ctx->ListState.CurrentList);
+
    trim_list(ctx);
 
    /* Destroy old list, if any */
@@ -9912,6 +10225,10 @@ print_list(struct gl_context *ctx, GLuint list)
             printf("Error: %s %s\n", enum_string(n[1].e),
                    (const char *) get_pointer(&n[2]));
             break;
+         case OPCODE_NOP:
+            printf("NOP (%u nodes)\n", n[1].ui);
+            n += n[1].ui;
+            break;
          case OPCODE_CONTINUE:
             printf("DISPLAY-LIST-CONTINUE\n");
             n = (Node *) get_pointer(&n[1]);
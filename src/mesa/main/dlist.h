@@ -36,6 +36,43 @@
 #include "main/mtypes.h"
 
 
+/**
+ * Current attribute value set by a glVertexAttrib-like display list
+ * instruction outside of glBegin/glEnd.  See gl_list_merge_item.
+ */
+struct gl_list_attrib_value
+{
+   GLuint attr;        /**< VERT_ATTRIB_x */
+   GLuint size;        /**< number of components given, 1..4 */
+   GLfloat value[4];   /**< padded with (0, 0, 0, 1) */
+};
+
+
+/**
+ * An extension instruction passed to its opcode's merge function at
+ * glEndList, along with the attribute instructions found between the
+ * previous item (or the last instruction which isn't an attribute) and it.
+ */
+struct gl_list_merge_item
+{
+   void *data;                                  /**< instruction payload */
+   const struct gl_list_attrib_value *attribs;  /**< in list order */
+   GLuint num_attribs;
+};
+
+
+/**
+ * Merge the leading \p count items into items[0].data.  Returns the number
+ * of items merged, 0 if items[0] was left untouched.  The attribute values
+ * of the merged items must be accounted for by items[0].data: their
+ * attribute instructions are removed from the list, as are merged items
+ * other than the first one, which are destroyed afterwards.
+ */
+typedef GLuint (*gl_list_merge_func)(struct gl_context *ctx,
+                                     struct gl_list_merge_item *items,
+                                     GLuint count);
+
+
 GLboolean GLAPIENTRY
 _mesa_IsList(GLuint list);
 void GLAPIENTRY
@@ -65,6 +102,9 @@ extern GLint _mesa_dlist_alloc_opcode( struct gl_context *ctx, GLuint sz,
                                        void (*destroy)( struct gl_context *, void * ),
                                        void (*print)( struct gl_context *, void * ) );
 
+extern void _mesa_dlist_set_merge_func(struct gl_context *ctx, GLuint opcode,
+                                       gl_list_merge_func merge);
+
 extern void _mesa_delete_list(struct gl_context *ctx, struct gl_display_list *dlist);
 
 extern void _mesa_initialize_save_table(const struct gl_context *);
@@ -0,0 +1,341 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file glthread.c
+ * The GL thread: batch submission, execution and synchronization.
+ */
+
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/glthread.h"
+#include "main/hash.h"
+#include "main/marshal.h"
+#include "glapi/glapi.h"
+
+
+/**
+ * Execute all the commands of a batch.
+ */
+static void
+glthread_execute_batch(struct gl_context *ctx, struct glthread_batch *batch)
+{
+   size_t pos = 0;
+
+   while (pos < batch->used) {
+      pos += _mesa_unmarshal_dispatch_cmd(ctx,
+                                          (const uint8_t *) batch->buffer + pos);
+   }
+   assert(pos == batch->used);
+   batch->used = 0;
+}
+
+
+static int
+glthread_worker(void *data)
+{
+   struct gl_context *ctx = data;
+   struct glthread_state *glthread = ctx->GLThread;
+
+   _glapi_check_multithread();
+   _glapi_set_context(ctx);
+   _glapi_set_dispatch(ctx->CurrentDispatch);
+
+   mtx_lock(&glthread->mutex);
+   for (;;) {
+      struct glthread_batch *batch;
+
+      while (glthread->queued == 0 && !glthread->shutdown)
+         cnd_wait(&glthread->new_work, &glthread->mutex);
+
+      if (glthread->queued == 0)
+         break;
+
+      batch = &glthread->batches[glthread->first];
+      mtx_unlock(&glthread->mutex);
+
+      glthread_execute_batch(ctx, batch);
+
+      mtx_lock(&glthread->mutex);
+      glthread->first = (glthread->first + 1) % MARSHAL_MAX_BATCHES;
+      glthread->queued--;
+      cnd_broadcast(&glthread->work_done);
+   }
+   mtx_unlock(&glthread->mutex);
+
+   _glapi_set_context(NULL);
+   _glapi_set_dispatch(NULL);
+   return 0;
+}
+
+
+/**
+ * Start the GL thread for the context.  If anything fails, the context
+ * just keeps executing the calls directly.
+ */
+void
+_mesa_glthread_init(struct gl_context *ctx)
+{
+   struct glthread_state *glthread;
+
+   assert(!ctx->GLThread);
+
+   glthread = calloc(1, sizeof(*glthread));
+   if (!glthread)
+      return;
+
+   glthread->VAOElementBuffers = _mesa_NewHashTable();
+   ctx->MarshalExec = _mesa_create_marshal_table(ctx);
+   if (!glthread->VAOElementBuffers || !ctx->MarshalExec)
+      goto fail;
+
+   mtx_init(&glthread->mutex, mtx_plain);
+   cnd_init(&glthread->new_work);
+   cnd_init(&glthread->work_done);
+
+   ctx->GLThread = glthread;
+   _glapi_check_multithread();
+
+   if (thrd_create(&glthread->thread, glthread_worker, ctx) != thrd_success) {
+      ctx->GLThread = NULL;
+      cnd_destroy(&glthread->work_done);
+      cnd_destroy(&glthread->new_work);
+      mtx_destroy(&glthread->mutex);
+      goto fail;
+   }
+
+   if (_mesa_get_current_context() == ctx)
+      _glapi_set_dispatch(ctx->MarshalExec);
+   return;
+
+fail:
+   if (glthread->VAOElementBuffers)
+      _mesa_DeleteHashTable(glthread->VAOElementBuffers);
+   free(ctx->MarshalExec);
+   ctx->MarshalExec = NULL;
+   free(glthread);
+}
+
+
+/**
+ * Execute the pending commands, stop the GL thread and go back to executing
+ * the calls directly.
+ */
+void
+_mesa_glthread_destroy(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread)
+      return;
+
+   _mesa_glthread_finish(ctx);
+
+   mtx_lock(&glthread->mutex);
+   glthread->shutdown = GL_TRUE;
+   cnd_signal(&glthread->new_work);
+   mtx_unlock(&glthread->mutex);
+   thrd_join(glthread->thread, NULL);
+
+   cnd_destroy(&glthread->work_done);
+   cnd_destroy(&glthread->new_work);
+   mtx_destroy(&glthread->mutex);
+   _mesa_DeleteHashTable(glthread->VAOElementBuffers);
+   free(glthread);
+   ctx->GLThread = NULL;
+
+   if (_mesa_get_current_context() == ctx)
+      _glapi_set_dispatch(ctx->CurrentDispatch);
+}
+
+
+/**
+ * Submit the batch being filled to the GL thread, and wait until the next
+ * one is free.
+ */
+void
+_mesa_glthread_flush_batch(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread || glthread->batches[glthread->next].used == 0)
+      return;
+
+   mtx_lock(&glthread->mutex);
+   glthread->queued++;
+   glthread->next = (glthread->next + 1) % MARSHAL_MAX_BATCHES;
+   cnd_signal(&glthread->new_work);
+
+   while (glthread->queued == MARSHAL_MAX_BATCHES)
+      cnd_wait(&glthread->work_done, &glthread->mutex);
+   mtx_unlock(&glthread->mutex);
+}
+
+
+/**
+ * Wait until the GL thread has executed all the commands recorded so far.
+ * Called before anything which needs the context to be up to date, such as
+ * a call which returns a value, or a SwapBuffers.
+ */
+void
+_mesa_glthread_finish(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread)
+      return;
+
+   /* The GL thread itself may end up here, eg. through the state tracker
+    * flushing the context.  There is nothing to wait for then.
+    */
+   if (thrd_equal(thrd_current(), glthread->thread))
+      return;
+
+   _mesa_glthread_flush_batch(ctx);
+
+   mtx_lock(&glthread->mutex);
+   while (glthread->queued)
+      cnd_wait(&glthread->work_done, &glthread->mutex);
+   mtx_unlock(&glthread->mutex);
+}
+
+
+/**
+ * Functions executed synchronously on the application's thread may switch
+ * its dispatch table, eg. glCallLists while compiling a display list.
+ * Make sure the following calls are still recorded.
+ */
+void
+_mesa_glthread_restore_dispatch(struct gl_context *ctx)
+{
+   if (ctx->GLThread && _glapi_get_dispatch() != ctx->MarshalExec)
+      _glapi_set_dispatch(ctx->MarshalExec);
+}
+
+
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   switch (target) {
+   case GL_ARRAY_BUFFER:
+      glthread->CurrentArrayBufferName = buffer;
+      break;
+   case GL_PIXEL_UNPACK_BUFFER:
+      glthread->PixelUnpackBufferName = buffer;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER:
+      glthread->ElementArrayBufferName = buffer;
+      if (glthread->CurrentVAO == 0)
+         glthread->DefaultElementArrayBufferName = buffer;
+      else if (buffer)
+         _mesa_HashInsert(glthread->VAOElementBuffers, glthread->CurrentVAO,
+                          (void *) (uintptr_t) buffer);
+      else
+         _mesa_HashRemove(glthread->VAOElementBuffers, glthread->CurrentVAO);
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (!buffers)
+      return;
+
+   /* Deleting a buffer unbinds it from the current bindings only. */
+   for (i = 0; i < n; i++) {
+      if (!buffers[i])
+         continue;
+      if (buffers[i] == glthread->CurrentArrayBufferName)
+         _mesa_glthread_BindBuffer(ctx, GL_ARRAY_BUFFER, 0);
+      if (buffers[i] == glthread->ElementArrayBufferName)
+         _mesa_glthread_BindBuffer(ctx, GL_ELEMENT_ARRAY_BUFFER, 0);
+      if (buffers[i] == glthread->PixelUnpackBufferName)
+         _mesa_glthread_BindBuffer(ctx, GL_PIXEL_UNPACK_BUFFER, 0);
+   }
+}
+
+
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->CurrentVAO = array;
+   if (array) {
+      glthread->ElementArrayBufferName = (GLuint) (uintptr_t)
+         _mesa_HashLookup(glthread->VAOElementBuffers, array);
+   } else {
+      glthread->ElementArrayBufferName =
+         glthread->DefaultElementArrayBufferName;
+   }
+}
+
+
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (!arrays)
+      return;
+
+   for (i = 0; i < n; i++) {
+      if (!arrays[i])
+         continue;
+      _mesa_HashRemove(glthread->VAOElementBuffers, arrays[i]);
+      if (arrays[i] == glthread->CurrentVAO)
+         _mesa_glthread_BindVertexArray(ctx, 0);
+   }
+}
+
+
+/**
+ * Reload the tracked bindings from the context, after a call which may
+ * have changed them in ways too complex to follow, eg. glPopClientAttrib.
+ * The GL thread must be idle.
+ */
+void
+_mesa_glthread_update_tracking(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   glthread->CurrentArrayBufferName = ctx->Array.ArrayBufferObj->Name;
+   glthread->PixelUnpackBufferName = ctx->Unpack.BufferObj->Name;
+   glthread->CurrentVAO = ctx->Array.VAO->Name;
+   _mesa_glthread_BindBuffer(ctx, GL_ELEMENT_ARRAY_BUFFER,
+                             ctx->Array.VAO->IndexBufferObj->Name);
+}
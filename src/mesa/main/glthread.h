@@ -0,0 +1,202 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file glthread.h
+ * Optional GL thread.
+ *
+ * When enabled, the application's GL calls are recorded into command
+ * batches (see marshal.h) and executed by a separate thread, so that the
+ * application can go on while Mesa validates state and the driver builds
+ * its command stream.  Calls which return a value or write to application
+ * memory make the application's thread wait for the GL thread to go idle
+ * and are then executed directly.
+ */
+
+
+#ifndef GLTHREAD_H
+#define GLTHREAD_H
+
+
+#include "c11/threads.h"
+#include "main/mtypes.h"
+
+
+/** Size of a command batch, in bytes */
+#define MARSHAL_BATCH_SIZE (64 * 1024)
+
+/** Number of batches which can be in flight, including the one filled */
+#define MARSHAL_MAX_BATCHES 4
+
+/**
+ * Largest command which is queued.  Calls with larger arrays are executed
+ * synchronously rather than copied.
+ */
+#define MARSHAL_MAX_CMD_SIZE (8 * 1024)
+
+
+struct glthread_batch
+{
+   /** Number of bytes of buffer[] used by commands */
+   size_t used;
+
+   uint64_t buffer[MARSHAL_BATCH_SIZE / 8];
+};
+
+
+struct glthread_state
+{
+   thrd_t thread;
+
+   /** Protects first, queued and shutdown */
+   mtx_t mutex;
+
+   /** Signalled when a batch is submitted or on shutdown */
+   cnd_t new_work;
+
+   /** Signalled when the GL thread is done with a batch */
+   cnd_t work_done;
+
+   GLboolean shutdown;
+
+   struct glthread_batch batches[MARSHAL_MAX_BATCHES];
+
+   /** Batch the application's thread is filling */
+   unsigned next;
+
+   /** Oldest batch submitted to the GL thread */
+   unsigned first;
+
+   /** Number of submitted batches not yet executed */
+   unsigned queued;
+
+   /**
+    * \name Client state, tracked on the application's thread.
+    *
+    * It is used to tell whether the pointer passed to gl*Pointer,
+    * glDraw*Elements and the pixel unpacking functions are offsets into
+    * buffer objects, which can be queued, or client memory, which the GL
+    * thread could only read after the call has returned.
+    */
+   /*@{*/
+   GLuint CurrentArrayBufferName;
+   GLuint PixelUnpackBufferName;
+   GLuint CurrentVAO;
+   GLuint ElementArrayBufferName;     /**< of CurrentVAO */
+   GLuint DefaultElementArrayBufferName; /**< of VAO 0 */
+
+   /** VAO name -> element array buffer name, for non-zero VAOs */
+   struct _mesa_HashTable *VAOElementBuffers;
+
+   /**
+    * Whether a gl*Pointer call ever specified an array in client memory.
+    * Draw calls are executed synchronously from then on.
+    */
+   GLboolean ClientArrays;
+   /*@}*/
+};
+
+
+extern void
+_mesa_glthread_init(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_destroy(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_flush_batch(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_finish(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_restore_dispatch(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer);
+
+extern void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers);
+
+extern void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array);
+
+extern void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays);
+
+extern void
+_mesa_glthread_update_tracking(struct gl_context *ctx);
+
+
+/**
+ * Whether the array pointer passed to gl*Pointer is an offset into a
+ * buffer object.  If not, remember that client arrays are in use.
+ */
+static inline GLboolean
+_mesa_glthread_array_pointer_is_offset(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (glthread->CurrentArrayBufferName == 0) {
+      glthread->ClientArrays = GL_TRUE;
+      return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Whether the data pointer passed to a pixel unpacking function, like
+ * glCompressedTexImage2D, is client memory which can be copied into the
+ * command.  If not, it's an offset into the bound GL_PIXEL_UNPACK_BUFFER.
+ */
+static inline GLboolean
+_mesa_glthread_unpack_pointer_is_client(const struct gl_context *ctx)
+{
+   return ctx->GLThread->PixelUnpackBufferName == 0;
+}
+
+
+/**
+ * Whether a draw call can be queued, ie. it won't read client memory.
+ */
+static inline GLboolean
+_mesa_glthread_can_queue_draw(const struct gl_context *ctx,
+                              GLboolean has_indices)
+{
+   const struct glthread_state *glthread = ctx->GLThread;
+
+   if (glthread->ClientArrays)
+      return GL_FALSE;
+   if (has_indices && glthread->ElementArrayBufferName == 0)
+      return GL_FALSE;
+   return GL_TRUE;
+}
+
+
+#endif /* GLTHREAD_H */
@@ -0,0 +1,94 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * \file marshal.h
+ * Layout of the commands queued for the GL thread.
+ *
+ * Every command starts with a marshal_cmd_base, followed by the
+ * function's parameters and then the contents of any variable sized
+ * arrays.  Commands are padded to 8 bytes so that the next one is aligned.
+ * The per-function command structures and the code which builds and
+ * executes them are generated by gl_marshal.py into marshal_generated.c.
+ */
+
+
+#ifndef MARSHAL_H
+#define MARSHAL_H
+
+
+#include "main/glthread.h"
+#include "main/macros.h"
+
+
+struct marshal_cmd_base
+{
+   /** Which function the command is for (enum marshal_dispatch_cmd_id) */
+   uint16_t cmd_id;
+
+   /** Total size of the command in bytes, including this header */
+   uint16_t cmd_size;
+};
+
+
+/**
+ * Reserve space for a command in the batch being filled, submitting the
+ * batch to the GL thread first if the command doesn't fit.
+ */
+static inline void *
+_mesa_glthread_allocate_command(struct gl_context *ctx,
+                                uint16_t cmd_id,
+                                size_t size)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_batch *batch;
+   struct marshal_cmd_base *cmd_base;
+
+   size = ALIGN(size, 8);
+   assert(size <= MARSHAL_MAX_CMD_SIZE);
+
+   batch = &glthread->batches[glthread->next];
+   if (batch->used + size > MARSHAL_BATCH_SIZE) {
+      _mesa_glthread_flush_batch(ctx);
+      batch = &glthread->batches[glthread->next];
+   }
+
+   cmd_base = (struct marshal_cmd_base *)
+      ((uint8_t *) batch->buffer + batch->used);
+   batch->used += size;
+   cmd_base->cmd_id = cmd_id;
+   cmd_base->cmd_size = size;
+   return cmd_base;
+}
+
+
+extern size_t
+_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, const void *cmd);
+
+extern struct _glapi_table *
+_mesa_create_marshal_table(const struct gl_context *ctx);
+
+
+#endif /* MARSHAL_H */
@@ -39,6 +39,11 @@
 #include "macros.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
+#include "../../gallium/auxiliary/util/u_parallel.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 
@@ -137,6 +142,198 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
 /*@}*/
 
 
+#ifdef __SSE2__
+/**
+ * \name SSE2 versions of the most common do_row() cases
+ *
+ * These only handle the 2:1 horizontal reduction and return how many
+ * destination pixels they produced; the rest of the row is left to the
+ * generic code.  The results are identical to the generic code.
+ */
+/*@{*/
+
+/**
+ * Add the horizontally adjacent pixel pairs in a vector of eight 16-bit
+ * components.  The four resulting components are returned in the low
+ * 64 bits.
+ */
+static inline __m128i
+add_pixel_pairs_epi16(__m128i v, GLuint comps)
+{
+   switch (comps) {
+   case 1:
+      v = _mm_add_epi16(v, _mm_srli_epi32(v, 16));
+      v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(3, 3, 2, 0));
+      v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(3, 3, 2, 0));
+      return _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 2, 0));
+   case 2:
+      v = _mm_add_epi16(v, _mm_srli_epi64(v, 32));
+      return _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 2, 0));
+   default:
+      return _mm_add_epi16(v, _mm_srli_si128(v, 8));
+   }
+}
+
+
+/** GL_UNSIGNED_BYTE with 1, 2 or 4 components */
+static GLint
+do_row_ubyte_sse2(GLuint comps, const GLubyte *rowA, const GLubyte *rowB,
+                  GLint dstWidth, GLubyte *dst)
+{
+   const __m128i zero = _mm_setzero_si128();
+   const GLint n = dstWidth * comps;
+   GLint i;
+
+   for (i = 0; i + 8 <= n; i += 8) {
+      const __m128i a = _mm_loadu_si128((const __m128i *) (rowA + 2 * i));
+      const __m128i b = _mm_loadu_si128((const __m128i *) (rowB + 2 * i));
+      const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                                       _mm_unpacklo_epi8(b, zero));
+      const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                                       _mm_unpackhi_epi8(b, zero));
+      __m128i sum = _mm_unpacklo_epi64(add_pixel_pairs_epi16(lo, comps),
+                                       add_pixel_pairs_epi16(hi, comps));
+      sum = _mm_srli_epi16(sum, 2);
+      _mm_storel_epi64((__m128i *) (dst + i), _mm_packus_epi16(sum, sum));
+   }
+
+   return i / comps;
+}
+
+
+/**
+ * Average four vectors of 5/6/5 pixels held in the low 16 bits of each
+ * 32-bit lane.
+ */
+static inline __m128i
+average_565_epi32(__m128i a0, __m128i a1, __m128i b0, __m128i b1)
+{
+   const __m128i rmask = _mm_set1_epi32(0x001f);
+   const __m128i gmask = _mm_set1_epi32(0x07e0);
+   const __m128i bmask = _mm_set1_epi32(0xf800);
+   __m128i r, g, b;
+
+   r = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a0, rmask),
+                                   _mm_and_si128(a1, rmask)),
+                     _mm_add_epi32(_mm_and_si128(b0, rmask),
+                                   _mm_and_si128(b1, rmask)));
+   g = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a0, gmask),
+                                   _mm_and_si128(a1, gmask)),
+                     _mm_add_epi32(_mm_and_si128(b0, gmask),
+                                   _mm_and_si128(b1, gmask)));
+   b = _mm_add_epi32(_mm_add_epi32(_mm_and_si128(a0, bmask),
+                                   _mm_and_si128(a1, bmask)),
+                     _mm_add_epi32(_mm_and_si128(b0, bmask),
+                                   _mm_and_si128(b1, bmask)));
+
+   r = _mm_srli_epi32(r, 2);
+   g = _mm_and_si128(_mm_srli_epi32(g, 2), gmask);
+   b = _mm_and_si128(_mm_srli_epi32(b, 2), bmask);
+
+   /* sign extend so that the saturating pack keeps all 16 bits */
+   return _mm_srai_epi32(_mm_slli_epi32(_mm_or_si128(_mm_or_si128(r, g), b),
+                                        16), 16);
+}
+
+
+/** GL_UNSIGNED_SHORT_5_6_5 */
+static GLint
+do_row_565_sse2(const GLushort *rowA, const GLushort *rowB,
+                GLint dstWidth, GLushort *dst)
+{
+   const __m128i lomask = _mm_set1_epi32(0xffff);
+   GLint i;
+
+   for (i = 0; i + 8 <= dstWidth; i += 8) {
+      const __m128i a0 = _mm_loadu_si128((const __m128i *) (rowA + 2 * i));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *) (rowA + 2 * i + 8));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *) (rowB + 2 * i));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *) (rowB + 2 * i + 8));
+      const __m128i lo =
+         average_565_epi32(_mm_and_si128(a0, lomask), _mm_srli_epi32(a0, 16),
+                           _mm_and_si128(b0, lomask), _mm_srli_epi32(b0, 16));
+      const __m128i hi =
+         average_565_epi32(_mm_and_si128(a1, lomask), _mm_srli_epi32(a1, 16),
+                           _mm_and_si128(b1, lomask), _mm_srli_epi32(b1, 16));
+      _mm_storeu_si128((__m128i *) (dst + i), _mm_packs_epi32(lo, hi));
+   }
+
+   return i;
+}
+
+
+/** GL_FLOAT with 1, 2 or 4 components */
+static GLint
+do_row_float_sse2(GLuint comps, const GLfloat *rowA, const GLfloat *rowB,
+                  GLint dstWidth, GLfloat *dst)
+{
+   const __m128 quarter = _mm_set1_ps(0.25F);
+   const GLint n = dstWidth * comps;
+   GLint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128 a0 = _mm_loadu_ps(rowA + 2 * i);
+      const __m128 a1 = _mm_loadu_ps(rowA + 2 * i + 4);
+      const __m128 b0 = _mm_loadu_ps(rowB + 2 * i);
+      const __m128 b1 = _mm_loadu_ps(rowB + 2 * i + 4);
+      __m128 aj, ak, bj, bk;
+
+      switch (comps) {
+      case 1:
+         aj = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+         ak = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+         bj = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+         bk = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+         break;
+      case 2:
+         aj = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(1, 0, 1, 0));
+         ak = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 2, 3, 2));
+         bj = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(1, 0, 1, 0));
+         bk = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 2, 3, 2));
+         break;
+      default:
+         aj = a0;
+         ak = a1;
+         bj = b0;
+         bk = b1;
+         break;
+      }
+
+      /* same order of operations as the generic code */
+      _mm_storeu_ps(dst + i,
+                    _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_add_ps(aj, ak), bj),
+                                          bk),
+                               quarter));
+   }
+
+   return i / comps;
+}
+
+
+/**
+ * \return number of destination pixels done, 0 if the format has no
+ *         SSE2 path
+ */
+static GLint
+do_row_sse2(GLenum datatype, GLuint comps,
+            const GLvoid *srcRowA, const GLvoid *srcRowB,
+            GLint dstWidth, GLvoid *dstRow)
+{
+   if (datatype == GL_UNSIGNED_BYTE && comps != 3) {
+      return do_row_ubyte_sse2(comps, srcRowA, srcRowB, dstWidth, dstRow);
+   }
+   else if (datatype == GL_UNSIGNED_SHORT_5_6_5 && comps == 3) {
+      return do_row_565_sse2(srcRowA, srcRowB, dstWidth, dstRow);
+   }
+   else if (datatype == GL_FLOAT && comps != 3) {
+      return do_row_float_sse2(comps, srcRowA, srcRowB, dstWidth, dstRow);
+   }
+   return 0;
+}
+/*@}*/
+#endif /* __SSE2__ */
+
+
 /**
  * Average together two rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -146,9 +343,9 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
  * \param comps  number of components per pixel (1..4)
  */
 static void
-do_row(GLenum datatype, GLuint comps, GLint srcWidth,
-       const GLvoid *srcRowA, const GLvoid *srcRowB,
-       GLint dstWidth, GLvoid *dstRow)
+do_row_generic(GLenum datatype, GLuint comps, GLint srcWidth,
+               const GLvoid *srcRowA, const GLvoid *srcRowB,
+               GLint dstWidth, GLvoid *dstRow)
 {
    const GLuint k0 = (srcWidth == dstWidth) ? 0 : 1;
    const GLuint colStride = (srcWidth == dstWidth) ? 1 : 2;
@@ -761,6 +958,40 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
 }
 
 
+/**
+ * Average together two rows of a source image to produce a single new
+ * row in the dest image.  Uses the SSE2 code for as much of the row as
+ * it can and do_row_generic() for everything else.
+ */
+static void
+do_row(GLenum datatype, GLuint comps, GLint srcWidth,
+       const GLvoid *srcRowA, const GLvoid *srcRowB,
+       GLint dstWidth, GLvoid *dstRow)
+{
+#ifdef __SSE2__
+   if (srcWidth != dstWidth) {
+      const GLint done = do_row_sse2(datatype, comps, srcRowA, srcRowB,
+                                     dstWidth, dstRow);
+      if (done > 0) {
+         const GLint bpt = bytes_per_pixel(datatype, comps);
+
+         if (done == dstWidth)
+            return;
+
+         srcRowA = (const GLubyte *) srcRowA + 2 * done * bpt;
+         srcRowB = (const GLubyte *) srcRowB + 2 * done * bpt;
+         dstRow = (GLubyte *) dstRow + done * bpt;
+         srcWidth -= 2 * done;
+         dstWidth -= done;
+      }
+   }
+#endif
+
+   do_row_generic(datatype, comps, srcWidth, srcRowA, srcRowB,
+                  dstWidth, dstRow);
+}
+
+
 /**
  * Average together four rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -1405,6 +1636,121 @@ do_row_3D(GLenum datatype, GLuint comps, GLint srcWidth,
 }
 
 
+/**
+ * \name Multi-threaded filtering of a mipmap level
+ *
+ * The destination rows of a big enough level are split into bands which
+ * are filtered in parallel.  The threads only live for the duration of
+ * one level; creating them is cheap next to filtering the levels that are
+ * big enough to be split.
+ */
+/*@{*/
+
+/** Don't bother with a thread for less than this many dest texels */
+#define MIN_TEXELS_PER_THREAD (64 * 1024)
+
+/**
+ * A band of destination rows of a 2D image or of one slice of a 3D image.
+ * srcC and srcD are only used for 3D images.
+ */
+struct mipmap_band
+{
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth;
+   const GLubyte *srcA, *srcB, *srcC, *srcD;
+   GLint srcStep;       /**< bytes between the source rows of two dest rows */
+   GLint dstWidth;
+   GLubyte *dst;
+   GLint dstRowStride;
+   GLint rows;
+};
+
+
+/**
+ * Number of threads to use for filtering.  Can be overridden with the
+ * MESA_MIPMAP_THREADS environment variable (1 disables threading).
+ */
+static unsigned
+mipmap_max_threads(void)
+{
+   static int max_threads = 0;
+
+   if (max_threads == 0) {
+      const char *env = _mesa_getenv("MESA_MIPMAP_THREADS");
+
+      max_threads = env ? MAX2(atoi(env), 1) : util_parallel_max_threads();
+   }
+
+   return max_threads;
+}
+
+
+static void
+filter_band(const struct mipmap_band *band)
+{
+   const GLubyte *srcA = band->srcA, *srcB = band->srcB;
+   const GLubyte *srcC = band->srcC, *srcD = band->srcD;
+   GLubyte *dst = band->dst;
+   GLint row;
+
+   for (row = 0; row < band->rows; row++) {
+      if (srcC) {
+         do_row_3D(band->datatype, band->comps, band->srcWidth,
+                   srcA, srcB, srcC, srcD, band->dstWidth, dst);
+         srcC += band->srcStep;
+         srcD += band->srcStep;
+      }
+      else {
+         do_row(band->datatype, band->comps, band->srcWidth,
+                srcA, srcB, band->dstWidth, dst);
+      }
+      srcA += band->srcStep;
+      srcB += band->srcStep;
+      dst += band->dstRowStride;
+   }
+}
+
+
+/** util_parallel_rows() callback filtering some of the rows of a band */
+static void
+filter_band_rows(void *data, unsigned first, unsigned count)
+{
+   struct mipmap_band band = *(const struct mipmap_band *) data;
+
+   band.rows = count;
+   band.srcA += first * band.srcStep;
+   band.srcB += first * band.srcStep;
+   if (band.srcC) {
+      band.srcC += first * band.srcStep;
+      band.srcD += first * band.srcStep;
+   }
+   band.dst += first * band.dstRowStride;
+
+   filter_band(&band);
+}
+
+
+/**
+ * Filter all the rows described by 'band', splitting them across
+ * several threads if there are enough of them.
+ */
+static void
+filter_rows(const struct mipmap_band *band)
+{
+   const unsigned numBands =
+      MIN2(mipmap_max_threads(),
+           (band->rows * band->dstWidth) / MIN_TEXELS_PER_THREAD);
+
+   if (band->rows <= 0)
+      return;
+
+   util_parallel_rows(band->rows, numBands, filter_band_rows,
+                      (void *) band);
+}
+/*@}*/
+
+
 /*
  * These functions generate a 1/2-size mipmap image from a source image.
  * Texture borders are handled by copying or averaging the source image's
@@ -1455,6 +1801,7 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
    const GLubyte *srcA, *srcB;
    GLubyte *dst;
    GLint row, srcRowStep;
+   struct mipmap_band band;
 
    /* Compute src and dst pointers, skipping any border */
    srcA = srcPtr + border * ((srcWidth + 1) * bpt);
@@ -1471,13 +1818,18 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
 
    dst = dstPtr + border * ((dstWidth + 1) * bpt);
 
-   for (row = 0; row < dstHeightNB; row++) {
-      do_row(datatype, comps, srcWidthNB, srcA, srcB,
-             dstWidthNB, dst);
-      srcA += srcRowStep * srcRowStride;
-      srcB += srcRowStep * srcRowStride;
-      dst += dstRowStride;
-   }
+   band.datatype = datatype;
+   band.comps = comps;
+   band.srcWidth = srcWidthNB;
+   band.srcA = srcA;
+   band.srcB = srcB;
+   band.srcC = band.srcD = NULL;
+   band.srcStep = srcRowStep * srcRowStride;
+   band.dstWidth = dstWidthNB;
+   band.dst = dst;
+   band.dstRowStride = dstRowStride;
+   band.rows = dstHeightNB;
+   filter_rows(&band);
 
    /* This is ugly but probably won't be used much */
    if (border > 0) {
@@ -1546,7 +1898,7 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
    const GLint dstWidthNB = dstWidth - 2 * border;
    const GLint dstHeightNB = dstHeight - 2 * border;
    const GLint dstDepthNB = dstDepth - 2 * border;
-   GLint img, row;
+   GLint img;
    GLint bytesPerSrcImage, bytesPerDstImage;
    GLint srcImageOffset, srcRowOffset;
 
@@ -1586,26 +1938,22 @@ make_3d_mipmap(GLenum datatype, GLuint comps, GLint border,
       GLubyte *imgDst = dstPtr[img + border]
          + dstRowStride * border + bpt * border;
 
+      struct mipmap_band band;
+
       /* setup the four source row pointers and the dest row pointer */
-      const GLubyte *srcImgARowA = imgSrcA;
-      const GLubyte *srcImgARowB = imgSrcA + srcRowOffset;
-      const GLubyte *srcImgBRowA = imgSrcB;
-      const GLubyte *srcImgBRowB = imgSrcB + srcRowOffset;
-      GLubyte *dstImgRow = imgDst;
-
-      for (row = 0; row < dstHeightNB; row++) {
-         do_row_3D(datatype, comps, srcWidthNB, 
-                   srcImgARowA, srcImgARowB,
-                   srcImgBRowA, srcImgBRowB,
-                   dstWidthNB, dstImgRow);
-
-         /* advance to next rows */
-         srcImgARowA += srcRowStride + srcRowOffset;
-         srcImgARowB += srcRowStride + srcRowOffset;
-         srcImgBRowA += srcRowStride + srcRowOffset;
-         srcImgBRowB += srcRowStride + srcRowOffset;
-         dstImgRow += dstRowStride;
-      }
+      band.datatype = datatype;
+      band.comps = comps;
+      band.srcWidth = srcWidthNB;
+      band.srcA = imgSrcA;
+      band.srcB = imgSrcA + srcRowOffset;
+      band.srcC = imgSrcB;
+      band.srcD = imgSrcB + srcRowOffset;
+      band.srcStep = srcRowStride + srcRowOffset;
+      band.dstWidth = dstWidthNB;
+      band.dst = imgDst;
+      band.dstRowStride = dstRowStride;
+      band.rows = dstHeightNB;
+      filter_rows(&band);
    }
 
 
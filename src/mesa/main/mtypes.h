@@ -81,6 +81,7 @@ struct gl_context;
 struct st_context;
 struct gl_uniform_storage;
 struct prog_instruction;
+struct glthread_state;
 struct gl_program_parameter_list;
 struct set;
 struct set_entry;
@@ -4025,8 +4026,17 @@ struct gl_context
     * re-set on glXMakeCurrent().
     */
    struct _glapi_table *CurrentDispatch;
+   /**
+    * The dispatch table used on the application's thread while the GL
+    * thread is enabled.  It records the calls for the GL thread, which
+    * then executes them with CurrentDispatch.
+    */
+   struct _glapi_table *MarshalExec;
    /*@}*/
 
+   /** Optional GL thread state, NULL if not enabled (see glthread.h) */
+   struct glthread_state *GLThread;
+
    struct gl_config Visual;
    struct gl_framebuffer *DrawBuffer;	/**< buffer for writing */
    struct gl_framebuffer *ReadBuffer;	/**< buffer for reading */
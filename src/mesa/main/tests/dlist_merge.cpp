@@ -0,0 +1,416 @@
+/*
+ * Copyright © 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks that the display lists which glEndList merges (see
+ * merge_list_instructions() and vbo_save_merge_vertex_lists()) draw the
+ * same vertices as the immediate mode commands they were compiled from.
+ *
+ * The context has no driver: the vbo module's draw function is replaced
+ * by one recording the primitives and the vertices it is given.
+ */
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/bufferobj.h"
+#include "main/context.h"
+#include "main/framebuffer.h"
+#include "main/vtxfmt.h"
+#include "glapi/glapi.h"
+#include "drivers/common/driverfuncs.h"
+
+#include "vbo/vbo.h"
+#include "vbo/vbo_save.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+}
+
+namespace {
+   struct vertex {
+      GLfloat pos[4];
+      GLfloat color[4];
+
+      bool
+      operator==(const vertex &v) const
+      {
+         return memcmp(pos, v.pos, sizeof(pos)) == 0 &&
+                memcmp(color, v.color, sizeof(color)) == 0;
+      }
+   };
+
+   struct prim {
+      GLenum mode;
+      std::vector<vertex> verts;
+   };
+
+   std::vector<prim> drawn;
+   unsigned num_draws;
+   unsigned num_indexed_draws;
+   bool restart_in_indexed_draw;
+
+   const GLubyte *
+   buffer_pointer(const struct gl_buffer_object *obj, const GLvoid *ptr)
+   {
+      if (_mesa_is_bufferobj(obj))
+         return obj->Data + (uintptr_t) ptr;
+      return (const GLubyte *) ptr;
+   }
+
+   void
+   fetch_attrib(const struct gl_client_array *array, GLuint i,
+                GLfloat value[4])
+   {
+      const GLfloat *src = (const GLfloat *)
+         (buffer_pointer(array->BufferObj, array->Ptr) + i * array->StrideB);
+      GLint c;
+
+      value[0] = value[1] = value[2] = 0.0F;
+      value[3] = 1.0F;
+      for (c = 0; c < array->Size; c++)
+         value[c] = src[c];
+   }
+
+   GLuint
+   fetch_index(const struct _mesa_index_buffer *ib, GLuint i)
+   {
+      const GLubyte *indices = buffer_pointer(ib->obj, ib->ptr);
+
+      switch (ib->type) {
+      case GL_UNSIGNED_BYTE:
+         return indices[i];
+      case GL_UNSIGNED_SHORT:
+         return ((const GLushort *) indices)[i];
+      default:
+         return ((const GLuint *) indices)[i];
+      }
+   }
+
+   void
+   record_draw(struct gl_context *ctx,
+               const struct _mesa_prim *prims, GLuint nr_prims,
+               const struct _mesa_index_buffer *ib,
+               GLboolean index_bounds_valid,
+               GLuint min_index, GLuint max_index,
+               struct gl_transform_feedback_object *tfb_vertcount,
+               struct gl_buffer_object *indirect)
+   {
+      const struct gl_client_array **arrays = ctx->Array._DrawArrays;
+      GLuint i, j;
+
+      num_draws++;
+      if (ib) {
+         num_indexed_draws++;
+         if (ctx->Array._PrimitiveRestart)
+            restart_in_indexed_draw = true;
+      }
+
+      for (i = 0; i < nr_prims; i++) {
+         prim p;
+
+         p.mode = prims[i].mode;
+         for (j = prims[i].start; j < prims[i].start + prims[i].count; j++) {
+            const GLuint index =
+               (ib ? fetch_index(ib, j) : j) + prims[i].basevertex;
+            vertex v;
+
+            fetch_attrib(arrays[VERT_ATTRIB_POS], index, v.pos);
+            fetch_attrib(arrays[VERT_ATTRIB_COLOR0], index, v.color);
+            p.verts.push_back(v);
+         }
+         drawn.push_back(p);
+      }
+   }
+
+   /**
+    * Join consecutive independent primitives of the same type, which
+    * draw the same whether they are merged or not.
+    */
+   std::vector<prim>
+   normalize(const std::vector<prim> &prims)
+   {
+      std::vector<prim> result;
+
+      for (size_t i = 0; i < prims.size(); i++) {
+         const GLenum mode = prims[i].mode;
+         const bool independent = mode == GL_POINTS || mode == GL_LINES ||
+                                  mode == GL_TRIANGLES || mode == GL_QUADS;
+
+         if (independent && !result.empty() && result.back().mode == mode) {
+            result.back().verts.insert(result.back().verts.end(),
+                                       prims[i].verts.begin(),
+                                       prims[i].verts.end());
+         }
+         else {
+            result.push_back(prims[i]);
+         }
+      }
+
+      return result;
+   }
+}
+
+class dlist_merge_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   /* The commands compiled into the lists, or run in immediate mode */
+   void emit_mixed();
+
+   void flush();
+
+   /* What is drawn by fn in immediate mode, and by a list compiled
+    * from it.
+    */
+   std::vector<prim> draw_immediate(void (dlist_merge_test::*fn)());
+   std::vector<prim> draw_list(GLuint list);
+   GLuint compile(void (dlist_merge_test::*fn)());
+
+   void check_same(const std::vector<prim> &expected,
+                   const std::vector<prim> &actual);
+
+   struct gl_config visual;
+   struct dd_function_table driver_functions;
+   struct gl_context ctx;
+   struct gl_framebuffer *fb;
+};
+
+void
+dlist_merge_test::SetUp()
+{
+   memset(&visual, 0, sizeof(visual));
+   memset(&driver_functions, 0, sizeof(driver_functions));
+   memset(&ctx, 0, sizeof(ctx));
+
+   /* read when the vbo module registers its merge function */
+   unsetenv("MESA_NO_DLIST_MERGE");
+
+   _mesa_init_driver_functions(&driver_functions);
+   _mesa_initialize_context(&ctx, API_OPENGL_COMPAT, &visual, NULL,
+                            &driver_functions);
+   _vbo_CreateContext(&ctx);
+   vbo_set_draw_func(&ctx, record_draw);
+
+   ctx.Version = 21;
+
+   _mesa_initialize_dispatch_tables(&ctx);
+   _mesa_initialize_vbo_vtxfmt(&ctx);
+
+   fb = _mesa_create_framebuffer(&visual);
+   _mesa_make_current(&ctx, fb, fb);
+
+   drawn.clear();
+   num_draws = 0;
+   num_indexed_draws = 0;
+   restart_in_indexed_draw = false;
+}
+
+void
+dlist_merge_test::TearDown()
+{
+   _vbo_DestroyContext(&ctx);
+   _mesa_free_context_data(&ctx);
+   _mesa_reference_framebuffer(&fb, NULL);
+}
+
+/**
+ * Begin/End pairs of several types, current colors set between and within
+ * them, and a repeated vertex.
+ */
+void
+dlist_merge_test::emit_mixed()
+{
+   CALL_Color3f(GET_DISPATCH(), (1.0F, 0.0F, 0.0F));
+   CALL_Begin(GET_DISPATCH(), (GL_TRIANGLES));
+   CALL_Vertex2f(GET_DISPATCH(), (0.0F, 0.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (1.0F, 0.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (0.0F, 1.0F));
+   CALL_End(GET_DISPATCH(), ());
+
+   CALL_Color3f(GET_DISPATCH(), (0.0F, 1.0F, 0.0F));
+   CALL_Begin(GET_DISPATCH(), (GL_TRIANGLES));
+   CALL_Vertex2f(GET_DISPATCH(), (0.0F, 0.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (1.0F, 0.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (0.0F, 1.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (0.0F, 0.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (1.0F, 1.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (1.0F, 0.0F));
+   CALL_End(GET_DISPATCH(), ());
+
+   CALL_Begin(GET_DISPATCH(), (GL_LINES));
+   CALL_Color3f(GET_DISPATCH(), (0.0F, 0.0F, 1.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (0.0F, 0.0F));
+   CALL_Color3f(GET_DISPATCH(), (1.0F, 1.0F, 0.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (1.0F, 1.0F));
+   CALL_End(GET_DISPATCH(), ());
+
+   CALL_Color4f(GET_DISPATCH(), (0.5F, 0.5F, 0.5F, 0.5F));
+   CALL_Begin(GET_DISPATCH(), (GL_TRIANGLE_STRIP));
+   CALL_Vertex3f(GET_DISPATCH(), (0.0F, 0.0F, 1.0F));
+   CALL_Vertex3f(GET_DISPATCH(), (1.0F, 0.0F, 1.0F));
+   CALL_Vertex3f(GET_DISPATCH(), (0.0F, 1.0F, 1.0F));
+   CALL_Vertex3f(GET_DISPATCH(), (1.0F, 1.0F, 1.0F));
+   CALL_End(GET_DISPATCH(), ());
+
+   CALL_Begin(GET_DISPATCH(), (GL_TRIANGLES));
+   CALL_Vertex2f(GET_DISPATCH(), (2.0F, 2.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (3.0F, 2.0F));
+   CALL_Vertex2f(GET_DISPATCH(), (2.0F, 3.0F));
+   CALL_End(GET_DISPATCH(), ());
+
+   CALL_Color3f(GET_DISPATCH(), (0.25F, 0.75F, 0.0F));
+   CALL_Begin(GET_DISPATCH(), (GL_POINTS));
+   CALL_Vertex2f(GET_DISPATCH(), (4.0F, 4.0F));
+   CALL_End(GET_DISPATCH(), ());
+}
+
+void
+dlist_merge_test::flush()
+{
+   struct gl_context *c = &ctx;
+
+   FLUSH_VERTICES(c, 0);
+}
+
+std::vector<prim>
+dlist_merge_test::draw_immediate(void (dlist_merge_test::*fn)())
+{
+   drawn.clear();
+   (this->*fn)();
+   flush();
+   return normalize(drawn);
+}
+
+GLuint
+dlist_merge_test::compile(void (dlist_merge_test::*fn)())
+{
+   const GLuint list = CALL_GenLists(GET_DISPATCH(), (1));
+
+   CALL_NewList(GET_DISPATCH(), (list, GL_COMPILE));
+   (this->*fn)();
+   CALL_EndList(GET_DISPATCH(), ());
+
+   return list;
+}
+
+std::vector<prim>
+dlist_merge_test::draw_list(GLuint list)
+{
+   drawn.clear();
+   num_draws = 0;
+   num_indexed_draws = 0;
+
+   CALL_CallList(GET_DISPATCH(), (list));
+   flush();
+   return normalize(drawn);
+}
+
+void
+dlist_merge_test::check_same(const std::vector<prim> &expected,
+                             const std::vector<prim> &actual)
+{
+   size_t i, j;
+
+   ASSERT_EQ(expected.size(), actual.size());
+   for (i = 0; i < expected.size(); i++) {
+      EXPECT_EQ(expected[i].mode, actual[i].mode) << "prim " << i;
+      ASSERT_EQ(expected[i].verts.size(), actual[i].verts.size())
+         << "prim " << i;
+      for (j = 0; j < expected[i].verts.size(); j++) {
+         EXPECT_TRUE(expected[i].verts[j] == actual[i].verts[j])
+            << "prim " << i << ", vertex " << j;
+      }
+   }
+}
+
+TEST_F(dlist_merge_test, mixed_prims_and_attributes)
+{
+   const std::vector<prim> expected =
+      draw_immediate(&dlist_merge_test::emit_mixed);
+   const GLuint list = compile(&dlist_merge_test::emit_mixed);
+
+   /* Start from another current color than the one the commands end
+    * with, so that the list has to set it.
+    */
+   CALL_Color3f(GET_DISPATCH(), (0.0F, 0.0F, 0.0F));
+
+   check_same(expected, draw_list(list));
+
+   /* the lists were merged into an indexed one */
+   EXPECT_EQ(1u, num_indexed_draws);
+
+   EXPECT_EQ(0.25F, ctx.Current.Attrib[VERT_ATTRIB_COLOR0][0]);
+   EXPECT_EQ(0.75F, ctx.Current.Attrib[VERT_ATTRIB_COLOR0][1]);
+   EXPECT_EQ(0.0F, ctx.Current.Attrib[VERT_ATTRIB_COLOR0][2]);
+   EXPECT_EQ(1.0F, ctx.Current.Attrib[VERT_ATTRIB_COLOR0][3]);
+}
+
+TEST_F(dlist_merge_test, primitive_restart)
+{
+   const std::vector<prim> expected =
+      draw_immediate(&dlist_merge_test::emit_mixed);
+   const GLuint list = compile(&dlist_merge_test::emit_mixed);
+
+   /* Vertex 0 of the merged list would restart the primitives if the
+    * application's restart index applied to its indices.
+    */
+   ctx.Array.PrimitiveRestart = GL_TRUE;
+   ctx.Array.RestartIndex = 0;
+   ctx.Array._PrimitiveRestart = GL_TRUE;
+   restart_in_indexed_draw = false;
+
+   check_same(expected, draw_list(list));
+
+   EXPECT_EQ(1u, num_indexed_draws);
+   EXPECT_FALSE(restart_in_indexed_draw);
+   EXPECT_TRUE(ctx.Array._PrimitiveRestart);
+}
+
+TEST_F(dlist_merge_test, loopback)
+{
+   const std::vector<prim> expected =
+      draw_immediate(&dlist_merge_test::emit_mixed);
+   const GLuint list = compile(&dlist_merge_test::emit_mixed);
+
+   /* Replay the list as immediate mode commands, following its indices */
+   vbo_save_fallback(&ctx, GL_TRUE);
+   CALL_Color3f(GET_DISPATCH(), (0.0F, 0.0F, 0.0F));
+
+   check_same(expected, draw_list(list));
+   EXPECT_EQ(0u, num_indexed_draws);
+
+   vbo_save_fallback(&ctx, GL_FALSE);
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright © 2014 VMware, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks that the calls marshalled for the GL thread fall back to being
+ * executed on the application's thread when their pointers aren't client
+ * memory which can be copied: vertex arrays in client memory, and image
+ * data in a bound GL_PIXEL_UNPACK_BUFFER.
+ *
+ * The GL thread runs the calls through a dispatch table recording what it
+ * was called with, rather than through a real context.
+ */
+
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "GL/gl.h"
+#include "GL/glext.h"
+#include "main/compiler.h"
+#include "main/api_exec.h"
+#include "main/glthread.h"
+#include "glapi/glapi.h"
+
+#ifndef GLAPIENTRYP
+#define GLAPIENTRYP GL_APIENTRYP
+#endif
+
+#include "main/dispatch.h"
+}
+
+namespace {
+   struct call {
+      /* whether the call was executed on the application's thread */
+      bool sync;
+      const void *pointer;
+      uint8_t first_byte;
+   };
+
+   pthread_t app_thread;
+   struct call last_call;
+   unsigned num_calls;
+
+   void
+   record(const void *pointer, bool read_pointer)
+   {
+      last_call.sync = pthread_equal(pthread_self(), app_thread);
+      last_call.pointer = pointer;
+      last_call.first_byte = read_pointer ? *(const uint8_t *) pointer : 0;
+      num_calls++;
+   }
+
+   bool
+   on_gl_thread()
+   {
+      return !pthread_equal(pthread_self(), app_thread);
+   }
+
+   void GLAPIENTRY
+   record_BindBuffer(GLenum target, GLuint buffer)
+   {
+   }
+
+   void GLAPIENTRY
+   record_CompressedTexImage2D(GLenum target, GLint level,
+                               GLenum internalformat, GLsizei width,
+                               GLsizei height, GLint border,
+                               GLsizei imageSize, const GLvoid *data)
+   {
+      /* only a copy made by the marshalling can be read */
+      record(data, on_gl_thread());
+   }
+
+   void GLAPIENTRY
+   record_PixelMapfv(GLenum map, GLsizei mapsize, const GLfloat *values)
+   {
+      record(values, false);
+   }
+
+   void GLAPIENTRY
+   record_VertexPointer(GLint size, GLenum type, GLsizei stride,
+                        const GLvoid *pointer)
+   {
+      record(pointer, false);
+   }
+
+   void GLAPIENTRY
+   record_DrawArrays(GLenum mode, GLint first, GLsizei count)
+   {
+      record(NULL, false);
+   }
+
+   void GLAPIENTRY
+   record_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                       const GLvoid *indices)
+   {
+      record(indices, false);
+   }
+}
+
+class glthread_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   /* the result of the last call, once the GL thread is idle */
+   struct call finish();
+
+   struct gl_context *ctx;
+   struct _glapi_table *exec;
+};
+
+void
+glthread_test::SetUp()
+{
+   app_thread = pthread_self();
+   memset(&last_call, 0, sizeof(last_call));
+   num_calls = 0;
+
+   ctx = (struct gl_context *) calloc(1, sizeof(*ctx));
+
+   ctx->CurrentDispatch = _mesa_alloc_dispatch_table();
+   SET_BindBuffer(ctx->CurrentDispatch, record_BindBuffer);
+   SET_CompressedTexImage2D(ctx->CurrentDispatch,
+                            record_CompressedTexImage2D);
+   SET_PixelMapfv(ctx->CurrentDispatch, record_PixelMapfv);
+   SET_VertexPointer(ctx->CurrentDispatch, record_VertexPointer);
+   SET_DrawArrays(ctx->CurrentDispatch, record_DrawArrays);
+   SET_DrawElements(ctx->CurrentDispatch, record_DrawElements);
+
+   _glapi_set_context(ctx);
+   _glapi_set_dispatch(ctx->CurrentDispatch);
+
+   _mesa_glthread_init(ctx);
+   ASSERT_TRUE(ctx->GLThread != NULL);
+   exec = ctx->MarshalExec;
+}
+
+void
+glthread_test::TearDown()
+{
+   _mesa_glthread_destroy(ctx);
+   _glapi_set_dispatch(NULL);
+   _glapi_set_context(NULL);
+
+   free(ctx->MarshalExec);
+   free(ctx->CurrentDispatch);
+   free(ctx);
+}
+
+struct call
+glthread_test::finish()
+{
+   _mesa_glthread_finish(ctx);
+   return last_call;
+}
+
+TEST_F(glthread_test, compressed_image_from_client_memory_is_copied)
+{
+   static const uint8_t data[8] = { 0x5a };
+   struct call c;
+
+   CALL_CompressedTexImage2D(exec, (GL_TEXTURE_2D, 0,
+                                    GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                    4, 4, 0, sizeof(data), data));
+   c = finish();
+
+   EXPECT_EQ(1u, num_calls);
+   EXPECT_FALSE(c.sync);
+   EXPECT_NE((const void *) data, c.pointer);
+   EXPECT_EQ(0x5a, c.first_byte);
+}
+
+TEST_F(glthread_test, compressed_image_from_unpack_buffer_is_sync)
+{
+   const void *offset = (const void *) (uintptr_t) 16;
+   struct call c;
+
+   CALL_BindBuffer(exec, (GL_PIXEL_UNPACK_BUFFER, 1));
+   CALL_CompressedTexImage2D(exec, (GL_TEXTURE_2D, 0,
+                                    GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                    4, 4, 0, 8, offset));
+   c = finish();
+
+   EXPECT_TRUE(c.sync);
+   EXPECT_EQ(offset, c.pointer);
+
+   /* Unbinding the buffer makes the data client memory again. */
+   CALL_BindBuffer(exec, (GL_PIXEL_UNPACK_BUFFER, 0));
+   CALL_CompressedTexImage2D(exec, (GL_TEXTURE_2D, 0,
+                                    GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                                    4, 4, 0, 8, &c));
+   c = finish();
+
+   EXPECT_FALSE(c.sync);
+}
+
+TEST_F(glthread_test, pixel_map_from_unpack_buffer_is_sync)
+{
+   const GLfloat *offset = (const GLfloat *) (uintptr_t) 64;
+   GLuint buffer = 3;
+   struct call c;
+
+   CALL_BindBuffer(exec, (GL_PIXEL_UNPACK_BUFFER, buffer));
+   CALL_PixelMapfv(exec, (GL_PIXEL_MAP_R_TO_R, 4, offset));
+   c = finish();
+
+   EXPECT_TRUE(c.sync);
+   EXPECT_EQ((const void *) offset, c.pointer);
+
+   /* Deleting the bound buffer unbinds it. */
+   _mesa_glthread_DeleteBuffers(ctx, 1, &buffer);
+   EXPECT_EQ(0u, ctx->GLThread->PixelUnpackBufferName);
+}
+
+TEST_F(glthread_test, arrays_in_buffer_objects_are_queued)
+{
+   const void *offset = (const void *) (uintptr_t) 32;
+   struct call c;
+
+   CALL_BindBuffer(exec, (GL_ARRAY_BUFFER, 1));
+   CALL_VertexPointer(exec, (4, GL_FLOAT, 0, offset));
+   c = finish();
+
+   EXPECT_FALSE(c.sync);
+   EXPECT_EQ(offset, c.pointer);
+
+   CALL_DrawArrays(exec, (GL_TRIANGLES, 0, 3));
+   c = finish();
+
+   EXPECT_FALSE(c.sync);
+
+   /* Without an element array buffer the indices are client memory. */
+   CALL_DrawElements(exec, (GL_TRIANGLES, 3, GL_UNSIGNED_INT, offset));
+   c = finish();
+
+   EXPECT_TRUE(c.sync);
+
+   CALL_BindBuffer(exec, (GL_ELEMENT_ARRAY_BUFFER, 2));
+   CALL_DrawElements(exec, (GL_TRIANGLES, 3, GL_UNSIGNED_INT, offset));
+   c = finish();
+
+   EXPECT_FALSE(c.sync);
+}
+
+TEST_F(glthread_test, client_arrays_make_draws_sync)
+{
+   static const GLfloat vertices[12] = { 0 };
+   struct call c;
+
+   CALL_VertexPointer(exec, (4, GL_FLOAT, 0, vertices));
+   c = finish();
+
+   EXPECT_TRUE(c.sync);
+   EXPECT_EQ((const void *) vertices, c.pointer);
+   EXPECT_TRUE(ctx->GLThread->ClientArrays);
+
+   /* Draws stay sync even once a buffer object is bound again. */
+   CALL_BindBuffer(exec, (GL_ARRAY_BUFFER, 1));
+   CALL_DrawArrays(exec, (GL_TRIANGLES, 0, 3));
+   c = finish();
+
+   EXPECT_TRUE(c.sync);
+}
@@ -42,6 +42,7 @@
 #include "texcompress.h"
 #include "texcompress_rgtc.h"
 #include "texstore.h"
+#include "../../gallium/auxiliary/util/u_parallel.h"
 
 
 #define RGTC_DEBUG 0
@@ -86,17 +87,113 @@ static void extractsrc_s( GLbyte srcpixels[4][4], const GLfloat *srcaddr,
 }
 
 
-GLboolean
-_mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
+/** Don't bother with a thread for less than this many blocks */
+#define RGTC_MIN_BLOCKS_PER_THREAD 1024
+
+/**
+ * An image to compress.  src is the temporary ubyte image for the
+ * unsigned formats and the temporary float image for the signed ones.
+ */
+struct rgtc_job
 {
+   const void *src;
+   GLint width, height;
+   GLint comps;                /**< 1 for RGTC1/LATC1, 2 for RGTC2/LATC2 */
    GLubyte *dst;
-   const GLubyte *tempImage = NULL;
-   int i, j;
+   GLint dstBlockRowStride;    /**< bytes between block rows */
+};
+
+/** util_parallel_rows() callback compressing some unsigned block rows */
+static void
+unsigned_compress_rows(void *data, unsigned first, unsigned count)
+{
+   const struct rgtc_job *job = (const struct rgtc_job *) data;
+   GLint i, j, c;
    int numxpixels, numypixels;
    const GLubyte *srcaddr;
    GLubyte srcpixels[4][4];
    GLubyte *blkaddr;
-   GLint dstRowDiff;
+
+   for (j = first * 4; j < (GLint) (first + count) * 4; j += 4) {
+      numypixels = MIN2(job->height - j, 4);
+      srcaddr = (const GLubyte *) job->src + j * job->width * job->comps;
+      blkaddr = job->dst + (j / 4) * job->dstBlockRowStride;
+      for (i = 0; i < job->width; i += 4) {
+	 numxpixels = MIN2(job->width - i, 4);
+	 for (c = 0; c < job->comps; c++) {
+	    extractsrc_u(srcpixels, srcaddr + c, job->width,
+			 numxpixels, numypixels, job->comps);
+	    unsigned_encode_rgtc_ubyte(blkaddr, srcpixels,
+				       numxpixels, numypixels);
+	    blkaddr += 8;
+	 }
+	 srcaddr += numxpixels * job->comps;
+      }
+   }
+}
+
+/** util_parallel_rows() callback compressing some signed block rows */
+static void
+signed_compress_rows(void *data, unsigned first, unsigned count)
+{
+   const struct rgtc_job *job = (const struct rgtc_job *) data;
+   GLint i, j, c;
+   int numxpixels, numypixels;
+   const GLfloat *srcaddr;
+   GLbyte srcpixels[4][4];
+   GLbyte *blkaddr;
+
+   for (j = first * 4; j < (GLint) (first + count) * 4; j += 4) {
+      numypixels = MIN2(job->height - j, 4);
+      srcaddr = (const GLfloat *) job->src + j * job->width * job->comps;
+      blkaddr = (GLbyte *) job->dst + (j / 4) * job->dstBlockRowStride;
+      for (i = 0; i < job->width; i += 4) {
+	 numxpixels = MIN2(job->width - i, 4);
+	 for (c = 0; c < job->comps; c++) {
+	    extractsrc_s(srcpixels, srcaddr + c, job->width,
+			 numxpixels, numypixels, job->comps);
+	    signed_encode_rgtc_ubyte(blkaddr, srcpixels,
+				     numxpixels, numypixels);
+	    blkaddr += 8;
+	 }
+	 srcaddr += numxpixels * job->comps;
+      }
+   }
+}
+
+/**
+ * Compress the temporary image, splitting the block rows across several
+ * threads if there are enough of them.
+ */
+static void
+rgtc_compress(util_parallel_rows_func compress_rows, const void *src,
+	      GLint width, GLint height, GLint comps,
+	      GLubyte *dst, GLint dstRowStride)
+{
+   const GLint blocksWide = (width + 3) / 4;
+   const GLint blockRows = (height + 3) / 4;
+   const GLint blockRowSize = blocksWide * 8 * comps;
+   struct rgtc_job job;
+
+   job.src = src;
+   job.width = width;
+   job.height = height;
+   job.comps = comps;
+   job.dst = dst;
+   job.dstBlockRowStride = dstRowStride >= width * 2 * comps ?
+                           dstRowStride : blockRowSize;
+
+   util_parallel_rows(blockRows,
+                      (blocksWide * blockRows) / RGTC_MIN_BLOCKS_PER_THREAD,
+                      compress_rows, &job);
+}
+
+
+GLboolean
+_mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
+{
+   const GLubyte *tempImage = NULL;
+
    ASSERT(dstFormat == MESA_FORMAT_R_RGTC1_UNORM ||
           dstFormat == MESA_FORMAT_L_LATC1_UNORM);
 
@@ -109,24 +206,8 @@ _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
    if (!tempImage)
       return GL_FALSE; /* out of memory */
 
-   dst = dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   rgtc_compress(unsigned_compress_rows, tempImage, srcWidth, srcHeight, 1,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -136,14 +217,8 @@ _mesa_texstore_red_rgtc1(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
 {
-   GLbyte *dst;
    const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff;
+
    ASSERT(dstFormat == MESA_FORMAT_R_RGTC1_SNORM ||
           dstFormat == MESA_FORMAT_L_LATC1_SNORM);
 
@@ -156,24 +231,8 @@ _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
    if (!tempImage)
       return GL_FALSE; /* out of memory */
 
-   dst = (GLbyte *) dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 2) ? dstRowStride - (((srcWidth + 3) & ~3) * 2) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 1);
-	 signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 srcaddr += numxpixels;
-	 blkaddr += 8;
-      }
-      blkaddr += dstRowDiff;
-   }
+   rgtc_compress(signed_compress_rows, tempImage, srcWidth, srcHeight, 1,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -183,14 +242,7 @@ _mesa_texstore_signed_red_rgtc1(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 {
-   GLubyte *dst;
    const GLubyte *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLubyte *srcaddr;
-   GLubyte srcpixels[4][4];
-   GLubyte *blkaddr;
-   GLint dstRowDiff;
 
    ASSERT(dstFormat == MESA_FORMAT_RG_RGTC2_UNORM ||
           dstFormat == MESA_FORMAT_LA_LATC2_UNORM);
@@ -204,30 +256,8 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
    if (!tempImage)
       return GL_FALSE; /* out of memory */
 
-   dst = dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j+=4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-	 extractsrc_u(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-	 extractsrc_u(srcpixels, (GLubyte *)srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 unsigned_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-      }
-      blkaddr += dstRowDiff;
-   }
+   rgtc_compress(unsigned_compress_rows, tempImage, srcWidth, srcHeight, 2,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -237,14 +267,7 @@ _mesa_texstore_rg_rgtc2(TEXSTORE_PARAMS)
 GLboolean
 _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
 {
-   GLbyte *dst;
    const GLfloat *tempImage = NULL;
-   int i, j;
-   int numxpixels, numypixels;
-   const GLfloat *srcaddr;
-   GLbyte srcpixels[4][4];
-   GLbyte *blkaddr;
-   GLint dstRowDiff;
 
    ASSERT(dstFormat == MESA_FORMAT_RG_RGTC2_SNORM ||
           dstFormat == MESA_FORMAT_LA_LATC2_SNORM);
@@ -258,31 +281,8 @@ _mesa_texstore_signed_rg_rgtc2(TEXSTORE_PARAMS)
    if (!tempImage)
       return GL_FALSE; /* out of memory */
 
-   dst = (GLbyte *) dstSlices[0];
-
-   blkaddr = dst;
-   dstRowDiff = dstRowStride >= (srcWidth * 4) ? dstRowStride - (((srcWidth + 3) & ~3) * 4) : 0;
-   for (j = 0; j < srcHeight; j += 4) {
-      if (srcHeight > j + 3) numypixels = 4;
-      else numypixels = srcHeight - j;
-      srcaddr = tempImage + j * srcWidth * 2;
-      for (i = 0; i < srcWidth; i += 4) {
-	 if (srcWidth > i + 3) numxpixels = 4;
-	 else numxpixels = srcWidth - i;
-
-	 extractsrc_s(srcpixels, srcaddr, srcWidth, numxpixels, numypixels, 2);
-	 signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 extractsrc_s(srcpixels, srcaddr + 1, srcWidth, numxpixels, numypixels, 2);
-	 signed_encode_rgtc_ubyte(blkaddr, srcpixels, numxpixels, numypixels);
-	 blkaddr += 8;
-
-	 srcaddr += numxpixels * 2;
-
-      }
-      blkaddr += dstRowDiff;
-   }
+   rgtc_compress(signed_compress_rows, tempImage, srcWidth, srcHeight, 2,
+                 dstSlices[0], dstRowStride);
 
    free((void *) tempImage);
 
@@ -423,111 +423,228 @@ _mesa_make_temp_float_image(struct gl_context *ctx, GLuint dims,
 
 
 /**
- * Make temporary image with uint pixel values.  Used for unsigned
- * integer-valued textures.
+ * Source image converter used by the texstore functions' general paths.
+ *
+ * Rather than converting the whole source image into a temporary float or
+ * uint image first (see _mesa_make_temp_float_image()), each source row is
+ * unpacked, put through the pixel transfer operations and rebased from
+ * logicalBaseFormat to textureBaseFormat just before it is stored.  Only
+ * one row of temporary storage is needed no matter how large the image is,
+ * and the row stays in the cache while the destination texels are packed.
+ *
+ * Formats with no more than 8 bits per channel use the ubyte variant and
+ * integer textures the uint variant, which never go through float, so the
+ * source values are converted exactly once.
  */
-static GLuint *
-make_temp_uint_image(struct gl_context *ctx, GLuint dims,
-                     GLenum logicalBaseFormat,
-                     GLenum textureBaseFormat,
-                     GLint srcWidth, GLint srcHeight, GLint srcDepth,
-                     GLenum srcFormat, GLenum srcType,
-                     const GLvoid *srcAddr,
-                     const struct gl_pixelstore_attrib *srcPacking)
+struct temp_rows
 {
-   GLuint *tempImage;
-   const GLint components = _mesa_components_in_format(logicalBaseFormat);
-   const GLint srcStride =
-      _mesa_image_row_stride(srcPacking, srcWidth, srcFormat, srcType);
-   GLuint *dst;
-   GLint img, row;
+   struct gl_context *ctx;
+   GLuint dims;
+   GLenum logicalBaseFormat;
+   GLint srcWidth, srcHeight;
+   GLenum srcFormat, srcType;
+   const GLvoid *srcAddr;
+   const struct gl_pixelstore_attrib *srcPacking;
+   GLbitfield transferOps;
+   GLint logComponents;
+   GLint texComponents;
+   GLboolean rebase;
+   GLubyte map[6];
+   /** one row of texComponents floats, uints or ubytes */
+   void *row;
+};
 
+
+static GLboolean
+temp_rows_init(struct temp_rows *rows,
+               struct gl_context *ctx, GLuint dims,
+               GLenum logicalBaseFormat,
+               GLenum textureBaseFormat,
+               GLint srcWidth, GLint srcHeight,
+               GLenum srcFormat, GLenum srcType,
+               const GLvoid *srcAddr,
+               const struct gl_pixelstore_attrib *srcPacking,
+               GLbitfield transferOps)
+{
    ASSERT(dims >= 1 && dims <= 3);
+   ASSERT(sizeof(GLfloat) == sizeof(GLuint));
+
+   rows->ctx = ctx;
+   rows->dims = dims;
+   rows->logicalBaseFormat = logicalBaseFormat;
+   rows->srcWidth = srcWidth;
+   rows->srcHeight = srcHeight;
+   rows->srcFormat = srcFormat;
+   rows->srcType = srcType;
+   rows->srcAddr = srcAddr;
+   rows->srcPacking = srcPacking;
+   rows->transferOps = transferOps;
+   rows->logComponents = _mesa_components_in_format(logicalBaseFormat);
+   rows->texComponents = _mesa_components_in_format(textureBaseFormat);
+   rows->rebase = logicalBaseFormat != textureBaseFormat;
+
+   if (rows->rebase) {
+      /* we only promote up to RGB, RGBA and LUMINANCE_ALPHA formats for now */
+      ASSERT(textureBaseFormat == GL_RGB || textureBaseFormat == GL_RGBA ||
+             textureBaseFormat == GL_LUMINANCE_ALPHA);
 
-   ASSERT(logicalBaseFormat == GL_RGBA ||
-          logicalBaseFormat == GL_RGB ||
-          logicalBaseFormat == GL_RG ||
-          logicalBaseFormat == GL_RED ||
-          logicalBaseFormat == GL_LUMINANCE_ALPHA ||
-          logicalBaseFormat == GL_LUMINANCE ||
-          logicalBaseFormat == GL_INTENSITY ||
-          logicalBaseFormat == GL_ALPHA);
+      /* The actual texture format should have at least as many components
+       * as the logical texture format.
+       */
+      ASSERT(rows->texComponents >= rows->logComponents);
 
-   ASSERT(textureBaseFormat == GL_RGBA ||
-          textureBaseFormat == GL_RGB ||
-          textureBaseFormat == GL_RG ||
-          textureBaseFormat == GL_RED ||
-          textureBaseFormat == GL_LUMINANCE_ALPHA ||
-          textureBaseFormat == GL_LUMINANCE ||
-          textureBaseFormat == GL_INTENSITY ||
-          textureBaseFormat == GL_ALPHA);
+      compute_component_mapping(logicalBaseFormat, textureBaseFormat,
+                                rows->map);
+   }
 
-   tempImage = malloc(srcWidth * srcHeight * srcDepth
-                                 * components * sizeof(GLuint));
-   if (!tempImage)
-      return NULL;
+   /* The rebase is done in place, so the row is sized for the larger of
+    * the two formats.
+    */
+   rows->row = malloc(srcWidth * MAX2(rows->logComponents,
+                                      rows->texComponents) * sizeof(GLuint));
+   return rows->row != NULL;
+}
 
-   dst = tempImage;
-   for (img = 0; img < srcDepth; img++) {
-      const GLubyte *src
-	 = (const GLubyte *) _mesa_image_address(dims, srcPacking, srcAddr,
-						 srcWidth, srcHeight,
-						 srcFormat, srcType,
-						 img, 0, 0);
-      for (row = 0; row < srcHeight; row++) {
-	 _mesa_unpack_color_span_uint(ctx, srcWidth, logicalBaseFormat,
-                                      dst, srcFormat, srcType, src,
-                                      srcPacking);
-	 dst += srcWidth * components;
-	 src += srcStride;
-      }
+
+static void
+temp_rows_fini(struct temp_rows *rows)
+{
+   free(rows->row);
+   rows->row = NULL;
+}
+
+
+static const GLubyte *
+temp_rows_src_address(const struct temp_rows *rows, GLint img, GLint row)
+{
+   return (const GLubyte *) _mesa_image_address(rows->dims, rows->srcPacking,
+                                                rows->srcAddr,
+                                                rows->srcWidth,
+                                                rows->srcHeight,
+                                                rows->srcFormat,
+                                                rows->srcType,
+                                                img, row, 0);
+}
+
+
+/**
+ * Expand a row of logicalBaseFormat values to textureBaseFormat in place.
+ * Pixels are visited back to front so no source value is overwritten
+ * before it has been read.
+ */
+static void
+temp_rows_rebase(const struct temp_rows *rows, GLuint *values,
+                 GLuint zero, GLuint one)
+{
+   const GLint logComponents = rows->logComponents;
+   const GLint texComponents = rows->texComponents;
+   GLint i, k;
+
+   for (i = rows->srcWidth - 1; i >= 0; i--) {
+      GLuint pixel[6];
+
+      for (k = 0; k < logComponents; k++)
+         pixel[k] = values[i * logComponents + k];
+      pixel[ZERO] = zero;
+      pixel[ONE] = one;
+
+      for (k = 0; k < texComponents; k++)
+         values[i * texComponents + k] = pixel[rows->map[k]];
    }
+}
 
-   if (logicalBaseFormat != textureBaseFormat) {
-      /* more work */
-      GLint texComponents = _mesa_components_in_format(textureBaseFormat);
-      GLint logComponents = _mesa_components_in_format(logicalBaseFormat);
-      GLuint *newImage;
-      GLint i, n;
-      GLubyte map[6];
 
-      /* we only promote up to RGB, RGBA and LUMINANCE_ALPHA formats for now */
-      ASSERT(textureBaseFormat == GL_RGB || textureBaseFormat == GL_RGBA ||
-             textureBaseFormat == GL_LUMINANCE_ALPHA);
+/** As above, for rows of GLubytes. */
+static void
+temp_rows_rebase_ubyte(const struct temp_rows *rows, GLubyte *values)
+{
+   const GLint logComponents = rows->logComponents;
+   const GLint texComponents = rows->texComponents;
+   GLint i, k;
 
-      /* The actual texture format should have at least as many components
-       * as the logical texture format.
-       */
-      ASSERT(texComponents >= logComponents);
+   for (i = rows->srcWidth - 1; i >= 0; i--) {
+      GLubyte pixel[6];
 
-      newImage = malloc(srcWidth * srcHeight * srcDepth
-                                   * texComponents * sizeof(GLuint));
-      if (!newImage) {
-         free(tempImage);
-         return NULL;
-      }
+      for (k = 0; k < logComponents; k++)
+         pixel[k] = values[i * logComponents + k];
+      pixel[ZERO] = 0;
+      pixel[ONE] = 255;
 
-      compute_component_mapping(logicalBaseFormat, textureBaseFormat, map);
+      for (k = 0; k < texComponents; k++)
+         values[i * texComponents + k] = pixel[rows->map[k]];
+   }
+}
 
-      n = srcWidth * srcHeight * srcDepth;
-      for (i = 0; i < n; i++) {
-         GLint k;
-         for (k = 0; k < texComponents; k++) {
-            GLint j = map[k];
-            if (j == ZERO)
-               newImage[i * texComponents + k] = 0;
-            else if (j == ONE)
-               newImage[i * texComponents + k] = 1;
-            else
-               newImage[i * texComponents + k] = tempImage[i * logComponents + j];
-         }
-      }
 
-      free(tempImage);
-      tempImage = newImage;
+/**
+ * Unpack row 'row' of image 'img' of the source to textureBaseFormat
+ * floats, applying the pixel transfer operations.
+ */
+static const GLfloat *
+temp_float_row(struct temp_rows *rows, GLint img, GLint row)
+{
+   GLfloat *dst = (GLfloat *) rows->row;
+
+   _mesa_unpack_color_span_float(rows->ctx, rows->srcWidth,
+                                 rows->logicalBaseFormat, dst,
+                                 rows->srcFormat, rows->srcType,
+                                 temp_rows_src_address(rows, img, row),
+                                 rows->srcPacking, rows->transferOps);
+
+   if (rows->rebase) {
+      fi_type zero, one;
+      zero.f = 0.0F;
+      one.f = 1.0F;
+      temp_rows_rebase(rows, (GLuint *) dst, zero.u, one.u);
    }
 
-   return tempImage;
+   return dst;
+}
+
+
+/**
+ * Unpack row 'row' of image 'img' of the source to textureBaseFormat
+ * uints.  Used for integer-valued textures.
+ */
+static const GLuint *
+temp_uint_row(struct temp_rows *rows, GLint img, GLint row)
+{
+   GLuint *dst = (GLuint *) rows->row;
+
+   _mesa_unpack_color_span_uint(rows->ctx, rows->srcWidth,
+                                rows->logicalBaseFormat, dst,
+                                rows->srcFormat, rows->srcType,
+                                temp_rows_src_address(rows, img, row),
+                                rows->srcPacking);
+
+   if (rows->rebase) {
+      temp_rows_rebase(rows, dst, 0, 1);
+   }
+
+   return dst;
+}
+
+
+/**
+ * Unpack row 'row' of image 'img' of the source to textureBaseFormat
+ * ubytes, applying the pixel transfer operations.
+ */
+static const GLubyte *
+temp_ubyte_row(struct temp_rows *rows, GLint img, GLint row)
+{
+   GLubyte *dst = (GLubyte *) rows->row;
+
+   _mesa_unpack_color_span_ubyte(rows->ctx, rows->srcWidth,
+                                 rows->logicalBaseFormat, dst,
+                                 rows->srcFormat, rows->srcType,
+                                 temp_rows_src_address(rows, img, row),
+                                 rows->srcPacking, rows->transferOps);
+
+   if (rows->rebase) {
+      temp_rows_rebase_ubyte(rows, dst);
+   }
+
+   return dst;
 }
 
 
@@ -975,27 +1092,24 @@ memcpy_texture(struct gl_context *ctx,
 static GLboolean
 store_ubyte_texture(TEXSTORE_PARAMS)
 {
-   const GLint srcRowStride = srcWidth * 4 * sizeof(GLubyte);
-   GLubyte *tempImage, *src;
-   GLint img;
-
-   tempImage = _mesa_make_temp_ubyte_image(ctx, dims,
-                                           baseInternalFormat,
-                                           GL_RGBA,
-                                           srcWidth, srcHeight, srcDepth,
-                                           srcFormat, srcType, srcAddr,
-                                           srcPacking);
-   if (!tempImage)
+   struct temp_rows rows;
+   GLint img, row;
+
+   if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, GL_RGBA,
+                       srcWidth, srcHeight, srcFormat, srcType,
+                       srcAddr, srcPacking, ctx->_ImageTransferState))
       return GL_FALSE;
 
-   src = tempImage;
    for (img = 0; img < srcDepth; img++) {
-      _mesa_pack_ubyte_rgba_rect(dstFormat, srcWidth, srcHeight,
-                                 src, srcRowStride,
-                                 dstSlices[img], dstRowStride);
-      src += srcHeight * srcRowStride;
+      GLubyte *dstRow = dstSlices[img];
+      for (row = 0; row < srcHeight; row++) {
+         const GLubyte *src = temp_ubyte_row(&rows, img, row);
+         _mesa_pack_ubyte_rgba_row(dstFormat, srcWidth,
+                                   (const GLubyte (*)[4]) src, dstRow);
+         dstRow += dstRowStride;
+      }
    }
-   free(tempImage);
+   temp_rows_fini(&rows);
 
    return GL_TRUE;
 }
@@ -1533,21 +1647,17 @@ _mesa_texstore_argb2101010(TEXSTORE_PARAMS)
       /* general path */
       /* Hardcode GL_RGBA as the base format, which forces alpha to 1.0
        * if the internal format is RGB. */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 GL_RGBA,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, GL_RGBA,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          if (baseInternalFormat == GL_RGBA || baseInternalFormat == GL_RGB) {
             for (row = 0; row < srcHeight; row++) {
+               const GLfloat *src = temp_float_row(&rows, img, row);
                GLuint *dstUI = (GLuint *) dstRow;
                for (col = 0; col < srcWidth; col++) {
                   GLushort a,r,g,b;
@@ -1565,7 +1675,7 @@ _mesa_texstore_argb2101010(TEXSTORE_PARAMS)
             ASSERT(0);
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -1584,19 +1694,16 @@ _mesa_texstore_unorm44(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLubyte *tempImage = _mesa_make_temp_ubyte_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking);
-      const GLubyte *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLubyte *src = temp_ubyte_row(&rows, img, row);
             GLubyte *dstUS = (GLubyte *) dstRow;
             for (col = 0; col < srcWidth; col++) {
                /* src[0] is luminance, src[1] is alpha */
@@ -1607,7 +1714,7 @@ _mesa_texstore_unorm44(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -1673,19 +1780,16 @@ _mesa_texstore_unorm88(TEXSTORE_PARAMS)
    }   
    else {
       /* general path */
-      const GLubyte *tempImage = _mesa_make_temp_ubyte_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking);
-      const GLubyte *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLubyte *src = temp_ubyte_row(&rows, img, row);
             GLushort *dstUS = (GLushort *) dstRow;
             if (dstFormat == MESA_FORMAT_L8A8_UNORM ||
 		dstFormat == MESA_FORMAT_R8G8_UNORM) {
@@ -1707,7 +1811,7 @@ _mesa_texstore_unorm88(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -1729,20 +1833,16 @@ _mesa_texstore_unorm1616(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLuint *dstUI = (GLuint *) dstRow;
             if (dstFormat == MESA_FORMAT_L16A16_UNORM ||
 		dstFormat == MESA_FORMAT_R16G16_UNORM) {
@@ -1768,7 +1868,7 @@ _mesa_texstore_unorm1616(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -1788,20 +1888,16 @@ _mesa_texstore_unorm16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLushort *dstUS = (GLushort *) dstRow;
 	    for (col = 0; col < srcWidth; col++) {
 	       GLushort r;
@@ -1813,7 +1909,7 @@ _mesa_texstore_unorm16(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -1830,22 +1926,18 @@ _mesa_texstore_rgba_16(TEXSTORE_PARAMS)
       /* general path */
       /* Hardcode GL_RGBA as the base format, which forces alpha to 1.0
        * if the internal format is RGB. */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 GL_RGBA,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
 
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, GL_RGBA,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
 
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLushort *dstUS = (GLushort *) dstRow;
             for (col = 0; col < srcWidth; col++) {
                GLushort r, g, b, a;
@@ -1863,7 +1955,7 @@ _mesa_texstore_rgba_16(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -1880,26 +1972,22 @@ _mesa_texstore_signed_rgba_16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       const GLuint comps = _mesa_get_format_bytes(dstFormat) / 2;
       GLint img, row, col;
 
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
 
-      /* Note: tempImage is always float[4] / RGBA.  We convert to 1, 2,
+      /* Note: the source row is always float[4] / RGBA.  We convert to 1, 2,
        * 3 or 4 components/pixel here.
        */
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLshort *dstRowS = (GLshort *) dstRow;
             if (dstFormat == MESA_FORMAT_RGBA_SNORM16) {
                for (col = 0; col < srcWidth; col++) {
@@ -1911,7 +1999,6 @@ _mesa_texstore_signed_rgba_16(TEXSTORE_PARAMS)
                   }
                }
                dstRow += dstRowStride;
-               src += 4 * srcWidth;
             }
             else if (dstFormat == MESA_FORMAT_RGBX_SNORM16) {
                for (col = 0; col < srcWidth; col++) {
@@ -1925,7 +2012,6 @@ _mesa_texstore_signed_rgba_16(TEXSTORE_PARAMS)
                   dstRowS[col * comps + 3] = 32767;
                }
                dstRow += dstRowStride;
-               src += 3 * srcWidth;
             }
             else {
                for (col = 0; col < srcWidth; col++) {
@@ -1937,11 +2023,10 @@ _mesa_texstore_signed_rgba_16(TEXSTORE_PARAMS)
                   }
                }
                dstRow += dstRowStride;
-               src += 3 * srcWidth;
             }
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -1990,27 +2075,23 @@ _mesa_texstore_unorm8(TEXSTORE_PARAMS)
    }   
    else {
       /* general path */
-      const GLubyte *tempImage = _mesa_make_temp_ubyte_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking);
-      const GLubyte *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLubyte *src = temp_ubyte_row(&rows, img, row);
             for (col = 0; col < srcWidth; col++) {
                dstRow[col] = src[col];
             }
             dstRow += dstRowStride;
-            src += srcWidth;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2078,28 +2159,23 @@ _mesa_texstore_snorm8(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLbyte *dstRow = (GLbyte *) dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             for (col = 0; col < srcWidth; col++) {
                dstRow[col] = FLOAT_TO_BYTE_TEX(src[col]);
             }
             dstRow += dstRowStride;
-            src += srcWidth;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2120,20 +2196,16 @@ _mesa_texstore_snorm88(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLbyte *dstRow = (GLbyte *) dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLushort *dst = (GLushort *) dstRow;
 
             if (dstFormat == MESA_FORMAT_L8A8_SNORM ||
@@ -2158,7 +2230,7 @@ _mesa_texstore_snorm88(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2177,20 +2249,16 @@ _mesa_texstore_snorm16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLshort *dstUS = (GLshort *) dstRow;
 	    for (col = 0; col < srcWidth; col++) {
 	       GLushort r;
@@ -2202,7 +2270,7 @@ _mesa_texstore_snorm16(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2222,20 +2290,16 @@ _mesa_texstore_snorm1616(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLuint *dst = (GLuint *) dstRow;
 
             if (dstFormat == MESA_FORMAT_LA_SNORM16 ||
@@ -2262,7 +2326,7 @@ _mesa_texstore_snorm1616(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2282,20 +2346,16 @@ _mesa_texstore_signed_rgbx8888(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLbyte *dstRow = (GLbyte *) dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *srcRow = temp_float_row(&rows, img, row);
             GLbyte *dst = dstRow;
             if (dstFormat == MESA_FORMAT_X8B8G8R8_SNORM) {
                for (col = 0; col < srcWidth; col++) {
@@ -2320,7 +2380,7 @@ _mesa_texstore_signed_rgbx8888(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2342,20 +2402,16 @@ _mesa_texstore_signed_rgba8888(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLbyte *dstRow = (GLbyte *) dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *srcRow = temp_float_row(&rows, img, row);
             GLbyte *dst = dstRow;
             if (dstFormat == MESA_FORMAT_A8B8G8R8_SNORM) {
                for (col = 0; col < srcWidth; col++) {
@@ -2380,7 +2436,7 @@ _mesa_texstore_signed_rgba8888(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2614,7 +2670,7 @@ _mesa_texstore_rgba_float32(TEXSTORE_PARAMS)
    GLenum baseFormat = _mesa_get_format_base_format(dstFormat);
    GLint components = _mesa_components_in_format(baseFormat);
 
-   /* this forces alpha to 1 in _mesa_make_temp_float_image */
+   /* this forces alpha to 1 in temp_float_row */
    if (dstFormat == MESA_FORMAT_RGBX_FLOAT32) {
       baseFormat = GL_RGBA;
       components = 4;
@@ -2641,29 +2697,24 @@ _mesa_texstore_rgba_float32(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct temp_rows rows;
       GLint bytesPerRow;
       GLint img, row;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       bytesPerRow = srcWidth * components * sizeof(GLfloat);
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *srcRow = temp_float_row(&rows, img, row);
             memcpy(dstRow, srcRow, bytesPerRow);
             dstRow += dstRowStride;
-            srcRow += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2679,7 +2730,7 @@ _mesa_texstore_rgba_float16(TEXSTORE_PARAMS)
    GLenum baseFormat = _mesa_get_format_base_format(dstFormat);
    GLint components = _mesa_components_in_format(baseFormat);
 
-   /* this forces alpha to 1 in _mesa_make_temp_float_image */
+   /* this forces alpha to 1 in temp_float_row */
    if (dstFormat == MESA_FORMAT_RGBX_FLOAT16) {
       baseFormat = GL_RGBA;
       components = 4;
@@ -2706,31 +2757,26 @@ _mesa_texstore_rgba_float16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLhalfARB *dstTexel = (GLhalfARB *) dstRow;
             GLint i;
             for (i = 0; i < srcWidth * components; i++) {
                dstTexel[i] = _mesa_float_to_half(src[i]);
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2743,7 +2789,7 @@ _mesa_texstore_rgba_int8(TEXSTORE_PARAMS)
    GLenum baseFormat = _mesa_get_format_base_format(dstFormat);
    GLint components = _mesa_components_in_format(baseFormat);
 
-   /* this forces alpha to 1 in make_temp_uint_image */
+   /* this forces alpha to 1 in temp_uint_row */
    if (dstFormat == MESA_FORMAT_RGBX_SINT8) {
       baseFormat = GL_RGBA;
       components = 4;
@@ -2770,21 +2816,17 @@ _mesa_texstore_rgba_int8(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-						     baseInternalFormat,
-						     baseFormat,
-						     srcWidth, srcHeight, srcDepth,
-						     srcFormat, srcType,
-						     srcAddr,
-						     srcPacking);
-      const GLuint *src = tempImage;
+      struct temp_rows rows;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLuint *src = temp_uint_row(&rows, img, row);
             GLbyte *dstTexel = (GLbyte *) dstRow;
             GLint i;
             if (is_unsigned) {
@@ -2797,11 +2839,10 @@ _mesa_texstore_rgba_int8(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2814,7 +2855,7 @@ _mesa_texstore_rgba_int16(TEXSTORE_PARAMS)
    GLenum baseFormat = _mesa_get_format_base_format(dstFormat);
    GLint components = _mesa_components_in_format(baseFormat);
 
-   /* this forces alpha to 1 in make_temp_uint_image */
+   /* this forces alpha to 1 in temp_uint_row */
    if (dstFormat == MESA_FORMAT_RGBX_SINT16) {
       baseFormat = GL_RGBA;
       components = 4;
@@ -2841,21 +2882,17 @@ _mesa_texstore_rgba_int16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-						     baseInternalFormat,
-						     baseFormat,
-						     srcWidth, srcHeight, srcDepth,
-						     srcFormat, srcType,
-						     srcAddr,
-						     srcPacking);
-      const GLuint *src = tempImage;
+      struct temp_rows rows;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLuint *src = temp_uint_row(&rows, img, row);
             GLshort *dstTexel = (GLshort *) dstRow;
             GLint i;
             if (is_unsigned) {
@@ -2868,11 +2905,10 @@ _mesa_texstore_rgba_int16(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2885,7 +2921,7 @@ _mesa_texstore_rgba_int32(TEXSTORE_PARAMS)
    GLenum baseFormat = _mesa_get_format_base_format(dstFormat);
    GLint components = _mesa_components_in_format(baseFormat);
 
-   /* this forces alpha to 1 in make_temp_uint_image */
+   /* this forces alpha to 1 in temp_uint_row */
    if (dstFormat == MESA_FORMAT_RGBX_SINT32) {
       baseFormat = GL_RGBA;
       components = 4;
@@ -2912,21 +2948,17 @@ _mesa_texstore_rgba_int32(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-						     baseInternalFormat,
-						     baseFormat,
-						     srcWidth, srcHeight, srcDepth,
-						     srcFormat, srcType,
-						     srcAddr,
-						     srcPacking);
-      const GLuint *src = tempImage;
+      struct temp_rows rows;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLuint *src = temp_uint_row(&rows, img, row);
             GLint *dstTexel = (GLint *) dstRow;
             GLint i;
             if (is_unsigned) {
@@ -2939,11 +2971,10 @@ _mesa_texstore_rgba_int32(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -2956,7 +2987,7 @@ _mesa_texstore_rgba_uint8(TEXSTORE_PARAMS)
    GLenum baseFormat = _mesa_get_format_base_format(dstFormat);
    GLint components = _mesa_components_in_format(baseFormat);
 
-   /* this forces alpha to 1 in make_temp_uint_image */
+   /* this forces alpha to 1 in temp_uint_row */
    if (dstFormat == MESA_FORMAT_RGBX_UINT8) {
       baseFormat = GL_RGBA;
       components = 4;
@@ -2983,18 +3014,17 @@ _mesa_texstore_rgba_uint8(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage =
-         make_temp_uint_image(ctx, dims, baseInternalFormat, baseFormat,
-                              srcWidth, srcHeight, srcDepth,
-                              srcFormat, srcType, srcAddr, srcPacking);
-      const GLuint *src = tempImage;
+      struct temp_rows rows;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLuint *src = temp_uint_row(&rows, img, row);
             GLubyte *dstTexel = (GLubyte *) dstRow;
             GLint i;
             if (is_unsigned) {
@@ -3007,11 +3037,10 @@ _mesa_texstore_rgba_uint8(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -3024,7 +3053,7 @@ _mesa_texstore_rgba_uint16(TEXSTORE_PARAMS)
    GLenum baseFormat = _mesa_get_format_base_format(dstFormat);
    GLint components = _mesa_components_in_format(baseFormat);
 
-   /* this forces alpha to 1 in make_temp_uint_image */
+   /* this forces alpha to 1 in temp_uint_row */
    if (dstFormat == MESA_FORMAT_RGBX_UINT16) {
       baseFormat = GL_RGBA;
       components = 4;
@@ -3051,18 +3080,17 @@ _mesa_texstore_rgba_uint16(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage =
-         make_temp_uint_image(ctx, dims, baseInternalFormat, baseFormat,
-                              srcWidth, srcHeight, srcDepth,
-                              srcFormat, srcType, srcAddr, srcPacking);
-      const GLuint *src = tempImage;
+      struct temp_rows rows;
       GLint img, row;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLuint *src = temp_uint_row(&rows, img, row);
             GLushort *dstTexel = (GLushort *) dstRow;
             GLint i;
             if (is_unsigned) {
@@ -3075,11 +3103,10 @@ _mesa_texstore_rgba_uint16(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -3092,7 +3119,7 @@ _mesa_texstore_rgba_uint32(TEXSTORE_PARAMS)
    GLenum baseFormat = _mesa_get_format_base_format(dstFormat);
    GLint components = _mesa_components_in_format(baseFormat);
 
-   /* this forces alpha to 1 in make_temp_uint_image */
+   /* this forces alpha to 1 in temp_uint_row */
    if (dstFormat == MESA_FORMAT_RGBX_UINT32) {
       baseFormat = GL_RGBA;
       components = 4;
@@ -3119,18 +3146,17 @@ _mesa_texstore_rgba_uint32(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage =
-         make_temp_uint_image(ctx, dims, baseInternalFormat, baseFormat,
-                              srcWidth, srcHeight, srcDepth,
-                              srcFormat, srcType, srcAddr, srcPacking);
-      const GLuint *src = tempImage;
+      struct temp_rows rows;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
       GLint img, row;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLuint *src = temp_uint_row(&rows, img, row);
             GLuint *dstTexel = (GLuint *) dstRow;
             GLint i;
             if (is_unsigned) {
@@ -3143,11 +3169,10 @@ _mesa_texstore_rgba_uint32(TEXSTORE_PARAMS)
                }
             }
             dstRow += dstRowStride;
-            src += srcWidth * components;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -3268,30 +3293,25 @@ _mesa_texstore_rgb9_e5(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *srcRow = temp_float_row(&rows, img, row);
             GLuint *dstUI = (GLuint*)dstRow;
             for (col = 0; col < srcWidth; col++) {
                dstUI[col] = float3_to_rgb9e5(&srcRow[col * 3]);
             }
             dstRow += dstRowStride;
-            srcRow += srcWidth * 3;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -3306,30 +3326,25 @@ _mesa_texstore_r11_g11_b10f(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *srcRow = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *srcRow = temp_float_row(&rows, img, row);
             GLuint *dstUI = (GLuint*)dstRow;
             for (col = 0; col < srcWidth; col++) {
                dstUI[col] = float3_to_r11g11b10f(&srcRow[col * 3]);
             }
             dstRow += dstRowStride;
-            srcRow += srcWidth * 3;
          }
       }
 
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -3394,22 +3409,18 @@ _mesa_texstore_argb2101010_uint(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-                                                     baseInternalFormat,
-                                                     baseFormat,
-                                                     srcWidth, srcHeight,
-                                                     srcDepth, srcFormat,
-                                                     srcType, srcAddr,
-                                                     srcPacking);
-      const GLuint *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
 
          for (row = 0; row < srcHeight; row++) {
+            const GLuint *src = temp_uint_row(&rows, img, row);
             GLuint *dstUI = (GLuint *) dstRow;
             if (is_unsigned) {
                for (col = 0; col < srcWidth; col++) {
@@ -3435,7 +3446,7 @@ _mesa_texstore_argb2101010_uint(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -3450,22 +3461,18 @@ _mesa_texstore_abgr2101010_uint(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLuint *tempImage = make_temp_uint_image(ctx, dims,
-                                                     baseInternalFormat,
-                                                     baseFormat,
-                                                     srcWidth, srcHeight,
-                                                     srcDepth, srcFormat,
-                                                     srcType, srcAddr,
-                                                     srcPacking);
-      const GLuint *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
       GLboolean is_unsigned = _mesa_is_type_unsigned(srcType);
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, 0))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
 
          for (row = 0; row < srcHeight; row++) {
+            const GLuint *src = temp_uint_row(&rows, img, row);
             GLuint *dstUI = (GLuint *) dstRow;
             if (is_unsigned) {
                for (col = 0; col < srcWidth; col++) {
@@ -3491,7 +3498,7 @@ _mesa_texstore_abgr2101010_uint(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -3506,21 +3513,17 @@ _mesa_texstore_abgr2101010(TEXSTORE_PARAMS)
 
    {
       /* general path */
-      const GLfloat *tempImage = _mesa_make_temp_float_image(ctx, dims,
-                                                 baseInternalFormat,
-                                                 baseFormat,
-                                                 srcWidth, srcHeight, srcDepth,
-                                                 srcFormat, srcType, srcAddr,
-                                                 srcPacking,
-                                                 ctx->_ImageTransferState);
-      const GLfloat *src = tempImage;
+      struct temp_rows rows;
       GLint img, row, col;
-      if (!tempImage)
+      if (!temp_rows_init(&rows, ctx, dims, baseInternalFormat, baseFormat,
+                          srcWidth, srcHeight, srcFormat, srcType,
+                          srcAddr, srcPacking, ctx->_ImageTransferState))
          return GL_FALSE;
       for (img = 0; img < srcDepth; img++) {
          GLubyte *dstRow = dstSlices[img];
 
          for (row = 0; row < srcHeight; row++) {
+            const GLfloat *src = temp_float_row(&rows, img, row);
             GLuint *dstUI = (GLuint *) dstRow;
             for (col = 0; col < srcWidth; col++) {
                GLushort a,r,g,b;
@@ -3535,7 +3538,7 @@ _mesa_texstore_abgr2101010(TEXSTORE_PARAMS)
             dstRow += dstRowStride;
          }
       }
-      free((void *) tempImage);
+      temp_rows_fini(&rows);
    }
    return GL_TRUE;
 }
@@ -35,6 +35,7 @@
 #include "main/fbobject.h"
 #include "main/renderbuffer.h"
 #include "main/version.h"
+#include "main/glthread.h"
 #include "st_texture.h"
 
 #include "st_context.h"
@@ -52,6 +53,10 @@
 #include "util/u_inlines.h"
 #include "util/u_atomic.h"
 #include "util/u_surface.h"
+#include "util/u_debug.h"
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(mesa_glthread, "MESA_GLTHREAD", FALSE)
 
 /**
  * Cast wrapper to convert a struct gl_framebuffer to an st_framebuffer.
@@ -493,6 +498,8 @@ st_context_flush(struct st_context_iface *stctxi, unsigned flags,
    struct st_context *st = (struct st_context *) stctxi;
    unsigned pipe_flags = 0;
 
+   _mesa_glthread_finish(st->ctx);
+
    if (flags & ST_FLUSH_END_OF_FRAME) {
       pipe_flags |= PIPE_FLUSH_END_OF_FRAME;
    }
@@ -535,6 +542,8 @@ st_context_teximage(struct st_context_iface *stctxi,
       return FALSE;
    }
 
+   _mesa_glthread_finish(ctx);
+
    texObj = _mesa_get_current_tex_object(ctx, target);
 
    _mesa_lock_texture(ctx, texObj);
@@ -599,6 +608,8 @@ st_context_copy(struct st_context_iface *stctxi,
    struct st_context *st = (struct st_context *) stctxi;
    struct st_context *src = (struct st_context *) stsrci;
 
+   _mesa_glthread_finish(src->ctx);
+   _mesa_glthread_finish(st->ctx);
    _mesa_copy_context(src->ctx, st->ctx, mask);
 }
 
@@ -609,6 +620,8 @@ st_context_share(struct st_context_iface *stctxi,
    struct st_context *st = (struct st_context *) stctxi;
    struct st_context *src = (struct st_context *) stsrci;
 
+   _mesa_glthread_finish(src->ctx);
+   _mesa_glthread_finish(st->ctx);
    return _mesa_share_state(st->ctx, src->ctx);
 }
 
@@ -616,6 +629,8 @@ static void
 st_context_destroy(struct st_context_iface *stctxi)
 {
    struct st_context *st = (struct st_context *) stctxi;
+
+   _mesa_glthread_destroy(st->ctx);
    st_destroy_context(st);
 }
 
@@ -701,6 +716,13 @@ st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
    st->iface.cso_context = st->cso_context;
    st->iface.pipe = st->pipe;
 
+   /* Debug contexts report messages from the calls as they are made, so
+    * they keep executing the calls on the application's thread.
+    */
+   if (debug_get_option_mesa_glthread() &&
+       !(attribs->flags & ST_CONTEXT_FLAG_DEBUG))
+      _mesa_glthread_init(st->ctx);
+
    *error = ST_CONTEXT_SUCCESS;
    return &st->iface;
 }
@@ -747,6 +769,9 @@ st_api_make_current(struct st_api *stapi, struct st_context_iface *stctxi,
    _glapi_check_multithread();
 
    if (st) {
+      /* the framebuffers are about to change under the GL thread */
+      _mesa_glthread_finish(st->ctx);
+
       /* reuse or create the draw fb */
       stdraw = st_framebuffer_reuse_or_create(st,
             st->ctx->WinSysDrawBuffer, stdrawi);
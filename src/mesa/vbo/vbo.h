@@ -161,6 +161,34 @@ vbo_get_minmax_indices(struct gl_context *ctx, const struct _mesa_prim *prim,
 
 void vbo_use_buffer_objects(struct gl_context *ctx);
 
+
+/**
+ * Why accumulated immediate mode vertices were drawn.
+ */
+enum vbo_flush_reason {
+   VBO_FLUSH_BUFFER_FULL,    /**< no room left in the vertex buffer */
+   VBO_FLUSH_PRIM_FULL,      /**< no room left in the primitive array */
+   VBO_FLUSH_FORMAT,         /**< vertex format change */
+   VBO_FLUSH_BEGIN,          /**< attributes set before glBegin */
+   VBO_FLUSH_STATE,          /**< state change, glFlush, etc. */
+   VBO_FLUSH_REASON_COUNT
+};
+
+/**
+ * Immediate mode (glBegin/glEnd) counters, since context creation.
+ */
+struct vbo_immediate_stats {
+   uint64_t flushes[VBO_FLUSH_REASON_COUNT];
+   uint64_t draws;
+   uint64_t prims;
+   uint64_t vertices;
+   unsigned buffer_size;     /**< current vertex buffer size, in bytes */
+   unsigned prim_max;        /**< current primitive array size */
+};
+
+void vbo_get_immediate_stats(struct gl_context *ctx,
+                             struct vbo_immediate_stats *stats);
+
 void vbo_always_unmap_buffers(struct gl_context *ctx);
 
 void vbo_set_draw_func(struct gl_context *ctx, vbo_draw_func func);
@@ -40,15 +40,22 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
 /**
- * Max number of primitives (number of glBegin/End pairs) per VBO.
+ * Initial max number of primitives (number of glBegin/End pairs) per VBO.
+ * The array grows, up to VBO_MAX_PRIM_LIMIT, when it fills up before the
+ * vertex buffer does.
  */
 #define VBO_MAX_PRIM 64
+#define VBO_MAX_PRIM_LIMIT 1024
 
 
 /**
- * Size of the VBO to use for glBegin/glVertex/glEnd-style rendering.
+ * Initial size of the VBO to use for glBegin/glVertex/glEnd-style
+ * rendering.  Each time a primitive has to be split because the buffer
+ * filled up, the next buffer is made twice as large, up to
+ * VBO_VERT_BUFFER_MAX_SIZE.
  */
 #define VBO_VERT_BUFFER_SIZE (1024*64)	/* bytes */
+#define VBO_VERT_BUFFER_MAX_SIZE (1024*1024)	/* bytes */
 
 
 /** Current vertex program mode */
@@ -88,12 +95,16 @@ struct vbo_exec_context
 
       GLuint vertex_size;       /* in dwords */
 
-      struct _mesa_prim prim[VBO_MAX_PRIM];
+      struct _mesa_prim *prim;          /* prim_store until it grows */
       GLuint prim_count;
+      GLuint prim_max;
+      struct _mesa_prim prim_store[VBO_MAX_PRIM];
 
       GLfloat *buffer_map;
       GLfloat *buffer_ptr;              /* cursor, points into buffer */
       GLuint   buffer_used;             /* in bytes */
+      GLuint   buffer_size;             /* in bytes */
+      GLboolean grow_buffer;            /* make the next VBO larger */
       GLfloat vertex[VBO_ATTRIB_MAX*4]; /* current vertex */
 
       GLuint vert_count;
@@ -133,6 +144,9 @@ struct vbo_exec_context
    /* Which flags to set in vbo_exec_BeginVertices() */
    GLbitfield begin_vertices_flags;
 
+   struct vbo_immediate_stats stats;
+   GLboolean print_stats;       /**< MESA_VBO_STATS */
+
 #ifdef DEBUG
    GLint flush_call_depth;
 #endif
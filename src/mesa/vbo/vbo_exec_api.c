@@ -59,6 +59,17 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 static void reset_attrfv( struct vbo_exec_context *exec );
 
 
+/**
+ * Account for a flush of the accumulated vertices, if there are any.
+ */
+static inline void
+count_flush(struct vbo_exec_context *exec, enum vbo_flush_reason reason)
+{
+   if (exec->vtx.vert_count)
+      exec->stats.flushes[reason]++;
+}
+
+
 /**
  * Close off the last primitive, execute the buffer, restart the
  * primitive.  
@@ -118,6 +129,13 @@ void vbo_exec_vtx_wrap( struct vbo_exec_context *exec )
    GLfloat *data = exec->vtx.copied.buffer;
    GLuint i;
 
+   /* The vertex buffer is full.  Ask for a larger one next time so that
+    * long primitives aren't split.
+    */
+   count_flush(exec, VBO_FLUSH_BUFFER_FULL);
+   if (_mesa_is_bufferobj(exec->vtx.bufferobj))
+      exec->vtx.grow_buffer = GL_TRUE;
+
    /* Run pipeline on current vertices, copy wrapped vertices
     * to exec->vtx.copied.
     */
@@ -248,6 +266,7 @@ vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
    /* Run pipeline on current vertices, copy wrapped vertices
     * to exec->vtx.copied.
     */
+   count_flush(exec, VBO_FLUSH_FORMAT);
    vbo_exec_wrap_buffers( exec );
 
    if (unlikely(exec->vtx.copied.nr)) {
@@ -279,7 +298,7 @@ vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
     */
    exec->vtx.attrsz[attr] = newSize;
    exec->vtx.vertex_size += newSize - oldSize;
-   exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) / 
+   exec->vtx.max_vert = ((exec->vtx.buffer_size - exec->vtx.buffer_used) /
                          (exec->vtx.vertex_size * sizeof(GLfloat)));
    exec->vtx.vert_count = 0;
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
@@ -688,8 +707,10 @@ static void GLAPIENTRY vbo_exec_Begin( GLenum mode )
    /* Heuristic: attempt to isolate attributes occuring outside
     * begin/end pairs.
     */
-   if (exec->vtx.vertex_size && !exec->vtx.attrsz[0])
+   if (exec->vtx.vertex_size && !exec->vtx.attrsz[0]) {
+      count_flush(exec, VBO_FLUSH_BEGIN);
       vbo_exec_FlushVertices_internal(exec, GL_FALSE);
+   }
 
    i = exec->vtx.prim_count++;
    exec->vtx.prim[i].mode = mode;
@@ -719,6 +740,38 @@ static void GLAPIENTRY vbo_exec_Begin( GLenum mode )
 }
 
 
+/**
+ * Make room for more primitives once the array is full, so that long runs
+ * of small glBegin/glEnd blocks in a stable vertex format end up in few
+ * draws.  Returns false if the array can't grow.
+ */
+static GLboolean
+grow_prims(struct vbo_exec_context *exec)
+{
+   const GLuint max = exec->vtx.prim_max * 2;
+   struct _mesa_prim *prim;
+
+   if (max > VBO_MAX_PRIM_LIMIT)
+      return GL_FALSE;
+
+   if (exec->vtx.prim == exec->vtx.prim_store) {
+      prim = malloc(max * sizeof(*prim));
+      if (prim)
+         memcpy(prim, exec->vtx.prim_store, sizeof(exec->vtx.prim_store));
+   }
+   else {
+      prim = realloc(exec->vtx.prim, max * sizeof(*prim));
+   }
+
+   if (!prim)
+      return GL_FALSE;
+
+   exec->vtx.prim = prim;
+   exec->vtx.prim_max = max;
+   return GL_TRUE;
+}
+
+
 /**
  * Try to merge / concatenate the two most recent VBO primitives.
  */
@@ -779,8 +832,11 @@ static void GLAPIENTRY vbo_exec_End( void )
 
    ctx->Driver.CurrentExecPrimitive = PRIM_OUTSIDE_BEGIN_END;
 
-   if (exec->vtx.prim_count == VBO_MAX_PRIM)
+   if (exec->vtx.prim_count == exec->vtx.prim_max &&
+       !grow_prims(exec)) {
+      count_flush(exec, VBO_FLUSH_PRIM_FULL);
       vbo_exec_vtx_flush( exec, GL_FALSE );
+   }
 
    if (MESA_DEBUG_FLAGS & DEBUG_ALWAYS_FLUSH) {
       _mesa_flush(ctx);
@@ -986,7 +1042,7 @@ void vbo_use_buffer_objects(struct gl_context *ctx)
    GLuint bufName = IMM_BUFFER_NAME;
    GLenum target = GL_ARRAY_BUFFER_ARB;
    GLenum usage = GL_STREAM_DRAW_ARB;
-   GLsizei size = VBO_VERT_BUFFER_SIZE;
+   GLsizei size = exec->vtx.buffer_size;
 
    /* Make sure this func is only used once */
    assert(exec->vtx.bufferobj == ctx->Shared->NullBufferObj);
@@ -1022,6 +1078,23 @@ vbo_always_unmap_buffers(struct gl_context *ctx)
 }
 
 
+/**
+ * Return the immediate mode counters, eg. to find out why vertices are
+ * flushed.  They are also printed at context destruction if the
+ * MESA_VBO_STATS environment variable is set.
+ */
+void
+vbo_get_immediate_stats(struct gl_context *ctx,
+                        struct vbo_immediate_stats *stats)
+{
+   struct vbo_exec_context *exec = &vbo_context(ctx)->exec;
+
+   *stats = exec->stats;
+   stats->buffer_size = exec->vtx.buffer_size;
+   stats->prim_max = exec->vtx.prim_max;
+}
+
+
 void vbo_exec_vtx_init( struct vbo_exec_context *exec )
 {
    struct gl_context *ctx = exec->ctx;
@@ -1037,8 +1110,16 @@ void vbo_exec_vtx_init( struct vbo_exec_context *exec )
                                  ctx->Shared->NullBufferObj);
 
    ASSERT(!exec->vtx.buffer_map);
-   exec->vtx.buffer_map = _mesa_align_malloc(VBO_VERT_BUFFER_SIZE, 64);
+   exec->vtx.buffer_size = VBO_VERT_BUFFER_SIZE;
+   exec->vtx.buffer_map = _mesa_align_malloc(exec->vtx.buffer_size, 64);
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
+   exec->vtx.grow_buffer = GL_FALSE;
+
+   exec->vtx.prim = exec->vtx.prim_store;
+   exec->vtx.prim_max = VBO_MAX_PRIM;
+
+   memset(&exec->stats, 0, sizeof(exec->stats));
+   exec->print_stats = _mesa_getenv("MESA_VBO_STATS") != NULL;
 
    vbo_exec_vtxfmt_init( exec );
    _mesa_noop_vtxfmt_init(&exec->vtxfmt_noop);
@@ -1108,6 +1189,31 @@ void vbo_exec_vtx_destroy( struct vbo_exec_context *exec )
       }
    }
 
+   if (exec->print_stats) {
+      struct vbo_immediate_stats stats;
+
+      vbo_get_immediate_stats(ctx, &stats);
+      fprintf(stderr, "Mesa: immediate mode: %llu draws, %llu prims, "
+              "%llu vertices\n",
+              (unsigned long long) stats.draws,
+              (unsigned long long) stats.prims,
+              (unsigned long long) stats.vertices);
+      fprintf(stderr, "Mesa: immediate mode flushes: buffer full %llu, "
+              "prims full %llu, format %llu, begin %llu, state %llu\n",
+              (unsigned long long) stats.flushes[VBO_FLUSH_BUFFER_FULL],
+              (unsigned long long) stats.flushes[VBO_FLUSH_PRIM_FULL],
+              (unsigned long long) stats.flushes[VBO_FLUSH_FORMAT],
+              (unsigned long long) stats.flushes[VBO_FLUSH_BEGIN],
+              (unsigned long long) stats.flushes[VBO_FLUSH_STATE]);
+      fprintf(stderr, "Mesa: immediate mode buffer %u bytes, %u prims\n",
+              stats.buffer_size, stats.prim_max);
+   }
+
+   if (exec->vtx.prim != exec->vtx.prim_store) {
+      free(exec->vtx.prim);
+      exec->vtx.prim = exec->vtx.prim_store;
+   }
+
    /* Drop any outstanding reference to the vertex buffer
     */
    for (i = 0; i < Elements(exec->vtx.arrays); i++) {
@@ -1165,6 +1271,7 @@ void vbo_exec_FlushVertices( struct gl_context *ctx, GLuint flags )
    }
 
    /* Flush (draw), and make sure VBO is left unmapped when done */
+   count_flush(exec, VBO_FLUSH_STATE);
    vbo_exec_FlushVertices_internal(exec, GL_TRUE);
 
    /* Need to do this to ensure BeginVertices gets called again:
@@ -30,6 +30,7 @@
 #include "main/compiler.h"
 #include "main/context.h"
 #include "main/enums.h"
+#include "main/macros.h"
 #include "main/state.h"
 #include "main/vtxfmt.h"
 
@@ -276,7 +277,7 @@ vbo_exec_vtx_unmap( struct vbo_exec_context *exec )
       exec->vtx.buffer_used += (exec->vtx.buffer_ptr -
                                 exec->vtx.buffer_map) * sizeof(float);
 
-      assert(exec->vtx.buffer_used <= VBO_VERT_BUFFER_SIZE);
+      assert(exec->vtx.buffer_used <= exec->vtx.buffer_size);
       assert(exec->vtx.buffer_ptr != NULL);
       
       ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj, MAP_INTERNAL);
@@ -307,13 +308,13 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
    assert(!exec->vtx.buffer_map);
    assert(!exec->vtx.buffer_ptr);
 
-   if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
+   if (exec->vtx.buffer_size > exec->vtx.buffer_used + 1024) {
       /* The VBO exists and there's room for more */
       if (exec->vtx.bufferobj->Size > 0) {
          exec->vtx.buffer_map =
             (GLfloat *)ctx->Driver.MapBufferRange(ctx, 
                                                   exec->vtx.buffer_used,
-                                                  (VBO_VERT_BUFFER_SIZE - 
+                                                  (exec->vtx.buffer_size -
                                                    exec->vtx.buffer_used),
                                                   accessRange,
                                                   exec->vtx.bufferobj,
@@ -329,8 +330,15 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
       /* Need to allocate a new VBO */
       exec->vtx.buffer_used = 0;
 
+      /* The last one was too small to hold a primitive, try harder */
+      if (exec->vtx.grow_buffer) {
+         exec->vtx.buffer_size = MIN2(exec->vtx.buffer_size * 2,
+                                      VBO_VERT_BUFFER_MAX_SIZE);
+         exec->vtx.grow_buffer = GL_FALSE;
+      }
+
       if (ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB,
-                                 VBO_VERT_BUFFER_SIZE,
+                                 exec->vtx.buffer_size,
                                  NULL, usage,
                                  GL_MAP_WRITE_BIT |
                                  GL_DYNAMIC_STORAGE_BIT |
@@ -339,7 +347,7 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
          /* buffer allocation worked, now map the buffer */
          exec->vtx.buffer_map =
             (GLfloat *)ctx->Driver.MapBufferRange(ctx,
-                                                  0, VBO_VERT_BUFFER_SIZE,
+                                                  0, exec->vtx.buffer_size,
                                                   accessRange,
                                                   exec->vtx.bufferobj,
                                                   MAP_INTERNAL);
@@ -415,6 +423,10 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
 				       exec->vtx.vert_count - 1,
 				       NULL, NULL);
 
+         exec->stats.draws++;
+         exec->stats.prims += exec->vtx.prim_count;
+         exec->stats.vertices += exec->vtx.vert_count;
+
 	 /* If using a real VBO, get new storage -- unless asked not to.
           */
          if (_mesa_is_bufferobj(exec->vtx.bufferobj) && !keepUnmapped) {
@@ -434,7 +446,7 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
    if (keepUnmapped || exec->vtx.vertex_size == 0)
       exec->vtx.max_vert = 0;
    else
-      exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) / 
+      exec->vtx.max_vert = ((exec->vtx.buffer_size - exec->vtx.buffer_used) /
                             (exec->vtx.vertex_size * sizeof(GLfloat)));
 
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
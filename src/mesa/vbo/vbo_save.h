@@ -81,6 +81,14 @@ struct vbo_save_vertex_list {
    struct _mesa_prim *prim;
    GLuint prim_count;
 
+   /* Lists merged at glEndList (see vbo_save_merge_vertex_lists) hold
+    * deduplicated vertices and are drawn with indices.  Their prims are
+    * then malloc'd rather than in a prim_store.
+    */
+   struct gl_buffer_object *index_bufferobj;
+   GLenum index_type;
+   GLuint index_count;
+
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
 };
@@ -103,6 +111,9 @@ struct vbo_save_vertex_list {
 
 #define VBO_SAVE_FALLBACK    0x10000000
 
+/* Largest number of vertices merged into one list at glEndList */
+#define VBO_SAVE_MERGE_MAX_VERTS (1024*1024)
+
 /* Storage to be shared among several vertex_lists.
  */
 struct vbo_save_vertex_store {
@@ -171,7 +182,9 @@ void vbo_loopback_vertex_list( struct gl_context *ctx,
 			       const struct _mesa_prim *prim,
 			       GLuint prim_count,
 			       GLuint wrap_count,
-			       GLuint vertex_size);
+			       GLuint vertex_size,
+			       const void *indices,
+			       GLenum index_type);
 
 /* Callbacks:
  */
@@ -73,6 +73,7 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "main/dlist.h"
 #include "main/enums.h"
 #include "main/eval.h"
+#include "main/hash_table.h"
 #include "main/macros.h"
 #include "main/api_validate.h"
 #include "main/api_arrayelt.h"
@@ -394,6 +395,9 @@ _save_compile_vertex_list(struct gl_context *ctx)
    node->dangling_attr_ref = save->dangling_attr_ref;
    node->prim = save->prim;
    node->prim_count = save->prim_count;
+   node->index_bufferobj = NULL;
+   node->index_type = 0;
+   node->index_count = 0;
    node->vertex_store = save->vertex_store;
    node->prim_store = save->prim_store;
 
@@ -455,7 +459,8 @@ _save_compile_vertex_list(struct gl_context *ctx)
                                                   vertex_store->buffer +
                                                   node->buffer_offset),
                                node->attrsz, node->prim, node->prim_count,
-                               node->wrap_count, node->vertex_size);
+                               node->wrap_count, node->vertex_size,
+                               NULL, 0);
 
       _glapi_set_dispatch(dispatch);
    }
@@ -1516,8 +1521,16 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
    if (--node->vertex_store->refcount == 0)
       free_vertex_store(ctx, node->vertex_store);
 
-   if (--node->prim_store->refcount == 0)
-      free(node->prim_store);
+   if (node->prim_store) {
+      if (--node->prim_store->refcount == 0)
+         free(node->prim_store);
+   }
+   else {
+      free(node->prim);
+   }
+
+   if (node->index_bufferobj)
+      _mesa_reference_buffer_object(ctx, &node->index_bufferobj, NULL);
 
    free(node->current_data);
    node->current_data = NULL;
@@ -1534,6 +1547,10 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data)
    printf("VBO-VERTEX-LIST, %u vertices %d primitives, %d vertsize\n",
           node->count, node->prim_count, node->vertex_size);
 
+   if (node->index_bufferobj)
+      printf("   %u %s indices\n", node->index_count,
+             _mesa_lookup_enum_by_nr(node->index_type));
+
    for (i = 0; i < node->prim_count; i++) {
       struct _mesa_prim *prim = &node->prim[i];
       printf("   prim %d: %s%s %d..%d %s %s\n",
@@ -1548,6 +1565,347 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data)
 }
 
 
+/**
+ * Whether a vertex list is self-contained enough to be merged with others.
+ */
+static GLboolean
+can_merge_vertex_list(const struct vbo_save_vertex_list *node)
+{
+   GLuint i;
+
+   if (node->count == 0 ||
+       node->prim_count == 0 ||
+       node->wrap_count ||
+       node->dangling_attr_ref ||
+       node->index_bufferobj)
+      return GL_FALSE;
+
+   for (i = 0; i < node->prim_count; i++) {
+      const struct _mesa_prim *prim = &node->prim[i];
+
+      if (!prim->begin || !prim->end || prim->weak ||
+          prim->no_current_update)
+         return GL_FALSE;
+   }
+
+   for (i = 0; i < VBO_ATTRIB_MAX; i++) {
+      if (node->attrsz[i] && node->attrtype[i] != GL_FLOAT)
+         return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+
+/**
+ * Look for a vertex equal to the one at \p num_verts in \p verts, and
+ * return its index.  Otherwise add it to the hash table and return
+ * \p num_verts.  \p table holds vertex indices + 1, 0 for empty slots.
+ */
+static GLuint
+find_vertex(GLuint *table, GLuint table_mask, const GLfloat *verts,
+            GLuint vertex_size, GLuint num_verts)
+{
+   const GLfloat *vert = verts + num_verts * vertex_size;
+   const size_t size = vertex_size * sizeof(GLfloat);
+   GLuint slot = _mesa_hash_data(vert, size) & table_mask;
+
+   while (table[slot]) {
+      const GLuint i = table[slot] - 1;
+
+      if (memcmp(verts + i * vertex_size, vert, size) == 0)
+         return i;
+
+      slot = (slot + 1) & table_mask;
+   }
+
+   table[slot] = num_verts + 1;
+   return num_verts;
+}
+
+
+/**
+ * Create a buffer object holding \p size bytes of \p data.
+ */
+static struct gl_buffer_object *
+create_merged_buffer(struct gl_context *ctx, GLenum target,
+                     GLsizeiptr size, const void *data)
+{
+   struct gl_buffer_object *obj =
+      ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID, target);
+
+   if (obj && !ctx->Driver.BufferData(ctx, target, size, data,
+                                      GL_STATIC_DRAW_ARB, GL_MAP_READ_BIT,
+                                      obj)) {
+      _mesa_reference_buffer_object(ctx, &obj, NULL);
+   }
+
+   return obj;
+}
+
+
+/**
+ * Called by glEndList through _mesa_dlist_set_merge_func() with runs of
+ * vertex lists separated only by current attribute changes.
+ *
+ * The leading lists which can be merged are rewritten as a single list:
+ * attributes the lists took from the current values set in between are
+ * stored per vertex, identical vertices are stored once and the
+ * primitives are drawn with indices.  Adjacent independent primitives of
+ * the same type are then drawn at once by merge_prims().
+ */
+static GLuint
+vbo_save_merge_vertex_lists(struct gl_context *ctx,
+                            struct gl_list_merge_item *items, GLuint count)
+{
+   struct vbo_save_vertex_list *node =
+      (struct vbo_save_vertex_list *) items[0].data;
+   struct vbo_save_vertex_store *vertex_store = NULL;
+   struct gl_buffer_object *index_bufferobj = NULL;
+   struct vbo_save_vertex_store *mapped_store = NULL;
+   const char *mapped = NULL;
+   GLubyte attrsz[VBO_ATTRIB_MAX];
+   GLfloat current[VBO_ATTRIB_MAX][4];
+   GLfloat *verts = NULL, *current_data = NULL;
+   GLuint *indices = NULL, *table = NULL;
+   struct _mesa_prim *prims = NULL;
+   GLuint total_verts, total_prims, num_attribs, table_size;
+   GLuint vertex_size, current_size, num_verts, num_indices, num_prims;
+   GLuint index_size;
+   GLenum index_type;
+   GLuint n, i, j, k;
+
+   if (!can_merge_vertex_list(node))
+      return 0;
+
+   /* Find how many lists can be merged, and the attributes they need. */
+   memcpy(attrsz, node->attrsz, sizeof(attrsz));
+   for (j = 0; j < items[0].num_attribs; j++) {
+      const struct gl_list_attrib_value *a = &items[0].attribs[j];
+      attrsz[a->attr] = MAX2(attrsz[a->attr], a->size);
+   }
+   total_verts = node->count;
+   total_prims = node->prim_count;
+   num_attribs = items[0].num_attribs;
+
+   for (n = 1; n < count; n++) {
+      const struct vbo_save_vertex_list *next =
+         (const struct vbo_save_vertex_list *) items[n].data;
+
+      if (!can_merge_vertex_list(next) ||
+          total_verts + next->count > VBO_SAVE_MERGE_MAX_VERTS)
+         break;
+
+      /* The previous lists took the attributes they don't have from the
+       * current values, which aren't known until the list is called.
+       */
+      for (i = 0; i < VBO_ATTRIB_MAX; i++) {
+         if (next->attrsz[i] && !attrsz[i])
+            break;
+      }
+      if (i < VBO_ATTRIB_MAX)
+         break;
+
+      for (j = 0; j < items[n].num_attribs; j++) {
+         if (!attrsz[items[n].attribs[j].attr])
+            break;
+      }
+      if (j < items[n].num_attribs)
+         break;
+
+      for (i = 0; i < VBO_ATTRIB_MAX; i++)
+         attrsz[i] = MAX2(attrsz[i], next->attrsz[i]);
+      for (j = 0; j < items[n].num_attribs; j++) {
+         const struct gl_list_attrib_value *a = &items[n].attribs[j];
+         attrsz[a->attr] = MAX2(attrsz[a->attr], a->size);
+      }
+
+      total_verts += next->count;
+      total_prims += next->prim_count;
+      num_attribs += items[n].num_attribs;
+   }
+
+   /* A single list is only worth rewriting if attribute changes go away */
+   if (n == 1 && num_attribs == 0)
+      return 0;
+
+   vertex_size = 0;
+   for (i = 0; i < VBO_ATTRIB_MAX; i++)
+      vertex_size += attrsz[i];
+   current_size = vertex_size - attrsz[VBO_ATTRIB_POS];
+
+   table_size = 1;
+   while (table_size < 2 * total_verts)
+      table_size *= 2;
+
+   verts = malloc(total_verts * vertex_size * sizeof(GLfloat));
+   indices = malloc(total_verts * sizeof(GLuint));
+   prims = malloc(total_prims * sizeof(struct _mesa_prim));
+   table = calloc(table_size, sizeof(GLuint));
+   if (current_size)
+      current_data = malloc(current_size * sizeof(GLfloat));
+   if (!verts || !indices || !prims || !table ||
+       (current_size && !current_data))
+      goto fail;
+
+   /* Build the merged vertices, following the current values as the
+    * lists and attribute changes would set them when called.
+    */
+   num_verts = 0;
+   num_indices = 0;
+   num_prims = 0;
+
+   for (k = 0; k < n; k++) {
+      const struct vbo_save_vertex_list *src =
+         (const struct vbo_save_vertex_list *) items[k].data;
+      const GLfloat *data;
+      GLuint v;
+
+      for (j = 0; j < items[k].num_attribs; j++) {
+         const struct gl_list_attrib_value *a = &items[k].attribs[j];
+         COPY_4V(current[a->attr], a->value);
+      }
+
+      if (src->vertex_store != mapped_store) {
+         if (mapped_store)
+            ctx->Driver.UnmapBuffer(ctx, mapped_store->bufferobj,
+                                    MAP_INTERNAL);
+         mapped_store = src->vertex_store;
+         assert(!mapped_store->buffer);
+         mapped = ctx->Driver.MapBufferRange(ctx, 0,
+                                             mapped_store->bufferobj->Size,
+                                             GL_MAP_READ_BIT,
+                                             mapped_store->bufferobj,
+                                             MAP_INTERNAL);
+         if (!mapped) {
+            mapped_store = NULL;
+            goto fail;
+         }
+      }
+
+      for (j = 0; j < src->prim_count; j++) {
+         prims[num_prims] = src->prim[j];
+         prims[num_prims].start += num_indices;
+         prims[num_prims].indexed = 1;
+         num_prims++;
+      }
+
+      data = (const GLfloat *) (mapped + src->buffer_offset);
+      for (v = 0; v < src->count; v++) {
+         GLfloat *dst = verts + num_verts * vertex_size;
+
+         for (i = 0; i < VBO_ATTRIB_MAX; i++) {
+            if (src->attrsz[i]) {
+               COPY_CLEAN_4V(current[i], src->attrsz[i], data);
+               data += src->attrsz[i];
+            }
+            if (attrsz[i]) {
+               memcpy(dst, current[i], attrsz[i] * sizeof(GLfloat));
+               dst += attrsz[i];
+            }
+         }
+
+         indices[num_indices] = find_vertex(table, table_size - 1, verts,
+                                            vertex_size, num_verts);
+         if (indices[num_indices] == num_verts)
+            num_verts++;
+         num_indices++;
+      }
+   }
+
+   ctx->Driver.UnmapBuffer(ctx, mapped_store->bufferobj, MAP_INTERNAL);
+   mapped_store = NULL;
+
+   /* The values of the last vertex, for updating the current ones */
+   if (current_size) {
+      GLfloat *dst = current_data;
+
+      for (i = VBO_ATTRIB_POS + 1; i < VBO_ATTRIB_MAX; i++) {
+         memcpy(dst, current[i], attrsz[i] * sizeof(GLfloat));
+         dst += attrsz[i];
+      }
+   }
+
+   merge_prims(ctx, prims, &num_prims);
+
+   if (num_verts <= 0x10000) {
+      GLushort *short_indices = (GLushort *) indices;
+
+      for (i = 0; i < num_indices; i++)
+         short_indices[i] = (GLushort) indices[i];
+      index_type = GL_UNSIGNED_SHORT;
+      index_size = sizeof(GLushort);
+   }
+   else {
+      index_type = GL_UNSIGNED_INT;
+      index_size = sizeof(GLuint);
+   }
+
+   vertex_store = CALLOC_STRUCT(vbo_save_vertex_store);
+   if (!vertex_store)
+      goto fail;
+
+   vertex_store->bufferobj =
+      create_merged_buffer(ctx, GL_ARRAY_BUFFER_ARB,
+                           num_verts * vertex_size * sizeof(GLfloat), verts);
+   index_bufferobj =
+      create_merged_buffer(ctx, GL_ELEMENT_ARRAY_BUFFER_ARB,
+                           num_indices * index_size, indices);
+   if (!vertex_store->bufferobj || !index_bufferobj)
+      goto fail;
+
+   vertex_store->used = num_verts * vertex_size;
+   vertex_store->refcount = 1;
+
+   /* Replace the first list by the merged one.  The others are destroyed
+    * by the caller.
+    */
+   vbo_destroy_vertex_list(ctx, node);
+
+   memcpy(node->attrsz, attrsz, sizeof(node->attrsz));
+   for (i = 0; i < VBO_ATTRIB_MAX; i++)
+      node->attrtype[i] = GL_FLOAT;
+   node->vertex_size = vertex_size;
+   node->current_data = current_data;
+   node->current_size = current_size;
+   node->buffer_offset = 0;
+   node->count = num_verts;
+   node->wrap_count = 0;
+   node->dangling_attr_ref = GL_FALSE;
+   node->prim = realloc(prims, num_prims * sizeof(struct _mesa_prim));
+   if (!node->prim)
+      node->prim = prims;
+   node->prim_count = num_prims;
+   node->index_bufferobj = index_bufferobj;
+   node->index_type = index_type;
+   node->index_count = num_indices;
+   node->vertex_store = vertex_store;
+   node->prim_store = NULL;
+
+   free(verts);
+   free(indices);
+   free(table);
+   return n;
+
+fail:
+   if (mapped_store)
+      ctx->Driver.UnmapBuffer(ctx, mapped_store->bufferobj, MAP_INTERNAL);
+   if (vertex_store) {
+      if (vertex_store->bufferobj)
+         _mesa_reference_buffer_object(ctx, &vertex_store->bufferobj, NULL);
+      free(vertex_store);
+   }
+   if (index_bufferobj)
+      _mesa_reference_buffer_object(ctx, &index_bufferobj, NULL);
+   free(verts);
+   free(indices);
+   free(prims);
+   free(table);
+   free(current_data);
+   return 0;
+}
+
+
 /**
  * Called during context creation/init.
  */
@@ -1589,6 +1947,11 @@ vbo_save_api_init(struct vbo_save_context *save)
                                vbo_destroy_vertex_list,
                                vbo_print_vertex_list);
 
+   /* Merging the vertex lists at glEndList may be disabled for debugging */
+   if (!_mesa_getenv("MESA_NO_DLIST_MERGE"))
+      _mesa_dlist_set_merge_func(ctx, save->opcode_vertex_list,
+                                 vbo_save_merge_vertex_lists);
+
    ctx->Driver.NotifySaveBegin = vbo_save_NotifyBegin;
 
    _save_vtxfmt_init(ctx);
@@ -227,6 +227,15 @@ vbo_save_loopback_vertex_list(struct gl_context *ctx,
 				 GL_MAP_READ_BIT, /* ? */
 				 list->vertex_store->bufferobj,
                                  MAP_INTERNAL);
+   const void *indices = NULL;
+
+   if (list->index_bufferobj) {
+      indices = ctx->Driver.MapBufferRange(ctx, 0,
+                                           list->index_bufferobj->Size,
+                                           GL_MAP_READ_BIT,
+                                           list->index_bufferobj,
+                                           MAP_INTERNAL);
+   }
 
    vbo_loopback_vertex_list(ctx,
                             (const GLfloat *)(buffer + list->buffer_offset),
@@ -234,7 +243,13 @@ vbo_save_loopback_vertex_list(struct gl_context *ctx,
                             list->prim,
                             list->prim_count,
                             list->wrap_count,
-                            list->vertex_size);
+                            list->vertex_size,
+                            indices,
+                            list->index_type);
+
+   if (list->index_bufferobj) {
+      ctx->Driver.UnmapBuffer(ctx, list->index_bufferobj, MAP_INTERNAL);
+   }
 
    ctx->Driver.UnmapBuffer(ctx, list->vertex_store->bufferobj,
                            MAP_INTERNAL);
@@ -307,7 +322,30 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       if (ctx->NewState)
 	 _mesa_update_state( ctx );
 
-      if (node->count > 0) {
+      if (node->count > 0 && node->index_bufferobj) {
+         /* The indices are ours, the application's restart index doesn't
+          * apply to them.
+          */
+         const GLboolean restart = ctx->Array._PrimitiveRestart;
+         struct _mesa_index_buffer ib;
+
+         ib.count = node->index_count;
+         ib.type = node->index_type;
+         ib.obj = node->index_bufferobj;
+         ib.ptr = NULL;
+
+         ctx->Array._PrimitiveRestart = GL_FALSE;
+         vbo_context(ctx)->draw_prims(ctx,
+                                      node->prim,
+                                      node->prim_count,
+                                      &ib,
+                                      GL_TRUE,
+                                      0,
+                                      node->count - 1,
+                                      NULL, NULL);
+         ctx->Array._PrimitiveRestart = restart;
+      }
+      else if (node->count > 0) {
          vbo_context(ctx)->draw_prims(ctx, 
                                       node->prim,
                                       node->prim_count,
@@ -85,6 +85,8 @@ static void loopback_prim( struct gl_context *ctx,
 			   const struct _mesa_prim *prim,
 			   GLuint wrap_count,
 			   GLuint vertex_size,
+			   const void *indices,
+			   GLenum index_type,
 			   const struct loopback_attr *la, GLuint nr )
 {
    GLint start = prim->start;
@@ -112,7 +114,16 @@ static void loopback_prim( struct gl_context *ctx,
    data = buffer + start * vertex_size;
 
    for (j = start ; j < end ; j++) {
-      const GLfloat *tmp = data + la[0].sz;
+      const GLfloat *tmp;
+
+      if (indices) {
+         if (index_type == GL_UNSIGNED_SHORT)
+            data = buffer + ((const GLushort *) indices)[j] * vertex_size;
+         else
+            data = buffer + ((const GLuint *) indices)[j] * vertex_size;
+      }
+
+      tmp = data + la[0].sz;
 
       for (k = 1 ; k < nr ; k++) {
 	 la[k].func( ctx, la[k].target, tmp );
@@ -158,7 +169,9 @@ void vbo_loopback_vertex_list( struct gl_context *ctx,
 			       const struct _mesa_prim *prim,
 			       GLuint prim_count,
 			       GLuint wrap_count,
-			       GLuint vertex_size)
+			       GLuint vertex_size,
+			       const void *indices,
+			       GLenum index_type)
 {
    struct loopback_attr la[VBO_ATTRIB_MAX];
    GLuint i, nr = 0;
@@ -183,7 +196,8 @@ void vbo_loopback_vertex_list( struct gl_context *ctx,
       }
       else
       {
-	 loopback_prim( ctx, buffer, &prim[i], wrap_count, vertex_size, la, nr );
+	 loopback_prim( ctx, buffer, &prim[i], wrap_count, vertex_size,
+			indices, index_type, la, nr );
       }
    }
 }